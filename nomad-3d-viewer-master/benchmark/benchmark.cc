@@ -0,0 +1,879 @@
+#include <node.h>
+#include <node_buffer.h>
+#include <iostream>
+#include <thread>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <sstream>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <unistd.h>
+#include "stand-in.h"
+#include "timings.h"
+#include "positions-json.h"
+#include "property-dispatcher.h"
+#include "position-stream.h"
+#include "collision-forwarder.h"
+#include "collision-pipeline.h"
+#include "shared-ring.h"
+#include "broad-phase.h"
+
+using namespace std;
+
+namespace nomad {
+
+using v8::Function;
+using v8::FunctionCallbackInfo;
+using v8::Isolate;
+using v8::Context;
+using v8::Local;
+using v8::Object;
+using v8::String;
+using v8::Value;
+using v8::Number;
+using v8::Integer;
+using v8::Persistent;
+using v8::ArrayBuffer;
+using v8::Float64Array;
+using v8::HandleScope;
+
+typedef Timings::Clock Clock;
+
+/**
+ * Gets a number option of the options object or the default value.
+ */
+static double GetOption(Isolate * isolate, Local<Value> options, const char * name, double defaultValue) {
+
+	if (!options->IsObject()) {
+		return defaultValue;
+	}
+
+	Local<Context> context = isolate->GetCurrentContext();
+	Local<Value> value;
+
+	if (!Local<Object>::Cast(options)->Get(context, String::NewFromUtf8(isolate, name, v8::NewStringType::kNormal).ToLocalChecked()).ToLocal(&value) || !value->IsNumber()) {
+		return defaultValue;
+	}
+
+	return value->NumberValue(context).FromMaybe(defaultValue);
+}
+
+/**
+ * Gets a string option of the options object or the default value.
+ */
+static string GetStringOption(Isolate * isolate, Local<Value> options, const char * name, const string& defaultValue) {
+
+	if (!options->IsObject()) {
+		return defaultValue;
+	}
+
+	Local<Context> context = isolate->GetCurrentContext();
+	Local<Value> value;
+
+	if (!Local<Object>::Cast(options)->Get(context, String::NewFromUtf8(isolate, name, v8::NewStringType::kNormal).ToLocalChecked()).ToLocal(&value) || !value->IsString()) {
+		return defaultValue;
+	}
+
+	v8::String::Utf8Value text(isolate, value);
+	return string(*text);
+}
+
+static void SetMember(Isolate * isolate, Local<Object> object, const char * name, Local<Value> value) {
+	object->Set(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, name, v8::NewStringType::kNormal).ToLocalChecked(), value).FromJust();
+}
+
+static void SetMember(Isolate * isolate, Local<Object> object, const char * name, double value) {
+	SetMember(isolate, object, name, Number::New(isolate, value));
+}
+
+/**
+ * Converts the summary to {count, mean, min, p50, p90, p99, max} in us.
+ */
+static Local<Object> NewSummary(Isolate * isolate, const TimingSummary& summary) {
+
+	Local<Object> result = Object::New(isolate);
+	SetMember(isolate, result, "count", summary.count);
+	SetMember(isolate, result, "mean", summary.mean);
+	SetMember(isolate, result, "min", summary.min);
+	SetMember(isolate, result, "p50", summary.p50);
+	SetMember(isolate, result, "p90", summary.p90);
+	SetMember(isolate, result, "p99", summary.p99);
+	SetMember(isolate, result, "max", summary.max);
+
+	return result;
+}
+
+static StandInOptions GetStandInOptions(Isolate * isolate, Local<Value> options) {
+
+	StandInOptions standInOptions;
+	standInOptions.axisCount = GetOption(isolate, options, "axes", standInOptions.axisCount);
+	standInOptions.collisionCount = GetOption(isolate, options, "collisions", standInOptions.collisionCount);
+	standInOptions.latencyUs = GetOption(isolate, options, "latencyUs", standInOptions.latencyUs);
+
+	return standInOptions;
+}
+
+/**
+ * Makes the request as the addons send it for the request type.
+ */
+static void MakeRequest(const string& type, StandIn& standIn, string& request) {
+
+	if (type == "COLLISIONS") {
+		// Same message as the collision forwarder.
+		string positions;
+		standIn.respond("POSITIONS", positions);
+		request = "{\"type\":\"COLLISIONS\",\"positions\":" + positions + "}";
+	}
+	else if (type == "ADD_OBJECT") {
+		request = "{\"type\":\"ADD_OBJECT\",\"path\":\"/tmp/\",\"fileName\":\"object.stl\"}";
+	}
+	else if (type == "MOVE_OBJECT") {
+		request = "{\"type\":\"MOVE_OBJECT\",\"objectId\":1,\"xx\":1,\"xy\":0,\"xz\":0,\"yx\":0,\"yy\":1,\"yz\":0,\"zx\":0,\"zy\":0,\"zz\":1,\"x\":0.5,\"y\":0.25,\"z\":0}";
+	}
+	else {
+		request = type;
+	}
+}
+
+/**
+ * Measures the round trip of a request to the stand-in servers.
+ * Options: {request, axes, collisions, latencyUs, iterations} where request is "POSITIONS", "PAUSE", "RESTART",
+ * "COLLISIONS", "ADD_OBJECT" or "MOVE_OBJECT".
+ * Returns {request, requestBytes, responseBytes, latency} with the latency summary in us.
+ */
+void RoundTrip(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+
+	string type = GetStringOption(isolate, args[0], "request", "POSITIONS");
+	int iterations = GetOption(isolate, args[0], "iterations", 10000);
+
+	StandIn standIn;
+	standIn.start(GetStandInOptions(isolate, args[0]));
+
+	string request;
+	string response;
+	MakeRequest(type, standIn, request);
+
+	Timings timings;
+	timings.reserve(iterations);
+
+	for (int i = 0; i < iterations; ++i) {
+		Clock::time_point start = Clock::now();
+		standIn.request(request, response);
+		timings.add(start, Clock::now());
+	}
+
+	standIn.stop();
+
+	Local<Object> result = Object::New(isolate);
+	SetMember(isolate, result, "request", String::NewFromUtf8(isolate, type.c_str(), v8::NewStringType::kNormal).ToLocalChecked());
+	SetMember(isolate, result, "requestBytes", request.size());
+	SetMember(isolate, result, "responseBytes", response.size());
+	SetMember(isolate, result, "latency", NewSummary(isolate, timings.summary()));
+
+	args.GetReturnValue().Set(result);
+}
+
+/**
+ * Measures the cost of the positions JSON.
+ * Options: {axes, iterations}.
+ * Returns {bytes, encode, decode, decodeValues} where decode builds the axis table and decodeValues is the
+ * fast path of an unchanged table.
+ */
+void Json(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+
+	int iterations = GetOption(isolate, args[0], "iterations", 10000);
+
+	StandIn standIn;
+	StandInOptions options = GetStandInOptions(isolate, args[0]);
+	standIn.start(options);
+	standIn.stop();
+
+	vector<double> values(options.axisCount);
+	for (size_t i = 0; i < values.size(); ++i) {
+		values[i] = 1000.0 * i + 0.123456789;
+	}
+
+	string json;
+	vector<string> names;
+	vector<double> decoded;
+
+	Timings encode;
+	Timings decode;
+	Timings decodeValues;
+
+	encode.reserve(iterations);
+	decode.reserve(iterations);
+	decodeValues.reserve(iterations);
+
+	for (int i = 0; i < iterations; ++i) {
+
+		values[0] = i;
+
+		Clock::time_point start = Clock::now();
+		formatPositions(standIn.axisNames(), values.data(), json);
+		Clock::time_point encoded = Clock::now();
+
+		names.clear();
+		decoded.clear();
+		parsePositions(json, names, decoded);
+		Clock::time_point parsed = Clock::now();
+
+		parsePositionValues(json, names, decoded);
+		Clock::time_point parsedValues = Clock::now();
+
+		encode.add(start, encoded);
+		decode.add(encoded, parsed);
+		decodeValues.add(parsed, parsedValues);
+	}
+
+	Local<Object> result = Object::New(isolate);
+	SetMember(isolate, result, "bytes", json.size());
+	SetMember(isolate, result, "encode", NewSummary(isolate, encode.summary()));
+	SetMember(isolate, result, "decode", NewSummary(isolate, decode.summary()));
+	SetMember(isolate, result, "decodeValues", NewSummary(isolate, decodeValues.summary()));
+
+	args.GetReturnValue().Set(result);
+}
+
+/**
+ * Value of a property change posted to the dispatcher.
+ */
+struct BenchmarkValue : PropertyDispatcher::Value {
+	double value;
+
+	BenchmarkValue(double value) : value(value) {}
+};
+
+/**
+ * Subscription converting the value to JS and calling the callback if any, as the cameo-nomad addon does.
+ */
+struct BenchmarkSubscription : PropertyDispatcher::Subscription {
+	Isolate * isolate;
+	Local<Function> callback;
+	double sum;
+
+	BenchmarkSubscription(Isolate * isolate, Local<Function> callback) : isolate(isolate), callback(callback), sum(0.0) {}
+
+	void deliver(PropertyDispatcher::Value * value) {
+
+		Local<Value> argv[1] = {Number::New(isolate, static_cast<BenchmarkValue *>(value)->value)};
+
+		if (!callback.IsEmpty()) {
+			callback->Call(isolate->GetCurrentContext(), isolate->GetCurrentContext()->Global(), 1, argv).IsEmpty();
+		}
+		else {
+			sum += argv[0]->NumberValue(isolate->GetCurrentContext()).FromJust();
+		}
+	}
+};
+
+/**
+ * Measures the throughput of the property change dispatch from the Nomad threads to the JS thread.
+ * Options: {properties, producers, changes}. The optional callback is called with each delivered value.
+ * Returns {changes, delivered, coalesced, batches, seconds, changesPerSecond, deliveredPerSecond, batch}
+ * where batch is the summary of the dispatch durations in us.
+ */
+void Dispatch(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+
+	int propertyCount = GetOption(isolate, args[0], "properties", 100);
+	int producerCount = GetOption(isolate, args[0], "producers", 2);
+	uint64_t changeCount = GetOption(isolate, args[0], "changes", 1000000);
+
+	Local<Function> callback;
+	if (args[1]->IsFunction()) {
+		callback = Local<Function>::Cast(args[1]);
+	}
+
+	PropertyDispatcher dispatcher;
+	vector<unique_ptr<BenchmarkSubscription> > subscriptions;
+	for (int i = 0; i < propertyCount; ++i) {
+		subscriptions.push_back(unique_ptr<BenchmarkSubscription>(new BenchmarkSubscription(isolate, callback)));
+	}
+
+	PropertySource source;
+	Timings batches;
+
+	Clock::time_point start = Clock::now();
+
+	source.start(propertyCount, producerCount, changeCount, [&](int property, double value) {
+		dispatcher.post(subscriptions[property].get(), new BenchmarkValue(value));
+	});
+
+	// The JS thread drains the changes as the async callback of the addon does.
+	while (true) {
+		bool done = source.done();
+
+		HandleScope handleScope(isolate);
+		Clock::time_point batchStart = Clock::now();
+
+		if (dispatcher.dispatch() > 0) {
+			batches.add(batchStart, Clock::now());
+		}
+		else if (done) {
+			break;
+		}
+		else {
+			this_thread::yield();
+		}
+	}
+
+	double seconds = chrono::duration<double>(Clock::now() - start).count();
+
+	source.join();
+
+	PropertyDispatcher::Stats stats = dispatcher.stats();
+
+	Local<Object> result = Object::New(isolate);
+	SetMember(isolate, result, "changes", stats.queued);
+	SetMember(isolate, result, "delivered", stats.delivered);
+	SetMember(isolate, result, "coalesced", stats.coalesced);
+	SetMember(isolate, result, "batches", stats.batches);
+	SetMember(isolate, result, "seconds", seconds);
+	SetMember(isolate, result, "changesPerSecond", stats.queued / seconds);
+	SetMember(isolate, result, "deliveredPerSecond", stats.delivered / seconds);
+	SetMember(isolate, result, "batch", NewSummary(isolate, batches.summary()));
+
+	args.GetReturnValue().Set(result);
+}
+
+/**
+ * Measures the conversion of the positions to JS values.
+ * Options: {axes, iterations}.
+ * Returns {string, float64Array, object}: the JSON string as returned by getPositions, a Float64Array copy of
+ * the values and an object with a number member per axis.
+ */
+void Conversion(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+	Local<Context> context = isolate->GetCurrentContext();
+
+	int iterations = GetOption(isolate, args[0], "iterations", 10000);
+
+	StandIn standIn;
+	StandInOptions options = GetStandInOptions(isolate, args[0]);
+	standIn.start(options);
+	standIn.stop();
+
+	string json;
+	standIn.respond("POSITIONS", json);
+
+	vector<string> names;
+	vector<double> values;
+	parsePositions(json, names, values);
+
+	Timings stringTimings;
+	Timings arrayTimings;
+	Timings objectTimings;
+
+	stringTimings.reserve(iterations);
+	arrayTimings.reserve(iterations);
+	objectTimings.reserve(iterations);
+
+	for (int i = 0; i < iterations; ++i) {
+
+		HandleScope handleScope(isolate);
+
+		Clock::time_point start = Clock::now();
+		String::NewFromUtf8(isolate, json.c_str(), v8::NewStringType::kNormal).ToLocalChecked();
+		Clock::time_point converted = Clock::now();
+		stringTimings.add(start, converted);
+
+		start = Clock::now();
+		Local<ArrayBuffer> buffer = ArrayBuffer::New(isolate, values.size() * sizeof(double));
+		memcpy(buffer->GetContents().Data(), values.data(), values.size() * sizeof(double));
+		Float64Array::New(buffer, 0, values.size());
+		converted = Clock::now();
+		arrayTimings.add(start, converted);
+
+		start = Clock::now();
+		Local<Object> object = Object::New(isolate);
+		for (size_t j = 0; j < names.size(); ++j) {
+			object->Set(context, String::NewFromUtf8(isolate, names[j].c_str(), v8::NewStringType::kNormal).ToLocalChecked(), Number::New(isolate, values[j])).FromJust();
+		}
+		converted = Clock::now();
+		objectTimings.add(start, converted);
+	}
+
+	Local<Object> result = Object::New(isolate);
+	SetMember(isolate, result, "string", NewSummary(isolate, stringTimings.summary()));
+	SetMember(isolate, result, "float64Array", NewSummary(isolate, arrayTimings.summary()));
+	SetMember(isolate, result, "object", NewSummary(isolate, objectTimings.summary()));
+
+	args.GetReturnValue().Set(result);
+}
+
+/**
+ * Runs the position stream and the collision forwarder of the positions addon against the stand-in servers.
+ * Options: {axes, collisions, latencyUs, periodMs, durationMs}.
+ * Returns {snapshots, verdicts, age, verdictLatency}: age is the time in us between the decoding of a snapshot and
+ * its reading by the polling thread, verdictLatency is the collision round trip in us.
+ */
+void Stream(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+
+	int periodMs = GetOption(isolate, args[0], "periodMs", 20);
+	int durationMs = GetOption(isolate, args[0], "durationMs", 2000);
+
+	StandInOptions options = GetStandInOptions(isolate, args[0]);
+
+	StandIn positionsServer;
+	StandIn collisionsServer;
+	positionsServer.start(options);
+	collisionsServer.start(options);
+
+	PositionStream stream;
+	CollisionForwarder forwarder;
+
+	forwarder.start([&](const string& request, string& response) {
+		collisionsServer.request(request, response);
+	});
+	stream.setListener([&](const PositionSnapshot& snapshot) {
+		forwarder.submit(snapshot);
+	});
+	stream.start(periodMs, [&](string& response) {
+		positionsServer.request("POSITIONS", response);
+		return true;
+	});
+
+	Timings age;
+	Timings verdictLatency;
+	uint64_t snapshots = 0;
+	uint64_t verdicts = 0;
+
+	// The JS thread polls the newest snapshot and verdict at every frame.
+	Clock::time_point end = Clock::now() + chrono::milliseconds(durationMs);
+	while (Clock::now() < end) {
+
+		if (stream.update()) {
+			age.add(stream.snapshot().time, Clock::now());
+			++snapshots;
+		}
+		if (forwarder.update()) {
+			verdictLatency.add(forwarder.verdict().latencyMs * 1000.0);
+			++verdicts;
+		}
+
+		this_thread::sleep_for(chrono::milliseconds(1));
+	}
+
+	stream.stop();
+	forwarder.stop();
+	positionsServer.stop();
+	collisionsServer.stop();
+
+	Local<Object> result = Object::New(isolate);
+	SetMember(isolate, result, "snapshots", snapshots);
+	SetMember(isolate, result, "verdicts", verdicts);
+	SetMember(isolate, result, "age", NewSummary(isolate, age.summary()));
+	SetMember(isolate, result, "verdictLatency", NewSummary(isolate, verdictLatency.summary()));
+
+	args.GetReturnValue().Set(result);
+}
+
+/**
+ * Runs the collision pipeline of the collision addon against stand-in servers, one per worker.
+ * Options: {depth, axes, collisions, latencyUs, submitPeriodUs, durationMs}.
+ * Returns {submitted, sent, dropped, stale, verdicts, verdictLatency} with the verdict latency in us from the submission.
+ */
+void Pipeline(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+
+	int depth = GetOption(isolate, args[0], "depth", 2);
+	int submitPeriodUs = GetOption(isolate, args[0], "submitPeriodUs", 1000);
+	int durationMs = GetOption(isolate, args[0], "durationMs", 2000);
+
+	StandInOptions options = GetStandInOptions(isolate, args[0]);
+
+	vector<unique_ptr<StandIn> > servers;
+	CollisionPipeline pipeline;
+
+	pipeline.start(depth, [&]() {
+		servers.push_back(unique_ptr<StandIn>(new StandIn()));
+		StandIn * server = servers.back().get();
+		server->start(options);
+
+		return CollisionPipeline::RequestFunction([server](const string& request, string& response) {
+			server->request(request, response);
+		});
+	});
+
+	string request;
+	MakeRequest("COLLISIONS", *servers.front(), request);
+
+	Timings verdictLatency;
+	PipelineVerdict verdict;
+
+	Clock::time_point end = Clock::now() + chrono::milliseconds(durationMs);
+	Clock::time_point next = Clock::now();
+
+	while (Clock::now() < end) {
+
+		if (Clock::now() >= next) {
+			pipeline.submit(request);
+			next += chrono::microseconds(submitPeriodUs);
+		}
+
+		if (pipeline.takeVerdict(verdict)) {
+			verdictLatency.add(verdict.latencyMs * 1000.0);
+		}
+
+		this_thread::sleep_for(chrono::microseconds(100));
+	}
+
+	pipeline.stop();
+	servers.clear();
+
+	PipelineStats stats = pipeline.stats();
+
+	Local<Object> result = Object::New(isolate);
+	SetMember(isolate, result, "submitted", stats.submitted);
+	SetMember(isolate, result, "sent", stats.sent);
+	SetMember(isolate, result, "dropped", stats.dropped);
+	SetMember(isolate, result, "stale", stats.stale);
+	SetMember(isolate, result, "verdictLatency", NewSummary(isolate, verdictLatency.summary()));
+
+	args.GetReturnValue().Set(result);
+}
+
+/**
+ * The init function declares what we will make visible to node.
+ */
+/**
+ * Runs the position stream and the collision forwarder over shared memory rings. The stand-in servers publish the
+ * positions and the verdicts from their own threads as the co-located servers would do from their processes.
+ * Options: {axes, collisions, periodMs, durationMs}.
+ * Returns {snapshots, verdicts, skipped, transport, age, verdictLatency}: transport is the time in us between the
+ * publication and the reading of the positions, skipped the number of positions overwritten before being read.
+ */
+void SharedMemory(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+
+	int periodMs = GetOption(isolate, args[0], "periodMs", 20);
+	int durationMs = GetOption(isolate, args[0], "durationMs", 2000);
+
+	StandInOptions options = GetStandInOptions(isolate, args[0]);
+
+	string prefix = "/n3dbenchmark-" + to_string(getpid());
+
+	SharedRingWriter positionsWriter;
+	SharedRingWriter collisionPositionsWriter;
+	SharedRingWriter verdictsWriter;
+	positionsWriter.create(prefix + "-positions", 4, 256 * 1024);
+	verdictsWriter.create(prefix + "-verdicts", 4, 256 * 1024);
+
+	SharedRingReader positionsReader;
+	SharedRingReader verdictsReader;
+	positionsReader.open(prefix + "-positions");
+	verdictsReader.open(prefix + "-verdicts");
+
+	collisionPositionsWriter.create(prefix + "-collision-positions", 4, 256 * 1024);
+
+	// Only the responses of the stand-ins are used, the latency is the one of the shared memory.
+	options.latencyUs = 0;
+
+	StandIn positionsServer;
+	StandIn collisionsServer;
+	positionsServer.start(options);
+	collisionsServer.start(options);
+	atomic<bool> running(true);
+
+	// The positions server publishes at the period, the collision server answers each positions frame.
+	thread positionsThread([&]() {
+		Clock::time_point next = Clock::now();
+		string positions;
+		while (running) {
+			positionsServer.respond("POSITIONS", positions);
+			positionsWriter.publish(positions);
+			next += chrono::milliseconds(periodMs);
+			this_thread::sleep_until(next);
+		}
+	});
+
+	thread collisionsThread([&]() {
+		SharedRingReader requests;
+		requests.open(prefix + "-collision-positions");
+		string request;
+		string response;
+		while (running) {
+			if (requests.next(request, Clock::now() + chrono::milliseconds(100))) {
+				collisionsServer.respond(request, response);
+				verdictsWriter.publish(response, requests.frame());
+			}
+		}
+	});
+
+	PositionStream stream;
+	CollisionForwarder forwarder;
+	Timings transport;
+
+	forwarder.start([&](const string& request, string& response) {
+		verdictsReader.read(response);
+		collisionPositionsWriter.publish(request);
+		Clock::time_point deadline = Clock::now() + chrono::seconds(1);
+		while (verdictsReader.next(response, deadline) && verdictsReader.request() != collisionPositionsWriter.published()) {
+		}
+	});
+	stream.setListener([&](const PositionSnapshot& snapshot) {
+		forwarder.submit(snapshot);
+	});
+	stream.setWait([&](Clock::time_point deadline) {
+		positionsReader.wait(deadline);
+		return true;
+	});
+	stream.start(periodMs, [&](string& response) {
+		if (!positionsReader.read(response)) {
+			return false;
+		}
+		transport.add(positionsReader.latencyNs() / 1000.0);
+		return true;
+	});
+
+	Timings age;
+	Timings verdictLatency;
+	uint64_t snapshots = 0;
+	uint64_t verdicts = 0;
+
+	Clock::time_point end = Clock::now() + chrono::milliseconds(durationMs);
+	while (Clock::now() < end) {
+
+		if (stream.update()) {
+			age.add(stream.snapshot().time, Clock::now());
+			++snapshots;
+		}
+		if (forwarder.update()) {
+			verdictLatency.add(forwarder.verdict().latencyMs * 1000.0);
+			++verdicts;
+		}
+
+		this_thread::sleep_for(chrono::milliseconds(1));
+	}
+
+	stream.stop();
+	forwarder.stop();
+	running = false;
+	positionsThread.join();
+	collisionsThread.join();
+	positionsServer.stop();
+	collisionsServer.stop();
+
+	Local<Object> result = Object::New(isolate);
+	SetMember(isolate, result, "snapshots", snapshots);
+	SetMember(isolate, result, "verdicts", verdicts);
+	SetMember(isolate, result, "skipped", positionsReader.skipped());
+	SetMember(isolate, result, "transport", NewSummary(isolate, transport.summary()));
+	SetMember(isolate, result, "age", NewSummary(isolate, age.summary()));
+	SetMember(isolate, result, "verdictLatency", NewSummary(isolate, verdictLatency.summary()));
+
+	args.GetReturnValue().Set(result);
+}
+
+/**
+ * Computes the world box of a local box by transforming its eight corners, independently of the broad phase.
+ */
+static Aabb CornersBox(const double* local, const double* matrix) {
+
+	Aabb world;
+	for (int i = 0; i < 3; ++i) {
+		world.min[i] = INFINITY;
+		world.max[i] = -INFINITY;
+	}
+
+	for (int corner = 0; corner < 8; ++corner) {
+
+		double point[3];
+		for (int j = 0; j < 3; ++j) {
+			point[j] = local[((corner >> j) & 1) ? 3 + j : j];
+		}
+
+		for (int i = 0; i < 3; ++i) {
+			double value = matrix[12 + i] + matrix[i] * point[0] + matrix[4 + i] * point[1] + matrix[8 + i] * point[2];
+			world.min[i] = min(world.min[i], value);
+			world.max[i] = max(world.max[i], value);
+		}
+	}
+
+	return world;
+}
+
+/**
+ * Runs the broad phase on bodies moving along a row and checks its pairs against a brute force test of all the pairs.
+ * A collision request is sent to the stand-in server only when the broad phase finds a candidate pair, as the viewer does.
+ * Options: {bodies, groupSize, margin, steps, axes, collisions}. One body out of four is static.
+ * Returns {bodies, updates, forwarded, skipped, missed, extra, update, bruteForce, request}: missed is the number of
+ * pairs found by the brute force only, that would be lost collisions, extra the number found by the broad phase only.
+ */
+void BroadPhaseCheck(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+
+	int count = GetOption(isolate, args[0], "bodies", 32);
+	int groupSize = GetOption(isolate, args[0], "groupSize", 3);
+	double margin = GetOption(isolate, args[0], "margin", 0.04);
+	int steps = GetOption(isolate, args[0], "steps", 1000);
+
+	StandInOptions options = GetStandInOptions(isolate, args[0]);
+	options.latencyUs = 0;
+
+	StandIn standIn;
+	standIn.start(options);
+
+	string request;
+	string response;
+	MakeRequest("COLLISIONS", standIn, request);
+
+	// Cubes of 0.8 spaced by 1 along x: the moving ones oscillate enough to touch their neighbours part of the time.
+	vector<double> localBoxes(6 * count);
+	vector<int32_t> groups(count);
+
+	for (int i = 0; i < count; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			localBoxes[6 * i + j] = -0.4;
+			localBoxes[6 * i + 3 + j] = 0.4;
+		}
+		groups[i] = (i % 4 == 0) ? 0 : 1 + i / max(groupSize, 1);
+	}
+
+	BroadPhase broadPhase;
+	broadPhase.setBodies(localBoxes.data(), groups.data(), count);
+
+	vector<double> matrices(16 * count, 0.0);
+	vector<Aabb> worldBoxes(count);
+	vector<pair<int32_t, int32_t> > expected;
+	vector<pair<int32_t, int32_t> > found;
+
+	Timings update;
+	Timings bruteForce;
+	Timings requestLatency;
+	uint64_t forwarded = 0;
+	uint64_t skipped = 0;
+	uint64_t missed = 0;
+	uint64_t extra = 0;
+
+	for (int step = 0; step < steps; ++step) {
+
+		for (int i = 0; i < count; ++i) {
+
+			double* matrix = &matrices[16 * i];
+			double angle = 0.0;
+			double offset = 0.0;
+
+			if (groups[i] != 0) {
+				double phase = 0.05 * step + 0.7 * i;
+				angle = 0.15 * sin(phase);
+				offset = 0.1 * cos(1.3 * phase);
+			}
+
+			// Rotation around z then translation, column-major.
+			matrix[0] = cos(angle);
+			matrix[1] = sin(angle);
+			matrix[4] = -sin(angle);
+			matrix[5] = cos(angle);
+			matrix[10] = 1.0;
+			matrix[12] = i + offset;
+			matrix[15] = 1.0;
+		}
+
+		Clock::time_point start = Clock::now();
+		size_t pairs = broadPhase.update(matrices.data(), margin);
+		update.add(start, Clock::now());
+
+		start = Clock::now();
+		expected.clear();
+
+		for (int i = 0; i < count; ++i) {
+			worldBoxes[i] = CornersBox(&localBoxes[6 * i], &matrices[16 * i]).expanded(0.5 * margin);
+		}
+
+		for (int i = 0; i < count; ++i) {
+			for (int j = i + 1; j < count; ++j) {
+				if (groups[i] == groups[j]) {
+					continue;
+				}
+				if (worldBoxes[i].overlaps(worldBoxes[j])) {
+					expected.push_back(make_pair(i, j));
+				}
+			}
+		}
+
+		bruteForce.add(start, Clock::now());
+
+		found.clear();
+		const vector<int32_t>& bodies = broadPhase.pairs();
+		for (size_t k = 0; k < pairs; ++k) {
+			found.push_back(make_pair(min(bodies[2 * k], bodies[2 * k + 1]), max(bodies[2 * k], bodies[2 * k + 1])));
+		}
+
+		sort(expected.begin(), expected.end());
+		sort(found.begin(), found.end());
+
+		size_t e = 0;
+		size_t f = 0;
+		while (e < expected.size() || f < found.size()) {
+			if (f == found.size() || (e < expected.size() && expected[e] < found[f])) {
+				++missed;
+				++e;
+			}
+			else if (e == expected.size() || found[f] < expected[e]) {
+				++extra;
+				++f;
+			}
+			else {
+				++e;
+				++f;
+			}
+		}
+
+		if (pairs != 0) {
+			start = Clock::now();
+			standIn.request(request, response);
+			requestLatency.add(start, Clock::now());
+			++forwarded;
+		}
+		else {
+			++skipped;
+		}
+	}
+
+	standIn.stop();
+
+	Local<Object> result = Object::New(isolate);
+	SetMember(isolate, result, "bodies", count);
+	SetMember(isolate, result, "updates", steps);
+	SetMember(isolate, result, "forwarded", forwarded);
+	SetMember(isolate, result, "skipped", skipped);
+	SetMember(isolate, result, "missed", missed);
+	SetMember(isolate, result, "extra", extra);
+	SetMember(isolate, result, "update", NewSummary(isolate, update.summary()));
+	SetMember(isolate, result, "bruteForce", NewSummary(isolate, bruteForce.summary()));
+	SetMember(isolate, result, "request", NewSummary(isolate, requestLatency.summary()));
+
+	args.GetReturnValue().Set(result);
+}
+
+void init(Local<Object> exports) {
+
+	// Register the functions.
+	NODE_SET_METHOD(exports, "roundTrip", RoundTrip);
+	NODE_SET_METHOD(exports, "json", Json);
+	NODE_SET_METHOD(exports, "dispatch", Dispatch);
+	NODE_SET_METHOD(exports, "conversion", Conversion);
+	NODE_SET_METHOD(exports, "stream", Stream);
+	NODE_SET_METHOD(exports, "pipeline", Pipeline);
+	NODE_SET_METHOD(exports, "sharedMemory", SharedMemory);
+	NODE_SET_METHOD(exports, "broadPhase", BroadPhaseCheck);
+}
+
+NODE_MODULE(benchmarkAddon, init)
+
+}
@@ -0,0 +1,180 @@
+/**
+ * Runs the native benchmarks against the in-process stand-in servers and writes the results as JSON.
+ *
+ * node benchmark/run-benchmark.js [-output benchmark-results.json] [-baseline baseline.json] [-threshold 0.2] [-quick] [-addon path]
+ *
+ * With a baseline, the times that increased or the rates that decreased by more than the threshold are reported
+ * as regressions and the exit code is 1.
+ */
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+
+let outputPath = 'benchmark-results.json';
+let baselinePath = null;
+let threshold = 0.2;
+let quick = false;
+let addonPath = path.join(__dirname, '../build/Release/addonnomad3dbenchmark');
+
+let i = 2;
+while (i < process.argv.length) {
+	if (process.argv[i] === '-output') {
+		outputPath = process.argv[i + 1];
+		i++;
+	} else if (process.argv[i] === '-baseline') {
+		baselinePath = process.argv[i + 1];
+		i++;
+	} else if (process.argv[i] === '-threshold') {
+		threshold = parseFloat(process.argv[i + 1]);
+		i++;
+	} else if (process.argv[i] === '-addon') {
+		addonPath = path.resolve(process.argv[i + 1]);
+		i++;
+	} else if (process.argv[i] === '-quick') {
+		quick = true;
+	}
+	i++;
+}
+
+const Benchmark = require(addonPath);
+
+const iterations = quick ? 1000 : 20000;
+const durationMs = quick ? 500 : 3000;
+const changes = quick ? 100000 : 2000000;
+
+/**
+ * Measures JSON.parse of the positions string returned by getPositions.
+ */
+function parsePositions(axes) {
+	let positions = {};
+	for (let i = 0; i < axes; i++) {
+		positions["axis" + i] = i + 0.001;
+	}
+	let json = JSON.stringify(positions);
+	let samples = [];
+
+	for (let i = 0; i < iterations; i++) {
+		let start = process.hrtime.bigint();
+		JSON.parse(json);
+		samples.push(Number(process.hrtime.bigint() - start) / 1000);
+	}
+
+	samples.sort((a, b) => a - b);
+
+	let sum = samples.reduce((a, b) => a + b, 0);
+	let percentile = (fraction) => samples[Math.round(fraction * (samples.length - 1))];
+
+	return {
+		count: samples.length,
+		mean: sum / samples.length,
+		min: samples[0],
+		p50: percentile(0.5),
+		p90: percentile(0.9),
+		p99: percentile(0.99),
+		max: samples[samples.length - 1]
+	};
+}
+
+const suites = [
+	["roundTrip.positions.32", () => Benchmark.roundTrip({request: "POSITIONS", axes: 32, iterations})],
+	["roundTrip.positions.256", () => Benchmark.roundTrip({request: "POSITIONS", axes: 256, iterations})],
+	["roundTrip.pause", () => Benchmark.roundTrip({request: "PAUSE", iterations})],
+	["roundTrip.restart", () => Benchmark.roundTrip({request: "RESTART", iterations})],
+	["roundTrip.collisions.ok", () => Benchmark.roundTrip({request: "COLLISIONS", axes: 32, collisions: 0, iterations})],
+	["roundTrip.collisions.colliding", () => Benchmark.roundTrip({request: "COLLISIONS", axes: 32, collisions: 20, iterations})],
+	["roundTrip.addObject", () => Benchmark.roundTrip({request: "ADD_OBJECT", iterations})],
+	["roundTrip.moveObject", () => Benchmark.roundTrip({request: "MOVE_OBJECT", iterations})],
+	["json.32", () => Benchmark.json({axes: 32, iterations})],
+	["json.256", () => Benchmark.json({axes: 256, iterations})],
+	["jsonParse.32", () => parsePositions(32)],
+	["jsonParse.256", () => parsePositions(256)],
+	["conversion.32", () => Benchmark.conversion({axes: 32, iterations})],
+	["conversion.256", () => Benchmark.conversion({axes: 256, iterations})],
+	["dispatch.native", () => Benchmark.dispatch({properties: 100, producers: 2, changes})],
+	["dispatch.callback", () => Benchmark.dispatch({properties: 100, producers: 2, changes}, (value) => {})],
+	["dispatch.contended", () => Benchmark.dispatch({properties: 1000, producers: 8, changes})],
+	["stream", () => Benchmark.stream({axes: 64, collisions: 2, latencyUs: 2000, periodMs: 20, durationMs})],
+	["sharedMemory", () => Benchmark.sharedMemory({axes: 64, collisions: 2, periodMs: 20, durationMs})],
+	["pipeline.1", () => Benchmark.pipeline({depth: 1, axes: 64, latencyUs: 5000, submitPeriodUs: 2000, durationMs})],
+	["pipeline.2", () => Benchmark.pipeline({depth: 2, axes: 64, latencyUs: 5000, submitPeriodUs: 2000, durationMs})],
+	["broadPhase.32", () => Benchmark.broadPhase({bodies: 32, axes: 64, steps: iterations / 10})],
+	["broadPhase.256", () => Benchmark.broadPhase({bodies: 256, axes: 64, steps: iterations / 10})]
+];
+
+let results = {};
+
+for (let i = 0; i < suites.length; i++) {
+	let start = Date.now();
+	results[suites[i][0]] = suites[i][1]();
+	console.error("benchmark " + suites[i][0] + " done in " + (Date.now() - start) + " ms");
+}
+
+// A pair found by the brute force but not by the broad phase is a collision that would never reach the server.
+for (let name in results) {
+	if (results[name].missed > 0) {
+		console.error("broad phase check " + name + ": " + results[name].missed + " missed pairs");
+		process.exitCode = 1;
+	}
+}
+
+let report = {
+	date: new Date().toISOString(),
+	node: process.version,
+	platform: os.platform() + " " + os.release(),
+	cpu: os.cpus()[0].model,
+	cpus: os.cpus().length,
+	quick,
+	results
+};
+
+// The results go to a file since the native components log on stdout.
+fs.writeFileSync(outputPath, JSON.stringify(report, null, 2));
+console.error("results written to " + outputPath);
+
+/**
+ * Collects the compared metrics: the mean and median times that must not increase and the rates that must not decrease.
+ */
+function metrics(object, prefix, result) {
+	for (let key in object) {
+		let name = (prefix === "") ? key : prefix + "." + key;
+		let value = object[key];
+
+		if (typeof value === 'object' && value !== null) {
+			metrics(value, name, result);
+		}
+		else if (key === 'mean' || key === 'p50') {
+			result[name] = {value, higherIsBetter: false};
+		}
+		else if (key.endsWith('PerSecond')) {
+			result[name] = {value, higherIsBetter: true};
+		}
+	}
+	return result;
+}
+
+if (baselinePath !== null) {
+
+	let baseline = metrics(JSON.parse(fs.readFileSync(baselinePath)).results, "", {});
+	let current = metrics(results, "", {});
+	let regressions = 0;
+
+	for (let name in baseline) {
+		if (!(name in current) || baseline[name].value <= 0) {
+			continue;
+		}
+
+		let ratio = current[name].value / baseline[name].value;
+		let regressed = baseline[name].higherIsBetter ? (ratio < 1 - threshold) : (ratio > 1 + threshold);
+
+		if (regressed) {
+			console.error("regression " + name + ": " + baseline[name].value.toFixed(3) + " -> " + current[name].value.toFixed(3));
+			regressions++;
+		}
+	}
+
+	console.error(regressions + " regressions with threshold " + threshold);
+
+	if (regressions > 0) {
+		process.exitCode = 1;
+	}
+}
@@ -0,0 +1,232 @@
+#include "stand-in.h"
+#include "positions-json.h"
+#include <chrono>
+#include <sstream>
+
+using namespace std;
+
+namespace nomad {
+
+StandIn::StandIn() :
+	m_running(false),
+	m_request(0),
+	m_response(0),
+	m_responded(false),
+	m_step(0),
+	m_objectId(0) {
+}
+
+StandIn::~StandIn() {
+	stop();
+}
+
+void StandIn::start(const StandInOptions& options) {
+
+	stop();
+
+	m_options = options;
+	m_names.clear();
+	m_values.assign(options.axisCount, 0.0);
+
+	for (int i = 0; i < options.axisCount; ++i) {
+		ostringstream name;
+		name << "axis" << i;
+		m_names.push_back(name.str());
+	}
+
+	m_step = 0;
+	m_request = 0;
+	m_response = 0;
+	m_responded = false;
+	m_running = true;
+	m_thread = thread(&StandIn::run, this);
+}
+
+void StandIn::stop() {
+
+	if (!m_thread.joinable()) {
+		return;
+	}
+
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_running = false;
+	}
+	m_condition.notify_all();
+	m_thread.join();
+}
+
+bool StandIn::isRunning() const {
+	return m_running;
+}
+
+const vector<string>& StandIn::axisNames() const {
+	return m_names;
+}
+
+void StandIn::request(const string& request, string& response) {
+
+	unique_lock<mutex> lock(m_mutex);
+
+	m_request = &request;
+	m_response = &response;
+	m_responded = false;
+	m_condition.notify_all();
+
+	m_condition.wait(lock, [this]() {
+		return m_responded || !m_running;
+	});
+
+	m_request = 0;
+	m_response = 0;
+}
+
+void StandIn::run() {
+
+	unique_lock<mutex> lock(m_mutex);
+
+	while (true) {
+
+		m_condition.wait(lock, [this]() {
+			return (m_request != 0 && !m_responded) || !m_running;
+		});
+
+		if (!m_running) {
+			return;
+		}
+
+		// The response is computed out of the lock as a server would do it in its own process.
+		const string * request = m_request;
+		string * response = m_response;
+		lock.unlock();
+
+		if (m_options.latencyUs > 0) {
+			this_thread::sleep_for(chrono::microseconds(m_options.latencyUs));
+		}
+		respond(*request, *response);
+
+		lock.lock();
+		m_responded = true;
+		m_condition.notify_all();
+	}
+}
+
+void StandIn::respond(const string& request, string& response) {
+
+	if (request == "POSITIONS") {
+		respondPositions(response);
+	}
+	else if (request == "PAUSE" || request == "RESTART") {
+		response = "OK";
+	}
+	else if (request.find("\"type\":\"COLLISIONS\"") != string::npos) {
+		respondCollisions(request, response);
+	}
+	else if (request.find("\"type\":\"ADD_OBJECT\"") != string::npos) {
+		ostringstream result;
+		result << "{\"objectId\":" << ++m_objectId << "}";
+		response = result.str();
+	}
+	else if (request.find("\"type\":\"MOVE_OBJECT\"") != string::npos) {
+		response = "{\"status\":\"OK\"}";
+	}
+	else {
+		response = "{\"status\":\"ERROR\"}";
+	}
+}
+
+void StandIn::respondPositions(string& response) {
+
+	// Every axis moves a little at each request.
+	++m_step;
+	for (size_t i = 0; i < m_values.size(); ++i) {
+		m_values[i] = static_cast<double>(i) + 0.001 * static_cast<double>(m_step);
+	}
+
+	formatPositions(m_names, m_values.data(), response);
+}
+
+void StandIn::respondCollisions(const string& request, string& response) {
+
+	// The positions are decoded as the collision server does before checking them.
+	size_t begin = request.find("\"positions\":");
+	size_t end = request.find('}', begin);
+
+	m_requestNames.clear();
+	if (begin == string::npos || end == string::npos
+		|| !parsePositions(request.substr(begin + 12, end - begin - 11), m_requestNames, m_requestValues)) {
+		response = "{\"status\":\"ERROR\"}";
+		return;
+	}
+
+	if (m_options.collisionCount == 0) {
+		response = "{\"status\":\"OK\",\"collisions\":[]}";
+		return;
+	}
+
+	ostringstream result;
+	result << "{\"status\":\"COLLIDING\",\"collisions\":[";
+
+	for (int i = 0; i < m_options.collisionCount; ++i) {
+		if (i > 0) {
+			result << ",";
+		}
+		result << "{\"mergedBlockA\":\"block" << 2 * i << "\",\"mergedBlockB\":\"block" << 2 * i + 1
+			<< "\",\"objectIdA\":-1,\"objectIdB\":-1}";
+	}
+	result << "]}";
+
+	response = result.str();
+}
+
+PropertySource::PropertySource() :
+	m_propertyCount(0),
+	m_producerCount(0),
+	m_changeCount(0),
+	m_running(0) {
+}
+
+PropertySource::~PropertySource() {
+	join();
+}
+
+void PropertySource::start(int propertyCount, int producerCount, uint64_t changeCount, Listener listener) {
+
+	join();
+
+	m_propertyCount = propertyCount;
+	m_producerCount = producerCount;
+	m_changeCount = changeCount;
+	m_listener = listener;
+	m_running = producerCount;
+
+	for (int i = 0; i < producerCount; ++i) {
+		m_producers.push_back(thread(&PropertySource::run, this, i));
+	}
+}
+
+void PropertySource::join() {
+
+	for (size_t i = 0; i < m_producers.size(); ++i) {
+		m_producers[i].join();
+	}
+	m_producers.clear();
+}
+
+bool PropertySource::done() const {
+	return m_running == 0;
+}
+
+void PropertySource::run(int producer) {
+
+	// The changes are shared between the producers, each one posts to all the properties.
+	uint64_t count = m_changeCount / m_producerCount + ((static_cast<uint64_t>(producer) < m_changeCount % m_producerCount) ? 1 : 0);
+
+	for (uint64_t i = 0; i < count; ++i) {
+		m_listener(static_cast<int>((i * m_producerCount + producer) % m_propertyCount), static_cast<double>(i));
+	}
+
+	--m_running;
+}
+
+}
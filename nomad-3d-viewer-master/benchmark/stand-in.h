@@ -0,0 +1,113 @@
+#ifndef NOMAD_STANDIN_H
+#define NOMAD_STANDIN_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nomad {
+
+/**
+ * Options of the stand-in servers.
+ */
+struct StandInOptions {
+	int axisCount;
+	int collisionCount;
+	int latencyUs;
+
+	StandInOptions() : axisCount(32), collisionCount(0), latencyUs(0) {}
+};
+
+/**
+ * In-process stand-in of the n3dpositions and n3dcollisions applications.
+ * The requests are passed to a responder thread and the caller waits for the response,
+ * as with a Cameo requester, so that a round trip includes the thread hand-off and the injected latency.
+ */
+class StandIn {
+
+public:
+	StandIn();
+	~StandIn();
+
+	void start(const StandInOptions& options);
+	void stop();
+	bool isRunning() const;
+
+	/**
+	 * Sends the request to the responder thread and waits for the response.
+	 */
+	void request(const std::string& request, std::string& response);
+
+	/**
+	 * Computes the response without the thread hand-off nor the latency.
+	 * It answers "POSITIONS", "PAUSE", "RESTART" and the JSON requests "COLLISIONS", "ADD_OBJECT", "MOVE_OBJECT".
+	 */
+	void respond(const std::string& request, std::string& response);
+
+	const std::vector<std::string>& axisNames() const;
+
+private:
+	void run();
+	void respondPositions(std::string& response);
+	void respondCollisions(const std::string& request, std::string& response);
+
+	StandInOptions m_options;
+	std::atomic<bool> m_running;
+	std::thread m_thread;
+
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	const std::string * m_request;
+	std::string * m_response;
+	bool m_responded;
+
+	std::vector<std::string> m_names;
+	std::vector<double> m_values;
+	std::vector<std::string> m_requestNames;
+	std::vector<double> m_requestValues;
+	uint64_t m_step;
+	int m_objectId;
+};
+
+/**
+ * Stand-in of the NomadAccessor property changes. Producer threads post changes of the properties
+ * round-robin as fast as possible until the given number of changes is reached.
+ */
+class PropertySource {
+
+public:
+	/**
+	 * The listener is called by the producer threads with the property index and the value.
+	 */
+	typedef std::function<void (int, double)> Listener;
+
+	PropertySource();
+	~PropertySource();
+
+	void start(int propertyCount, int producerCount, uint64_t changeCount, Listener listener);
+	void join();
+
+	/**
+	 * Tells whether all the changes were posted.
+	 */
+	bool done() const;
+
+private:
+	void run(int producer);
+
+	int m_propertyCount;
+	int m_producerCount;
+	uint64_t m_changeCount;
+	Listener m_listener;
+	std::vector<std::thread> m_producers;
+	std::atomic<int> m_running;
+};
+
+}
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef NOMAD_TIMINGS_H
+#define NOMAD_TIMINGS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+namespace nomad {
+
+/**
+ * Summary of the measured durations in us.
+ */
+struct TimingSummary {
+	size_t count;
+	double mean;
+	double min;
+	double p50;
+	double p90;
+	double p99;
+	double max;
+
+	TimingSummary() : count(0), mean(0.0), min(0.0), p50(0.0), p90(0.0), p99(0.0), max(0.0) {}
+};
+
+/**
+ * Collects the durations of the iterations of a benchmark.
+ */
+class Timings {
+
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	void reserve(size_t count) {
+		m_samples.reserve(count);
+	}
+
+	void add(Clock::time_point start, Clock::time_point end) {
+		m_samples.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+	}
+
+	void add(double us) {
+		m_samples.push_back(us);
+	}
+
+	TimingSummary summary() {
+
+		TimingSummary summary;
+
+		if (m_samples.empty()) {
+			return summary;
+		}
+
+		std::sort(m_samples.begin(), m_samples.end());
+
+		double sum = 0.0;
+		for (size_t i = 0; i < m_samples.size(); ++i) {
+			sum += m_samples[i];
+		}
+
+		summary.count = m_samples.size();
+		summary.mean = sum / m_samples.size();
+		summary.min = m_samples.front();
+		summary.p50 = percentile(0.5);
+		summary.p90 = percentile(0.9);
+		summary.p99 = percentile(0.99);
+		summary.max = m_samples.back();
+
+		return summary;
+	}
+
+private:
+	// The samples must be sorted.
+	double percentile(double fraction) const {
+		size_t index = static_cast<size_t>(fraction * (m_samples.size() - 1) + 0.5);
+		return m_samples[index];
+	}
+
+	std::vector<double> m_samples;
+};
+
+}
+
+#endif
@@ -2,6 +2,8 @@
 	"variables": {
    		"nomad%": "false",
 		"collisions%": "false",
+		"geometry%": "true",
+		"benchmark%": "false",
    	},  
 
 	"targets": [
@@ -13,13 +15,27 @@
         		['nomad=="true"', {
           			"sources": [
             			"nomad-positions/nomad-positions.cc",
+            			"nomad-positions/position-stream.cc",
+            			"nomad-positions/collision-forwarder.cc",
+            			"nomad-positions/server-watcher.cc",
+            			"nomad-positions/positions-log.cc",
+            			"common/positions-json.cc",
+            			"common/shared-ring.cc",
+          			],
+          			"include_dirs": [
+            			"common"
           			],
           			"conditions": [
             			['OS=="mac"', {
               				'xcode_settings': {
                 				'GCC_ENABLE_CPP_EXCEPTIONS': 'YES'
               				},
-            			}]    
+            			}],
+            			['OS=="linux"', {
+              				"libraries": [
+                				"-lrt"
+              				]
+            			}]
           			],
           			"libraries": [
             			"-lcameo -lprotobuf -lzmq"
@@ -36,6 +52,14 @@
         		['collisions=="true"', {
 					"sources": [
 						"collision/collision.cc",
+						"collision/collision-pipeline.cc",
+						"collision/collision-lookahead.cc",
+						"collision/aabb-tree.cc",
+						"collision/broad-phase.cc",
+						"common/positions-json.cc",
+					],
+					"include_dirs": [
+						"common"
 					],
 					'conditions': [
 						['OS=="mac"', {
@@ -49,6 +73,102 @@
 					]
 				}]
 			]
+		},
+
+		{
+			"target_name": "addonnomad3dgeometry",
+			'cflags!': [ '-fno-exceptions' ],
+			'cflags_cc!': [ '-fno-exceptions' ],
+			'conditions': [
+				['geometry=="true"', {
+					"sources": [
+						"geometry/geometry.cc",
+						"geometry/geometry-cache.cc",
+						"geometry/file-signature.cc",
+						"geometry/mesh-decimator.cc",
+						"geometry/mesh-merger.cc",
+						"geometry/stl-io.cc",
+					],
+					"include_dirs": [
+						"common"
+					],
+					'conditions': [
+						['OS=="mac"', {
+							'xcode_settings': {
+								'GCC_ENABLE_CPP_EXCEPTIONS': 'YES'
+							}
+						}]
+					]
+				}]
+			]
+		},
+
+		{
+			"target_name": "n3dlod",
+			"type": "executable",
+			'cflags!': [ '-fno-exceptions' ],
+			'cflags_cc!': [ '-fno-exceptions' ],
+			'conditions': [
+				['geometry=="true"', {
+					"sources": [
+						"geometry/n3dlod.cc",
+						"geometry/geometry-cache.cc",
+						"geometry/file-signature.cc",
+						"geometry/mesh-decimator.cc",
+						"geometry/mesh-merger.cc",
+						"geometry/stl-io.cc",
+					],
+					'conditions': [
+						['OS=="mac"', {
+							'xcode_settings': {
+								'GCC_ENABLE_CPP_EXCEPTIONS': 'YES'
+							}
+						}]
+					],
+					"libraries": [
+						"-lpthread"
+					]
+				}]
+			]
+		},
+
+		{
+			"target_name": "addonnomad3dbenchmark",
+			'cflags!': [ '-fno-exceptions' ],
+			'cflags_cc!': [ '-fno-exceptions' ],
+			'conditions': [
+				['benchmark=="true"', {
+					"sources": [
+						"benchmark/benchmark.cc",
+						"benchmark/stand-in.cc",
+						"common/positions-json.cc",
+						"common/shared-ring.cc",
+						"nomad-positions/position-stream.cc",
+						"nomad-positions/collision-forwarder.cc",
+						"collision/collision-pipeline.cc",
+						"collision/aabb-tree.cc",
+						"collision/broad-phase.cc",
+					],
+					"include_dirs": [
+						"common",
+						"cameo-nomad",
+						"nomad-positions",
+						"collision"
+					],
+					'conditions': [
+						['OS=="mac"', {
+							'xcode_settings': {
+								'GCC_ENABLE_CPP_EXCEPTIONS': 'YES'
+							}
+						}],
+						['OS=="linux"', {
+							"libraries": [
+								"-lrt"
+							]
+						}]
+					]
+				}]
+			]
 		}
 	]
-}
\ No newline at end of file
+}
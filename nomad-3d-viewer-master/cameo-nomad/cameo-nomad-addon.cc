@@ -1,4 +1,5 @@
 #include <node.h>
+#include <node_buffer.h>
 #include <iostream>
 #include <unistd.h>
 #include <nomadaccessor.h>
@@ -6,6 +7,8 @@
 #include <thread>
 #include <sstream>
 #include <functional>
+#include "property-dispatcher.h"
+#include "addon-stats.h"
 
 using namespace std;
 using namespace nomad;
@@ -16,6 +19,8 @@ namespace nomad {
 using v8::Function;
 using v8::FunctionCallbackInfo;
 using v8::Isolate;
+using v8::Context;
+using v8::Exception;
 using v8::Local;
 using v8::Object;
 using v8::String;
@@ -25,15 +30,47 @@ using v8::Integer;
 using v8::Boolean;
 using v8::Array;
 using v8::Persistent;
+using v8::ArrayBuffer;
+using v8::Float64Array;
+using v8::Int32Array;
+using v8::Uint8Array;
+using v8::TypedArray;
 
 NomadAccessor accessor;
 Isolate * v8Isolate;
 
+// Dispatcher of the property changes to the JS thread.
+PropertyDispatcher dispatcher;
+uv_async_t dispatchAsync;
+bool dispatchAsyncInitialised = false;
+
+static void DispatchAsync(uv_async_t *handle);
+
+// Latency histograms, counters and events. The histograms of the hot paths are kept by reference.
+AddonStats stats("nomad");
+LatencyHistogram& getFloat64Histogram = stats.histogram("get.float64");
+LatencyHistogram& getInt32Histogram = stats.histogram("get.int32");
+LatencyHistogram& getBooleanHistogram = stats.histogram("get.boolean");
+LatencyHistogram& getStringHistogram = stats.histogram("get.string");
+LatencyHistogram& getInt32ArrayHistogram = stats.histogram("get.int32Array");
+LatencyHistogram& getFloat64ArrayHistogram = stats.histogram("get.float64Array");
+LatencyHistogram& setFloat64Histogram = stats.histogram("set.float64");
+LatencyHistogram& setInt32Histogram = stats.histogram("set.int32");
+LatencyHistogram& setBooleanHistogram = stats.histogram("set.boolean");
+LatencyHistogram& setStringHistogram = stats.histogram("set.string");
+LatencyHistogram& getPropertiesHistogram = stats.histogram("getProperties");
+LatencyHistogram& setPropertiesHistogram = stats.histogram("setProperties");
+LatencyHistogram& dispatchHistogram = stats.histogram("dispatch.batch");
+atomic<uint64_t>& bytesReceived = stats.counter("bytes.received");
+atomic<uint64_t>& bytesSent = stats.counter("bytes.sent");
+
 /**
  * Init function to initialise the Cameo Nomad addon.
  */
 void Init(const FunctionCallbackInfo<Value>& args) {
 
+	stats.event("init");
+
 	// Get the V8 isolate.
 	v8Isolate = args.GetIsolate();
 
@@ -41,37 +78,53 @@ void Init(const FunctionCallbackInfo<Value>& args) {
 	v8::String::Utf8Value param1(args[0]->ToString());
 	string electronArgs(*param1);
 
-	cout << "electron args = " << electronArgs << endl;
-
 	size_t pos = 0;
 
 	// Parse the args.
 	size_t endPos = electronArgs.find_first_of(',', pos);
 	string localEndpoint = electronArgs.substr(pos, endPos - pos);
 
-	cout << "local endpoint = " << localEndpoint << endl;
-
 	pos = endPos + 1;
 	endPos = electronArgs.find_first_of(',', pos);
 	string nomadEndpoint = electronArgs.substr(pos, endPos - pos);
 
-	cout << "nomad endpoint = " << nomadEndpoint << endl;
-
 	pos = endPos + 1;
 	endPos = electronArgs.find_first_of(',', pos);
 	string name = electronArgs.substr(pos, endPos - pos + 1);
 
-	cout << "name = " << name << endl;
+	stats.event("args", {{"electronArgs", electronArgs}, {"localEndpoint", localEndpoint}, {"nomadEndpoint", nomadEndpoint}, {"name", name}});
 
 	string localParams = localEndpoint + ":" + name;
 
 	// We only need the last argument that we convert to an array.
 	char *argv[1] = {(char *)localParams.c_str()};
 
+	// Initialise the dispatcher. The async handle does not keep the loop alive.
+	if (!dispatchAsyncInitialised) {
+		uv_async_init(uv_default_loop(), &dispatchAsync, DispatchAsync);
+		uv_unref(reinterpret_cast<uv_handle_t *>(&dispatchAsync));
+		dispatcher.setNotifier([]() {
+			uv_async_send(&dispatchAsync);
+		});
+		dispatchAsyncInitialised = true;
+
+		// The dispatch counters are kept by the dispatcher.
+		stats.addSource([](AddonStats& stats) {
+			PropertyDispatcher::Stats dispatchStats = dispatcher.stats();
+			stats.counter("dispatch.queued") = dispatchStats.queued;
+			stats.counter("dispatch.coalesced") = dispatchStats.coalesced;
+			stats.counter("dispatch.delivered") = dispatchStats.delivered;
+			stats.counter("dispatch.batches") = dispatchStats.batches;
+			stats.gauge("dispatch.pending").set(dispatchStats.queued - dispatchStats.coalesced - dispatchStats.delivered);
+		});
+	}
+
 	// Initialise the Nomad accessor.
 	accessor.init(1, argv);
 	accessor.connectNomadServer(nomadEndpoint);
 
+	stats.event("initialised", {{"nomadEndpoint", nomadEndpoint}});
+
 	args.GetReturnValue().Set(Undefined(v8Isolate));
 }
 
@@ -79,9 +132,9 @@ void Init(const FunctionCallbackInfo<Value>& args) {
  * Terminate function to terminate the Cameo Nomad addon.
  */
 void Terminate(const FunctionCallbackInfo<Value>& args) {
-	cout << "terminating" << endl;
+	stats.event("terminate");
 	accessor.terminate();
-	cout << "terminated" << endl;	
+	stats.event("terminated");
 }
 
 /**
@@ -102,6 +155,7 @@ void GetPropertyId(const FunctionCallbackInfo<Value>& args) {
  * Gets the float64 property value.
  */
 void GetFloat64Property(const FunctionCallbackInfo<Value>& args) {
+	LatencyTimer timer(getFloat64Histogram);
 	args.GetReturnValue().Set(Number::New(args.GetIsolate(), accessor.getFloat64Value(Local<Integer>::Cast(args[0])->Value())));
 }
 
@@ -109,6 +163,7 @@ void GetFloat64Property(const FunctionCallbackInfo<Value>& args) {
  * Gets the int32 property value.
  */
 void GetInt32Property(const FunctionCallbackInfo<Value>& args) {
+	LatencyTimer timer(getInt32Histogram);
 	args.GetReturnValue().Set(Number::New(args.GetIsolate(), accessor.getInt32Value(Local<Integer>::Cast(args[0])->Value())));
 }
 
@@ -116,6 +171,7 @@ void GetInt32Property(const FunctionCallbackInfo<Value>& args) {
  * Gets the boolean property value.
  */
 void GetBooleanProperty(const FunctionCallbackInfo<Value>& args) {
+	LatencyTimer timer(getBooleanHistogram);
 	args.GetReturnValue().Set(Boolean::New(args.GetIsolate(), accessor.getBooleanValue(Local<Integer>::Cast(args[0])->Value())));
 }
 
@@ -124,46 +180,71 @@ void GetBooleanProperty(const FunctionCallbackInfo<Value>& args) {
  */
 void GetStringProperty(const FunctionCallbackInfo<Value>& args) {
 
+	LatencyTimer timer(getStringHistogram);
+
 	string value = accessor.getStringValue(Local<Integer>::Cast(args[0])->Value());
+	bytesReceived += value.size();
 	args.GetReturnValue().Set(String::NewFromUtf8(args.GetIsolate(), value.c_str()));
 }
 
 /**
- * Gets the int32 array property value.
+ * Releases the vector viewed by a typed array once it is garbage collected.
+ */
+template<typename Type>
+static void ReleaseVector(char * data, void * hint) {
+	delete static_cast<vector<Type> *>(hint);
+}
+
+/**
+ * Creates a typed array that views the values without a copy. The values are moved into the buffer.
+ */
+template<typename Type, typename ArrayType>
+static Local<ArrayType> NewTypedArray(Isolate * isolate, vector<Type>& values) {
+
+	if (values.empty()) {
+		return ArrayType::New(ArrayBuffer::New(isolate, 0), 0, 0);
+	}
+
+	vector<Type> * holder = new vector<Type>(std::move(values));
+	size_t size = holder->size();
+
+	Local<Object> buffer = node::Buffer::New(isolate, reinterpret_cast<char *>(holder->data()), size * sizeof(Type), ReleaseVector<Type>, holder).ToLocalChecked();
+	Local<Uint8Array> bytes = buffer.As<Uint8Array>();
+
+	return ArrayType::New(bytes->Buffer(), bytes->ByteOffset(), size);
+}
+
+/**
+ * Gets the int32 array property value as an Int32Array.
  */
 void GetInt32ArrayProperty(const FunctionCallbackInfo<Value>& args) {
 
-	Local<Array> array = Array::New(args.GetIsolate(), 0);
+	LatencyTimer timer(getInt32ArrayHistogram);
 
 	vector<int32_t> arrayValue = accessor.getInt32Array(Local<Integer>::Cast(args[0])->Value());
+	bytesReceived += arrayValue.size() * sizeof(int32_t);
 
-	for (int i = 0; i < arrayValue.size(); ++i) {
-		array->Set(i, Integer::New(args.GetIsolate(), arrayValue[i]));
-	}
-
-	args.GetReturnValue().Set(array);
+	args.GetReturnValue().Set(NewTypedArray<int32_t, Int32Array>(args.GetIsolate(), arrayValue));
 }
 
 /**
- * Gets the float64 array property value.
+ * Gets the float64 array property value as a Float64Array.
  */
 void GetFloat64ArrayProperty(const FunctionCallbackInfo<Value>& args) {
 
-	Local<Array> array = Array::New(args.GetIsolate(), 0);
+	LatencyTimer timer(getFloat64ArrayHistogram);
 
 	vector<double> arrayValue = accessor.getFloat64Array(Local<Integer>::Cast(args[0])->Value());
+	bytesReceived += arrayValue.size() * sizeof(double);
 
-	for (int i = 0; i < arrayValue.size(); ++i) {
-		array->Set(i, Number::New(args.GetIsolate(), arrayValue[i]));
-	}
-
-	args.GetReturnValue().Set(array);
+	args.GetReturnValue().Set(NewTypedArray<double, Float64Array>(args.GetIsolate(), arrayValue));
 }
 
 /**
  * Sets the float64 property value.
  */
 void SetFloat64Property(const FunctionCallbackInfo<Value>& args) {
+	LatencyTimer timer(setFloat64Histogram);
 	args.GetReturnValue().Set(Boolean::New(args.GetIsolate(), accessor.setFloat64Value(Local<Integer>::Cast(args[0])->Value(), Local<Number>::Cast(args[1])->Value())));
 }
 
@@ -171,6 +252,7 @@ void SetFloat64Property(const FunctionCallbackInfo<Value>& args) {
  * Sets the int32 property value.
  */
 void SetInt32Property(const FunctionCallbackInfo<Value>& args) {
+	LatencyTimer timer(setInt32Histogram);
 	args.GetReturnValue().Set(Boolean::New(args.GetIsolate(), accessor.setInt32Value(Local<Integer>::Cast(args[0])->Value(), Local<Integer>::Cast(args[1])->Value())));
 }
 
@@ -178,6 +260,7 @@ void SetInt32Property(const FunctionCallbackInfo<Value>& args) {
  * Sets the boolean property value.
  */
 void SetBooleanProperty(const FunctionCallbackInfo<Value>& args) {
+	LatencyTimer timer(setBooleanHistogram);
 	args.GetReturnValue().Set(Boolean::New(args.GetIsolate(), accessor.setBooleanValue(Local<Integer>::Cast(args[0])->Value(), Local<Boolean>::Cast(args[1])->Value())));
 }
 
@@ -185,174 +268,294 @@ void SetBooleanProperty(const FunctionCallbackInfo<Value>& args) {
  * Sets the string property value.
  */
 void SetStringProperty(const FunctionCallbackInfo<Value>& args) {
+	LatencyTimer timer(setStringHistogram);
 	v8::String::Utf8Value param1(args[1]->ToString());
 	std::string value(*param1);
+	bytesSent += value.size();
 	args.GetReturnValue().Set(Boolean::New(args.GetIsolate(), accessor.setStringValue(Local<Integer>::Cast(args[0])->Value(), value)));
 }
 
 /**
- * Work structure is be used to pass the callback function and data
- * from the initiating function to the function which triggers the callback.
+ * Reads the property ids from a JS Array or Int32Array.
+ * Returns false if an element of the Array is not an integer.
  */
-template<typename Type>
-struct Work {
-	uv_work_t request;
-	Persistent<Function> callback;
-	Type result;
-};
+static bool ReadIds(Isolate * isolate, Local<Value> value, vector<int32_t>& ids) {
 
-static void WorkAsync(uv_work_t *req) {
-	// Do nothing.
+	ids.clear();
+
+	if (value->IsInt32Array()) {
+		Local<Int32Array> array = Local<Int32Array>::Cast(value);
+		ids.resize(array->Length());
+		if (!ids.empty()) {
+			array->CopyContents(ids.data(), ids.size() * sizeof(int32_t));
+		}
+	}
+	else if (value->IsArray()) {
+		Local<Context> context = isolate->GetCurrentContext();
+		Local<Array> array = Local<Array>::Cast(value);
+		ids.resize(array->Length());
+		for (uint32_t i = 0; i < array->Length(); ++i) {
+			Local<Value> id = array->Get(context, i).ToLocalChecked();
+			if (!id->IsInt32()) {
+				return false;
+			}
+			ids[i] = id->Int32Value(context).FromJust();
+		}
+	}
+
+	return true;
 }
 
 /**
- * WorkAsyncComplete function is called once we are ready to trigger the callback
- * function in JS.
+ * Reads the number values from a JS Array or typed array.
  */
-template<typename Type, typename JSType>
-static void WorkAsyncComplete(uv_work_t *req, int status) {
+static void ReadValues(Isolate * isolate, Local<Value> value, vector<double>& values) {
 
-	Isolate * isolate = Isolate::GetCurrent();
+	values.clear();
 
-	v8::HandleScope handleScope(isolate);
+	if (value->IsFloat64Array()) {
+		Local<Float64Array> array = Local<Float64Array>::Cast(value);
+		values.resize(array->Length());
+		if (!values.empty()) {
+			array->CopyContents(values.data(), values.size() * sizeof(double));
+		}
+	}
+	else if (value->IsArray() || value->IsTypedArray()) {
+		Local<Context> context = isolate->GetCurrentContext();
+		Local<Object> array = Local<Object>::Cast(value);
+		uint32_t length = value->IsArray() ? Local<Array>::Cast(value)->Length() : Local<TypedArray>::Cast(value)->Length();
+		values.resize(length);
+		for (uint32_t i = 0; i < length; ++i) {
+			values[i] = array->Get(context, i).ToLocalChecked()->NumberValue(context).FromMaybe(0.0);
+		}
+	}
+}
 
-	Work<Type> *work = static_cast<Work<Type> *>(req->data);
+/**
+ * Gets the member of a JS object or undefined if the object is not an object.
+ */
+static Local<Value> GetMember(Isolate * isolate, Local<Value> object, const char * name) {
 
-	// Get the result and pass it to the JS callback.
-	Local<Value> argv[1] = {JSType::New(isolate, work->result)};
+	if (!object->IsObject()) {
+		return v8::Undefined(isolate);
+	}
 
-	// https://stackoverflow.com/questions/13826803/calling-javascript-function-from-a-c-callback-in-v8/28554065#28554065
-	Local<Function>::New(isolate, work->callback)->Call(isolate->GetCurrentContext()->Global(), 1, argv);
+	return Local<Object>::Cast(object)->Get(String::NewFromUtf8(isolate, name));
+}
 
-	work->callback.Reset();
-	delete work;
+/**
+ * Throws a JS TypeError with the message.
+ */
+static void ThrowTypeError(Isolate * isolate, const string& message) {
+	isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, message.c_str(), v8::NewStringType::kNormal).ToLocalChecked()));
 }
 
 /**
- * StringWorkAsyncComplete function is called once we are ready to trigger the callback
- * function in JS.
+ * Reads the ids of the type in the first argument, throws a TypeError and returns false if one is not an integer.
  */
-static void StringWorkAsyncComplete(uv_work_t *req, int status) {
+static bool ReadTypeIds(const FunctionCallbackInfo<Value>& args, const char * type, vector<int32_t>& ids) {
 
-	Isolate * isolate = Isolate::GetCurrent();
+	if (!ReadIds(args.GetIsolate(), GetMember(args.GetIsolate(), args[0], type), ids)) {
+		ThrowTypeError(args.GetIsolate(), string("the ") + type + " ids must be integers");
+		return false;
+	}
 
-	v8::HandleScope handleScope(isolate);
+	return true;
+}
 
-	Work<string> *work = static_cast<Work<string> *>(req->data);
+/**
+ * Reads the ids of the type in the first argument and their values in the second one, throws a TypeError and returns false
+ * if an id is not an integer or if there are not as many values as ids.
+ */
+static bool ReadTypeIdValues(const FunctionCallbackInfo<Value>& args, const char * type, vector<int32_t>& ids, vector<double>& values) {
 
-	// Get the result and pass it to the JS callback.
-	Local<Value> argv[1] = {String::NewFromUtf8(isolate, work->result.c_str())};
+	if (!ReadTypeIds(args, type, ids)) {
+		return false;
+	}
 
-	// https://stackoverflow.com/questions/13826803/calling-javascript-function-from-a-c-callback-in-v8/28554065#28554065
-	Local<Function>::New(isolate, work->callback)->Call(isolate->GetCurrentContext()->Global(), 1, argv);
+	ReadValues(args.GetIsolate(), GetMember(args.GetIsolate(), args[1], type), values);
+	if (values.size() != ids.size()) {
+		ThrowTypeError(args.GetIsolate(), string("the ") + type + " ids and values must have the same length");
+		return false;
+	}
 
-	work->callback.Reset();
-	delete work;
+	return true;
 }
 
 /**
- * Float64ArrayWorkAsyncComplete function is called once we are ready to trigger the callback
- * function in JS.
+ * Gets several property values in one call.
+ * The argument is an object {float64: ids, int32: ids, boolean: ids} where ids is an Array or Int32Array.
+ * The result is an object {float64: Float64Array, int32: Int32Array, boolean: Uint8Array} with the values
+ * in the order of the ids. Throws a TypeError if an id is not an integer.
  */
-static void Float64ArrayWorkAsyncComplete(uv_work_t *req, int status) {
+void GetProperties(const FunctionCallbackInfo<Value>& args) {
 
-	Isolate * isolate = Isolate::GetCurrent();
+	LatencyTimer timer(getPropertiesHistogram);
 
-	v8::HandleScope handleScope(isolate);
-
-	Work<vector<double> > *work = static_cast<Work<vector<double> > *>(req->data);
-
-	// Get the result and pass it to the JS callback.
-	Local<Array> array = Array::New(isolate, 0);
+	Isolate * isolate = args.GetIsolate();
 
-	const vector<double>& arrayValue = work->result;
+	vector<int32_t> ids;
+	Local<Object> result = Object::New(isolate);
 
-	for (int i = 0; i < arrayValue.size(); ++i) {
-		array->Set(i, Number::New(isolate, arrayValue[i]));
+	if (!ReadTypeIds(args, "float64", ids)) {
+		return;
 	}
+	Local<ArrayBuffer> float64Buffer = ArrayBuffer::New(isolate, ids.size() * sizeof(double));
+	double * float64Values = static_cast<double *>(float64Buffer->GetContents().Data());
+	for (size_t i = 0; i < ids.size(); ++i) {
+		float64Values[i] = accessor.getFloat64Value(ids[i]);
+	}
+	result->Set(String::NewFromUtf8(isolate, "float64"), Float64Array::New(float64Buffer, 0, ids.size()));
 
-	Local<Value> argv[1] = {array};
+	if (!ReadTypeIds(args, "int32", ids)) {
+		return;
+	}
+	Local<ArrayBuffer> int32Buffer = ArrayBuffer::New(isolate, ids.size() * sizeof(int32_t));
+	int32_t * int32Values = static_cast<int32_t *>(int32Buffer->GetContents().Data());
+	for (size_t i = 0; i < ids.size(); ++i) {
+		int32Values[i] = accessor.getInt32Value(ids[i]);
+	}
+	result->Set(String::NewFromUtf8(isolate, "int32"), Int32Array::New(int32Buffer, 0, ids.size()));
 
-	// https://stackoverflow.com/questions/13826803/calling-javascript-function-from-a-c-callback-in-v8/28554065#28554065
-	Local<Function>::New(isolate, work->callback)->Call(isolate->GetCurrentContext()->Global(), 1, argv);
+	if (!ReadTypeIds(args, "boolean", ids)) {
+		return;
+	}
+	Local<ArrayBuffer> booleanBuffer = ArrayBuffer::New(isolate, ids.size());
+	uint8_t * booleanValues = static_cast<uint8_t *>(booleanBuffer->GetContents().Data());
+	for (size_t i = 0; i < ids.size(); ++i) {
+		booleanValues[i] = accessor.getBooleanValue(ids[i]) ? 1 : 0;
+	}
+	result->Set(String::NewFromUtf8(isolate, "boolean"), Uint8Array::New(booleanBuffer, 0, ids.size()));
 
-	work->callback.Reset();
-	delete work;
+	args.GetReturnValue().Set(result);
 }
 
 /**
- * Int32ArrayWorkAsyncComplete function is called once we are ready to trigger the callback
- * function in JS.
+ * Sets several property values in one call.
+ * The arguments are the ids {float64: ids, int32: ids, boolean: ids} and the values {float64: values, int32: values, boolean: values}
+ * in the same order. Returns the number of properties that could not be set.
+ * Throws a TypeError if an id is not an integer or if the ids and the values of a type do not have the same length.
  */
-static void Int32ArrayWorkAsyncComplete(uv_work_t *req, int status) {
+void SetProperties(const FunctionCallbackInfo<Value>& args) {
 
-	Isolate * isolate = Isolate::GetCurrent();
+	LatencyTimer timer(setPropertiesHistogram);
 
-	v8::HandleScope handleScope(isolate);
+	Isolate * isolate = args.GetIsolate();
 
-	Work<vector<int32_t> > *work = static_cast<Work<vector<int32_t> > *>(req->data);
+	vector<int32_t> ids;
+	vector<double> values;
+	int failures = 0;
 
-	// Get the result and pass it to the JS callback.
-	Local<Array> array = Array::New(isolate, 0);
+	if (!ReadTypeIdValues(args, "float64", ids, values)) {
+		return;
+	}
+	for (size_t i = 0; i < ids.size(); ++i) {
+		if (!accessor.setFloat64Value(ids[i], values[i])) {
+			++failures;
+		}
+	}
 
-	const vector<int32_t>& arrayValue = work->result;
+	if (!ReadTypeIdValues(args, "int32", ids, values)) {
+		return;
+	}
+	for (size_t i = 0; i < ids.size(); ++i) {
+		if (!accessor.setInt32Value(ids[i], static_cast<int32_t>(values[i]))) {
+			++failures;
+		}
+	}
 
-	for (int i = 0; i < arrayValue.size(); ++i) {
-		array->Set(i, Integer::New(isolate, arrayValue[i]));
+	if (!ReadTypeIdValues(args, "boolean", ids, values)) {
+		return;
+	}
+	for (size_t i = 0; i < ids.size(); ++i) {
+		if (!accessor.setBooleanValue(ids[i], values[i] != 0)) {
+			++failures;
+		}
 	}
 
-	Local<Value> argv[1] = {array};
+	args.GetReturnValue().Set(Integer::New(isolate, failures));
+}
 
-	// https://stackoverflow.com/questions/13826803/calling-javascript-function-from-a-c-callback-in-v8/28554065#28554065
-	Local<Function>::New(isolate, work->callback)->Call(isolate->GetCurrentContext()->Global(), 1, argv);
+/**
+ * Value of a property change posted to the dispatcher.
+ */
+template<typename Type>
+struct PropertyValue : PropertyDispatcher::Value {
+	Type value;
 
-	work->callback.Reset();
-	delete work;
+	PropertyValue(const Type& value) : value(value) {}
+};
+
+/**
+ * Converts the property values to JS values.
+ */
+static Local<Value> ToJS(Isolate * isolate, double value) {
+	return Number::New(isolate, value);
 }
 
-template<typename Type, typename JSType>
-void PropertyChanged(Persistent<Function>* callback, Type value) {
+static Local<Value> ToJS(Isolate * isolate, int32_t value) {
+	return Integer::New(isolate, value);
+}
+
+static Local<Value> ToJS(Isolate * isolate, bool value) {
+	return Boolean::New(isolate, value);
+}
 
-	Work<Type> * work = new Work<Type>();
+static Local<Value> ToJS(Isolate * isolate, const string& value) {
+	return String::NewFromUtf8(isolate, value.c_str());
+}
 
-	work->request.data = work;
-	work->callback.Reset(v8Isolate, *callback);
-	work->result = value;
+// The array values are moved into the typed array, the posted value is deleted after the delivery.
+static Local<Value> ToJS(Isolate * isolate, vector<double>& arrayValue) {
+	bytesReceived += arrayValue.size() * sizeof(double);
+	return NewTypedArray<double, Float64Array>(isolate, arrayValue);
+}
 
-	uv_queue_work(uv_default_loop(), &work->request, WorkAsync, WorkAsyncComplete<Type, JSType>);
+static Local<Value> ToJS(Isolate * isolate, vector<int32_t>& arrayValue) {
+	bytesReceived += arrayValue.size() * sizeof(int32_t);
+	return NewTypedArray<int32_t, Int32Array>(isolate, arrayValue);
 }
 
-void StringPropertyChanged(Persistent<Function>* callback, const std::string& value) {
+/**
+ * Subscription calling the JS callback with the newest value of the property.
+ */
+template<typename Type>
+struct JSSubscription : PropertyDispatcher::Subscription {
+	Persistent<Function> callback;
 
-	Work<string> * work = new Work<string>();
+	void deliver(PropertyDispatcher::Value * value) {
 
-	work->request.data = work;
-	work->callback.Reset(v8Isolate, *callback);
-	work->result = value;
+		Local<Value> argv[1] = {ToJS(v8Isolate, static_cast<PropertyValue<Type> *>(value)->value)};
 
-	uv_queue_work(uv_default_loop(), &work->request, WorkAsync, StringWorkAsyncComplete);
-}
+		// https://stackoverflow.com/questions/13826803/calling-javascript-function-from-a-c-callback-in-v8/28554065#28554065
+		Local<Function>::New(v8Isolate, callback)->Call(v8Isolate->GetCurrentContext()->Global(), 1, argv);
+	}
+};
 
-void Float64ArrayPropertyChanged(Persistent<Function>* callback, const std::vector<double>& value) {
+/**
+ * DispatchAsync function is called on the JS thread when property changes are pending.
+ * All the pending changes are delivered in one batch.
+ */
+static void DispatchAsync(uv_async_t *handle) {
 
-	Work<std::vector<double> > * work = new Work<std::vector<double> >();
+	v8::HandleScope handleScope(v8Isolate);
 
-	work->request.data = work;
-	work->callback.Reset(v8Isolate, *callback);
-	work->result = value;
+	LatencyTimer timer(dispatchHistogram);
 
-	uv_queue_work(uv_default_loop(), &work->request, WorkAsync, Float64ArrayWorkAsyncComplete);
+	dispatcher.dispatch();
 }
 
-void Int32ArrayPropertyChanged(Persistent<Function>* callback, const std::vector<int32_t>& value) {
-
-	Work<std::vector<int32_t> > * work = new Work<std::vector<int32_t> >();
+/**
+ * Creates the subscription of the JS callback.
+ * The subscription is allocated for the lifetime of the addon because the accessor keeps the std function.
+ */
+template<typename Type>
+JSSubscription<Type> * NewSubscription(Isolate * isolate, Local<Value> callback) {
 
-	work->request.data = work;
-	work->callback.Reset(v8Isolate, *callback);
-	work->result = value;
+	JSSubscription<Type> * subscription = new JSSubscription<Type>();
+	subscription->callback.Reset(isolate, Local<Function>::Cast(callback));
 
-	uv_queue_work(uv_default_loop(), &work->request, WorkAsync, Int32ArrayWorkAsyncComplete);
+	return subscription;
 }
 
 void RegisterFloat64PropertyChanged(const FunctionCallbackInfo<Value>& args) {
@@ -360,13 +563,11 @@ void RegisterFloat64PropertyChanged(const FunctionCallbackInfo<Value>& args) {
 	Isolate * isolate = args.GetIsolate();
 
 	int propertyId = Local<Integer>::Cast(args[0])->Value();
-	Local<Function> callback = Local<Function>::Cast(args[1]);
+	JSSubscription<double> * subscription = NewSubscription<double>(isolate, args[1]);
 
-	// The persistent function callback is allocated (should not) to allow to use it through the std function parameter.
-	// That could lead to a memory leak.
-	Persistent<Function>* pCallback = new Persistent<Function>();
-	pCallback->Reset(isolate, callback);
-	accessor.registerFloat64PropertyChanged(propertyId, std::bind(&PropertyChanged<double, Number>, pCallback, _1));
+	accessor.registerFloat64PropertyChanged(propertyId, [subscription](double value) {
+		dispatcher.post(subscription, new PropertyValue<double>(value));
+	});
 
 	args.GetReturnValue().Set(Undefined(isolate));
 }
@@ -376,13 +577,11 @@ void RegisterInt32PropertyChanged(const FunctionCallbackInfo<Value>& args) {
 	Isolate * isolate = args.GetIsolate();
 
 	int propertyId = Local<Integer>::Cast(args[0])->Value();
-	Local<Function> callback = Local<Function>::Cast(args[1]);
+	JSSubscription<int32_t> * subscription = NewSubscription<int32_t>(isolate, args[1]);
 
-	// The persistent function callback is allocated (should not) to allow to use it through the std function parameter.
-	// That could lead to a memory leak.
-	Persistent<Function>* pCallback = new Persistent<Function>();
-	pCallback->Reset(isolate, callback);
-	accessor.registerInt32PropertyChanged(propertyId, std::bind(&PropertyChanged<int32_t, Integer>, pCallback, _1));
+	accessor.registerInt32PropertyChanged(propertyId, [subscription](int32_t value) {
+		dispatcher.post(subscription, new PropertyValue<int32_t>(value));
+	});
 
 	args.GetReturnValue().Set(Undefined(isolate));
 }
@@ -392,13 +591,11 @@ void RegisterBooleanPropertyChanged(const FunctionCallbackInfo<Value>& args) {
 	Isolate * isolate = args.GetIsolate();
 
 	int propertyId = Local<Integer>::Cast(args[0])->Value();
-	Local<Function> callback = Local<Function>::Cast(args[1]);
+	JSSubscription<bool> * subscription = NewSubscription<bool>(isolate, args[1]);
 
-	// The persistent function callback is allocated (should not) to allow to use it through the std function parameter.
-	// That could lead to a memory leak.
-	Persistent<Function>* pCallback = new Persistent<Function>();
-	pCallback->Reset(isolate, callback);
-	accessor.registerBooleanPropertyChanged(propertyId, std::bind(&PropertyChanged<bool, Boolean>, pCallback, _1));
+	accessor.registerBooleanPropertyChanged(propertyId, [subscription](bool value) {
+		dispatcher.post(subscription, new PropertyValue<bool>(value));
+	});
 
 	args.GetReturnValue().Set(Undefined(isolate));
 }
@@ -408,13 +605,11 @@ void RegisterStringPropertyChanged(const FunctionCallbackInfo<Value>& args) {
 	Isolate * isolate = args.GetIsolate();
 
 	int propertyId = Local<Integer>::Cast(args[0])->Value();
-	Local<Function> callback = Local<Function>::Cast(args[1]);
+	JSSubscription<string> * subscription = NewSubscription<string>(isolate, args[1]);
 
-	// The persistent function callback is allocated (should not) to allow to use it through the std function parameter.
-	// That could lead to a memory leak.
-	Persistent<Function>* pCallback = new Persistent<Function>();
-	pCallback->Reset(isolate, callback);
-	accessor.registerStringPropertyChanged(propertyId, std::bind(&StringPropertyChanged, pCallback, _1));
+	accessor.registerStringPropertyChanged(propertyId, [subscription](const std::string& value) {
+		dispatcher.post(subscription, new PropertyValue<string>(value));
+	});
 
 	args.GetReturnValue().Set(Undefined(isolate));
 }
@@ -424,13 +619,11 @@ void RegisterFloat64ArrayPropertyChanged(const FunctionCallbackInfo<Value>& args
 	Isolate * isolate = args.GetIsolate();
 
 	int propertyId = Local<Integer>::Cast(args[0])->Value();
-	Local<Function> callback = Local<Function>::Cast(args[1]);
+	JSSubscription<vector<double> > * subscription = NewSubscription<vector<double> >(isolate, args[1]);
 
-	// The persistent function callback is allocated (should not) to allow to use it through the std function parameter.
-	// That could lead to a memory leak.
-	Persistent<Function>* pCallback = new Persistent<Function>();
-	pCallback->Reset(isolate, callback);
-	accessor.registerFloat64ArrayPropertyChanged(propertyId, std::bind(&Float64ArrayPropertyChanged, pCallback, _1));
+	accessor.registerFloat64ArrayPropertyChanged(propertyId, [subscription](const std::vector<double>& value) {
+		dispatcher.post(subscription, new PropertyValue<vector<double> >(value));
+	});
 
 	args.GetReturnValue().Set(Undefined(isolate));
 }
@@ -440,17 +633,67 @@ void RegisterInt32ArrayPropertyChanged(const FunctionCallbackInfo<Value>& args)
 	Isolate * isolate = args.GetIsolate();
 
 	int propertyId = Local<Integer>::Cast(args[0])->Value();
-	Local<Function> callback = Local<Function>::Cast(args[1]);
+	JSSubscription<vector<int32_t> > * subscription = NewSubscription<vector<int32_t> >(isolate, args[1]);
 
-	// The persistent function callback is allocated (should not) to allow to use it through the std function parameter.
-	// That could lead to a memory leak.
-	Persistent<Function>* pCallback = new Persistent<Function>();
-	pCallback->Reset(isolate, callback);
-	accessor.registerInt32ArrayPropertyChanged(propertyId, std::bind(&Int32ArrayPropertyChanged, pCallback, _1));
+	accessor.registerInt32ArrayPropertyChanged(propertyId, [subscription](const std::vector<int32_t>& value) {
+		dispatcher.post(subscription, new PropertyValue<vector<int32_t> >(value));
+	});
 
 	args.GetReturnValue().Set(Undefined(isolate));
 }
 
+/**
+ * Gets the dispatch counters {queued, coalesced, delivered, batches}.
+ * Coalesced changes were replaced by a newer value of the same property before being delivered.
+ */
+void GetDispatchStats(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+
+	PropertyDispatcher::Stats stats = dispatcher.stats();
+
+	Local<Object> result = Object::New(isolate);
+	result->Set(String::NewFromUtf8(isolate, "queued"), Number::New(isolate, stats.queued));
+	result->Set(String::NewFromUtf8(isolate, "coalesced"), Number::New(isolate, stats.coalesced));
+	result->Set(String::NewFromUtf8(isolate, "delivered"), Number::New(isolate, stats.delivered));
+	result->Set(String::NewFromUtf8(isolate, "batches"), Number::New(isolate, stats.batches));
+
+	args.GetReturnValue().Set(result);
+}
+
+/**
+ * Gets the stats {time, addon, histograms, counters, gauges, events} without waiting on Nomad.
+ * The histograms give the count and the min, mean, percentiles and max times in us, the times are wall clock ms.
+ */
+void GetStats(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+
+	Local<String> json = String::NewFromUtf8(isolate, stats.toJson().c_str());
+
+	args.GetReturnValue().Set(v8::JSON::Parse(isolate->GetCurrentContext(), json).ToLocalChecked());
+}
+
+/**
+ * Starts appending the stats to the file every period in ms.
+ */
+void StartStatsDump(const FunctionCallbackInfo<Value>& args) {
+
+	v8::String::Utf8Value param0(args[0]->ToString());
+	std::string path(*param0);
+
+	int periodMs = Local<Integer>::Cast(args[1])->Value();
+
+	args.GetReturnValue().Set(Boolean::New(args.GetIsolate(), stats.startDump(path, periodMs)));
+}
+
+void StopStatsDump(const FunctionCallbackInfo<Value>& args) {
+
+	stats.stopDump();
+
+	args.GetReturnValue().Set(Undefined(args.GetIsolate()));
+}
+
 /**
  * The init function declares what we will make visible to node.
  */
@@ -470,12 +713,18 @@ void init(Local<Object> exports) {
 	NODE_SET_METHOD(exports, "setInt32Property", SetInt32Property);
 	NODE_SET_METHOD(exports, "setStringProperty", SetStringProperty);
 	NODE_SET_METHOD(exports, "setBooleanProperty", SetBooleanProperty);
+	NODE_SET_METHOD(exports, "getProperties", GetProperties);
+	NODE_SET_METHOD(exports, "setProperties", SetProperties);
 	NODE_SET_METHOD(exports, "registerFloat64PropertyChanged", RegisterFloat64PropertyChanged);
 	NODE_SET_METHOD(exports, "registerInt32PropertyChanged", RegisterInt32PropertyChanged);
 	NODE_SET_METHOD(exports, "registerBooleanPropertyChanged", RegisterBooleanPropertyChanged);
 	NODE_SET_METHOD(exports, "registerStringPropertyChanged", RegisterStringPropertyChanged);
 	NODE_SET_METHOD(exports, "registerFloat64ArrayPropertyChanged", RegisterFloat64ArrayPropertyChanged);
 	NODE_SET_METHOD(exports, "registerInt32ArrayPropertyChanged", RegisterInt32ArrayPropertyChanged);
+	NODE_SET_METHOD(exports, "getDispatchStats", GetDispatchStats);
+	NODE_SET_METHOD(exports, "getStats", GetStats);
+	NODE_SET_METHOD(exports, "startStatsDump", StartStatsDump);
+	NODE_SET_METHOD(exports, "stopStatsDump", StopStatsDump);
 }
 
 NODE_MODULE(cameonomadAddon, init)
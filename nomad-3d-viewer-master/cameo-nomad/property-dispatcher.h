@@ -0,0 +1,149 @@
+#ifndef NOMAD_PROPERTYDISPATCHER_H
+#define NOMAD_PROPERTYDISPATCHER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace nomad {
+
+/**
+ * Dispatches the property changes received on the Nomad threads to the JS thread.
+ * Each subscription keeps only its newest value: a value that was not delivered yet is replaced
+ * by the next one. The subscriptions with a pending value are pushed once into a lock-free
+ * multi-producer single-consumer list that the JS thread drains in one batch.
+ */
+class PropertyDispatcher {
+
+public:
+	/**
+	 * Base of the values posted to a subscription.
+	 */
+	struct Value {
+		virtual ~Value() {}
+	};
+
+	/**
+	 * Base of the subscriptions. deliver() is called on the consumer thread with the newest value.
+	 */
+	struct Subscription {
+		std::atomic<Value *> latest;
+		Subscription * next;
+
+		Subscription() : latest(0), next(0) {}
+
+		virtual ~Subscription() {
+			delete latest.exchange(0);
+		}
+
+		virtual void deliver(Value * value) = 0;
+	};
+
+	/**
+	 * Dispatch counters.
+	 */
+	struct Stats {
+		uint64_t queued;
+		uint64_t coalesced;
+		uint64_t delivered;
+		uint64_t batches;
+	};
+
+	PropertyDispatcher() : m_head(0), m_queued(0), m_coalesced(0), m_delivered(0), m_batches(0) {}
+
+	/**
+	 * Sets the function that wakes up the consumer thread, for instance uv_async_send.
+	 */
+	void setNotifier(std::function<void ()> notifier) {
+		m_notifier = notifier;
+	}
+
+	/**
+	 * Posts a value to the subscription. Called by any producer thread, never blocks.
+	 * The dispatcher takes the ownership of the value.
+	 */
+	void post(Subscription * subscription, Value * value) {
+
+		++m_queued;
+
+		Value * previous = subscription->latest.exchange(value, std::memory_order_acq_rel);
+
+		if (previous != 0) {
+			// The subscription is already in the list: the previous value is replaced.
+			delete previous;
+			++m_coalesced;
+			return;
+		}
+
+		Subscription * head = m_head.load(std::memory_order_relaxed);
+		do {
+			subscription->next = head;
+		}
+		while (!m_head.compare_exchange_weak(head, subscription, std::memory_order_release, std::memory_order_relaxed));
+
+		if (m_notifier) {
+			m_notifier();
+		}
+	}
+
+	/**
+	 * Delivers the newest value of every pending subscription. Called by the consumer thread.
+	 * Returns the number of delivered values.
+	 */
+	size_t dispatch() {
+
+		Subscription * subscription = m_head.exchange(0, std::memory_order_acquire);
+
+		if (subscription == 0) {
+			return 0;
+		}
+
+		// Collect the list before taking the values: a subscription can be pushed again once its value is taken.
+		m_pending.clear();
+		for (; subscription != 0; subscription = subscription->next) {
+			m_pending.push_back(subscription);
+		}
+
+		size_t count = 0;
+
+		// The list is in reverse order of arrival.
+		for (size_t i = m_pending.size(); i > 0; --i) {
+			Value * value = m_pending[i - 1]->latest.exchange(0, std::memory_order_acq_rel);
+			if (value != 0) {
+				m_pending[i - 1]->deliver(value);
+				delete value;
+				++count;
+			}
+		}
+
+		m_delivered += count;
+		++m_batches;
+
+		return count;
+	}
+
+	Stats stats() const {
+		Stats stats;
+		stats.queued = m_queued;
+		stats.coalesced = m_coalesced;
+		stats.delivered = m_delivered;
+		stats.batches = m_batches;
+		return stats;
+	}
+
+private:
+	std::atomic<Subscription *> m_head;
+	std::function<void ()> m_notifier;
+	std::vector<Subscription *> m_pending;
+
+	std::atomic<uint64_t> m_queued;
+	std::atomic<uint64_t> m_coalesced;
+	std::atomic<uint64_t> m_delivered;
+	std::atomic<uint64_t> m_batches;
+};
+
+}
+
+#endif
@@ -0,0 +1,356 @@
+#include "aabb-tree.h"
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std;
+
+namespace nomad {
+
+const int32_t AabbTree::NULL_NODE;
+
+AabbTree::AabbTree() : m_root(NULL_NODE), m_free(NULL_NODE) {
+}
+
+void AabbTree::clear() {
+	m_nodes.clear();
+	m_root = NULL_NODE;
+	m_free = NULL_NODE;
+}
+
+int32_t AabbTree::allocate() {
+
+	int32_t node;
+
+	if (m_free != NULL_NODE) {
+		node = m_free;
+		m_free = m_nodes[node].parent;
+	}
+	else {
+		node = m_nodes.size();
+		m_nodes.push_back(Node());
+	}
+
+	m_nodes[node].parent = NULL_NODE;
+	m_nodes[node].left = NULL_NODE;
+	m_nodes[node].right = NULL_NODE;
+	m_nodes[node].height = 0;
+	m_nodes[node].data = -1;
+
+	return node;
+}
+
+void AabbTree::release(int32_t node) {
+	// The free list is chained through the parents.
+	m_nodes[node].parent = m_free;
+	m_nodes[node].height = -1;
+	m_free = node;
+}
+
+int32_t AabbTree::insert(const Aabb& box, int32_t data) {
+
+	int32_t proxy = allocate();
+
+	m_nodes[proxy].box = box;
+	m_nodes[proxy].data = data;
+
+	insertLeaf(proxy);
+
+	return proxy;
+}
+
+void AabbTree::remove(int32_t proxy) {
+	removeLeaf(proxy);
+	release(proxy);
+}
+
+bool AabbTree::move(int32_t proxy, const Aabb& box, double fatten) {
+
+	if (m_nodes[proxy].box.contains(box)) {
+		return false;
+	}
+
+	removeLeaf(proxy);
+	m_nodes[proxy].box = box.expanded(fatten);
+	insertLeaf(proxy);
+
+	return true;
+}
+
+const Aabb& AabbTree::fatBox(int32_t proxy) const {
+	return m_nodes[proxy].box;
+}
+
+int32_t AabbTree::data(int32_t proxy) const {
+	return m_nodes[proxy].data;
+}
+
+int32_t AabbTree::height() const {
+	return (m_root == NULL_NODE ? 0 : m_nodes[m_root].height);
+}
+
+void AabbTree::query(const Aabb& box, function<void (int32_t)> callback) const {
+
+	if (m_root == NULL_NODE) {
+		return;
+	}
+
+	m_stack.clear();
+	m_stack.push_back(m_root);
+
+	while (!m_stack.empty()) {
+
+		int32_t node = m_stack.back();
+		m_stack.pop_back();
+
+		const Node& current = m_nodes[node];
+
+		if (!current.box.overlaps(box)) {
+			continue;
+		}
+
+		if (current.isLeaf()) {
+			callback(current.data);
+		}
+		else {
+			m_stack.push_back(current.left);
+			m_stack.push_back(current.right);
+		}
+	}
+}
+
+void AabbTree::insertLeaf(int32_t leaf) {
+
+	if (m_root == NULL_NODE) {
+		m_root = leaf;
+		m_nodes[leaf].parent = NULL_NODE;
+		return;
+	}
+
+	// Find the best sibling with the surface area heuristic.
+	Aabb leafBox = m_nodes[leaf].box;
+	int32_t index = m_root;
+
+	while (!m_nodes[index].isLeaf()) {
+
+		int32_t left = m_nodes[index].left;
+		int32_t right = m_nodes[index].right;
+
+		double area = m_nodes[index].box.perimeter();
+		double combinedArea = m_nodes[index].box.merged(leafBox).perimeter();
+
+		// Cost of creating a new parent for this node and the new leaf.
+		double cost = 2.0 * combinedArea;
+
+		// Minimum cost of pushing the leaf further down the tree.
+		double inheritanceCost = 2.0 * (combinedArea - area);
+
+		double costLeft = leafBox.merged(m_nodes[left].box).perimeter() + inheritanceCost;
+		if (!m_nodes[left].isLeaf()) {
+			costLeft -= m_nodes[left].box.perimeter();
+		}
+
+		double costRight = leafBox.merged(m_nodes[right].box).perimeter() + inheritanceCost;
+		if (!m_nodes[right].isLeaf()) {
+			costRight -= m_nodes[right].box.perimeter();
+		}
+
+		if (cost < costLeft && cost < costRight) {
+			break;
+		}
+
+		index = (costLeft < costRight ? left : right);
+	}
+
+	int32_t sibling = index;
+
+	// Create a new parent.
+	int32_t oldParent = m_nodes[sibling].parent;
+	int32_t newParent = allocate();
+
+	m_nodes[newParent].parent = oldParent;
+	m_nodes[newParent].box = leafBox.merged(m_nodes[sibling].box);
+	m_nodes[newParent].height = m_nodes[sibling].height + 1;
+	m_nodes[newParent].left = sibling;
+	m_nodes[newParent].right = leaf;
+	m_nodes[sibling].parent = newParent;
+	m_nodes[leaf].parent = newParent;
+
+	if (oldParent != NULL_NODE) {
+		if (m_nodes[oldParent].left == sibling) {
+			m_nodes[oldParent].left = newParent;
+		}
+		else {
+			m_nodes[oldParent].right = newParent;
+		}
+	}
+	else {
+		m_root = newParent;
+	}
+
+	// Walk back up the tree fixing the heights and boxes.
+	index = m_nodes[leaf].parent;
+
+	while (index != NULL_NODE) {
+
+		index = balance(index);
+
+		int32_t left = m_nodes[index].left;
+		int32_t right = m_nodes[index].right;
+
+		m_nodes[index].height = 1 + max(m_nodes[left].height, m_nodes[right].height);
+		m_nodes[index].box = m_nodes[left].box.merged(m_nodes[right].box);
+
+		index = m_nodes[index].parent;
+	}
+}
+
+void AabbTree::removeLeaf(int32_t leaf) {
+
+	if (leaf == m_root) {
+		m_root = NULL_NODE;
+		return;
+	}
+
+	int32_t parent = m_nodes[leaf].parent;
+	int32_t grandParent = m_nodes[parent].parent;
+	int32_t sibling = (m_nodes[parent].left == leaf ? m_nodes[parent].right : m_nodes[parent].left);
+
+	if (grandParent == NULL_NODE) {
+		m_root = sibling;
+		m_nodes[sibling].parent = NULL_NODE;
+		release(parent);
+		return;
+	}
+
+	// Connect the sibling to the grand parent and destroy the parent.
+	if (m_nodes[grandParent].left == parent) {
+		m_nodes[grandParent].left = sibling;
+	}
+	else {
+		m_nodes[grandParent].right = sibling;
+	}
+
+	m_nodes[sibling].parent = grandParent;
+	release(parent);
+
+	int32_t index = grandParent;
+
+	while (index != NULL_NODE) {
+
+		index = balance(index);
+
+		int32_t left = m_nodes[index].left;
+		int32_t right = m_nodes[index].right;
+
+		m_nodes[index].box = m_nodes[left].box.merged(m_nodes[right].box);
+		m_nodes[index].height = 1 + max(m_nodes[left].height, m_nodes[right].height);
+
+		index = m_nodes[index].parent;
+	}
+}
+
+int32_t AabbTree::balance(int32_t a) {
+
+	Node& A = m_nodes[a];
+
+	if (A.isLeaf() || A.height < 2) {
+		return a;
+	}
+
+	int32_t b = A.left;
+	int32_t c = A.right;
+
+	int32_t heightBalance = m_nodes[c].height - m_nodes[b].height;
+
+	// Rotate C up.
+	if (heightBalance > 1) {
+
+		int32_t f = m_nodes[c].left;
+		int32_t g = m_nodes[c].right;
+
+		m_nodes[c].left = a;
+		m_nodes[c].parent = A.parent;
+		A.parent = c;
+
+		if (m_nodes[c].parent != NULL_NODE) {
+			if (m_nodes[m_nodes[c].parent].left == a) {
+				m_nodes[m_nodes[c].parent].left = c;
+			}
+			else {
+				m_nodes[m_nodes[c].parent].right = c;
+			}
+		}
+		else {
+			m_root = c;
+		}
+
+		if (m_nodes[f].height > m_nodes[g].height) {
+			m_nodes[c].right = f;
+			A.right = g;
+			m_nodes[g].parent = a;
+			A.box = m_nodes[b].box.merged(m_nodes[g].box);
+			m_nodes[c].box = A.box.merged(m_nodes[f].box);
+			A.height = 1 + max(m_nodes[b].height, m_nodes[g].height);
+			m_nodes[c].height = 1 + max(A.height, m_nodes[f].height);
+		}
+		else {
+			m_nodes[c].right = g;
+			A.right = f;
+			m_nodes[f].parent = a;
+			A.box = m_nodes[b].box.merged(m_nodes[f].box);
+			m_nodes[c].box = A.box.merged(m_nodes[g].box);
+			A.height = 1 + max(m_nodes[b].height, m_nodes[f].height);
+			m_nodes[c].height = 1 + max(A.height, m_nodes[g].height);
+		}
+
+		return c;
+	}
+
+	// Rotate B up.
+	if (heightBalance < -1) {
+
+		int32_t d = m_nodes[b].left;
+		int32_t e = m_nodes[b].right;
+
+		m_nodes[b].left = a;
+		m_nodes[b].parent = A.parent;
+		A.parent = b;
+
+		if (m_nodes[b].parent != NULL_NODE) {
+			if (m_nodes[m_nodes[b].parent].left == a) {
+				m_nodes[m_nodes[b].parent].left = b;
+			}
+			else {
+				m_nodes[m_nodes[b].parent].right = b;
+			}
+		}
+		else {
+			m_root = b;
+		}
+
+		if (m_nodes[d].height > m_nodes[e].height) {
+			m_nodes[b].right = d;
+			A.left = e;
+			m_nodes[e].parent = a;
+			A.box = m_nodes[c].box.merged(m_nodes[e].box);
+			m_nodes[b].box = A.box.merged(m_nodes[d].box);
+			A.height = 1 + max(m_nodes[c].height, m_nodes[e].height);
+			m_nodes[b].height = 1 + max(A.height, m_nodes[d].height);
+		}
+		else {
+			m_nodes[b].right = e;
+			A.left = d;
+			m_nodes[d].parent = a;
+			A.box = m_nodes[c].box.merged(m_nodes[d].box);
+			m_nodes[b].box = A.box.merged(m_nodes[e].box);
+			A.height = 1 + max(m_nodes[c].height, m_nodes[d].height);
+			m_nodes[b].height = 1 + max(A.height, m_nodes[e].height);
+		}
+
+		return b;
+	}
+
+	return a;
+}
+
+}
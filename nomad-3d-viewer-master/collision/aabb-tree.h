@@ -0,0 +1,124 @@
+#ifndef NOMAD_AABBTREE_H
+#define NOMAD_AABBTREE_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace nomad {
+
+/**
+ * Axis aligned bounding box.
+ */
+struct Aabb {
+	double min[3];
+	double max[3];
+
+	bool overlaps(const Aabb& other) const {
+		for (int i = 0; i < 3; ++i) {
+			if (max[i] < other.min[i] || min[i] > other.max[i]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool contains(const Aabb& other) const {
+		for (int i = 0; i < 3; ++i) {
+			if (other.min[i] < min[i] || other.max[i] > max[i]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	Aabb expanded(double extent) const {
+		Aabb result;
+		for (int i = 0; i < 3; ++i) {
+			result.min[i] = min[i] - extent;
+			result.max[i] = max[i] + extent;
+		}
+		return result;
+	}
+
+	Aabb merged(const Aabb& other) const {
+		Aabb result;
+		for (int i = 0; i < 3; ++i) {
+			result.min[i] = (min[i] < other.min[i] ? min[i] : other.min[i]);
+			result.max[i] = (max[i] > other.max[i] ? max[i] : other.max[i]);
+		}
+		return result;
+	}
+
+	/**
+	 * Half of the surface area, the cost of a node in the tree.
+	 */
+	double perimeter() const {
+		double x = max[0] - min[0], y = max[1] - min[1], z = max[2] - min[2];
+		return x * y + y * z + z * x;
+	}
+};
+
+/**
+ * Dynamic bounding volume tree. The leaves hold fat boxes so that small moves do not change the tree.
+ * The tree is balanced with rotations at insertion, as in Box2D's b2DynamicTree.
+ */
+class AabbTree {
+
+public:
+	static const int32_t NULL_NODE = -1;
+
+	AabbTree();
+
+	void clear();
+
+	/**
+	 * Inserts a proxy with the user data and returns its id.
+	 */
+	int32_t insert(const Aabb& box, int32_t data);
+	void remove(int32_t proxy);
+
+	/**
+	 * Moves a proxy. The tree is only changed if the box leaves the fat box. Returns true if it was changed.
+	 */
+	bool move(int32_t proxy, const Aabb& box, double fatten);
+
+	const Aabb& fatBox(int32_t proxy) const;
+	int32_t data(int32_t proxy) const;
+
+	/**
+	 * Calls the callback with the user data of each proxy whose fat box overlaps the box.
+	 */
+	void query(const Aabb& box, std::function<void (int32_t)> callback) const;
+
+	int32_t height() const;
+
+private:
+	struct Node {
+		Aabb box;
+		int32_t parent;
+		int32_t left;
+		int32_t right;
+		int32_t height;
+		int32_t data;
+
+		bool isLeaf() const {
+			return left == NULL_NODE;
+		}
+	};
+
+	int32_t allocate();
+	void release(int32_t node);
+	void insertLeaf(int32_t leaf);
+	void removeLeaf(int32_t leaf);
+	int32_t balance(int32_t node);
+
+	std::vector<Node> m_nodes;
+	int32_t m_root;
+	int32_t m_free;
+	mutable std::vector<int32_t> m_stack;
+};
+
+}
+
+#endif
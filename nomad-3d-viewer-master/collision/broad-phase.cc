@@ -0,0 +1,122 @@
+#include "broad-phase.h"
+#include <cmath>
+
+using namespace std;
+
+namespace nomad {
+
+BroadPhase::BroadPhase() {
+	m_stats = BroadPhaseStats();
+}
+
+void BroadPhase::setBodies(const double* localBoxes, const int32_t* groups, size_t count) {
+
+	m_localBoxes.assign(localBoxes, localBoxes + 6 * count);
+	m_groups.assign(groups, groups + count);
+	m_proxies.assign(count, AabbTree::NULL_NODE);
+	m_worldBoxes.resize(count);
+	m_pairs.clear();
+	m_tree.clear();
+
+	m_stats = BroadPhaseStats();
+	m_stats.bodies = count;
+}
+
+size_t BroadPhase::bodiesCount() const {
+	return m_groups.size();
+}
+
+void BroadPhase::transform(const double* local, const double* matrix, Aabb& world) const {
+
+	// Arvo's method: each world axis is the translation plus the extremes of the rotated local axes.
+	for (int i = 0; i < 3; ++i) {
+
+		world.min[i] = matrix[12 + i];
+		world.max[i] = matrix[12 + i];
+
+		for (int j = 0; j < 3; ++j) {
+			double a = matrix[4 * j + i] * local[j];
+			double b = matrix[4 * j + i] * local[3 + j];
+
+			if (a < b) {
+				world.min[i] += a;
+				world.max[i] += b;
+			}
+			else {
+				world.min[i] += b;
+				world.max[i] += a;
+			}
+		}
+	}
+}
+
+size_t BroadPhase::update(const double* matrices, double margin) {
+
+	size_t count = m_groups.size();
+	double extent = 0.5 * margin;
+
+	// The fat boxes let the bodies move by a margin before the tree changes.
+	double fatten = (margin > 0.0 ? margin : 0.0);
+
+	for (size_t i = 0; i < count; ++i) {
+
+		transform(&m_localBoxes[6 * i], &matrices[16 * i], m_worldBoxes[i]);
+		m_worldBoxes[i] = m_worldBoxes[i].expanded(extent);
+
+		if (m_proxies[i] == AabbTree::NULL_NODE) {
+			m_proxies[i] = m_tree.insert(m_worldBoxes[i].expanded(fatten), i);
+		}
+		else {
+			m_tree.move(m_proxies[i], m_worldBoxes[i], fatten);
+		}
+	}
+
+	m_pairs.clear();
+
+	for (size_t i = 0; i < count; ++i) {
+
+		// Static bodies only query against moving ones, which find them in their own query.
+		if (m_groups[i] == 0) {
+			continue;
+		}
+
+		const Aabb& box = m_worldBoxes[i];
+		int32_t group = m_groups[i];
+		int32_t body = i;
+
+		m_tree.query(box, [&](int32_t other) {
+
+			if (other == body || m_groups[other] == group) {
+				return;
+			}
+
+			// Report the moving pairs once.
+			if (m_groups[other] != 0 && other < body) {
+				return;
+			}
+
+			if (box.overlaps(m_worldBoxes[other])) {
+				m_pairs.push_back(body);
+				m_pairs.push_back(other);
+			}
+		});
+	}
+
+	m_stats.updates++;
+	if (m_pairs.empty()) {
+		m_stats.clearUpdates++;
+	}
+	m_stats.pairs += m_pairs.size() / 2;
+
+	return m_pairs.size() / 2;
+}
+
+const vector<int32_t>& BroadPhase::pairs() const {
+	return m_pairs;
+}
+
+BroadPhaseStats BroadPhase::stats() const {
+	return m_stats;
+}
+
+}
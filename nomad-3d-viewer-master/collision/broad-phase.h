@@ -0,0 +1,64 @@
+#ifndef NOMAD_BROADPHASE_H
+#define NOMAD_BROADPHASE_H
+
+#include "aabb-tree.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace nomad {
+
+/**
+ * Broad phase statistics.
+ */
+struct BroadPhaseStats {
+	uint64_t bodies;
+	uint64_t updates;
+	uint64_t clearUpdates;
+	uint64_t pairs;
+};
+
+/**
+ * Local broad phase that finds the pairs of bodies whose world boxes come closer than the margin.
+ * Each body has a group: pairs inside the same group are ignored, as are the pairs of two static bodies (group 0).
+ * When there is no candidate pair, the collision server has nothing to report and the request can be skipped.
+ */
+class BroadPhase {
+
+public:
+	BroadPhase();
+
+	/**
+	 * Sets the bodies from their local boxes (6 values per body: min then max) and their groups.
+	 */
+	void setBodies(const double* localBoxes, const int32_t* groups, size_t count);
+
+	size_t bodiesCount() const;
+
+	/**
+	 * Updates the world boxes from the column-major world matrices (16 values per body) and returns the number of candidate pairs.
+	 */
+	size_t update(const double* matrices, double margin);
+
+	/**
+	 * The candidate pairs of the last update, two body indices per pair.
+	 */
+	const std::vector<int32_t>& pairs() const;
+
+	BroadPhaseStats stats() const;
+
+private:
+	void transform(const double* local, const double* matrix, Aabb& world) const;
+
+	std::vector<double> m_localBoxes;
+	std::vector<int32_t> m_groups;
+	std::vector<int32_t> m_proxies;
+	std::vector<Aabb> m_worldBoxes;
+	std::vector<int32_t> m_pairs;
+	AabbTree m_tree;
+	BroadPhaseStats m_stats;
+};
+
+}
+
+#endif
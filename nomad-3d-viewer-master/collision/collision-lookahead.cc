@@ -0,0 +1,468 @@
+#include "collision-lookahead.h"
+#include "positions-json.h"
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+namespace nomad {
+
+/**
+ * Below this interval between two submissions, the velocities are kept.
+ */
+static const double MIN_INTERVAL_MS = 1.0;
+
+/**
+ * Time after which a batch request without response is canceled.
+ */
+static const chrono::milliseconds REQUEST_TIMEOUT(1000);
+
+/**
+ * Delays before the next batch after successive timeouts, doubled from the first to the last.
+ */
+static const chrono::milliseconds FIRST_BACKOFF(100);
+static const chrono::milliseconds MAX_BACKOFF(5000);
+
+/**
+ * Finds the number of the member with the name in a JSON response.
+ */
+static bool FindNumber(const string& json, const char * name, double& value) {
+
+	string key = string("\"") + name + "\"";
+
+	size_t position = json.find(key);
+	if (position == string::npos) {
+		return false;
+	}
+
+	const char * c = json.c_str() + position + key.size();
+	while (*c == ' ' || *c == ':') {
+		++c;
+	}
+
+	char * end;
+	value = strtod(c, &end);
+
+	return end != c;
+}
+
+static bool IsColliding(const string& response) {
+	return response.find("\"COLLIDING\"") != string::npos;
+}
+
+CollisionLookahead::CollisionLookahead() :
+	m_steps(0),
+	m_stepMs(0.0),
+	m_running(false),
+	m_inFlight(false),
+	m_canceled(false),
+	m_pendingSequence(0),
+	m_sequence(0),
+	m_supported(true),
+	m_verdictTaken(true),
+	m_submitted(0),
+	m_checked(0),
+	m_still(0),
+	m_replaced(0),
+	m_colliding(0),
+	m_requests(0),
+	m_timeouts(0) {
+}
+
+CollisionLookahead::~CollisionLookahead() {
+	stop();
+}
+
+void CollisionLookahead::start(int steps, double stepMs, RequestFunction request, CancelFunction cancel) {
+
+	stop();
+
+	m_request = request;
+	m_cancel = cancel;
+	m_steps = steps;
+	m_stepMs = stepMs;
+	m_supported = true;
+	m_inFlight = false;
+	m_canceled = false;
+	m_names.clear();
+	m_values.clear();
+	m_velocities.clear();
+
+	m_running = true;
+	m_thread = thread(&CollisionLookahead::run, this);
+	m_watchdog = thread(&CollisionLookahead::watch, this);
+
+	event("lookahead-started", {{"steps", AddonStats::number(steps)}, {"stepMs", AddonStats::number(stepMs)}});
+}
+
+void CollisionLookahead::stop() {
+
+	if (!m_thread.joinable()) {
+		return;
+	}
+
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_running = false;
+	}
+	m_condition.notify_all();
+
+	// Unblock the request in flight.
+	{
+		lock_guard<mutex> lock(m_requestMutex);
+
+		if (m_inFlight && !m_canceled) {
+			m_canceled = true;
+			m_cancel();
+		}
+	}
+	m_requestCondition.notify_all();
+
+	m_thread.join();
+	m_watchdog.join();
+
+	event("lookahead-stopped");
+}
+
+bool CollisionLookahead::isRunning() const {
+	return m_running;
+}
+
+bool CollisionLookahead::isSupported() const {
+	return m_supported;
+}
+
+int CollisionLookahead::steps() const {
+	return m_steps;
+}
+
+double CollisionLookahead::stepMs() const {
+	return m_stepMs;
+}
+
+uint64_t CollisionLookahead::submit(const string& jsonPositions) {
+
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+
+	vector<double> values;
+
+	// The velocities are estimated from the previous positions if the axes did not change.
+	if (!m_names.empty() && parsePositionValues(jsonPositions, m_names, values)) {
+
+		double intervalMs = chrono::duration<double, milli>(now - m_time).count();
+
+		if (intervalMs < MIN_INTERVAL_MS) {
+			return 0;
+		}
+
+		for (size_t i = 0; i < values.size(); ++i) {
+			m_velocities[i] = (values[i] - m_values[i]) / intervalMs;
+		}
+	}
+	else {
+		m_names.clear();
+		values.clear();
+
+		if (!parsePositions(jsonPositions, m_names, values)) {
+			m_names.clear();
+			return 0;
+		}
+
+		m_velocities.assign(values.size(), 0.0);
+	}
+
+	m_values.swap(values);
+	m_time = now;
+
+	uint64_t sequence;
+	{
+		lock_guard<mutex> lock(m_mutex);
+
+		// The pending pose was not checked yet: replace it.
+		if (m_pendingSequence != 0) {
+			++m_replaced;
+		}
+
+		sequence = ++m_sequence;
+		m_pendingNames = m_names;
+		m_pendingValues = m_values;
+		m_pendingVelocities = m_velocities;
+		m_pendingSequence = sequence;
+		m_pendingTime = now;
+	}
+	m_condition.notify_one();
+
+	++m_submitted;
+
+	return sequence;
+}
+
+bool CollisionLookahead::setTargets(const string& jsonTargets) {
+
+	vector<string> names;
+	vector<double> values;
+
+	if (!parsePositions(jsonTargets, names, values)) {
+		return false;
+	}
+
+	lock_guard<mutex> lock(m_mutex);
+
+	m_targetNames.swap(names);
+	m_targetValues.swap(values);
+
+	return true;
+}
+
+bool CollisionLookahead::takeVerdict(LookaheadVerdict& verdict) {
+
+	lock_guard<mutex> lock(m_verdictMutex);
+
+	if (m_verdictTaken) {
+		return false;
+	}
+
+	verdict = m_verdict;
+	m_verdictTaken = true;
+
+	return true;
+}
+
+LookaheadStats CollisionLookahead::stats() const {
+
+	LookaheadStats stats;
+	stats.submitted = m_submitted;
+	stats.checked = m_checked;
+	stats.still = m_still;
+	stats.replaced = m_replaced;
+	stats.colliding = m_colliding;
+	stats.requests = m_requests;
+	stats.timeouts = m_timeouts;
+
+	return stats;
+}
+
+void CollisionLookahead::interpolate(const vector<double>& values, const vector<double>& velocities,
+	const vector<double>& targets, const vector<char>& hasTarget, int steps, double stepMs, vector<double>& poses) {
+
+	size_t count = values.size();
+
+	poses.resize(count * steps);
+
+	for (int step = 1; step <= steps; ++step) {
+
+		double * pose = &poses[(step - 1) * count];
+		double timeMs = step * stepMs;
+
+		for (size_t i = 0; i < count; ++i) {
+
+			double value = values[i] + velocities[i] * timeMs;
+
+			if (hasTarget[i]) {
+				if (velocities[i] == 0.0) {
+					value = values[i] + (targets[i] - values[i]) * step / steps;
+				}
+				else if ((velocities[i] > 0.0 && value > targets[i] && targets[i] >= values[i])
+					|| (velocities[i] < 0.0 && value < targets[i] && targets[i] <= values[i])) {
+					value = targets[i];
+				}
+			}
+
+			pose[i] = value;
+		}
+	}
+}
+
+void CollisionLookahead::watch() {
+
+	unique_lock<mutex> lock(m_requestMutex);
+
+	while (m_running) {
+
+		if (!m_inFlight || m_canceled) {
+			m_requestCondition.wait(lock);
+		}
+		else if (m_requestCondition.wait_until(lock, m_deadline) == cv_status::timeout && m_inFlight && !m_canceled
+			&& chrono::steady_clock::now() >= m_deadline) {
+			m_canceled = true;
+			m_cancel();
+		}
+	}
+}
+
+/**
+ * Sends the request with a deadline. Returns false if it was canceled by the watchdog or by stop().
+ * The cancellation is reset so that the next request can be sent.
+ */
+bool CollisionLookahead::request(const string& message, string& response) {
+
+	{
+		lock_guard<mutex> lock(m_requestMutex);
+
+		if (!m_running) {
+			return false;
+		}
+
+		m_inFlight = true;
+		m_deadline = chrono::steady_clock::now() + REQUEST_TIMEOUT;
+	}
+	m_requestCondition.notify_all();
+
+	++m_requests;
+	m_request(message, response);
+
+	lock_guard<mutex> lock(m_requestMutex);
+
+	bool canceled = m_canceled;
+	m_inFlight = false;
+	m_canceled = false;
+
+	return !canceled;
+}
+
+/**
+ * Waits for the delay or until the lookahead is stopped.
+ */
+void CollisionLookahead::backoff(chrono::milliseconds delay) {
+
+	unique_lock<mutex> lock(m_mutex);
+	m_condition.wait_for(lock, delay, [this] { return !m_running; });
+}
+
+CollisionLookahead::BatchResult CollisionLookahead::checkBatch(const vector<string>& names, const vector<double>& poses, LookaheadVerdict& verdict) {
+
+	string message = "{\"type\":\"COLLISIONS_BATCH\",\"stepMs\":" + to_string(m_stepMs) + ",\"poses\":[";
+	string json;
+
+	for (int step = 0; step < m_steps; ++step) {
+		formatPositions(names, &poses[step * names.size()], json);
+		message += (step == 0) ? "" : ",";
+		message += json;
+	}
+
+	message += "]}";
+
+	if (!request(message, verdict.response)) {
+		return BATCH_TIMEOUT;
+	}
+
+	double step;
+	if (!FindNumber(verdict.response, "step", step)) {
+		return BATCH_UNSUPPORTED;
+	}
+
+	verdict.step = IsColliding(verdict.response) ? static_cast<int>(step) : 0;
+
+	return BATCH_CHECKED;
+}
+
+void CollisionLookahead::run() {
+
+	vector<string> names;
+	vector<double> values;
+	vector<double> velocities;
+	vector<double> targets;
+	vector<char> hasTarget;
+	vector<double> poses;
+	chrono::milliseconds backoffDelay(0);
+
+	while (true) {
+
+		uint64_t sequence;
+		chrono::steady_clock::time_point submitTime;
+		{
+			unique_lock<mutex> lock(m_mutex);
+			m_condition.wait(lock, [this] { return !m_running || m_pendingSequence != 0; });
+
+			if (!m_running) {
+				return;
+			}
+
+			names.swap(m_pendingNames);
+			values.swap(m_pendingValues);
+			velocities.swap(m_pendingVelocities);
+			sequence = m_pendingSequence;
+			submitTime = m_pendingTime;
+			m_pendingSequence = 0;
+
+			// The targets are matched by name, the axes without target are extrapolated.
+			targets.assign(names.size(), 0.0);
+			hasTarget.assign(names.size(), 0);
+
+			for (size_t t = 0; t < m_targetNames.size(); ++t) {
+				for (size_t i = 0; i < names.size(); ++i) {
+					if (names[i] == m_targetNames[t]) {
+						targets[i] = m_targetValues[t];
+						hasTarget[i] = 1;
+						break;
+					}
+				}
+			}
+		}
+
+		// Nothing moves: the future poses are the current one, already checked.
+		bool moving = false;
+		for (size_t i = 0; i < names.size() && !moving; ++i) {
+			moving = (velocities[i] != 0.0) || (hasTarget[i] && targets[i] != values[i]);
+		}
+
+		if (!moving || m_steps <= 0 || !m_supported) {
+			++m_still;
+			continue;
+		}
+
+		interpolate(values, velocities, targets, hasTarget, m_steps, m_stepMs, poses);
+
+		LookaheadVerdict verdict;
+
+		try {
+			// The poses are not sent one by one, the server would be left at a future pose.
+			BatchResult result = checkBatch(names, poses, verdict);
+
+			if (result == BATCH_TIMEOUT) {
+				if (!m_running) {
+					return;
+				}
+
+				// A busy server: the newest pose is checked after the backoff.
+				++m_timeouts;
+				backoffDelay = (backoffDelay.count() == 0) ? FIRST_BACKOFF : min(2 * backoffDelay, MAX_BACKOFF);
+				event("lookahead-timeout", {{"backoffMs", AddonStats::number(static_cast<int64_t>(backoffDelay.count()))}});
+				backoff(backoffDelay);
+				continue;
+			}
+
+			if (result == BATCH_UNSUPPORTED) {
+				event("lookahead-disabled", {{"reason", "the collision server does not check batches"}});
+				m_supported = false;
+				continue;
+			}
+
+			backoffDelay = chrono::milliseconds(0);
+		}
+		catch (const exception& e) {
+			event("lookahead-failed", {{"error", e.what()}});
+			continue;
+		}
+
+		++m_checked;
+		if (verdict.step > 0) {
+			++m_colliding;
+		}
+
+		verdict.sequence = sequence;
+		verdict.timeMs = verdict.step * m_stepMs;
+		verdict.latencyMs = chrono::duration<double, milli>(chrono::steady_clock::now() - submitTime).count();
+
+		lock_guard<mutex> lock(m_verdictMutex);
+
+		m_verdict.response.swap(verdict.response);
+		m_verdict.sequence = verdict.sequence;
+		m_verdict.step = verdict.step;
+		m_verdict.timeMs = verdict.timeMs;
+		m_verdict.latencyMs = verdict.latencyMs;
+		m_verdictTaken = false;
+	}
+}
+
+}
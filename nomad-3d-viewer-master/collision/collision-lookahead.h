@@ -0,0 +1,170 @@
+#ifndef NOMAD_COLLISIONLOOKAHEAD_H
+#define NOMAD_COLLISIONLOOKAHEAD_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "addon-stats.h"
+
+namespace nomad {
+
+/**
+ * Lookahead verdict for a submitted pose. The step is the earliest colliding future pose, from 1 to the number
+ * of steps, or 0 if none collides. The response is the one of the colliding pose.
+ */
+struct LookaheadVerdict {
+	std::string response;
+	uint64_t sequence;
+	int step;
+	double timeMs;
+	double latencyMs;
+
+	LookaheadVerdict() : sequence(0), step(0), timeMs(0.0), latencyMs(0.0) {}
+};
+
+/**
+ * Lookahead statistics.
+ */
+struct LookaheadStats {
+	uint64_t submitted;
+	uint64_t checked;
+	uint64_t still;
+	uint64_t replaced;
+	uint64_t colliding;
+	uint64_t requests;
+	uint64_t timeouts;
+};
+
+/**
+ * Checks the future poses of the instrument from its own thread so that a collision can be anticipated.
+ * The velocity of each axis is estimated from the successive submitted positions, an axis with a target never
+ * passes it and an axis with a target but no velocity reaches it at the end of the horizon. The K future poses
+ * are sent at once in a COLLISIONS_BATCH request answered with the earliest colliding step. The poses are never
+ * sent as COLLISIONS requests because the collision server would keep the last one as its state. A batch that is not
+ * answered before the timeout is canceled and the next one is sent after a backoff. If the collision server answers
+ * without a step, it does not check the batches and the lookahead is disabled.
+ * Only the newest submitted pose is checked, as in the pipeline.
+ */
+class CollisionLookahead : public EventSource {
+
+public:
+	/**
+	 * The request function sends the request and fills the response.
+	 */
+	typedef std::function<void (const std::string&, std::string&)> RequestFunction;
+
+	/**
+	 * The cancel function unblocks the request waiting for its response.
+	 */
+	typedef std::function<void ()> CancelFunction;
+
+	CollisionLookahead();
+	~CollisionLookahead();
+
+	void start(int steps, double stepMs, RequestFunction request, CancelFunction cancel);
+	void stop();
+	bool isRunning() const;
+
+	/**
+	 * Tells whether the collision server checks the batches. It is false once a batch was answered without a step.
+	 */
+	bool isSupported() const;
+
+	int steps() const;
+	double stepMs() const;
+
+	/**
+	 * Submits the current JSON positions and returns their sequence number, 0 if they cannot be parsed.
+	 * Called by the JS thread, never waits on the collision server.
+	 */
+	uint64_t submit(const std::string& jsonPositions);
+
+	/**
+	 * Sets the JSON targets of the moving axes. An empty object removes them.
+	 */
+	bool setTargets(const std::string& jsonTargets);
+
+	/**
+	 * Takes the newest verdict if it was not taken yet. Returns false otherwise.
+	 */
+	bool takeVerdict(LookaheadVerdict& verdict);
+
+	LookaheadStats stats() const;
+
+	/**
+	 * Fills the poses 1 to steps, packed in the order of the values. The velocities are in units per ms and
+	 * the targets are only used where hasTarget is not 0.
+	 */
+	static void interpolate(const std::vector<double>& values, const std::vector<double>& velocities,
+		const std::vector<double>& targets, const std::vector<char>& hasTarget, int steps, double stepMs, std::vector<double>& poses);
+
+private:
+	enum BatchResult {
+		BATCH_CHECKED,
+		BATCH_TIMEOUT,
+		BATCH_UNSUPPORTED
+	};
+
+	void run();
+	void watch();
+	bool request(const std::string& message, std::string& response);
+	BatchResult checkBatch(const std::vector<std::string>& names, const std::vector<double>& poses, LookaheadVerdict& verdict);
+	void backoff(std::chrono::milliseconds delay);
+
+	RequestFunction m_request;
+	CancelFunction m_cancel;
+	int m_steps;
+	double m_stepMs;
+	std::atomic<bool> m_running;
+	std::thread m_thread;
+
+	// The watchdog cancels the request in flight at its deadline or when the lookahead is stopped.
+	std::thread m_watchdog;
+	std::mutex m_requestMutex;
+	std::condition_variable m_requestCondition;
+	bool m_inFlight;
+	bool m_canceled;
+	std::chrono::steady_clock::time_point m_deadline;
+
+	// Last submitted positions used to estimate the velocities, only used by the JS thread.
+	std::vector<std::string> m_names;
+	std::vector<double> m_values;
+	std::vector<double> m_velocities;
+	std::chrono::steady_clock::time_point m_time;
+
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::vector<std::string> m_pendingNames;
+	std::vector<double> m_pendingValues;
+	std::vector<double> m_pendingVelocities;
+	uint64_t m_pendingSequence;
+	std::chrono::steady_clock::time_point m_pendingTime;
+	uint64_t m_sequence;
+	std::vector<std::string> m_targetNames;
+	std::vector<double> m_targetValues;
+
+	// Set to false once the collision server answered a batch without a step.
+	std::atomic<bool> m_supported;
+
+	std::mutex m_verdictMutex;
+	LookaheadVerdict m_verdict;
+	bool m_verdictTaken;
+
+	std::atomic<uint64_t> m_submitted;
+	std::atomic<uint64_t> m_checked;
+	std::atomic<uint64_t> m_still;
+	std::atomic<uint64_t> m_replaced;
+	std::atomic<uint64_t> m_colliding;
+	std::atomic<uint64_t> m_requests;
+	std::atomic<uint64_t> m_timeouts;
+};
+
+}
+
+#endif
@@ -0,0 +1,171 @@
+#include "collision-pipeline.h"
+
+using namespace std;
+
+namespace nomad {
+
+CollisionPipeline::CollisionPipeline() :
+	m_running(false),
+	m_pendingSequence(0),
+	m_sequence(0),
+	m_verdictTaken(true),
+	m_submitted(0),
+	m_sent(0),
+	m_dropped(0),
+	m_stale(0) {
+}
+
+CollisionPipeline::~CollisionPipeline() {
+	stop();
+}
+
+bool CollisionPipeline::start(int depth, RequestFactory factory) {
+
+	stop();
+
+	m_running = true;
+
+	for (int i = 0; i < depth; ++i) {
+		RequestFunction request = factory();
+		if (!request) {
+			event("pipeline-worker-failed", {{"worker", AddonStats::number(i)}});
+			break;
+		}
+		m_workers.push_back(thread(&CollisionPipeline::run, this, request));
+	}
+
+	if (m_workers.empty()) {
+		m_running = false;
+		return false;
+	}
+
+	event("pipeline-started", {{"depth", AddonStats::number(static_cast<uint64_t>(m_workers.size()))}});
+
+	return true;
+}
+
+void CollisionPipeline::stop() {
+
+	if (m_workers.empty()) {
+		return;
+	}
+
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_running = false;
+	}
+	m_condition.notify_all();
+
+	for (size_t i = 0; i < m_workers.size(); ++i) {
+		m_workers[i].join();
+	}
+	m_workers.clear();
+
+	event("pipeline-stopped");
+}
+
+bool CollisionPipeline::isRunning() const {
+	return m_running;
+}
+
+int CollisionPipeline::depth() const {
+	return m_workers.size();
+}
+
+uint64_t CollisionPipeline::submit(const string& message) {
+
+	uint64_t sequence;
+	{
+		lock_guard<mutex> lock(m_mutex);
+
+		// The pending request was not sent because all the workers are busy: replace it.
+		if (m_pendingSequence != 0) {
+			++m_dropped;
+		}
+
+		sequence = ++m_sequence;
+		m_pendingMessage = message;
+		m_pendingSequence = sequence;
+		m_pendingTime = chrono::steady_clock::now();
+	}
+	m_condition.notify_one();
+
+	++m_submitted;
+
+	return sequence;
+}
+
+bool CollisionPipeline::takeVerdict(PipelineVerdict& verdict) {
+
+	lock_guard<mutex> lock(m_verdictMutex);
+
+	if (m_verdictTaken) {
+		return false;
+	}
+
+	verdict = m_verdict;
+	m_verdictTaken = true;
+
+	return true;
+}
+
+PipelineStats CollisionPipeline::stats() const {
+
+	PipelineStats stats;
+	stats.submitted = m_submitted;
+	stats.sent = m_sent;
+	stats.dropped = m_dropped;
+	stats.stale = m_stale;
+
+	return stats;
+}
+
+void CollisionPipeline::run(RequestFunction request) {
+
+	string message;
+	string response;
+
+	while (true) {
+
+		uint64_t sequence;
+		chrono::steady_clock::time_point submitTime;
+		{
+			unique_lock<mutex> lock(m_mutex);
+			m_condition.wait(lock, [this] { return !m_running || m_pendingSequence != 0; });
+
+			if (!m_running) {
+				return;
+			}
+
+			message.swap(m_pendingMessage);
+			sequence = m_pendingSequence;
+			submitTime = m_pendingTime;
+			m_pendingSequence = 0;
+		}
+
+		++m_sent;
+
+		try {
+			request(message, response);
+		}
+		catch (const exception& e) {
+			event("pipeline-failed", {{"error", e.what()}});
+			continue;
+		}
+
+		lock_guard<mutex> lock(m_verdictMutex);
+
+		// A newer request may have been answered first by another worker.
+		if (sequence < m_verdict.sequence) {
+			++m_stale;
+			continue;
+		}
+
+		m_verdict.response.swap(response);
+		m_verdict.sequence = sequence;
+		m_verdict.latencyMs = chrono::duration<double, milli>(chrono::steady_clock::now() - submitTime).count();
+		m_verdictTaken = false;
+	}
+}
+
+}
@@ -0,0 +1,104 @@
+#ifndef NOMAD_COLLISIONPIPELINE_H
+#define NOMAD_COLLISIONPIPELINE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "addon-stats.h"
+
+namespace nomad {
+
+/**
+ * Collision verdict for a submitted request.
+ */
+struct PipelineVerdict {
+	std::string response;
+	uint64_t sequence;
+	double latencyMs;
+
+	PipelineVerdict() : sequence(0), latencyMs(0.0) {}
+};
+
+/**
+ * Pipeline statistics.
+ */
+struct PipelineStats {
+	uint64_t submitted;
+	uint64_t sent;
+	uint64_t dropped;
+	uint64_t stale;
+};
+
+/**
+ * Collision client that keeps up to N requests in flight, one per worker thread with its own requester.
+ * Requests are tagged with a sequence number. When all the workers are busy, a newer request replaces the
+ * pending one so that the checked state is always the newest. Verdicts older than the last delivered one are dropped.
+ */
+class CollisionPipeline : public EventSource {
+
+public:
+	/**
+	 * The request function sends the request and fills the response.
+	 */
+	typedef std::function<void (const std::string&, std::string&)> RequestFunction;
+
+	/**
+	 * Creates the request function of a worker. Returns an empty function if the requester cannot be created.
+	 */
+	typedef std::function<RequestFunction ()> RequestFactory;
+
+	CollisionPipeline();
+	~CollisionPipeline();
+
+	/**
+	 * Starts the workers. Returns false if no worker could be started.
+	 */
+	bool start(int depth, RequestFactory factory);
+	void stop();
+	bool isRunning() const;
+	int depth() const;
+
+	/**
+	 * Submits a request and returns its sequence number. Never waits on the collision server.
+	 */
+	uint64_t submit(const std::string& message);
+
+	/**
+	 * Takes the newest verdict if it was not taken yet. Returns false otherwise.
+	 */
+	bool takeVerdict(PipelineVerdict& verdict);
+
+	PipelineStats stats() const;
+
+private:
+	void run(RequestFunction request);
+
+	std::atomic<bool> m_running;
+	std::vector<std::thread> m_workers;
+
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::string m_pendingMessage;
+	uint64_t m_pendingSequence;
+	std::chrono::steady_clock::time_point m_pendingTime;
+	uint64_t m_sequence;
+
+	std::mutex m_verdictMutex;
+	PipelineVerdict m_verdict;
+	bool m_verdictTaken;
+
+	std::atomic<uint64_t> m_submitted;
+	std::atomic<uint64_t> m_sent;
+	std::atomic<uint64_t> m_dropped;
+	std::atomic<uint64_t> m_stale;
+};
+
+}
+
+#endif
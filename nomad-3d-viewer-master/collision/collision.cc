@@ -6,7 +6,15 @@
 #include <sstream>
 #include <functional>
 #include <string>
+#include <mutex>
+#include <chrono>
+#include <cstring>
+#include <vector>
 #include <cameo/cameo.h>
+#include "collision-pipeline.h"
+#include "collision-lookahead.h"
+#include "broad-phase.h"
+#include "addon-stats.h"
 
 using namespace std;
 using namespace std::placeholders;
@@ -25,21 +33,104 @@ using v8::Integer;
 using v8::Boolean;
 using v8::Array;
 using v8::Persistent;
+using v8::Promise;
+using v8::Exception;
+using v8::Context;
+using v8::TypedArray;
+using v8::Int32Array;
+using v8::ArrayBuffer;
 
 unique_ptr<cameo::Server> server;
 unique_ptr<cameo::application::Instance> collisionServer;
 unique_ptr<cameo::application::Requester> requester;
 Isolate * v8Isolate;
 
+// The requester is used by the synchronous functions, the async workers have their own requester so that the JS thread
+// never waits for a request in flight on a worker.
+mutex requesterMutex;
+unique_ptr<cameo::application::Requester> asyncRequester;
+mutex asyncRequesterMutex;
+
+// Round trip time of the last async collision request.
+double lastLatencyMs = 0.0;
+
+// Pipelined collision checks.
+CollisionPipeline pipeline;
+
+// Lookahead checks of the future poses.
+CollisionLookahead lookahead;
+
+// Local broad phase.
+BroadPhase broadPhase;
+vector<double> broadPhaseValues;
+vector<int32_t> broadPhaseGroups;
+
+// Latency histograms, counters and events. The histograms of the hot paths are kept by reference.
+AddonStats stats("collisions");
+LatencyHistogram& collisionsHistogram = stats.histogram("COLLISIONS");
+LatencyHistogram& verdictHistogram = stats.histogram("pipeline.verdict");
+LatencyHistogram& lookaheadHistogram = stats.histogram("lookahead.verdict");
+LatencyHistogram& queueHistogram = stats.histogram("async.queue");
+LatencyHistogram& broadPhaseHistogram = stats.histogram("broadphase.update");
+atomic<uint64_t>& bytesSent = stats.counter("bytes.sent");
+atomic<uint64_t>& bytesReceived = stats.counter("bytes.received");
+Gauge& asyncRequests = stats.gauge("async.requests");
+
 std::string COLLISION_SERVER = "n3dcollisions";
 std::string COLLISION_SERVER_GUI = "n3dcollisionsgui";
 
+/**
+ * Formats the object as it is written to a stream.
+ */
+template<typename Type>
+static string ToString(const Type& object) {
+	ostringstream text;
+	text << object;
+	return text.str();
+}
+
+/**
+ * Gets the histogram of the type of the JSON request.
+ */
+static LatencyHistogram& RequestHistogram(const string& request) {
+
+	size_t begin = request.find("\"type\":\"");
+
+	if (begin == string::npos) {
+		return stats.histogram("other");
+	}
+
+	begin += 8;
+	size_t end = request.find('"', begin);
+
+	if (request.compare(begin, end - begin, "COLLISIONS") == 0) {
+		return collisionsHistogram;
+	}
+
+	return stats.histogram(request.substr(begin, end - begin));
+}
+
+/**
+ * Sends the request with the requester and records its round trip and the bytes moved.
+ */
+static void SendRequest(cameo::application::Requester& requester, const string& request, string& response) {
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	requester.send(request);
+	requester.receive(response);
+
+	RequestHistogram(request).record(start, chrono::steady_clock::now());
+	bytesSent += request.size();
+	bytesReceived += response.size();
+}
+
 /**
  * Init function to initialise the Cameo Nomad addon.
  */
 void Init(const FunctionCallbackInfo<Value>& args) {
 
-    cout << "initialising collision detection" << endl; 
+    stats.event("init");
 
 	// Get the V8 isolate.
 	v8Isolate = args.GetIsolate();
@@ -48,52 +139,39 @@ void Init(const FunctionCallbackInfo<Value>& args) {
 	v8::String::Utf8Value param1(args[0]->ToString());
 	string electronArgs(*param1);
 
-	cout << "electron args = " << electronArgs << endl;
-
 	size_t pos = 0;
 
     // Parse the args.
 	size_t endPos = electronArgs.find_first_of(',', pos);
 	string localEndpoint = electronArgs.substr(pos, endPos - pos);
 
-	cout << "local endpoint = " << localEndpoint << endl;
-
     pos = endPos + 1;
 	endPos = electronArgs.find_first_of(',', pos);
 	string name = electronArgs.substr(pos, endPos - pos + 1);
 
-	cout << "name = " << name << endl;
-
 	pos = endPos + 1;
 	endPos = electronArgs.find_first_of(',', pos);
 	string modelDirectory = electronArgs.substr(pos, endPos - pos);
     modelDirectory += "/";
 
-	cout << "model directory = " << modelDirectory << endl;
-
 	pos = endPos + 1;
 	endPos = electronArgs.find_first_of(',', pos);
 	string fileName = electronArgs.substr(pos, endPos - pos);
 
-	cout << "model file name = " << fileName << endl;
-
 	pos = endPos + 1;
 	endPos = electronArgs.find_first_of(',', pos);
 	string lod = electronArgs.substr(pos, endPos - pos + 1);
 
-	cout << "lod = " << lod << endl;
-
     pos = endPos + 1;
 	endPos = electronArgs.find_first_of(',', pos);
 	string collisionMargin = electronArgs.substr(pos, endPos - pos + 1);
 
-	cout << "collision margin = " << collisionMargin << endl;
-
 	pos = endPos + 1;
 	endPos = electronArgs.find_first_of(',', pos);
 	string collisionGUI = electronArgs.substr(pos, endPos - pos + 1);
 
-	cout << "collision gui = " << collisionGUI << endl;
+	stats.event("args", {{"electronArgs", electronArgs}, {"localEndpoint", localEndpoint}, {"name", name}, {"modelDirectory", modelDirectory},
+		{"fileName", fileName}, {"lod", lod}, {"collisionMargin", collisionMargin}, {"collisionGUI", collisionGUI}});
 
 
     // Init the app if it is not already done.
@@ -107,7 +185,7 @@ void Init(const FunctionCallbackInfo<Value>& args) {
 
 		cameo::application::This::init(1, argv);
 
-        cout << "initialised cameo" << endl;
+        stats.event("cameo-initialised");
 	}
 
 	// Init nomad 3D collision.
@@ -115,14 +193,14 @@ void Init(const FunctionCallbackInfo<Value>& args) {
 
 	if (collisionGUI == "false") {
 
-		cout << "cameo server " << *server << endl;
+		stats.event("cameo-server", {{"server", ToString(*server)}});
 
 		collisionServer = server->connect(COLLISION_SERVER);
 		if (collisionServer->exists()) {
 			// The application exists from a previous server session
 			collisionServer->kill();
 			cameo::application::State state = collisionServer->waitFor();
-			cout << "terminated old collision server with state " << cameo::application::toString(state) << endl;
+			stats.event("old-server-terminated", {{"state", cameo::application::toString(state)}});
 		}
 
 		vector<string> appArgs;
@@ -138,20 +216,35 @@ void Init(const FunctionCallbackInfo<Value>& args) {
 	}
 
 	if (!collisionServer->exists()) {
-		cout << "no collision server" << endl;
+		stats.event("no-collision-server");
 	}
     else {
-        cout << "collision server " << *collisionServer << endl;
+        stats.event("collision-server", {{"server", ToString(*collisionServer)}});
     }
 
     // Create the requester
 	requester = cameo::application::Requester::create(*collisionServer, "update_positions");
 
 	if (requester.get() == 0) {
-		cout << "cannot create requester" << endl;
+		stats.event("requester-failed");
+		return;
+	}
+
+	// The async requests have their own requester, the lock is only taken to replace it.
+	unique_ptr<cameo::application::Requester> createdAsyncRequester = cameo::application::Requester::create(*collisionServer, "update_positions");
+
+	if (createdAsyncRequester.get() == 0) {
+		stats.event("requester-failed", {{"requester", "async"}});
 		return;
 	}
 
+	{
+		lock_guard<mutex> lock(asyncRequesterMutex);
+		asyncRequester = move(createdAsyncRequester);
+	}
+
+	stats.event("initialised");
+
 	args.GetReturnValue().Set(Undefined(v8Isolate));
 }
 
@@ -160,12 +253,11 @@ void UpdatePositions(const FunctionCallbackInfo<Value>& args) {
 	v8::String::Utf8Value param0(args[0]->ToString());
 	std::string jsonPositions(*param0);
 
-	// Send the file content to the server.
-	requester->send(jsonPositions);
+	lock_guard<mutex> lock(requesterMutex);
 
-	// Wait for the response from the server.
+	// Send the file content to the server and wait for the response.
 	string response;
-	requester->receive(response);
+	SendRequest(*requester, jsonPositions, response);
     
     args.GetReturnValue().Set(String::NewFromUtf8(args.GetIsolate(), response.c_str()).ToLocalChecked());
 }
@@ -175,16 +267,477 @@ void Request(const FunctionCallbackInfo<Value>& args) {
 	v8::String::Utf8Value param0(args[0]->ToString());
 	std::string jsonRequest(*param0);
 
-	// Send the file content to the server.
-	requester->send(jsonRequest);
+	lock_guard<mutex> lock(requesterMutex);
 
-	// Wait for the response from the server.
+	// Send the file content to the server and wait for the response.
 	string response;
-	requester->receive(response);
+	SendRequest(*requester, jsonRequest, response);
     
     args.GetReturnValue().Set(String::NewFromUtf8(args.GetIsolate(), response.c_str()).ToLocalChecked());
 }
 
+/**
+ * Work structure used to run a request on the libuv thread pool and resolve
+ * the promise once the response is received.
+ */
+struct RequestWork {
+	uv_work_t request;
+	Persistent<Promise::Resolver> resolver;
+	string message;
+	string response;
+	string error;
+	double latencyMs;
+	chrono::steady_clock::time_point queueTime;
+};
+
+static void RequestWorkAsync(uv_work_t *req) {
+
+	RequestWork *work = static_cast<RequestWork *>(req->data);
+
+	// Time spent waiting for a thread of the pool.
+	queueHistogram.record(work->queueTime, chrono::steady_clock::now());
+
+	lock_guard<mutex> lock(asyncRequesterMutex);
+
+	if (asyncRequester.get() == 0) {
+		work->error = "no requester";
+		return;
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	try {
+		// Send the request and wait for the response outside the JS thread.
+		SendRequest(*asyncRequester, work->message, work->response);
+	}
+	catch (const exception& e) {
+		work->error = e.what();
+	}
+
+	work->latencyMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * RequestWorkAsyncComplete function is called on the JS thread once the response is received.
+ */
+static void RequestWorkAsyncComplete(uv_work_t *req, int status) {
+
+	Isolate * isolate = Isolate::GetCurrent();
+
+	v8::HandleScope handleScope(isolate);
+
+	RequestWork *work = static_cast<RequestWork *>(req->data);
+
+	asyncRequests.add(-1);
+
+	// The callback scope runs the microtasks so that the promise continuations are executed now.
+	node::CallbackScope callbackScope(isolate, Object::New(isolate), {0, 0});
+
+	Local<Context> context = isolate->GetCurrentContext();
+	Local<Promise::Resolver> resolver = Local<Promise::Resolver>::New(isolate, work->resolver);
+
+	if (work->error.empty()) {
+		lastLatencyMs = work->latencyMs;
+		resolver->Resolve(context, String::NewFromUtf8(isolate, work->response.c_str()).ToLocalChecked()).FromJust();
+	}
+	else {
+		resolver->Reject(context, Exception::Error(String::NewFromUtf8(isolate, work->error.c_str()).ToLocalChecked())).FromJust();
+	}
+
+	work->resolver.Reset();
+	delete work;
+}
+
+/**
+ * Sends the JSON request without blocking the JS thread. Returns a promise resolved with the JSON response.
+ */
+void RequestAsync(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+	Local<Promise::Resolver> resolver = Promise::Resolver::New(isolate->GetCurrentContext()).ToLocalChecked();
+
+	v8::String::Utf8Value param0(args[0]->ToString());
+
+	RequestWork * work = new RequestWork();
+
+	work->request.data = work;
+	work->resolver.Reset(isolate, resolver);
+	work->message = *param0;
+	work->latencyMs = 0.0;
+	work->queueTime = chrono::steady_clock::now();
+
+	asyncRequests.add(1);
+
+	uv_queue_work(uv_default_loop(), &work->request, RequestWorkAsync, RequestWorkAsyncComplete);
+
+	args.GetReturnValue().Set(resolver->GetPromise());
+}
+
+/**
+ * Creates the request function of a pipeline worker with its own requester.
+ */
+CollisionPipeline::RequestFunction CreateWorkerRequest() {
+
+	shared_ptr<cameo::application::Requester> workerRequester(cameo::application::Requester::create(*collisionServer, "update_positions"));
+
+	if (workerRequester.get() == 0) {
+		return CollisionPipeline::RequestFunction();
+	}
+
+	return [workerRequester](const string& message, string& response) {
+		SendRequest(*workerRequester, message, response);
+	};
+}
+
+/**
+ * Starts the collision pipeline with the number of requests in flight.
+ */
+void StartPipeline(const FunctionCallbackInfo<Value>& args) {
+
+	int depth = Local<Integer>::Cast(args[0])->Value();
+
+	if (collisionServer.get() == 0 || !collisionServer->exists()) {
+		stats.event("pipeline-failed");
+		args.GetReturnValue().Set(Boolean::New(args.GetIsolate(), false));
+		return;
+	}
+
+	bool started = pipeline.start(depth, CreateWorkerRequest);
+
+	stats.event(started ? "pipeline-started" : "pipeline-failed", {{"depth", ToString(depth)}});
+
+	args.GetReturnValue().Set(Boolean::New(args.GetIsolate(), started));
+}
+
+void StopPipeline(const FunctionCallbackInfo<Value>& args) {
+
+	pipeline.stop();
+
+	args.GetReturnValue().Set(Undefined(args.GetIsolate()));
+}
+
+void IsPipelineRunning(const FunctionCallbackInfo<Value>& args) {
+	args.GetReturnValue().Set(Boolean::New(args.GetIsolate(), pipeline.isRunning()));
+}
+
+/**
+ * Submits the JSON request to the pipeline and returns its sequence number.
+ */
+void Submit(const FunctionCallbackInfo<Value>& args) {
+
+	v8::String::Utf8Value param0(args[0]->ToString());
+	std::string jsonRequest(*param0);
+
+	args.GetReturnValue().Set(Number::New(args.GetIsolate(), pipeline.submit(jsonRequest)));
+}
+
+/**
+ * Gets the newest verdict of the pipeline as an object {sequence, latency, response} where latency is
+ * the time in ms from the submission to the response. Returns null if there is no new verdict.
+ */
+void GetVerdict(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+
+	PipelineVerdict verdict;
+
+	if (!pipeline.takeVerdict(verdict)) {
+		args.GetReturnValue().SetNull();
+		return;
+	}
+
+	verdictHistogram.recordNs(static_cast<int64_t>(verdict.latencyMs * 1e6));
+
+	Local<Object> result = Object::New(isolate);
+	result->Set(String::NewFromUtf8(isolate, "sequence").ToLocalChecked(), Number::New(isolate, verdict.sequence));
+	result->Set(String::NewFromUtf8(isolate, "latency").ToLocalChecked(), Number::New(isolate, verdict.latencyMs));
+	result->Set(String::NewFromUtf8(isolate, "response").ToLocalChecked(), String::NewFromUtf8(isolate, verdict.response.c_str()).ToLocalChecked());
+
+	args.GetReturnValue().Set(result);
+}
+
+/**
+ * Gets the pipeline counters {submitted, sent, dropped, stale}.
+ */
+void GetPipelineStats(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+
+	PipelineStats stats = pipeline.stats();
+
+	Local<Object> result = Object::New(isolate);
+	result->Set(String::NewFromUtf8(isolate, "submitted").ToLocalChecked(), Number::New(isolate, stats.submitted));
+	result->Set(String::NewFromUtf8(isolate, "sent").ToLocalChecked(), Number::New(isolate, stats.sent));
+	result->Set(String::NewFromUtf8(isolate, "dropped").ToLocalChecked(), Number::New(isolate, stats.dropped));
+	result->Set(String::NewFromUtf8(isolate, "stale").ToLocalChecked(), Number::New(isolate, stats.stale));
+
+	args.GetReturnValue().Set(result);
+}
+
+/**
+ * Requester of the lookahead, replaced once it was canceled so that a late response of the canceled batch is never
+ * read as the response of the next one.
+ */
+struct LookaheadRequester {
+	mutex requesterMutex;
+	shared_ptr<cameo::application::Requester> requester;
+};
+
+/**
+ * Starts the lookahead checks of the number of future poses spaced by the step in ms.
+ */
+void StartLookahead(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+
+	int steps = Local<Integer>::Cast(args[0])->Value();
+	double stepMs = args[1]->NumberValue(isolate->GetCurrentContext()).FromMaybe(0.0);
+
+	if (collisionServer.get() == 0 || !collisionServer->exists() || steps <= 0 || stepMs <= 0.0) {
+		stats.event("lookahead-failed");
+		args.GetReturnValue().Set(Boolean::New(isolate, false));
+		return;
+	}
+
+	// The lookahead has its own requester so that it never delays the current checks. It is canceled if the collision
+	// server does not answer a batch in time.
+	shared_ptr<LookaheadRequester> lookaheadRequester(new LookaheadRequester());
+	lookaheadRequester->requester = cameo::application::Requester::create(*collisionServer, "update_positions");
+
+	if (lookaheadRequester->requester.get() == 0) {
+		stats.event("lookahead-failed");
+		args.GetReturnValue().Set(Boolean::New(isolate, false));
+		return;
+	}
+
+	lookahead.start(steps, stepMs, [lookaheadRequester](const string& message, string& response) {
+
+		shared_ptr<cameo::application::Requester> requester;
+		{
+			lock_guard<mutex> lock(lookaheadRequester->requesterMutex);
+
+			if (lookaheadRequester->requester->isCanceled()) {
+				shared_ptr<cameo::application::Requester> created = cameo::application::Requester::create(*collisionServer, "update_positions");
+				if (created.get() == 0) {
+					throw runtime_error("cannot create the lookahead requester");
+				}
+				lookaheadRequester->requester = created;
+			}
+			requester = lookaheadRequester->requester;
+		}
+
+		SendRequest(*requester, message, response);
+	}, [lookaheadRequester]() {
+		lock_guard<mutex> lock(lookaheadRequester->requesterMutex);
+		lookaheadRequester->requester->cancel();
+	});
+
+	stats.event("lookahead-started", {{"steps", ToString(steps)}, {"stepMs", ToString(stepMs)}});
+
+	args.GetReturnValue().Set(Boolean::New(isolate, true));
+}
+
+void StopLookahead(const FunctionCallbackInfo<Value>& args) {
+
+	lookahead.stop();
+
+	args.GetReturnValue().Set(Undefined(args.GetIsolate()));
+}
+
+void IsLookaheadRunning(const FunctionCallbackInfo<Value>& args) {
+	args.GetReturnValue().Set(Boolean::New(args.GetIsolate(), lookahead.isRunning() && lookahead.isSupported()));
+}
+
+/**
+ * Submits the current JSON positions to the lookahead and returns their sequence number, 0 if they are ignored.
+ */
+void SubmitLookahead(const FunctionCallbackInfo<Value>& args) {
+
+	v8::String::Utf8Value param0(args[0]->ToString());
+	std::string jsonPositions(*param0);
+
+	args.GetReturnValue().Set(Number::New(args.GetIsolate(), lookahead.submit(jsonPositions)));
+}
+
+/**
+ * Sets the JSON targets of the moving axes.
+ */
+void SetLookaheadTargets(const FunctionCallbackInfo<Value>& args) {
+
+	v8::String::Utf8Value param0(args[0]->ToString());
+	std::string jsonTargets(*param0);
+
+	args.GetReturnValue().Set(Boolean::New(args.GetIsolate(), lookahead.setTargets(jsonTargets)));
+}
+
+/**
+ * Gets the newest lookahead verdict as an object {sequence, step, time, latency, response} where step is the earliest
+ * colliding future pose (0 if none), time its delay in ms from the submitted positions and latency the time in ms
+ * from the submission to the verdict. Returns null if there is no new verdict.
+ */
+void GetLookaheadVerdict(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+
+	LookaheadVerdict verdict;
+
+	if (!lookahead.takeVerdict(verdict)) {
+		args.GetReturnValue().SetNull();
+		return;
+	}
+
+	lookaheadHistogram.recordNs(static_cast<int64_t>(verdict.latencyMs * 1e6));
+
+	Local<Object> result = Object::New(isolate);
+	result->Set(String::NewFromUtf8(isolate, "sequence").ToLocalChecked(), Number::New(isolate, verdict.sequence));
+	result->Set(String::NewFromUtf8(isolate, "step").ToLocalChecked(), Integer::New(isolate, verdict.step));
+	result->Set(String::NewFromUtf8(isolate, "time").ToLocalChecked(), Number::New(isolate, verdict.timeMs));
+	result->Set(String::NewFromUtf8(isolate, "latency").ToLocalChecked(), Number::New(isolate, verdict.latencyMs));
+	result->Set(String::NewFromUtf8(isolate, "response").ToLocalChecked(), String::NewFromUtf8(isolate, verdict.response.c_str()).ToLocalChecked());
+
+	args.GetReturnValue().Set(result);
+}
+
+/**
+ * Copies the content of a typed array.
+ */
+template<typename Type>
+static void CopyTypedArray(Local<Value> value, vector<Type>& values) {
+
+	values.clear();
+
+	if (value->IsTypedArray()) {
+		Local<TypedArray> array = Local<TypedArray>::Cast(value);
+		values.resize(array->ByteLength() / sizeof(Type));
+		if (!values.empty()) {
+			array->CopyContents(values.data(), values.size() * sizeof(Type));
+		}
+	}
+}
+
+/**
+ * Sets the bodies of the broad phase from their local boxes (Float64Array of 6 values per body) and their groups (Int32Array).
+ * Bodies of the same group are never paired and group 0 contains the static bodies.
+ */
+void SetBodies(const FunctionCallbackInfo<Value>& args) {
+
+	CopyTypedArray(args[0], broadPhaseValues);
+	CopyTypedArray(args[1], broadPhaseGroups);
+
+	size_t count = broadPhaseGroups.size();
+
+	if (broadPhaseValues.size() != 6 * count) {
+		stats.event("invalid-bodies", {{"values", ToString(broadPhaseValues.size())}, {"groups", ToString(count)}});
+		count = 0;
+	}
+
+	broadPhase.setBodies(broadPhaseValues.data(), broadPhaseGroups.data(), count);
+
+	args.GetReturnValue().Set(Number::New(args.GetIsolate(), count));
+}
+
+/**
+ * Updates the broad phase with the world matrices of the bodies (Float64Array of 16 values per body) and the margin.
+ * Returns the number of candidate pairs, 0 meaning that no collision is possible.
+ */
+void UpdateBodies(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+
+	double margin = args[1]->NumberValue(isolate->GetCurrentContext()).FromMaybe(0.0);
+
+	CopyTypedArray(args[0], broadPhaseValues);
+
+	if (broadPhaseValues.size() != 16 * broadPhase.bodiesCount()) {
+		stats.event("invalid-matrices", {{"values", ToString(broadPhaseValues.size())}});
+		args.GetReturnValue().Set(Number::New(isolate, -1));
+		return;
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	size_t pairs = broadPhase.update(broadPhaseValues.data(), margin);
+
+	broadPhaseHistogram.record(start, chrono::steady_clock::now());
+
+	args.GetReturnValue().Set(Number::New(isolate, pairs));
+}
+
+/**
+ * Gets the candidate pairs of the last update as an Int32Array of body indices.
+ */
+void GetCandidatePairs(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+
+	const vector<int32_t>& pairs = broadPhase.pairs();
+
+	Local<ArrayBuffer> buffer = ArrayBuffer::New(isolate, pairs.size() * sizeof(int32_t));
+	if (!pairs.empty()) {
+		memcpy(buffer->GetContents().Data(), pairs.data(), pairs.size() * sizeof(int32_t));
+	}
+
+	args.GetReturnValue().Set(Int32Array::New(buffer, 0, pairs.size()));
+}
+
+/**
+ * Gets the broad phase counters {bodies, updates, clearUpdates, pairs}.
+ */
+void GetBroadPhaseStats(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+
+	BroadPhaseStats stats = broadPhase.stats();
+
+	Local<Object> result = Object::New(isolate);
+	result->Set(String::NewFromUtf8(isolate, "bodies").ToLocalChecked(), Number::New(isolate, stats.bodies));
+	result->Set(String::NewFromUtf8(isolate, "updates").ToLocalChecked(), Number::New(isolate, stats.updates));
+	result->Set(String::NewFromUtf8(isolate, "clearUpdates").ToLocalChecked(), Number::New(isolate, stats.clearUpdates));
+	result->Set(String::NewFromUtf8(isolate, "pairs").ToLocalChecked(), Number::New(isolate, stats.pairs));
+
+	args.GetReturnValue().Set(result);
+}
+
+/**
+ * Gets the round trip time in ms of the last async request.
+ */
+void GetLatency(const FunctionCallbackInfo<Value>& args) {
+	args.GetReturnValue().Set(Number::New(args.GetIsolate(), lastLatencyMs));
+}
+
+/**
+ * Gets the stats {time, addon, histograms, counters, gauges, events} without waiting on a request.
+ * The histograms give the count and the min, mean, percentiles and max times in us, the times are wall clock ms.
+ */
+void GetStats(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+
+	Local<String> json = String::NewFromUtf8(isolate, stats.toJson().c_str()).ToLocalChecked();
+
+	args.GetReturnValue().Set(v8::JSON::Parse(isolate->GetCurrentContext(), json).ToLocalChecked());
+}
+
+/**
+ * Starts appending the stats to the file every period in ms.
+ */
+void StartStatsDump(const FunctionCallbackInfo<Value>& args) {
+
+	v8::String::Utf8Value param0(args[0]->ToString());
+	std::string path(*param0);
+
+	int periodMs = Local<Integer>::Cast(args[1])->Value();
+
+	args.GetReturnValue().Set(Boolean::New(args.GetIsolate(), stats.startDump(path, periodMs)));
+}
+
+void StopStatsDump(const FunctionCallbackInfo<Value>& args) {
+
+	stats.stopDump();
+
+	args.GetReturnValue().Set(Undefined(args.GetIsolate()));
+}
+
 /**
  * The init function declares what we will make visible to node.
  */
@@ -193,6 +746,49 @@ void init(Local<Object> exports) {
 	// Register the functions.
 	NODE_SET_METHOD(exports, "init", Init);
 	NODE_SET_METHOD(exports, "request", Request);
+	NODE_SET_METHOD(exports, "requestAsync", RequestAsync);
+	NODE_SET_METHOD(exports, "getLatency", GetLatency);
+	NODE_SET_METHOD(exports, "startPipeline", StartPipeline);
+	NODE_SET_METHOD(exports, "stopPipeline", StopPipeline);
+	NODE_SET_METHOD(exports, "isPipelineRunning", IsPipelineRunning);
+	NODE_SET_METHOD(exports, "submit", Submit);
+	NODE_SET_METHOD(exports, "getVerdict", GetVerdict);
+	NODE_SET_METHOD(exports, "getPipelineStats", GetPipelineStats);
+	NODE_SET_METHOD(exports, "startLookahead", StartLookahead);
+	NODE_SET_METHOD(exports, "stopLookahead", StopLookahead);
+	NODE_SET_METHOD(exports, "isLookaheadRunning", IsLookaheadRunning);
+	NODE_SET_METHOD(exports, "submitLookahead", SubmitLookahead);
+	NODE_SET_METHOD(exports, "setLookaheadTargets", SetLookaheadTargets);
+	NODE_SET_METHOD(exports, "getLookaheadVerdict", GetLookaheadVerdict);
+	NODE_SET_METHOD(exports, "setBodies", SetBodies);
+	NODE_SET_METHOD(exports, "updateBodies", UpdateBodies);
+	NODE_SET_METHOD(exports, "getCandidatePairs", GetCandidatePairs);
+	NODE_SET_METHOD(exports, "getBroadPhaseStats", GetBroadPhaseStats);
+	NODE_SET_METHOD(exports, "getStats", GetStats);
+	NODE_SET_METHOD(exports, "startStatsDump", StartStatsDump);
+	NODE_SET_METHOD(exports, "stopStatsDump", StopStatsDump);
+
+	// The workers emit their events through the stats of the addon.
+	pipeline.setStats(&stats);
+	lookahead.setStats(&stats);
+
+	// The dropped requests are counted by the pipeline.
+	stats.addSource([](AddonStats& stats) {
+		PipelineStats pipelineStats = pipeline.stats();
+		stats.counter("pipeline.submitted") = pipelineStats.submitted;
+		stats.counter("pipeline.sent") = pipelineStats.sent;
+		stats.counter("pipeline.dropped") = pipelineStats.dropped;
+		stats.counter("pipeline.stale") = pipelineStats.stale;
+
+		LookaheadStats lookaheadStats = lookahead.stats();
+		stats.counter("lookahead.submitted") = lookaheadStats.submitted;
+		stats.counter("lookahead.checked") = lookaheadStats.checked;
+		stats.counter("lookahead.still") = lookaheadStats.still;
+		stats.counter("lookahead.replaced") = lookaheadStats.replaced;
+		stats.counter("lookahead.colliding") = lookaheadStats.colliding;
+		stats.counter("lookahead.requests") = lookaheadStats.requests;
+		stats.counter("lookahead.timeouts") = lookaheadStats.timeouts;
+	});
 }
 
 NODE_MODULE(addonnomad3dcollision, init)
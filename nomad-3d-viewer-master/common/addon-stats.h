@@ -0,0 +1,324 @@
+#ifndef NOMAD_ADDONSTATS_H
+#define NOMAD_ADDONSTATS_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <fcntl.h>
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+#include "latency-histogram.h"
+
+namespace nomad {
+
+/**
+ * Level of a queue with the highest level reached.
+ */
+class Gauge {
+
+public:
+	Gauge() : m_value(0), m_max(0) {}
+
+	void add(int64_t delta) {
+		int64_t value = m_value.fetch_add(delta, std::memory_order_relaxed) + delta;
+		int64_t max = m_max.load(std::memory_order_relaxed);
+		while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+	}
+
+	void set(int64_t value) {
+		add(value - m_value.load(std::memory_order_relaxed));
+	}
+
+	int64_t value() const {
+		return m_value.load(std::memory_order_relaxed);
+	}
+
+	int64_t max() const {
+		return m_max.load(std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<int64_t> m_value;
+	std::atomic<int64_t> m_max;
+};
+
+/**
+ * Latency histograms, counters, queue gauges and events of an addon.
+ * The histograms, counters and gauges are created on first use and never removed so that the hot paths keep
+ * a reference and only update atomics. The events replace the log lines of the addon: each one is written
+ * to cout as a JSON line with its wall clock time in ms, comparable to Date.now() in the viewer, and the
+ * last ones are kept for the stats. The stats can be dumped periodically as JSON lines appended to a file.
+ * The counters kept by other components are copied by the sources before each formatting.
+ */
+class AddonStats {
+
+public:
+	typedef std::initializer_list<std::pair<const char *, std::string> > Fields;
+
+	/**
+	 * Updates the stats from a component. Called by the thread that formats the stats.
+	 */
+	typedef std::function<void (AddonStats&)> Source;
+
+	static const size_t MAX_EVENTS = 64;
+
+	AddonStats(const std::string& addon) : m_addon(addon), m_dumpRunning(false) {}
+
+	~AddonStats() {
+		stopDump();
+	}
+
+	LatencyHistogram& histogram(const std::string& name) {
+		return get(m_histograms, name);
+	}
+
+	std::atomic<uint64_t>& counter(const std::string& name) {
+		return get(m_counters, name);
+	}
+
+	Gauge& gauge(const std::string& name) {
+		return get(m_gauges, name);
+	}
+
+	void addSource(Source source) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_sources.push_back(source);
+	}
+
+	/**
+	 * Emits the event with its fields. The values are written as JSON strings.
+	 */
+	void event(const char * name, Fields fields = Fields()) {
+
+		std::string json = "{\"time\":" + number(nowMs()) + ",\"addon\":" + quote(m_addon) + ",\"event\":" + quote(name);
+		for (Fields::const_iterator field = fields.begin(); field != fields.end(); ++field) {
+			json += "," + quote(field->first) + ":" + quote(field->second);
+		}
+		json += "}";
+
+		std::cout << json << std::endl;
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_events.push_back(json);
+		if (m_events.size() > MAX_EVENTS) {
+			m_events.pop_front();
+		}
+	}
+
+	/**
+	 * Formats the stats as a JSON object {time, addon, histograms, counters, gauges, events}.
+	 */
+	std::string toJson() {
+
+		std::vector<Source> sources;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			sources = m_sources;
+		}
+
+		for (size_t i = 0; i < sources.size(); ++i) {
+			sources[i](*this);
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		std::string json = "{\"time\":" + number(nowMs()) + ",\"addon\":" + quote(m_addon) + ",\"histograms\":{";
+
+		for (std::map<std::string, std::unique_ptr<LatencyHistogram> >::const_iterator h = m_histograms.begin(); h != m_histograms.end(); ++h) {
+			HistogramSummary summary = h->second->summary();
+			json += ((h == m_histograms.begin()) ? "" : ",") + quote(h->first)
+				+ ":{\"count\":" + number(summary.count)
+				+ ",\"min\":" + number(summary.min)
+				+ ",\"mean\":" + number(summary.mean)
+				+ ",\"p50\":" + number(summary.p50)
+				+ ",\"p90\":" + number(summary.p90)
+				+ ",\"p99\":" + number(summary.p99)
+				+ ",\"p999\":" + number(summary.p999)
+				+ ",\"max\":" + number(summary.max) + "}";
+		}
+
+		json += "},\"counters\":{";
+
+		for (std::map<std::string, std::unique_ptr<std::atomic<uint64_t> > >::const_iterator c = m_counters.begin(); c != m_counters.end(); ++c) {
+			json += ((c == m_counters.begin()) ? "" : ",") + quote(c->first) + ":" + number(c->second->load(std::memory_order_relaxed));
+		}
+
+		json += "},\"gauges\":{";
+
+		for (std::map<std::string, std::unique_ptr<Gauge> >::const_iterator g = m_gauges.begin(); g != m_gauges.end(); ++g) {
+			json += ((g == m_gauges.begin()) ? "" : ",") + quote(g->first)
+				+ ":{\"value\":" + number(g->second->value()) + ",\"max\":" + number(g->second->max()) + "}";
+		}
+
+		json += "},\"events\":[";
+
+		for (size_t i = 0; i < m_events.size(); ++i) {
+			json += ((i == 0) ? "" : ",") + m_events[i];
+		}
+
+		json += "]}";
+
+		return json;
+	}
+
+	/**
+	 * Appends the stats to the file every period from a background thread.
+	 * Each dump is a single line written at once so that several addons can share the file.
+	 */
+	bool startDump(const std::string& path, int periodMs) {
+
+		stopDump();
+
+		int file = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+		if (file == -1) {
+			event("dump-failed", {{"path", path}});
+			return false;
+		}
+
+		m_dumpRunning = true;
+		m_dumpThread = std::thread([this, file, periodMs]() {
+
+			std::unique_lock<std::mutex> lock(m_dumpMutex);
+
+			while (!m_dumpCondition.wait_for(lock, std::chrono::milliseconds(periodMs), [this]() { return !m_dumpRunning; })) {
+				std::string line = toJson() + "\n";
+				if (::write(file, line.data(), line.size()) != static_cast<ssize_t>(line.size())) {
+					break;
+				}
+			}
+
+			::close(file);
+		});
+
+		event("dump-started", {{"path", path}, {"periodMs", number(periodMs)}});
+
+		return true;
+	}
+
+	void stopDump() {
+
+		if (!m_dumpThread.joinable()) {
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_dumpMutex);
+			m_dumpRunning = false;
+		}
+		m_dumpCondition.notify_all();
+		m_dumpThread.join();
+	}
+
+	static double nowMs() {
+		return std::chrono::duration<double, std::milli>(std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+
+	static std::string number(double value) {
+		char text[32];
+		snprintf(text, sizeof(text), "%.3f", value);
+		return text;
+	}
+
+	static std::string number(uint64_t value) {
+		return std::to_string(value);
+	}
+
+	static std::string number(int64_t value) {
+		return std::to_string(value);
+	}
+
+	static std::string number(int value) {
+		return std::to_string(value);
+	}
+
+	static std::string quote(const std::string& text) {
+
+		std::string result = "\"";
+
+		for (size_t i = 0; i < text.size(); ++i) {
+			char c = text[i];
+			if (c == '"' || c == '\\') {
+				result += '\\';
+				result += c;
+			}
+			else if (static_cast<unsigned char>(c) < 0x20) {
+				char escaped[8];
+				snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+				result += escaped;
+			}
+			else {
+				result += c;
+			}
+		}
+
+		return result + "\"";
+	}
+
+private:
+	template<typename Type>
+	Type& get(std::map<std::string, std::unique_ptr<Type> >& map, const std::string& name) {
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		std::unique_ptr<Type>& value = map[name];
+		if (!value) {
+			value.reset(new Type());
+		}
+
+		return *value;
+	}
+
+	std::string m_addon;
+
+	std::mutex m_mutex;
+	std::map<std::string, std::unique_ptr<LatencyHistogram> > m_histograms;
+	std::map<std::string, std::unique_ptr<std::atomic<uint64_t> > > m_counters;
+	std::map<std::string, std::unique_ptr<Gauge> > m_gauges;
+	std::deque<std::string> m_events;
+	std::vector<Source> m_sources;
+
+	std::thread m_dumpThread;
+	std::mutex m_dumpMutex;
+	std::condition_variable m_dumpCondition;
+	bool m_dumpRunning;
+};
+
+/**
+ * Base of the components that emit events: the events go to the stats of the addon that owns the component.
+ * The stats are set before the component is started. Without stats, the events are dropped.
+ */
+class EventSource {
+
+public:
+	EventSource() : m_stats(0) {}
+
+	void setStats(AddonStats * stats) {
+		m_stats = stats;
+	}
+
+protected:
+	void event(const char * name, AddonStats::Fields fields = AddonStats::Fields()) const {
+		if (m_stats != 0) {
+			m_stats->event(name, fields);
+		}
+	}
+
+private:
+	AddonStats * m_stats;
+};
+
+}
+
+#endif
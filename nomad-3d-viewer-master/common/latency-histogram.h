@@ -0,0 +1,181 @@
+#ifndef NOMAD_LATENCYHISTOGRAM_H
+#define NOMAD_LATENCYHISTOGRAM_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace nomad {
+
+/**
+ * Summary of a latency histogram. The times are in us.
+ */
+struct HistogramSummary {
+	uint64_t count;
+	double min;
+	double max;
+	double mean;
+	double p50;
+	double p90;
+	double p99;
+	double p999;
+
+	HistogramSummary() : count(0), min(0.0), max(0.0), mean(0.0), p50(0.0), p90(0.0), p99(0.0), p999(0.0) {}
+};
+
+/**
+ * Log-linear histogram of durations in ns, in the manner of HdrHistogram: each power of two is split
+ * into 16 linear sub-buckets so that the relative error stays below 6.25% from 16 ns to hours.
+ * Recording is wait-free and can be done by any thread while the summary is read.
+ */
+class LatencyHistogram {
+
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	static const int SUB_BUCKET_BITS = 4;
+	static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+	static const int BUCKETS = SUB_BUCKETS + (64 - SUB_BUCKET_BITS) * SUB_BUCKETS;
+
+	LatencyHistogram() : m_count(0), m_sumNs(0), m_minNs(UINT64_MAX), m_maxNs(0) {
+		for (int i = 0; i < BUCKETS; ++i) {
+			m_buckets[i].store(0, std::memory_order_relaxed);
+		}
+	}
+
+	void record(Clock::time_point start, Clock::time_point end) {
+		recordNs(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+	}
+
+	void recordNs(int64_t durationNs) {
+
+		uint64_t value = (durationNs > 0) ? static_cast<uint64_t>(durationNs) : 0;
+
+		m_buckets[index(value)].fetch_add(1, std::memory_order_relaxed);
+		m_count.fetch_add(1, std::memory_order_relaxed);
+		m_sumNs.fetch_add(value, std::memory_order_relaxed);
+
+		uint64_t min = m_minNs.load(std::memory_order_relaxed);
+		while (value < min && !m_minNs.compare_exchange_weak(min, value, std::memory_order_relaxed)) {}
+
+		uint64_t max = m_maxNs.load(std::memory_order_relaxed);
+		while (value > max && !m_maxNs.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+	}
+
+	/**
+	 * Gets the summary. The buckets are read without lock, a record in progress may be missed.
+	 */
+	HistogramSummary summary() const {
+
+		HistogramSummary summary;
+
+		uint64_t counts[BUCKETS];
+		uint64_t total = 0;
+
+		for (int i = 0; i < BUCKETS; ++i) {
+			counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+			total += counts[i];
+		}
+
+		if (total == 0) {
+			return summary;
+		}
+
+		summary.count = total;
+		summary.min = m_minNs.load(std::memory_order_relaxed) / 1000.0;
+		summary.max = m_maxNs.load(std::memory_order_relaxed) / 1000.0;
+		summary.mean = static_cast<double>(m_sumNs.load(std::memory_order_relaxed)) / m_count.load(std::memory_order_relaxed) / 1000.0;
+		summary.p50 = percentile(counts, total, 0.5);
+		summary.p90 = percentile(counts, total, 0.9);
+		summary.p99 = percentile(counts, total, 0.99);
+		summary.p999 = percentile(counts, total, 0.999);
+
+		// The bucket bounds are approximations, keep them in the observed range.
+		double * percentiles[4] = {&summary.p50, &summary.p90, &summary.p99, &summary.p999};
+		for (int i = 0; i < 4; ++i) {
+			if (*percentiles[i] > summary.max) {
+				*percentiles[i] = summary.max;
+			}
+			if (*percentiles[i] < summary.min) {
+				*percentiles[i] = summary.min;
+			}
+		}
+
+		return summary;
+	}
+
+private:
+	static int index(uint64_t value) {
+
+		if (value < SUB_BUCKETS) {
+			return static_cast<int>(value);
+		}
+
+		int exponent = 63 - __builtin_clzll(value);
+		int shift = exponent - SUB_BUCKET_BITS;
+
+		return SUB_BUCKETS + shift * SUB_BUCKETS + static_cast<int>((value >> shift) & (SUB_BUCKETS - 1));
+	}
+
+	/**
+	 * Gets the middle of the bucket in us.
+	 */
+	static double value(int index) {
+
+		if (index < SUB_BUCKETS) {
+			return index / 1000.0;
+		}
+
+		int shift = (index - SUB_BUCKETS) / SUB_BUCKETS;
+		uint64_t low = static_cast<uint64_t>(SUB_BUCKETS + (index - SUB_BUCKETS) % SUB_BUCKETS) << shift;
+		uint64_t width = static_cast<uint64_t>(1) << shift;
+
+		return (low + width / 2.0) / 1000.0;
+	}
+
+	static double percentile(const uint64_t * counts, uint64_t total, double fraction) {
+
+		uint64_t rank = static_cast<uint64_t>(fraction * total + 0.5);
+		if (rank == 0) {
+			rank = 1;
+		}
+
+		uint64_t cumulated = 0;
+		for (int i = 0; i < BUCKETS; ++i) {
+			cumulated += counts[i];
+			if (cumulated >= rank) {
+				return value(i);
+			}
+		}
+
+		return value(BUCKETS - 1);
+	}
+
+	std::atomic<uint64_t> m_buckets[BUCKETS];
+	std::atomic<uint64_t> m_count;
+	std::atomic<uint64_t> m_sumNs;
+	std::atomic<uint64_t> m_minNs;
+	std::atomic<uint64_t> m_maxNs;
+};
+
+/**
+ * Records the duration of the enclosing scope into the histogram.
+ */
+class LatencyTimer {
+
+public:
+	LatencyTimer(LatencyHistogram& histogram) : m_histogram(histogram), m_start(LatencyHistogram::Clock::now()) {}
+
+	~LatencyTimer() {
+		m_histogram.record(m_start, LatencyHistogram::Clock::now());
+	}
+
+private:
+	LatencyHistogram& m_histogram;
+	LatencyHistogram::Clock::time_point m_start;
+};
+
+}
+
+#endif
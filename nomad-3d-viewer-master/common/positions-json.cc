@@ -0,0 +1,166 @@
+#include "positions-json.h"
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+namespace nomad {
+
+namespace {
+
+void skipSpaces(const char *& c) {
+	while (*c == ' ' || *c == '\t' || *c == '\n' || *c == '\r') {
+		++c;
+	}
+}
+
+/**
+ * Reads a JSON string. Escape sequences are kept as is since axis names do not contain them.
+ */
+bool readName(const char *& c, const char *& begin, size_t& length) {
+
+	if (*c != '"') {
+		return false;
+	}
+
+	begin = ++c;
+	while (*c != '"') {
+		if (*c == '\0') {
+			return false;
+		}
+		if (*c == '\\' && *(c + 1) != '\0') {
+			++c;
+		}
+		++c;
+	}
+
+	length = c - begin;
+	++c;
+
+	return true;
+}
+
+bool readValue(const char *& c, double& value) {
+
+	char * end;
+	value = strtod(c, &end);
+
+	if (end == c) {
+		return false;
+	}
+
+	c = end;
+	return true;
+}
+
+/**
+ * Iterates the members of the object and calls the function with each name and value.
+ */
+template<typename Function>
+bool parseMembers(const string& json, Function function) {
+
+	const char * c = json.c_str();
+
+	skipSpaces(c);
+	if (*c != '{') {
+		return false;
+	}
+	++c;
+	skipSpaces(c);
+
+	if (*c == '}') {
+		return true;
+	}
+
+	size_t index = 0;
+
+	while (true) {
+		const char * name;
+		size_t length;
+		double value;
+
+		skipSpaces(c);
+		if (!readName(c, name, length)) {
+			return false;
+		}
+		skipSpaces(c);
+		if (*c != ':') {
+			return false;
+		}
+		++c;
+		skipSpaces(c);
+		if (!readValue(c, value)) {
+			return false;
+		}
+		if (!function(index, name, length, value)) {
+			return false;
+		}
+		++index;
+
+		skipSpaces(c);
+		if (*c == ',') {
+			++c;
+		}
+		else if (*c == '}') {
+			return true;
+		}
+		else {
+			return false;
+		}
+	}
+}
+
+}
+
+bool parsePositions(const string& json, vector<string>& names, vector<double>& values) {
+
+	return parseMembers(json, [&](size_t, const char * name, size_t length, double value) {
+		names.push_back(string(name, length));
+		values.push_back(value);
+		return true;
+	});
+}
+
+bool parsePositionValues(const string& json, const vector<string>& names, vector<double>& values) {
+
+	values.resize(names.size());
+
+	size_t count = 0;
+
+	bool result = parseMembers(json, [&](size_t index, const char * name, size_t length, double value) {
+		if (index >= names.size() || names[index].size() != length || memcmp(names[index].data(), name, length) != 0) {
+			return false;
+		}
+		values[index] = value;
+		++count;
+		return true;
+	});
+
+	return result && count == names.size();
+}
+
+void formatPositions(const vector<string>& names, const double * values, string& json) {
+
+	char buffer[32];
+
+	json.clear();
+	json += '{';
+
+	for (size_t i = 0; i < names.size(); ++i) {
+		if (i > 0) {
+			json += ',';
+		}
+		json += '"';
+		json += names[i];
+		json += "\":";
+
+		// 17 significant digits keep the exact double value.
+		snprintf(buffer, sizeof(buffer), "%.17g", values[i]);
+		json += buffer;
+	}
+
+	json += '}';
+}
+
+}
@@ -0,0 +1,30 @@
+#ifndef NOMAD_POSITIONSJSON_H
+#define NOMAD_POSITIONSJSON_H
+
+#include <string>
+#include <vector>
+
+namespace nomad {
+
+/**
+ * Parses a flat JSON object of numbers such as {"axis1": 1.5, "axis2": -3}.
+ * The names and values are appended in the order of the object.
+ * Returns false if the text is not a flat object of numbers.
+ */
+bool parsePositions(const std::string& json, std::vector<std::string>& names, std::vector<double>& values);
+
+/**
+ * Parses the values of a flat JSON object whose names are expected in the given order.
+ * This is the fast path when the axis table did not change: the names are compared but not copied.
+ * Returns false if a name differs or the count does not match.
+ */
+bool parsePositionValues(const std::string& json, const std::vector<std::string>& names, std::vector<double>& values);
+
+/**
+ * Formats the names and values as a flat JSON object.
+ */
+void formatPositions(const std::vector<std::string>& names, const double * values, std::string& json);
+
+}
+
+#endif
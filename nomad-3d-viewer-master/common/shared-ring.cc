@@ -0,0 +1,432 @@
+#include "shared-ring.h"
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+using namespace std;
+
+namespace nomad {
+
+static const size_t ALIGNMENT = 64;
+
+static size_t Align(size_t size) {
+	return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+/**
+ * Waits while the word has the value or until the timeout. The futex is not private because the segment
+ * is mapped by several processes. Without futex, the word is polled.
+ */
+static void FutexWait(atomic<uint32_t> * word, uint32_t value, int64_t timeoutNs) {
+
+#ifdef __linux__
+	struct timespec timeout;
+	timeout.tv_sec = timeoutNs / 1000000000;
+	timeout.tv_nsec = timeoutNs % 1000000000;
+
+	syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAIT, value, &timeout, 0, 0);
+#else
+	if (word->load(memory_order_acquire) == value) {
+		this_thread::sleep_for(chrono::nanoseconds(min<int64_t>(timeoutNs, 100000)));
+	}
+#endif
+}
+
+static void FutexWake(atomic<uint32_t> * word) {
+
+#ifdef __linux__
+	syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAKE, INT_MAX, 0, 0, 0);
+#endif
+}
+
+/**
+ * Gets the start time of the process in clock ticks since boot, field 22 of /proc/<pid>/stat. Returns 0 if it is unknown.
+ */
+static uint64_t ProcessStartTime(int pid) {
+
+#ifdef __linux__
+	ifstream file("/proc/" + to_string(pid) + "/stat");
+	string stat;
+	getline(file, stat);
+
+	// The command name can contain spaces, the fields are counted from its closing parenthesis.
+	size_t end = stat.rfind(')');
+	if (end == string::npos) {
+		return 0;
+	}
+
+	istringstream fields(stat.substr(end + 1));
+	string field;
+	for (int i = 3; i < 22; ++i) {
+		fields >> field;
+	}
+
+	uint64_t startTime = 0;
+	fields >> startTime;
+
+	return startTime;
+#else
+	return 0;
+#endif
+}
+
+SharedRing::SharedRing() :
+	m_header(0),
+	m_size(0),
+	m_slotStride(0) {
+}
+
+SharedRing::~SharedRing() {
+	unmap();
+}
+
+bool SharedRing::isOpen() const {
+	return m_header != 0;
+}
+
+const string& SharedRing::name() const {
+	return m_name;
+}
+
+string SharedRing::positionsName(int instanceId) {
+	return "/n3dpositions-" + to_string(instanceId);
+}
+
+string SharedRing::collisionPositionsName(int instanceId) {
+	return "/n3dcollisions-" + to_string(instanceId) + "-positions";
+}
+
+string SharedRing::collisionVerdictsName(int instanceId) {
+	return "/n3dcollisions-" + to_string(instanceId) + "-verdicts";
+}
+
+int64_t SharedRing::nowNs() {
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+void SharedRing::unmap() {
+
+	if (m_header != 0) {
+		munmap(m_header, m_size);
+		m_header = 0;
+	}
+
+	m_size = 0;
+	m_slotStride = 0;
+}
+
+SharedRingSlot * SharedRing::slot(uint64_t frame) const {
+
+	char * slots = reinterpret_cast<char *>(m_header) + Align(sizeof(SharedRingHeader));
+
+	return reinterpret_cast<SharedRingSlot *>(slots + ((frame - 1) % m_header->slotCount) * m_slotStride);
+}
+
+char * SharedRing::data(SharedRingSlot * slot) const {
+	return reinterpret_cast<char *>(slot) + sizeof(SharedRingSlot);
+}
+
+SharedRingWriter::~SharedRingWriter() {
+	close();
+}
+
+bool SharedRingWriter::create(const string& name, uint32_t slotCount, uint32_t slotSize) {
+
+	close();
+
+	if (slotCount == 0) {
+		return false;
+	}
+
+	size_t slotStride = Align(sizeof(SharedRingSlot) + slotSize);
+	size_t size = Align(sizeof(SharedRingHeader)) + slotCount * slotStride;
+
+	// A segment left by a killed writer is replaced.
+	shm_unlink(name.c_str());
+
+	int file = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (file == -1) {
+		return false;
+	}
+
+	if (ftruncate(file, size) == -1) {
+		::close(file);
+		shm_unlink(name.c_str());
+		return false;
+	}
+
+	void * address = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	::close(file);
+
+	if (address == MAP_FAILED) {
+		shm_unlink(name.c_str());
+		return false;
+	}
+
+	// The segment is filled with zeros by ftruncate.
+	m_name = name;
+	m_header = static_cast<SharedRingHeader *>(address);
+	m_size = size;
+	m_slotStride = slotStride;
+
+	m_header->version = VERSION;
+	m_header->slotCount = slotCount;
+	m_header->slotSize = slotSize;
+	m_header->writerPid = getpid();
+	m_header->writerStartTime = ProcessStartTime(getpid());
+	m_header->magic.store(MAGIC, memory_order_release);
+
+	return true;
+}
+
+void SharedRingWriter::close() {
+
+	if (isOpen()) {
+		shm_unlink(m_name.c_str());
+		unmap();
+	}
+}
+
+bool SharedRingWriter::publish(const char * frameData, size_t size, uint64_t request) {
+
+	if (!isOpen() || size > m_header->slotSize) {
+		return false;
+	}
+
+	uint64_t frame = m_header->published.load(memory_order_relaxed) + 1;
+	SharedRingSlot * frameSlot = slot(frame);
+
+	// The readers that copy the slot meanwhile see the odd sequence and drop their copy.
+	frameSlot->sequence.store(2 * frame - 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	memcpy(data(frameSlot), frameData, size);
+	frameSlot->size = size;
+	frameSlot->request = request;
+	frameSlot->publishNs = nowNs();
+
+	frameSlot->sequence.store(2 * frame, memory_order_release);
+	m_header->published.store(frame, memory_order_release);
+
+	// The futex is only called if a reader waits. Both orders are sequentially consistent with the reader side.
+	m_header->signal.fetch_add(1, memory_order_seq_cst);
+	if (m_header->waiters.load(memory_order_seq_cst) > 0) {
+		FutexWake(&m_header->signal);
+	}
+
+	return true;
+}
+
+bool SharedRingWriter::publish(const string& frame, uint64_t request) {
+	return publish(frame.data(), frame.size(), request);
+}
+
+uint64_t SharedRingWriter::published() const {
+	return isOpen() ? m_header->published.load(memory_order_relaxed) : 0;
+}
+
+SharedRingReader::SharedRingReader() :
+	m_last(0),
+	m_request(0),
+	m_latencyNs(0),
+	m_skipped(0),
+	m_dropped(0) {
+}
+
+bool SharedRingReader::open(const string& name) {
+
+	close();
+
+	int file = shm_open(name.c_str(), O_RDWR, 0);
+	if (file == -1) {
+		return false;
+	}
+
+	struct stat status;
+	if (fstat(file, &status) == -1 || static_cast<size_t>(status.st_size) < Align(sizeof(SharedRingHeader))) {
+		::close(file);
+		return false;
+	}
+
+	size_t size = status.st_size;
+	void * address = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	::close(file);
+
+	if (address == MAP_FAILED) {
+		return false;
+	}
+
+	SharedRingHeader * header = static_cast<SharedRingHeader *>(address);
+	size_t slotStride = Align(sizeof(SharedRingSlot) + header->slotSize);
+
+	if (header->magic.load(memory_order_acquire) != MAGIC || header->version != VERSION || header->slotCount == 0
+		|| size < Align(sizeof(SharedRingHeader)) + header->slotCount * slotStride) {
+		munmap(address, size);
+		return false;
+	}
+
+	m_name = name;
+	m_header = header;
+	m_size = size;
+	m_slotStride = slotStride;
+
+	// Only the frames published from now are read.
+	m_last = m_header->published.load(memory_order_acquire);
+	m_request = 0;
+	m_latencyNs = 0;
+	m_skipped = 0;
+	m_dropped = 0;
+
+	return true;
+}
+
+void SharedRingReader::close() {
+	unmap();
+}
+
+bool SharedRingReader::isWriterAlive() const {
+
+	if (!isOpen() || (kill(m_header->writerPid, 0) == -1 && errno != EPERM)) {
+		return false;
+	}
+
+	// Another process with the same pid was started after the writer.
+	uint64_t startTime = ProcessStartTime(m_header->writerPid);
+
+	return m_header->writerStartTime == 0 || startTime == 0 || startTime == m_header->writerStartTime;
+}
+
+bool SharedRingReader::readFrame(uint64_t frame, string& frameData) {
+
+	SharedRingSlot * frameSlot = slot(frame);
+
+	uint64_t sequence = frameSlot->sequence.load(memory_order_acquire);
+	if (sequence != 2 * frame) {
+		return false;
+	}
+
+	uint32_t size = frameSlot->size;
+	uint64_t request = frameSlot->request;
+	int64_t publishNs = frameSlot->publishNs;
+	if (size > m_header->slotSize) {
+		return false;
+	}
+
+	frameData.assign(data(frameSlot), size);
+
+	// The copy is valid if the writer did not start another frame in the slot meanwhile.
+	atomic_thread_fence(memory_order_acquire);
+	if (frameSlot->sequence.load(memory_order_relaxed) != sequence) {
+		return false;
+	}
+
+	m_request = request;
+	m_latencyNs = nowNs() - publishNs;
+
+	return true;
+}
+
+bool SharedRingReader::read(string& frame) {
+
+	if (!isOpen()) {
+		return false;
+	}
+
+	uint64_t published = 0;
+
+	for (int retry = 0; retry < MAX_READ_RETRIES; ++retry) {
+		published = m_header->published.load(memory_order_acquire);
+		if (published <= m_last) {
+			return false;
+		}
+
+		// The slot can be overwritten during the copy, then the newer frame is read.
+		if (readFrame(published, frame)) {
+			m_skipped += published - m_last - 1;
+			m_last = published;
+			return true;
+		}
+	}
+
+	// A corrupt size or a writer killed in the middle of a frame: the reader restarts after the frame.
+	m_dropped += published - m_last;
+	m_last = published;
+
+	return false;
+}
+
+bool SharedRingReader::wait(chrono::steady_clock::time_point deadline) {
+
+	if (!isOpen()) {
+		return false;
+	}
+
+	while (true) {
+		uint32_t signal = m_header->signal.load(memory_order_acquire);
+
+		if (m_header->published.load(memory_order_acquire) > m_last) {
+			return true;
+		}
+
+		int64_t remainingNs = chrono::duration_cast<chrono::nanoseconds>(deadline - chrono::steady_clock::now()).count();
+		if (remainingNs <= 0) {
+			return false;
+		}
+
+		// The signal is read before the published frame so that a frame published meanwhile is not missed.
+		m_header->waiters.fetch_add(1, memory_order_seq_cst);
+		FutexWait(&m_header->signal, signal, remainingNs);
+		m_header->waiters.fetch_sub(1, memory_order_seq_cst);
+	}
+}
+
+bool SharedRingReader::next(string& frame, chrono::steady_clock::time_point deadline) {
+
+	while (wait(deadline)) {
+		if (read(frame)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int64_t SharedRingReader::latencyNs() const {
+	return m_latencyNs;
+}
+
+uint64_t SharedRingReader::frame() const {
+	return m_last;
+}
+
+uint64_t SharedRingReader::request() const {
+	return m_request;
+}
+
+uint64_t SharedRingReader::skipped() const {
+	return m_skipped;
+}
+
+uint64_t SharedRingReader::dropped() const {
+	return m_dropped;
+}
+
+}
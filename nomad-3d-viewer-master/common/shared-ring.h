@@ -0,0 +1,191 @@
+#ifndef NOMAD_SHAREDRING_H
+#define NOMAD_SHAREDRING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace nomad {
+
+/**
+ * Header at the start of the shared memory segment.
+ * The magic is written last by the writer so that a reader never maps a segment being initialised.
+ * The start time of the writer process, in clock ticks since boot as in /proc/<pid>/stat, tells a reused pid apart.
+ */
+struct SharedRingHeader {
+	std::atomic<uint32_t> magic;
+	uint32_t version;
+	uint32_t slotCount;
+	uint32_t slotSize;
+	int32_t writerPid;
+	std::atomic<uint32_t> signal;
+	std::atomic<uint32_t> waiters;
+	std::atomic<uint64_t> published;
+	uint64_t writerStartTime;
+};
+
+/**
+ * Slot of a frame. The sequence is odd while the frame n is written (2n - 1) and even once it is written (2n).
+ * The publish time is read from the monotonic clock that is shared by the processes of the host.
+ * A response frame carries the number of the request frame it answers, so that a late response is recognised.
+ */
+struct SharedRingSlot {
+	std::atomic<uint64_t> sequence;
+	int64_t publishNs;
+	uint64_t request;
+	uint32_t size;
+	uint32_t padding;
+};
+
+/**
+ * Ring of frames in a POSIX shared memory segment, for the servers running on the same host as the viewer.
+ * There is a single writer and any number of readers. The writer never waits: the readers only take the newest
+ * frame and skip the ones that were overwritten. Each slot is protected by a sequence lock and the readers wait
+ * for a new frame on a futex of the segment, so that a frame is received a few us after it is published.
+ * Cameo is still used to start the servers: the segments are found by their names derived from the instance ids.
+ */
+class SharedRing {
+
+public:
+	static const uint32_t MAGIC = 0x4e33444d;
+	static const uint32_t VERSION = 2;
+
+	SharedRing();
+	virtual ~SharedRing();
+
+	bool isOpen() const;
+	const std::string& name() const;
+
+	/**
+	 * Gets the name of the ring of the positions published by the n3dpositions instance.
+	 */
+	static std::string positionsName(int instanceId);
+
+	/**
+	 * Gets the names of the rings of the positions sent to the n3dcollisions instance and of its verdicts.
+	 */
+	static std::string collisionPositionsName(int instanceId);
+	static std::string collisionVerdictsName(int instanceId);
+
+	static int64_t nowNs();
+
+protected:
+	void unmap();
+	SharedRingSlot * slot(uint64_t frame) const;
+	char * data(SharedRingSlot * slot) const;
+
+	std::string m_name;
+	SharedRingHeader * m_header;
+	size_t m_size;
+	size_t m_slotStride;
+};
+
+/**
+ * Creates the segment and publishes the frames.
+ */
+class SharedRingWriter : public SharedRing {
+
+public:
+	~SharedRingWriter();
+
+	/**
+	 * Creates the segment with the name. An existing segment with the same name is replaced.
+	 */
+	bool create(const std::string& name, uint32_t slotCount, uint32_t slotSize);
+
+	/**
+	 * Removes the segment. The readers keep their mapping until they close it.
+	 */
+	void close();
+
+	/**
+	 * Publishes the frame and wakes the readers. Returns false if the frame is larger than a slot.
+	 * A response frame gives the number of the request frame it answers.
+	 */
+	bool publish(const char * data, size_t size, uint64_t request = 0);
+	bool publish(const std::string& frame, uint64_t request = 0);
+
+	/**
+	 * Gets the number of the last published frame.
+	 */
+	uint64_t published() const;
+};
+
+/**
+ * Maps an existing segment and reads the newest frames.
+ */
+class SharedRingReader : public SharedRing {
+
+public:
+	SharedRingReader();
+
+	/**
+	 * Opens the segment. Returns false if it does not exist or if it is not a ring of this version.
+	 */
+	bool open(const std::string& name);
+	void close();
+
+	/**
+	 * Returns true if the process of the writer is alive. A killed writer leaves its segment behind and its pid
+	 * can be reused by another process, which is detected with the start time of the process.
+	 */
+	bool isWriterAlive() const;
+
+	/**
+	 * Reads the newest frame if it was published after the last one read. Never waits.
+	 */
+	bool read(std::string& frame);
+
+	/**
+	 * Waits until a frame is published after the last one read or until the deadline.
+	 * Returns true if there is a new frame.
+	 */
+	bool wait(std::chrono::steady_clock::time_point deadline);
+
+	/**
+	 * Waits for the next frame and reads it. Returns false at the deadline.
+	 */
+	bool next(std::string& frame, std::chrono::steady_clock::time_point deadline);
+
+	/**
+	 * Gets the number of the last frame read, which a response frame gives as its request.
+	 */
+	uint64_t frame() const;
+
+	/**
+	 * Gets the number of the request frame answered by the last frame read, 0 if it is not a response.
+	 */
+	uint64_t request() const;
+
+	/**
+	 * Gets the time between the publication and the read of the last frame in ns.
+	 */
+	int64_t latencyNs() const;
+
+	/**
+	 * Gets the number of frames that were overwritten before being read.
+	 */
+	uint64_t skipped() const;
+
+	/**
+	 * Gets the number of frames dropped because they could not be read after the retries.
+	 */
+	uint64_t dropped() const;
+
+private:
+	static const int MAX_READ_RETRIES = 64;
+
+	bool readFrame(uint64_t frame, std::string& data);
+
+	uint64_t m_last;
+	uint64_t m_request;
+	int64_t m_latencyNs;
+	uint64_t m_skipped;
+	uint64_t m_dropped;
+};
+
+}
+
+#endif
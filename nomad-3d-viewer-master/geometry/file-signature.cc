@@ -0,0 +1,78 @@
+#include "file-signature.h"
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace nomad {
+
+static const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+uint64_t hashBytes(const char * data, size_t size) {
+
+	uint64_t hash = FNV_OFFSET;
+
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
+
+string formatHash(uint64_t hash) {
+
+	char text[17];
+	snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(hash));
+
+	return text;
+}
+
+bool statFile(const string& path, FileSignature& signature) {
+
+	struct stat status;
+
+	if (stat(path.c_str(), &status) != 0) {
+		return false;
+	}
+
+	signature.size = status.st_size;
+	signature.mtimeMs = status.st_mtim.tv_sec * 1000.0 + status.st_mtim.tv_nsec / 1000000.0;
+
+	return true;
+}
+
+bool signFile(const string& path, FileSignature& signature) {
+
+	if (!statFile(path, signature)) {
+		return false;
+	}
+
+	ifstream file(path.c_str(), ios::binary);
+
+	if (!file) {
+		return false;
+	}
+
+	// Hash by chunks, the FNV state carries over.
+	vector<char> buffer(1 << 20);
+	uint64_t hash = FNV_OFFSET;
+
+	while (file) {
+		file.read(buffer.data(), buffer.size());
+		streamsize count = file.gcount();
+		for (streamsize i = 0; i < count; ++i) {
+			hash ^= static_cast<unsigned char>(buffer[i]);
+			hash *= FNV_PRIME;
+		}
+	}
+
+	signature.hash = hash;
+
+	return true;
+}
+
+}
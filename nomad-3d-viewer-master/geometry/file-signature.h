@@ -0,0 +1,44 @@
+#ifndef NOMAD_FILESIGNATURE_H
+#define NOMAD_FILESIGNATURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace nomad {
+
+/**
+ * Signature of a source file used to invalidate the geometry cache.
+ * The size and modification time are checked first, the content hash only when they changed.
+ */
+struct FileSignature {
+	uint64_t size;
+	double mtimeMs;
+	uint64_t hash;
+
+	FileSignature() : size(0), mtimeMs(0.0), hash(0) {}
+};
+
+/**
+ * 64-bit FNV-1a hash of the bytes.
+ */
+uint64_t hashBytes(const char * data, size_t size);
+
+/**
+ * Formats the hash as 16 hexadecimal digits so that it can be stored in JS.
+ */
+std::string formatHash(uint64_t hash);
+
+/**
+ * Gets the size and modification time of the file. Returns false if the file does not exist.
+ */
+bool statFile(const std::string& path, FileSignature& signature);
+
+/**
+ * Gets the size, modification time and content hash of the file. Returns false if the file cannot be read.
+ */
+bool signFile(const std::string& path, FileSignature& signature);
+
+}
+
+#endif
@@ -0,0 +1,304 @@
+#include "geometry-cache.h"
+#include "file-signature.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace nomad {
+
+static const char MAGIC[4] = {'N', '3', 'D', 'C'};
+static const uint64_t ALIGNMENT = 16;
+
+/**
+ * File header.
+ */
+struct CacheHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t reserved;
+	uint64_t fileSize;
+};
+
+/**
+ * Index record of a component LOD. The offsets are relative to the beginning of the file.
+ */
+struct CacheRecord {
+	uint64_t nameOffset;
+	uint64_t positionOffset;
+	uint64_t normalOffset;
+	uint64_t indexOffset;
+	uint64_t groupOffset;
+	uint64_t materialsOffset;
+	uint64_t sourcesOffset;
+	uint32_t nameLength;
+	uint32_t lod;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t groupCount;
+	uint32_t materialsLength;
+	uint32_t sourcesLength;
+	uint32_t reserved;
+};
+
+static uint64_t align(uint64_t offset) {
+	return (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+/**
+ * Reserves a block and returns its offset.
+ */
+static uint64_t reserve(uint64_t& offset, uint64_t size) {
+	uint64_t block = align(offset);
+	offset = block + size;
+	return block;
+}
+
+/**
+ * Hashes the vertex, normal, index and group blocks of the entry.
+ */
+static uint64_t hashGeometry(const CacheEntry& entry) {
+
+	uint64_t hash = hashBytes(reinterpret_cast<const char *>(entry.positions.data()), entry.positions.size() * sizeof(float));
+	hash = hash * 31 + hashBytes(reinterpret_cast<const char *>(entry.normals.data()), entry.normals.size() * sizeof(float));
+	hash = hash * 31 + hashBytes(reinterpret_cast<const char *>(entry.indices.data()), entry.indices.size() * sizeof(uint32_t));
+	hash = hash * 31 + hashBytes(reinterpret_cast<const char *>(entry.groups.data()), entry.groups.size() * sizeof(MeshGroup));
+
+	return hash;
+}
+
+static bool sameGeometry(const CacheEntry& a, const CacheEntry& b) {
+
+	if (a.positions != b.positions || a.normals != b.normals || a.indices != b.indices || a.groups.size() != b.groups.size()) {
+		return false;
+	}
+
+	return a.groups.empty() || memcmp(a.groups.data(), b.groups.data(), a.groups.size() * sizeof(MeshGroup)) == 0;
+}
+
+static void writeBlock(ofstream& file, uint64_t offset, const void * data, uint64_t size) {
+
+	static const char padding[ALIGNMENT] = {0};
+
+	uint64_t position = file.tellp();
+	file.write(padding, offset - position);
+	file.write(static_cast<const char *>(data), size);
+}
+
+GeometryCache::GeometryCache() : m_data(0), m_size(0), m_version(0) {
+}
+
+GeometryCache::~GeometryCache() {
+	if (m_data != 0) {
+		munmap(m_data, m_size);
+	}
+}
+
+bool GeometryCache::write(const string& path, const vector<CacheEntry>& entries) {
+
+	// Compute the layout.
+	vector<CacheRecord> records(entries.size());
+	uint64_t offset = align(sizeof(CacheHeader)) + records.size() * sizeof(CacheRecord);
+
+	// Index of the entry writing the geometry blocks of each entry, the identical geometries share the blocks of the first one.
+	vector<size_t> geometryEntries(entries.size());
+	multimap<uint64_t, size_t> geometries;
+
+	for (size_t i = 0; i < entries.size(); ++i) {
+
+		const CacheEntry& entry = entries[i];
+		CacheRecord& record = records[i];
+
+		record.nameLength = entry.name.size();
+		record.lod = entry.lod;
+		record.vertexCount = entry.positions.size() / 3;
+		record.indexCount = entry.indices.size();
+		record.groupCount = entry.groups.size();
+		record.materialsLength = entry.materials.size();
+		record.sourcesLength = entry.sources.size();
+		record.reserved = 0;
+
+		record.nameOffset = reserve(offset, record.nameLength);
+
+		uint64_t hash = hashGeometry(entry);
+		geometryEntries[i] = i;
+
+		for (multimap<uint64_t, size_t>::const_iterator same = geometries.lower_bound(hash); same != geometries.upper_bound(hash); ++same) {
+			if (sameGeometry(entries[same->second], entry)) {
+				geometryEntries[i] = same->second;
+				break;
+			}
+		}
+
+		if (geometryEntries[i] != i) {
+			const CacheRecord& shared = records[geometryEntries[i]];
+			record.positionOffset = shared.positionOffset;
+			record.normalOffset = shared.normalOffset;
+			record.indexOffset = shared.indexOffset;
+			record.groupOffset = shared.groupOffset;
+		}
+		else {
+			geometries.insert(make_pair(hash, i));
+			record.positionOffset = reserve(offset, entry.positions.size() * sizeof(float));
+			record.normalOffset = reserve(offset, entry.normals.size() * sizeof(float));
+			record.indexOffset = reserve(offset, entry.indices.size() * sizeof(uint32_t));
+			record.groupOffset = reserve(offset, entry.groups.size() * sizeof(MeshGroup));
+		}
+
+		record.materialsOffset = reserve(offset, record.materialsLength);
+		record.sourcesOffset = reserve(offset, record.sourcesLength);
+	}
+
+	CacheHeader header;
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.entryCount = entries.size();
+	header.reserved = 0;
+	header.fileSize = offset;
+
+	string temporaryPath = path + ".tmp";
+	ofstream file(temporaryPath.c_str(), ios::binary | ios::trunc);
+
+	if (!file) {
+		return false;
+	}
+
+	file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+	writeBlock(file, align(sizeof(CacheHeader)), records.data(), records.size() * sizeof(CacheRecord));
+
+	for (size_t i = 0; i < entries.size(); ++i) {
+
+		const CacheEntry& entry = entries[i];
+		const CacheRecord& record = records[i];
+
+		writeBlock(file, record.nameOffset, entry.name.data(), record.nameLength);
+
+		if (geometryEntries[i] == i) {
+			writeBlock(file, record.positionOffset, entry.positions.data(), entry.positions.size() * sizeof(float));
+			writeBlock(file, record.normalOffset, entry.normals.data(), entry.normals.size() * sizeof(float));
+			writeBlock(file, record.indexOffset, entry.indices.data(), entry.indices.size() * sizeof(uint32_t));
+			writeBlock(file, record.groupOffset, entry.groups.data(), entry.groups.size() * sizeof(MeshGroup));
+		}
+
+		writeBlock(file, record.materialsOffset, entry.materials.data(), record.materialsLength);
+		writeBlock(file, record.sourcesOffset, entry.sources.data(), record.sourcesLength);
+	}
+
+	file.close();
+
+	if (!file) {
+		remove(temporaryPath.c_str());
+		return false;
+	}
+
+	return (rename(temporaryPath.c_str(), path.c_str()) == 0);
+}
+
+shared_ptr<GeometryCache> GeometryCache::open(const string& path, string& error) {
+
+	int fd = ::open(path.c_str(), O_RDONLY);
+
+	if (fd < 0) {
+		error = "no cache";
+		return shared_ptr<GeometryCache>();
+	}
+
+	struct stat status;
+	if (fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(CacheHeader)) {
+		close(fd);
+		error = "invalid cache";
+		return shared_ptr<GeometryCache>();
+	}
+
+	// The mapping is private so that the typed arrays viewing it can be written without changing the file.
+	size_t size = status.st_size;
+	void * data = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED) {
+		error = "cannot map cache";
+		return shared_ptr<GeometryCache>();
+	}
+
+	shared_ptr<GeometryCache> cache(new GeometryCache());
+	cache->m_data = data;
+	cache->m_size = size;
+
+	const char * bytes = static_cast<const char *>(data);
+	const CacheHeader * header = reinterpret_cast<const CacheHeader *>(bytes);
+
+	if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->fileSize != size) {
+		error = "invalid cache";
+		return shared_ptr<GeometryCache>();
+	}
+
+	cache->m_version = header->version;
+
+	if (header->version != VERSION) {
+		error = "cache version mismatch";
+		return shared_ptr<GeometryCache>();
+	}
+
+	uint64_t recordsOffset = align(sizeof(CacheHeader));
+	if (recordsOffset + uint64_t(header->entryCount) * sizeof(CacheRecord) > size) {
+		error = "invalid cache";
+		return shared_ptr<GeometryCache>();
+	}
+
+	const CacheRecord * records = reinterpret_cast<const CacheRecord *>(bytes + recordsOffset);
+
+	for (uint32_t i = 0; i < header->entryCount; ++i) {
+
+		const CacheRecord& record = records[i];
+
+		// Check that the blocks are in the file.
+		if (record.nameOffset + record.nameLength > size
+			|| record.positionOffset + uint64_t(record.vertexCount) * 3 * sizeof(float) > size
+			|| record.normalOffset + uint64_t(record.vertexCount) * 3 * sizeof(float) > size
+			|| record.indexOffset + uint64_t(record.indexCount) * sizeof(uint32_t) > size
+			|| record.groupOffset + uint64_t(record.groupCount) * sizeof(MeshGroup) > size
+			|| record.materialsOffset + record.materialsLength > size
+			|| record.sourcesOffset + record.sourcesLength > size) {
+			error = "invalid cache";
+			return shared_ptr<GeometryCache>();
+		}
+
+		CacheEntryView entry;
+		entry.name.assign(bytes + record.nameOffset, record.nameLength);
+		entry.lod = record.lod;
+		entry.positions = reinterpret_cast<const float *>(bytes + record.positionOffset);
+		entry.normals = reinterpret_cast<const float *>(bytes + record.normalOffset);
+		entry.vertexCount = record.vertexCount;
+		entry.indices = reinterpret_cast<const uint32_t *>(bytes + record.indexOffset);
+		entry.indexCount = record.indexCount;
+		entry.groups = reinterpret_cast<const MeshGroup *>(bytes + record.groupOffset);
+		entry.groupCount = record.groupCount;
+		entry.materials = bytes + record.materialsOffset;
+		entry.materialsLength = record.materialsLength;
+		entry.sources = bytes + record.sourcesOffset;
+		entry.sourcesLength = record.sourcesLength;
+		entry.blob = record.positionOffset;
+
+		cache->m_entries.push_back(entry);
+	}
+
+	return cache;
+}
+
+uint32_t GeometryCache::version() const {
+	return m_version;
+}
+
+const vector<CacheEntryView>& GeometryCache::entries() const {
+	return m_entries;
+}
+
+}
@@ -0,0 +1,87 @@
+#ifndef NOMAD_GEOMETRYCACHE_H
+#define NOMAD_GEOMETRYCACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "mesh-merger.h"
+
+namespace nomad {
+
+/**
+ * Merged geometry of a component LOD written to the cache.
+ * The materials are the JSON description of the component materials.
+ * The sources are the JSON description of the inputs of the merge, used to invalidate the entry.
+ */
+struct CacheEntry {
+	std::string name;
+	uint32_t lod;
+	std::vector<float> positions;
+	std::vector<float> normals;
+	std::vector<uint32_t> indices;
+	std::vector<MeshGroup> groups;
+	std::string materials;
+	std::string sources;
+};
+
+/**
+ * View of an entry in a mapped cache. The pointers are valid as long as the cache is mapped.
+ * The entries with the same geometry have the same blob, the offset of their shared blocks.
+ */
+struct CacheEntryView {
+	std::string name;
+	uint32_t lod;
+	const float * positions;
+	const float * normals;
+	uint32_t vertexCount;
+	const uint32_t * indices;
+	uint32_t indexCount;
+	const MeshGroup * groups;
+	uint32_t groupCount;
+	const char * materials;
+	uint32_t materialsLength;
+	const char * sources;
+	uint32_t sourcesLength;
+	uint64_t blob;
+};
+
+/**
+ * Single cache file of the merged geometries of a model.
+ * The file is made of a header, an index of the component LODs, then the name, vertex, normal, index,
+ * group, materials and sources blocks aligned on 16 bytes so that they can be viewed directly once mapped.
+ * The identical geometries are written once, their records point to the same vertex, normal, index and group blocks.
+ */
+class GeometryCache {
+
+public:
+	static const uint32_t VERSION = 2;
+
+	~GeometryCache();
+
+	/**
+	 * Writes the entries to a temporary file renamed to the path so that a mapped cache stays valid.
+	 * Returns false if the file cannot be written.
+	 */
+	static bool write(const std::string& path, const std::vector<CacheEntry>& entries);
+
+	/**
+	 * Maps the cache file. Returns null with the error if the file is missing, has another version or is corrupted.
+	 */
+	static std::shared_ptr<GeometryCache> open(const std::string& path, std::string& error);
+
+	uint32_t version() const;
+	const std::vector<CacheEntryView>& entries() const;
+
+private:
+	GeometryCache();
+
+	void * m_data;
+	size_t m_size;
+	uint32_t m_version;
+	std::vector<CacheEntryView> m_entries;
+};
+
+}
+
+#endif
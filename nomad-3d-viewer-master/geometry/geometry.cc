@@ -0,0 +1,773 @@
+#include <node.h>
+#include <node_buffer.h>
+#include <uv.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include "mesh-merger.h"
+#include "mesh-decimator.h"
+#include "stl-io.h"
+#include "geometry-cache.h"
+#include "file-signature.h"
+#include "addon-stats.h"
+
+using namespace std;
+
+namespace nomad {
+
+using v8::FunctionCallbackInfo;
+using v8::Isolate;
+using v8::Context;
+using v8::Local;
+using v8::Object;
+using v8::String;
+using v8::Value;
+using v8::Number;
+using v8::Integer;
+using v8::Array;
+using v8::Persistent;
+using v8::Promise;
+using v8::Exception;
+using v8::ArrayBuffer;
+using v8::Uint8Array;
+using v8::Float32Array;
+using v8::Uint32Array;
+using v8::TypedArray;
+using v8::Boolean;
+
+// STL files shared by the merges of the components until they are released.
+SourceCache sources;
+
+// Times of the merges, decimations and cache accesses, and events of the geometry addon.
+AddonStats stats("geometry");
+LatencyHistogram& mergeHistogram = stats.histogram("merge");
+LatencyHistogram& decimateHistogram = stats.histogram("decimate");
+LatencyHistogram& cacheWriteHistogram = stats.histogram("cache.write");
+LatencyHistogram& cacheOpenHistogram = stats.histogram("cache.open");
+
+/**
+ * Work structure used to merge the parts or decimate a mesh on the libuv thread pool and resolve
+ * the promise once the mesh is ready.
+ */
+struct MeshWork {
+	uv_work_t request;
+	Persistent<Promise::Resolver> resolver;
+	vector<MeshPart> parts;
+	uint32_t groupCount;
+	MergedMesh source;
+	double budget;
+	bool decimate;
+	unsigned int threadCount;
+	string cachePath;
+	MergedMesh mesh;
+	string error;
+	double durationMs;
+};
+
+static void MeshWorkAsync(uv_work_t *req) {
+
+	MeshWork *work = static_cast<MeshWork *>(req->data);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	try {
+		if (work->decimate) {
+			decimateMesh(work->source, work->budget, work->threadCount, work->mesh);
+		}
+		else {
+			mergeParts(work->parts, work->groupCount, work->threadCount, work->mesh, &sources);
+		}
+
+		// Write the cache file outside the JS thread.
+		if (!work->cachePath.empty() && !writeStl(work->cachePath, work->mesh.positions, work->mesh.normals, work->mesh.indices)) {
+			stats.event("cache-write-failed", {{"path", work->cachePath}});
+		}
+	}
+	catch (const exception& e) {
+		work->error = e.what();
+	}
+
+	chrono::steady_clock::time_point end = chrono::steady_clock::now();
+	(work->decimate ? decimateHistogram : mergeHistogram).record(start, end);
+	work->durationMs = chrono::duration<double, milli>(end - start).count();
+}
+
+/**
+ * Releases the vector viewed by a typed array once it is garbage collected.
+ */
+template<typename Type>
+static void ReleaseVector(char * data, void * hint) {
+	delete static_cast<vector<Type> *>(hint);
+}
+
+/**
+ * Creates a typed array that views the values without a copy. The values are moved into the buffer.
+ */
+template<typename Type, typename ArrayType>
+static Local<ArrayType> NewTypedArray(Isolate * isolate, vector<Type>& values) {
+
+	if (values.empty()) {
+		return ArrayType::New(ArrayBuffer::New(isolate, 0), 0, 0);
+	}
+
+	vector<Type> * holder = new vector<Type>(std::move(values));
+	size_t size = holder->size();
+
+	Local<Object> buffer = node::Buffer::New(isolate, reinterpret_cast<char *>(holder->data()), size * sizeof(Type), ReleaseVector<Type>, holder).ToLocalChecked();
+	Local<Uint8Array> bytes = buffer.As<Uint8Array>();
+
+	return ArrayType::New(bytes->Buffer(), bytes->ByteOffset(), size);
+}
+
+/**
+ * Creates the JS object {size, mtime, hash} of a file signature.
+ */
+static Local<Object> NewSignature(Isolate * isolate, const FileSignature& signature) {
+
+	Local<Context> context = isolate->GetCurrentContext();
+	Local<Object> object = Object::New(isolate);
+
+	object->Set(context, String::NewFromUtf8(isolate, "size", v8::NewStringType::kNormal).ToLocalChecked(), Number::New(isolate, signature.size)).FromJust();
+	object->Set(context, String::NewFromUtf8(isolate, "mtime", v8::NewStringType::kNormal).ToLocalChecked(), Number::New(isolate, signature.mtimeMs)).FromJust();
+	object->Set(context, String::NewFromUtf8(isolate, "hash", v8::NewStringType::kNormal).ToLocalChecked(), String::NewFromUtf8(isolate, formatHash(signature.hash).c_str(), v8::NewStringType::kNormal).ToLocalChecked()).FromJust();
+
+	return object;
+}
+
+/**
+ * Creates the JS object of a mesh. The arrays are moved into typed arrays.
+ */
+static Local<Object> NewMesh(Isolate * isolate, MergedMesh& mesh) {
+
+	Local<Context> context = isolate->GetCurrentContext();
+	Local<Object> result = Object::New(isolate);
+
+	Local<Array> groups = Array::New(isolate, mesh.groups.size());
+	for (size_t i = 0; i < mesh.groups.size(); ++i) {
+		Local<Object> group = Object::New(isolate);
+		group->Set(context, String::NewFromUtf8(isolate, "start", v8::NewStringType::kNormal).ToLocalChecked(), Integer::NewFromUnsigned(isolate, mesh.groups[i].start)).FromJust();
+		group->Set(context, String::NewFromUtf8(isolate, "count", v8::NewStringType::kNormal).ToLocalChecked(), Integer::NewFromUnsigned(isolate, mesh.groups[i].count)).FromJust();
+		group->Set(context, String::NewFromUtf8(isolate, "materialIndex", v8::NewStringType::kNormal).ToLocalChecked(), Integer::NewFromUnsigned(isolate, mesh.groups[i].materialIndex)).FromJust();
+		groups->Set(context, i, group).FromJust();
+	}
+
+	Local<Array> sources = Array::New(isolate, mesh.sources.size());
+	for (size_t i = 0; i < mesh.sources.size(); ++i) {
+		sources->Set(context, i, NewSignature(isolate, mesh.sources[i])).FromJust();
+	}
+
+	Local<Array> errors = Array::New(isolate, mesh.errors.size());
+	for (size_t i = 0; i < mesh.errors.size(); ++i) {
+		errors->Set(context, i, String::NewFromUtf8(isolate, mesh.errors[i].c_str(), v8::NewStringType::kNormal).ToLocalChecked()).FromJust();
+	}
+
+	result->Set(context, String::NewFromUtf8(isolate, "position", v8::NewStringType::kNormal).ToLocalChecked(), NewTypedArray<float, Float32Array>(isolate, mesh.positions)).FromJust();
+	result->Set(context, String::NewFromUtf8(isolate, "normal", v8::NewStringType::kNormal).ToLocalChecked(), NewTypedArray<float, Float32Array>(isolate, mesh.normals)).FromJust();
+	result->Set(context, String::NewFromUtf8(isolate, "index", v8::NewStringType::kNormal).ToLocalChecked(), NewTypedArray<uint32_t, Uint32Array>(isolate, mesh.indices)).FromJust();
+	result->Set(context, String::NewFromUtf8(isolate, "groups", v8::NewStringType::kNormal).ToLocalChecked(), groups).FromJust();
+	result->Set(context, String::NewFromUtf8(isolate, "sources", v8::NewStringType::kNormal).ToLocalChecked(), sources).FromJust();
+	result->Set(context, String::NewFromUtf8(isolate, "errors", v8::NewStringType::kNormal).ToLocalChecked(), errors).FromJust();
+
+	return result;
+}
+
+/**
+ * MeshWorkAsyncComplete function is called on the JS thread once the mesh is ready.
+ */
+static void MeshWorkAsyncComplete(uv_work_t *req, int status) {
+
+	Isolate * isolate = Isolate::GetCurrent();
+
+	v8::HandleScope handleScope(isolate);
+
+	MeshWork *work = static_cast<MeshWork *>(req->data);
+
+	// The callback scope runs the microtasks so that the promise continuations are executed now.
+	node::CallbackScope callbackScope(isolate, Object::New(isolate), {0, 0});
+
+	Local<Context> context = isolate->GetCurrentContext();
+	Local<Promise::Resolver> resolver = Local<Promise::Resolver>::New(isolate, work->resolver);
+
+	if (work->error.empty()) {
+		Local<Object> result = NewMesh(isolate, work->mesh);
+		result->Set(context, String::NewFromUtf8(isolate, "duration", v8::NewStringType::kNormal).ToLocalChecked(), Number::New(isolate, work->durationMs)).FromJust();
+		resolver->Resolve(context, result).FromJust();
+	}
+	else {
+		resolver->Reject(context, Exception::Error(String::NewFromUtf8(isolate, work->error.c_str(), v8::NewStringType::kNormal).ToLocalChecked())).FromJust();
+	}
+
+	work->resolver.Reset();
+	delete work;
+}
+
+static Local<Value> GetMember(Isolate * isolate, Local<Value> object, const char * name) {
+
+	if (!object->IsObject()) {
+		return v8::Undefined(isolate);
+	}
+
+	Local<Context> context = isolate->GetCurrentContext();
+	return Local<Object>::Cast(object)->Get(context, String::NewFromUtf8(isolate, name, v8::NewStringType::kNormal).ToLocalChecked()).ToLocalChecked();
+}
+
+/**
+ * Loads and merges the STL parts of a mergeable component.
+ * The first argument is an array of parts {path, matrix, group} where matrix contains the 16 elements of a THREE.Matrix4
+ * and group is the index of the material group. The second argument is the number of material groups.
+ * The optional third argument is an object {threads, cachePath}: threads is the size of the pool, 0 for the
+ * number of cores, and cachePath is the binary STL file written with the merged mesh.
+ * Returns a promise resolved with {position: Float32Array, normal: Float32Array, index: Uint32Array,
+ * groups: [{start, count, materialIndex}], sources: [{size, mtime, hash}], errors: [path], duration}
+ * where sources are the signatures of the part files.
+ */
+void MergeStl(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+	Local<Context> context = isolate->GetCurrentContext();
+	Local<Promise::Resolver> resolver = Promise::Resolver::New(context).ToLocalChecked();
+
+	MeshWork * work = new MeshWork();
+
+	work->request.data = work;
+	work->resolver.Reset(isolate, resolver);
+	work->groupCount = args[1]->Uint32Value(context).FromMaybe(0);
+	work->budget = 1.0;
+	work->decimate = false;
+	work->threadCount = 0;
+	work->durationMs = 0.0;
+
+	if (args[0]->IsArray()) {
+
+		Local<Array> parts = Local<Array>::Cast(args[0]);
+		work->parts.resize(parts->Length());
+
+		for (uint32_t i = 0; i < parts->Length(); ++i) {
+
+			Local<Value> part = parts->Get(context, i).ToLocalChecked();
+			MeshPart& meshPart = work->parts[i];
+
+			String::Utf8Value path(isolate, GetMember(isolate, part, "path"));
+			meshPart.path = (*path != 0 ? *path : "");
+			meshPart.group = GetMember(isolate, part, "group")->Uint32Value(context).FromMaybe(0);
+
+			// Identity if the matrix is missing.
+			Local<Value> matrix = GetMember(isolate, part, "matrix");
+			for (uint32_t j = 0; j < 16; ++j) {
+				meshPart.matrix[j] = (j % 5 == 0 ? 1.0 : 0.0);
+				if (matrix->IsObject()) {
+					meshPart.matrix[j] = Local<Object>::Cast(matrix)->Get(context, j).ToLocalChecked()->NumberValue(context).FromMaybe(meshPart.matrix[j]);
+				}
+			}
+		}
+	}
+
+	Local<Value> threads = GetMember(isolate, args[2], "threads");
+	if (threads->IsNumber()) {
+		work->threadCount = threads->Uint32Value(context).FromMaybe(0);
+	}
+
+	Local<Value> cachePath = GetMember(isolate, args[2], "cachePath");
+	if (cachePath->IsString()) {
+		String::Utf8Value path(isolate, cachePath);
+		work->cachePath = *path;
+	}
+
+	uv_queue_work(uv_default_loop(), &work->request, MeshWorkAsync, MeshWorkAsyncComplete);
+
+	args.GetReturnValue().Set(resolver->GetPromise());
+}
+
+/**
+ * Work structure used to write the geometry cache on the libuv thread pool.
+ */
+struct WriteCacheWork {
+	uv_work_t request;
+	Persistent<Promise::Resolver> resolver;
+	string path;
+	vector<CacheEntry> entries;
+	bool written;
+};
+
+static void WriteCacheWorkAsync(uv_work_t *req) {
+
+	WriteCacheWork *work = static_cast<WriteCacheWork *>(req->data);
+
+	LatencyTimer timer(cacheWriteHistogram);
+	work->written = GeometryCache::write(work->path, work->entries);
+}
+
+static void WriteCacheWorkAsyncComplete(uv_work_t *req, int status) {
+
+	Isolate * isolate = Isolate::GetCurrent();
+
+	v8::HandleScope handleScope(isolate);
+
+	WriteCacheWork *work = static_cast<WriteCacheWork *>(req->data);
+
+	node::CallbackScope callbackScope(isolate, Object::New(isolate), {0, 0});
+
+	Local<Context> context = isolate->GetCurrentContext();
+	Local<Promise::Resolver> resolver = Local<Promise::Resolver>::New(isolate, work->resolver);
+
+	if (work->written) {
+		resolver->Resolve(context, v8::Boolean::New(isolate, true)).FromJust();
+	}
+	else {
+		string error = "cannot write geometry cache " + work->path;
+		resolver->Reject(context, Exception::Error(String::NewFromUtf8(isolate, error.c_str(), v8::NewStringType::kNormal).ToLocalChecked())).FromJust();
+	}
+
+	work->resolver.Reset();
+	delete work;
+}
+
+/**
+ * Copies the content of a typed array.
+ */
+template<typename Type>
+static void CopyTypedArray(Local<Value> value, vector<Type>& values) {
+
+	values.clear();
+
+	if (value->IsTypedArray()) {
+		Local<TypedArray> array = Local<TypedArray>::Cast(value);
+		values.resize(array->ByteLength() / sizeof(Type));
+		if (!values.empty()) {
+			array->CopyContents(values.data(), values.size() * sizeof(Type));
+		}
+	}
+}
+
+/**
+ * Reads the groups [{start, count, materialIndex}] of a mesh.
+ */
+static void ReadGroups(Isolate * isolate, Local<Value> value, vector<MeshGroup>& groups) {
+
+	Local<Context> context = isolate->GetCurrentContext();
+
+	groups.clear();
+
+	if (!value->IsArray()) {
+		return;
+	}
+
+	Local<Array> groupArray = Local<Array>::Cast(value);
+	for (uint32_t g = 0; g < groupArray->Length(); ++g) {
+		Local<Value> group = groupArray->Get(context, g).ToLocalChecked();
+		MeshGroup meshGroup;
+		meshGroup.start = GetMember(isolate, group, "start")->Uint32Value(context).FromMaybe(0);
+		meshGroup.count = GetMember(isolate, group, "count")->Uint32Value(context).FromMaybe(0);
+		meshGroup.materialIndex = GetMember(isolate, group, "materialIndex")->Uint32Value(context).FromMaybe(0);
+		groups.push_back(meshGroup);
+	}
+}
+
+/**
+ * Writes the geometry cache of a model.
+ * The first argument is the path of the cache file. The second argument is an array of entries
+ * {name, lod, position: Float32Array, normal: Float32Array, index: Uint32Array, groups: [{start, count, materialIndex}], materials, sources}
+ * where materials is the JSON description of the component materials and sources the JSON description of the merge inputs.
+ * The arrays are copied, then the file is written outside the JS thread. Returns a promise resolved once written.
+ */
+void WriteCache(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+	Local<Context> context = isolate->GetCurrentContext();
+	Local<Promise::Resolver> resolver = Promise::Resolver::New(context).ToLocalChecked();
+
+	WriteCacheWork * work = new WriteCacheWork();
+
+	work->request.data = work;
+	work->resolver.Reset(isolate, resolver);
+	work->written = false;
+
+	String::Utf8Value path(isolate, args[0]);
+	work->path = (*path != 0 ? *path : "");
+
+	if (args[1]->IsArray()) {
+
+		Local<Array> entries = Local<Array>::Cast(args[1]);
+		work->entries.resize(entries->Length());
+
+		for (uint32_t i = 0; i < entries->Length(); ++i) {
+
+			Local<Value> entry = entries->Get(context, i).ToLocalChecked();
+			CacheEntry& cacheEntry = work->entries[i];
+
+			String::Utf8Value name(isolate, GetMember(isolate, entry, "name"));
+			cacheEntry.name = (*name != 0 ? *name : "");
+			cacheEntry.lod = GetMember(isolate, entry, "lod")->Uint32Value(context).FromMaybe(0);
+
+			CopyTypedArray(GetMember(isolate, entry, "position"), cacheEntry.positions);
+			CopyTypedArray(GetMember(isolate, entry, "normal"), cacheEntry.normals);
+			CopyTypedArray(GetMember(isolate, entry, "index"), cacheEntry.indices);
+
+			ReadGroups(isolate, GetMember(isolate, entry, "groups"), cacheEntry.groups);
+
+			Local<Value> materials = GetMember(isolate, entry, "materials");
+			if (materials->IsString()) {
+				String::Utf8Value json(isolate, materials);
+				cacheEntry.materials = *json;
+			}
+
+			Local<Value> sources = GetMember(isolate, entry, "sources");
+			if (sources->IsString()) {
+				String::Utf8Value json(isolate, sources);
+				cacheEntry.sources = *json;
+			}
+		}
+	}
+
+	uv_queue_work(uv_default_loop(), &work->request, WriteCacheWorkAsync, WriteCacheWorkAsyncComplete);
+
+	args.GetReturnValue().Set(resolver->GetPromise());
+}
+
+/**
+ * Simplifies a mesh with quadric edge collapses to generate a LOD.
+ * The first argument is a mesh {position, normal, index, groups} as returned by mergeStl. The second argument is
+ * the budget: up to 1 a ratio of the triangles, above a triangle count. The optional third argument is an object {threads}.
+ * The arrays are copied, then the mesh is simplified outside the JS thread. Returns a promise resolved with the
+ * simplified mesh with the same members as mergeStl.
+ */
+void Decimate(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+	Local<Context> context = isolate->GetCurrentContext();
+	Local<Promise::Resolver> resolver = Promise::Resolver::New(context).ToLocalChecked();
+
+	MeshWork * work = new MeshWork();
+
+	work->request.data = work;
+	work->resolver.Reset(isolate, resolver);
+	work->groupCount = 0;
+	work->budget = args[1]->NumberValue(context).FromMaybe(1.0);
+	work->decimate = true;
+	work->threadCount = 0;
+	work->durationMs = 0.0;
+
+	CopyTypedArray(GetMember(isolate, args[0], "position"), work->source.positions);
+	CopyTypedArray(GetMember(isolate, args[0], "normal"), work->source.normals);
+	CopyTypedArray(GetMember(isolate, args[0], "index"), work->source.indices);
+	ReadGroups(isolate, GetMember(isolate, args[0], "groups"), work->source.groups);
+
+	Local<Value> threads = GetMember(isolate, args[2], "threads");
+	if (threads->IsNumber()) {
+		work->threadCount = threads->Uint32Value(context).FromMaybe(0);
+	}
+
+	uv_queue_work(uv_default_loop(), &work->request, MeshWorkAsync, MeshWorkAsyncComplete);
+
+	args.GetReturnValue().Set(resolver->GetPromise());
+}
+
+/**
+ * Releases the reference to the mapped cache once a typed array viewing it is garbage collected.
+ */
+static void ReleaseCache(char * data, void * hint) {
+	delete static_cast<shared_ptr<GeometryCache> *>(hint);
+}
+
+/**
+ * Creates a typed array that views a block of the mapped cache. The cache stays mapped as long as the array lives.
+ */
+template<typename Type, typename ArrayType>
+static Local<ArrayType> NewMappedArray(Isolate * isolate, const shared_ptr<GeometryCache>& cache, const Type * data, size_t size) {
+
+	if (size == 0) {
+		return ArrayType::New(ArrayBuffer::New(isolate, 0), 0, 0);
+	}
+
+	shared_ptr<GeometryCache> * hint = new shared_ptr<GeometryCache>(cache);
+
+	Local<Object> buffer = node::Buffer::New(isolate, reinterpret_cast<char *>(const_cast<Type *>(data)), size * sizeof(Type), ReleaseCache, hint).ToLocalChecked();
+	Local<Uint8Array> bytes = buffer.As<Uint8Array>();
+
+	return ArrayType::New(bytes->Buffer(), bytes->ByteOffset(), size);
+}
+
+/**
+ * Maps the geometry cache of a model.
+ * Returns {version, entries} where the entries have the same members as in writeCache and the typed arrays
+ * view the mapped file without parsing nor copy, and blob identifies the geometry shared by identical entries. Returns null if the file is missing, invalid or has another version.
+ */
+void OpenCache(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+	Local<Context> context = isolate->GetCurrentContext();
+
+	String::Utf8Value path(isolate, args[0]);
+	string error;
+	shared_ptr<GeometryCache> cache;
+	{
+		LatencyTimer timer(cacheOpenHistogram);
+		cache = GeometryCache::open(*path != 0 ? *path : "", error);
+	}
+
+	if (cache.get() == 0) {
+		if (error != "no cache") {
+			stats.event("cache-ignored", {{"path", *path != 0 ? *path : ""}, {"error", error}});
+		}
+		args.GetReturnValue().Set(v8::Null(isolate));
+		return;
+	}
+
+	const vector<CacheEntryView>& entries = cache->entries();
+	Local<Array> entryArray = Array::New(isolate, entries.size());
+
+	for (size_t i = 0; i < entries.size(); ++i) {
+
+		const CacheEntryView& entry = entries[i];
+		Local<Object> object = Object::New(isolate);
+
+		Local<Array> groups = Array::New(isolate, entry.groupCount);
+		for (uint32_t g = 0; g < entry.groupCount; ++g) {
+			Local<Object> group = Object::New(isolate);
+			group->Set(context, String::NewFromUtf8(isolate, "start", v8::NewStringType::kNormal).ToLocalChecked(), Integer::NewFromUnsigned(isolate, entry.groups[g].start)).FromJust();
+			group->Set(context, String::NewFromUtf8(isolate, "count", v8::NewStringType::kNormal).ToLocalChecked(), Integer::NewFromUnsigned(isolate, entry.groups[g].count)).FromJust();
+			group->Set(context, String::NewFromUtf8(isolate, "materialIndex", v8::NewStringType::kNormal).ToLocalChecked(), Integer::NewFromUnsigned(isolate, entry.groups[g].materialIndex)).FromJust();
+			groups->Set(context, g, group).FromJust();
+		}
+
+		string materials(entry.materials, entry.materialsLength);
+		string sources(entry.sources, entry.sourcesLength);
+
+		object->Set(context, String::NewFromUtf8(isolate, "name", v8::NewStringType::kNormal).ToLocalChecked(), String::NewFromUtf8(isolate, entry.name.c_str(), v8::NewStringType::kNormal).ToLocalChecked()).FromJust();
+		object->Set(context, String::NewFromUtf8(isolate, "lod", v8::NewStringType::kNormal).ToLocalChecked(), Integer::NewFromUnsigned(isolate, entry.lod)).FromJust();
+		object->Set(context, String::NewFromUtf8(isolate, "blob", v8::NewStringType::kNormal).ToLocalChecked(), Number::New(isolate, entry.blob)).FromJust();
+		object->Set(context, String::NewFromUtf8(isolate, "position", v8::NewStringType::kNormal).ToLocalChecked(), NewMappedArray<float, Float32Array>(isolate, cache, entry.positions, entry.vertexCount * 3)).FromJust();
+		object->Set(context, String::NewFromUtf8(isolate, "normal", v8::NewStringType::kNormal).ToLocalChecked(), NewMappedArray<float, Float32Array>(isolate, cache, entry.normals, entry.vertexCount * 3)).FromJust();
+		object->Set(context, String::NewFromUtf8(isolate, "index", v8::NewStringType::kNormal).ToLocalChecked(), NewMappedArray<uint32_t, Uint32Array>(isolate, cache, entry.indices, entry.indexCount)).FromJust();
+		object->Set(context, String::NewFromUtf8(isolate, "groups", v8::NewStringType::kNormal).ToLocalChecked(), groups).FromJust();
+		object->Set(context, String::NewFromUtf8(isolate, "materials", v8::NewStringType::kNormal).ToLocalChecked(), String::NewFromUtf8(isolate, materials.c_str(), v8::NewStringType::kNormal).ToLocalChecked()).FromJust();
+		object->Set(context, String::NewFromUtf8(isolate, "sources", v8::NewStringType::kNormal).ToLocalChecked(), String::NewFromUtf8(isolate, sources.c_str(), v8::NewStringType::kNormal).ToLocalChecked()).FromJust();
+
+		entryArray->Set(context, i, object).FromJust();
+	}
+
+	Local<Object> result = Object::New(isolate);
+	result->Set(context, String::NewFromUtf8(isolate, "version", v8::NewStringType::kNormal).ToLocalChecked(), Integer::NewFromUnsigned(isolate, cache->version())).FromJust();
+	result->Set(context, String::NewFromUtf8(isolate, "entries", v8::NewStringType::kNormal).ToLocalChecked(), entryArray).FromJust();
+
+	args.GetReturnValue().Set(result);
+}
+
+/**
+ * Work structure used to check the signatures of source files on the libuv thread pool.
+ * The known signatures are copied on the JS thread, the files are stated and hashed by the work.
+ */
+struct SourcesWork {
+	uv_work_t request;
+	Persistent<Promise::Resolver> resolver;
+	vector<string> paths;
+	vector<FileSignature> known;
+	vector<string> knownHashes;
+	vector<FileSignature> signatures;
+	vector<string> hashes;
+	vector<bool> exists;
+};
+
+static void SourcesWorkAsync(uv_work_t *req) {
+
+	SourcesWork *work = static_cast<SourcesWork *>(req->data);
+
+	size_t count = work->paths.size();
+
+	work->signatures.resize(count);
+	work->hashes.resize(count);
+	work->exists.resize(count, false);
+
+	vector<size_t> toHash;
+
+	for (size_t i = 0; i < count; ++i) {
+
+		if (!statFile(work->paths[i], work->signatures[i])) {
+			continue;
+		}
+
+		work->exists[i] = true;
+
+		if (!work->knownHashes[i].empty()
+			&& work->known[i].size == work->signatures[i].size
+			&& work->known[i].mtimeMs == work->signatures[i].mtimeMs) {
+			work->hashes[i] = work->knownHashes[i];
+		}
+		else {
+			toHash.push_back(i);
+		}
+	}
+
+	parallelFor(toHash.size(), 0, [&](size_t j) {
+		size_t i = toHash[j];
+		if (signFile(work->paths[i], work->signatures[i])) {
+			work->hashes[i] = formatHash(work->signatures[i].hash);
+		}
+		else {
+			work->exists[i] = false;
+		}
+	});
+}
+
+static void SourcesWorkAsyncComplete(uv_work_t *req, int status) {
+
+	Isolate * isolate = Isolate::GetCurrent();
+
+	v8::HandleScope handleScope(isolate);
+
+	SourcesWork *work = static_cast<SourcesWork *>(req->data);
+
+	node::CallbackScope callbackScope(isolate, Object::New(isolate), {0, 0});
+
+	Local<Context> context = isolate->GetCurrentContext();
+	Local<Promise::Resolver> resolver = Local<Promise::Resolver>::New(isolate, work->resolver);
+
+	Local<Array> result = Array::New(isolate, work->paths.size());
+
+	for (size_t i = 0; i < work->paths.size(); ++i) {
+		if (!work->exists[i]) {
+			result->Set(context, i, v8::Null(isolate)).FromJust();
+			continue;
+		}
+		Local<Object> object = Object::New(isolate);
+		object->Set(context, String::NewFromUtf8(isolate, "size", v8::NewStringType::kNormal).ToLocalChecked(), Number::New(isolate, work->signatures[i].size)).FromJust();
+		object->Set(context, String::NewFromUtf8(isolate, "mtime", v8::NewStringType::kNormal).ToLocalChecked(), Number::New(isolate, work->signatures[i].mtimeMs)).FromJust();
+		object->Set(context, String::NewFromUtf8(isolate, "hash", v8::NewStringType::kNormal).ToLocalChecked(), String::NewFromUtf8(isolate, work->hashes[i].c_str(), v8::NewStringType::kNormal).ToLocalChecked()).FromJust();
+		result->Set(context, i, object).FromJust();
+	}
+
+	resolver->Resolve(context, result).FromJust();
+
+	work->resolver.Reset();
+	delete work;
+}
+
+/**
+ * Checks the signatures of source files.
+ * The first argument is the array of paths, the second one the array of known signatures {size, mtime, hash}.
+ * The content of a file is hashed only if its size or modification time differs from the known signature,
+ * the files to hash are read in parallel outside the JS thread.
+ * Returns a promise resolved with the array of current signatures, with null for the files that do not exist.
+ */
+void CheckSources(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+	Local<Context> context = isolate->GetCurrentContext();
+	Local<Promise::Resolver> resolver = Promise::Resolver::New(context).ToLocalChecked();
+
+	SourcesWork * work = new SourcesWork();
+
+	work->request.data = work;
+	work->resolver.Reset(isolate, resolver);
+
+	if (args[0]->IsArray()) {
+		Local<Array> pathArray = Local<Array>::Cast(args[0]);
+		for (uint32_t i = 0; i < pathArray->Length(); ++i) {
+			String::Utf8Value path(isolate, pathArray->Get(context, i).ToLocalChecked());
+			work->paths.push_back(*path != 0 ? *path : "");
+		}
+	}
+
+	work->known.resize(work->paths.size());
+	work->knownHashes.resize(work->paths.size());
+
+	for (size_t i = 0; i < work->paths.size(); ++i) {
+
+		Local<Value> known = v8::Undefined(isolate);
+		if (args[1]->IsArray() && i < Local<Array>::Cast(args[1])->Length()) {
+			known = Local<Array>::Cast(args[1])->Get(context, i).ToLocalChecked();
+		}
+
+		// A missing hash forces the hash of the file.
+		Local<Value> hash = GetMember(isolate, known, "hash");
+		double size = GetMember(isolate, known, "size")->NumberValue(context).FromMaybe(-1.0);
+
+		if (hash->IsString() && size >= 0.0) {
+			String::Utf8Value knownHash(isolate, hash);
+			work->knownHashes[i] = *knownHash;
+			work->known[i].size = size;
+			work->known[i].mtimeMs = GetMember(isolate, known, "mtime")->NumberValue(context).FromMaybe(-1.0);
+		}
+	}
+
+	uv_queue_work(uv_default_loop(), &work->request, SourcesWorkAsync, SourcesWorkAsyncComplete);
+
+	args.GetReturnValue().Set(resolver->GetPromise());
+}
+
+/**
+ * Releases the STL files read by the merges once all the components are merged.
+ * Returns the counters of the source cache {reads, hits, shared, meshes, bytes} where hits are the files
+ * already read, shared the files with the content of another one, meshes and bytes the distinct meshes held.
+ */
+void ReleaseSources(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+	Local<Context> context = isolate->GetCurrentContext();
+
+	SourceCacheStats sourceStats = sources.stats();
+	sources.clear();
+
+	Local<Object> result = Object::New(isolate);
+	result->Set(context, String::NewFromUtf8(isolate, "reads", v8::NewStringType::kNormal).ToLocalChecked(), Number::New(isolate, sourceStats.reads)).FromJust();
+	result->Set(context, String::NewFromUtf8(isolate, "hits", v8::NewStringType::kNormal).ToLocalChecked(), Number::New(isolate, sourceStats.hits)).FromJust();
+	result->Set(context, String::NewFromUtf8(isolate, "shared", v8::NewStringType::kNormal).ToLocalChecked(), Number::New(isolate, sourceStats.shared)).FromJust();
+	result->Set(context, String::NewFromUtf8(isolate, "meshes", v8::NewStringType::kNormal).ToLocalChecked(), Number::New(isolate, sourceStats.meshes)).FromJust();
+	result->Set(context, String::NewFromUtf8(isolate, "bytes", v8::NewStringType::kNormal).ToLocalChecked(), Number::New(isolate, sourceStats.bytes)).FromJust();
+
+	args.GetReturnValue().Set(result);
+}
+
+/**
+ * Gets the stats {time, addon, histograms, counters, gauges, events} of the geometry addon.
+ * The histograms give the count and the min, mean, percentiles and max times in us, the times are wall clock ms.
+ */
+void GetStats(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+
+	Local<String> json = String::NewFromUtf8(isolate, stats.toJson().c_str(), v8::NewStringType::kNormal).ToLocalChecked();
+
+	args.GetReturnValue().Set(v8::JSON::Parse(isolate->GetCurrentContext(), json).ToLocalChecked());
+}
+
+/**
+ * Starts appending the stats to the file every period in ms.
+ */
+void StartStatsDump(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+
+	String::Utf8Value path(isolate, args[0]);
+	int periodMs = args[1]->Int32Value(isolate->GetCurrentContext()).FromMaybe(0);
+
+	args.GetReturnValue().Set(Boolean::New(isolate, stats.startDump(*path != 0 ? *path : "", periodMs)));
+}
+
+void StopStatsDump(const FunctionCallbackInfo<Value>& args) {
+
+	stats.stopDump();
+
+	args.GetReturnValue().Set(v8::Undefined(args.GetIsolate()));
+}
+
+/**
+ * The init function declares what we will make visible to node.
+ */
+void init(Local<Object> exports) {
+
+	// Register the functions.
+	NODE_SET_METHOD(exports, "mergeStl", MergeStl);
+	NODE_SET_METHOD(exports, "decimate", Decimate);
+	NODE_SET_METHOD(exports, "writeCache", WriteCache);
+	NODE_SET_METHOD(exports, "openCache", OpenCache);
+	NODE_SET_METHOD(exports, "checkSources", CheckSources);
+	NODE_SET_METHOD(exports, "releaseSources", ReleaseSources);
+	NODE_SET_METHOD(exports, "getStats", GetStats);
+	NODE_SET_METHOD(exports, "startStatsDump", StartStatsDump);
+	NODE_SET_METHOD(exports, "stopStatsDump", StopStatsDump);
+}
+
+NODE_MODULE(addonnomad3dgeometry, init)
+
+}
@@ -0,0 +1,488 @@
+#include "mesh-decimator.h"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <unordered_map>
+
+using namespace std;
+
+namespace nomad {
+
+// Weight of the planes that keep the open borders in place.
+static const double BORDER_WEIGHT = 1000.0;
+
+// Minimum cosine between the normals of a face before and after a collapse.
+static const double MAX_FLIP = 0.2;
+
+struct Vec3 {
+	double x, y, z;
+
+	Vec3() : x(0.0), y(0.0), z(0.0) {}
+	Vec3(double x, double y, double z) : x(x), y(y), z(z) {}
+
+	Vec3 operator+(const Vec3& v) const { return Vec3(x + v.x, y + v.y, z + v.z); }
+	Vec3 operator-(const Vec3& v) const { return Vec3(x - v.x, y - v.y, z - v.z); }
+	Vec3 operator*(double s) const { return Vec3(x * s, y * s, z * s); }
+
+	double dot(const Vec3& v) const { return x * v.x + y * v.y + z * v.z; }
+	Vec3 cross(const Vec3& v) const { return Vec3(y * v.z - z * v.y, z * v.x - x * v.z, x * v.y - y * v.x); }
+	double length() const { return sqrt(dot(*this)); }
+};
+
+/**
+ * Symmetric 4x4 quadric of the squared distances to a set of planes.
+ */
+struct Quadric {
+	double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+	Quadric() : a2(0), ab(0), ac(0), ad(0), b2(0), bc(0), bd(0), c2(0), cd(0), d2(0) {}
+
+	/**
+	 * Quadric of the plane n.p + d = 0 with a unit normal, scaled by the weight.
+	 */
+	Quadric(const Vec3& n, double d, double weight) :
+		a2(n.x * n.x * weight), ab(n.x * n.y * weight), ac(n.x * n.z * weight), ad(n.x * d * weight),
+		b2(n.y * n.y * weight), bc(n.y * n.z * weight), bd(n.y * d * weight),
+		c2(n.z * n.z * weight), cd(n.z * d * weight), d2(d * d * weight) {}
+
+	Quadric& operator+=(const Quadric& q) {
+		a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+		b2 += q.b2; bc += q.bc; bd += q.bd;
+		c2 += q.c2; cd += q.cd; d2 += q.d2;
+		return *this;
+	}
+
+	double error(const Vec3& p) const {
+		return a2 * p.x * p.x + 2 * ab * p.x * p.y + 2 * ac * p.x * p.z + 2 * ad * p.x
+			+ b2 * p.y * p.y + 2 * bc * p.y * p.z + 2 * bd * p.y
+			+ c2 * p.z * p.z + 2 * cd * p.z + d2;
+	}
+
+	/**
+	 * Finds the point of minimal error. Returns false if the system is singular.
+	 */
+	bool optimum(Vec3& p) const {
+
+		double det = a2 * (b2 * c2 - bc * bc) - ab * (ab * c2 - bc * ac) + ac * (ab * bc - b2 * ac);
+
+		if (fabs(det) < 1.0e-12) {
+			return false;
+		}
+
+		// Cramer's rule on the 3x3 system.
+		p.x = (-ad * (b2 * c2 - bc * bc) + ab * (bd * c2 - bc * cd) - ac * (bd * bc - b2 * cd)) / det;
+		p.y = (-a2 * (bd * c2 - cd * bc) + ad * (ab * c2 - bc * ac) - ac * (ab * cd - bd * ac)) / det;
+		p.z = (-a2 * (b2 * cd - bc * bd) + ab * (ab * cd - bd * ac) - ad * (ab * bc - b2 * ac)) / det;
+
+		return true;
+	}
+};
+
+/**
+ * Candidate collapse of the edge (v0, v1) into the point.
+ */
+struct Collapse {
+	double cost;
+	uint32_t v0, v1;
+	uint32_t version0, version1;
+	Vec3 point;
+
+	bool operator>(const Collapse& other) const {
+		return cost > other.cost;
+	}
+};
+
+/**
+ * Simplifier of the triangles of one group.
+ */
+class Simplifier {
+
+public:
+	Simplifier(const MergedMesh& source, const MeshGroup& group) {
+
+		// Weld the positions only: the vertices of the flat faces are split by their normals.
+		unordered_map<uint64_t, vector<uint32_t> > buckets;
+
+		for (uint32_t i = group.start; i + 2 < group.start + group.count; i += 3) {
+
+			uint32_t triangle[3];
+
+			for (int k = 0; k < 3; ++k) {
+				const float * p = &source.positions[source.indices[i + k] * 3];
+				triangle[k] = vertex(buckets, Vec3(p[0], p[1], p[2]));
+			}
+
+			if (triangle[0] != triangle[1] && triangle[1] != triangle[2] && triangle[0] != triangle[2]) {
+				m_triangles.push_back(Triangle(triangle));
+			}
+		}
+
+		m_activeTriangles = m_triangles.size();
+		m_vertexFaces.resize(m_positions.size());
+		m_quadrics.resize(m_positions.size());
+		m_versions.resize(m_positions.size(), 0);
+		m_removed.resize(m_positions.size(), false);
+
+		for (uint32_t t = 0; t < m_triangles.size(); ++t) {
+			for (int k = 0; k < 3; ++k) {
+				m_vertexFaces[m_triangles[t].v[k]].push_back(t);
+			}
+		}
+
+		computeQuadrics();
+	}
+
+	size_t triangleCount() const {
+		return m_activeTriangles;
+	}
+
+	/**
+	 * Collapses the cheapest edges until the target is reached or no edge can be collapsed.
+	 */
+	void simplify(size_t targetTriangles) {
+
+		priority_queue<Collapse, vector<Collapse>, greater<Collapse> > queue;
+
+		for (uint32_t t = 0; t < m_triangles.size(); ++t) {
+			for (int k = 0; k < 3; ++k) {
+				uint32_t v0 = m_triangles[t].v[k];
+				uint32_t v1 = m_triangles[t].v[(k + 1) % 3];
+				// Each interior edge is seen twice, keep one direction.
+				if (v0 < v1 || isBorder(v0, v1)) {
+					queue.push(collapse(v0, v1));
+				}
+			}
+		}
+
+		while (m_activeTriangles > targetTriangles && !queue.empty()) {
+
+			Collapse candidate = queue.top();
+			queue.pop();
+
+			if (m_removed[candidate.v0] || m_removed[candidate.v1]
+				|| candidate.version0 != m_versions[candidate.v0] || candidate.version1 != m_versions[candidate.v1]) {
+				continue;
+			}
+
+			if (flips(candidate.v0, candidate.v1, candidate.point) || flips(candidate.v1, candidate.v0, candidate.point)) {
+				continue;
+			}
+
+			apply(candidate);
+
+			// Update the costs of the edges around the kept vertex.
+			vector<uint32_t> neighbours;
+			for (size_t f = 0; f < m_vertexFaces[candidate.v0].size(); ++f) {
+				const Triangle& triangle = m_triangles[m_vertexFaces[candidate.v0][f]];
+				for (int k = 0; k < 3; ++k) {
+					if (triangle.v[k] != candidate.v0) {
+						neighbours.push_back(triangle.v[k]);
+					}
+				}
+			}
+
+			sort(neighbours.begin(), neighbours.end());
+			neighbours.erase(unique(neighbours.begin(), neighbours.end()), neighbours.end());
+
+			for (size_t n = 0; n < neighbours.size(); ++n) {
+				queue.push(collapse(candidate.v0, neighbours[n]));
+			}
+		}
+	}
+
+	/**
+	 * Appends the remaining triangles with their face normals.
+	 */
+	void output(WeldedGroup& group) const {
+
+		VertexWelder welder(group);
+		welder.reserve(m_activeTriangles * 3);
+
+		for (size_t t = 0; t < m_triangles.size(); ++t) {
+
+			const Triangle& triangle = m_triangles[t];
+
+			if (triangle.removed) {
+				continue;
+			}
+
+			Vec3 n = normal(m_positions[triangle.v[0]], m_positions[triangle.v[1]], m_positions[triangle.v[2]]);
+			float normalValues[3] = {float(n.x), float(n.y), float(n.z)};
+
+			for (int k = 0; k < 3; ++k) {
+				const Vec3& p = m_positions[triangle.v[k]];
+				float position[3] = {float(p.x), float(p.y), float(p.z)};
+				welder.add(position, normalValues);
+			}
+		}
+	}
+
+private:
+	struct Triangle {
+		uint32_t v[3];
+		bool removed;
+
+		Triangle(const uint32_t * vertices) : removed(false) {
+			v[0] = vertices[0];
+			v[1] = vertices[1];
+			v[2] = vertices[2];
+		}
+	};
+
+	uint32_t vertex(unordered_map<uint64_t, vector<uint32_t> >& buckets, const Vec3& p) {
+
+		uint64_t hash = 14695981039346656037ULL;
+		double values[3] = {p.x, p.y, p.z};
+		for (int i = 0; i < 3; ++i) {
+			hash ^= static_cast<uint64_t>(llround(values[i] * 1.0e4));
+			hash *= 1099511628211ULL;
+		}
+
+		vector<uint32_t>& bucket = buckets[hash];
+
+		for (size_t i = 0; i < bucket.size(); ++i) {
+			const Vec3& q = m_positions[bucket[i]];
+			if (q.x == p.x && q.y == p.y && q.z == p.z) {
+				return bucket[i];
+			}
+		}
+
+		uint32_t index = m_positions.size();
+		m_positions.push_back(p);
+		bucket.push_back(index);
+
+		return index;
+	}
+
+	static Vec3 normal(const Vec3& p0, const Vec3& p1, const Vec3& p2) {
+
+		Vec3 n = (p1 - p0).cross(p2 - p0);
+		double length = n.length();
+
+		return (length > 0.0 ? n * (1.0 / length) : n);
+	}
+
+	bool isBorder(uint32_t v0, uint32_t v1) const {
+
+		int count = 0;
+
+		for (size_t f = 0; f < m_vertexFaces[v0].size(); ++f) {
+			const Triangle& triangle = m_triangles[m_vertexFaces[v0][f]];
+			if (!triangle.removed && (triangle.v[0] == v1 || triangle.v[1] == v1 || triangle.v[2] == v1)) {
+				++count;
+			}
+		}
+
+		return (count == 1);
+	}
+
+	void computeQuadrics() {
+
+		for (size_t t = 0; t < m_triangles.size(); ++t) {
+
+			const Triangle& triangle = m_triangles[t];
+			const Vec3& p0 = m_positions[triangle.v[0]];
+			const Vec3& p1 = m_positions[triangle.v[1]];
+			const Vec3& p2 = m_positions[triangle.v[2]];
+
+			Vec3 n = (p1 - p0).cross(p2 - p0);
+			double area = n.length();
+
+			if (area == 0.0) {
+				continue;
+			}
+
+			n = n * (1.0 / area);
+
+			// Area weighted plane quadric.
+			Quadric quadric(n, -n.dot(p0), area * 0.5);
+
+			for (int k = 0; k < 3; ++k) {
+				m_quadrics[triangle.v[k]] += quadric;
+			}
+
+			// Planes perpendicular to the open borders.
+			for (int k = 0; k < 3; ++k) {
+
+				uint32_t v0 = triangle.v[k];
+				uint32_t v1 = triangle.v[(k + 1) % 3];
+
+				if (!isBorder(v0, v1)) {
+					continue;
+				}
+
+				Vec3 edge = m_positions[v1] - m_positions[v0];
+				Vec3 borderNormal = edge.cross(n);
+				double length = borderNormal.length();
+
+				if (length == 0.0) {
+					continue;
+				}
+
+				borderNormal = borderNormal * (1.0 / length);
+
+				Quadric border(borderNormal, -borderNormal.dot(m_positions[v0]), BORDER_WEIGHT * edge.dot(edge));
+				m_quadrics[v0] += border;
+				m_quadrics[v1] += border;
+			}
+		}
+	}
+
+	Collapse collapse(uint32_t v0, uint32_t v1) const {
+
+		Quadric quadric = m_quadrics[v0];
+		quadric += m_quadrics[v1];
+
+		Collapse result;
+		result.v0 = v0;
+		result.v1 = v1;
+		result.version0 = m_versions[v0];
+		result.version1 = m_versions[v1];
+
+		if (quadric.optimum(result.point)) {
+			result.cost = quadric.error(result.point);
+			return result;
+		}
+
+		// Singular system: take the best of the ends and the middle.
+		Vec3 candidates[3] = {m_positions[v0], m_positions[v1], (m_positions[v0] + m_positions[v1]) * 0.5};
+
+		result.point = candidates[0];
+		result.cost = quadric.error(candidates[0]);
+
+		for (int i = 1; i < 3; ++i) {
+			double cost = quadric.error(candidates[i]);
+			if (cost < result.cost) {
+				result.cost = cost;
+				result.point = candidates[i];
+			}
+		}
+
+		return result;
+	}
+
+	/**
+	 * Checks if moving the vertex to the point flips one of its faces that does not contain the other vertex.
+	 */
+	bool flips(uint32_t vertex, uint32_t other, const Vec3& point) const {
+
+		for (size_t f = 0; f < m_vertexFaces[vertex].size(); ++f) {
+
+			const Triangle& triangle = m_triangles[m_vertexFaces[vertex][f]];
+
+			if (triangle.removed || triangle.v[0] == other || triangle.v[1] == other || triangle.v[2] == other) {
+				continue;
+			}
+
+			Vec3 before[3], after[3];
+			for (int k = 0; k < 3; ++k) {
+				before[k] = m_positions[triangle.v[k]];
+				after[k] = (triangle.v[k] == vertex ? point : before[k]);
+			}
+
+			Vec3 n0 = normal(before[0], before[1], before[2]);
+			Vec3 n1 = normal(after[0], after[1], after[2]);
+
+			if (n1.length() == 0.0 || n0.dot(n1) < MAX_FLIP) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void apply(const Collapse& candidate) {
+
+		uint32_t v0 = candidate.v0;
+		uint32_t v1 = candidate.v1;
+
+		m_positions[v0] = candidate.point;
+		m_quadrics[v0] += m_quadrics[v1];
+		m_removed[v1] = true;
+		++m_versions[v0];
+
+		for (size_t f = 0; f < m_vertexFaces[v1].size(); ++f) {
+
+			uint32_t face = m_vertexFaces[v1][f];
+			Triangle& triangle = m_triangles[face];
+
+			if (triangle.removed) {
+				continue;
+			}
+
+			if (triangle.v[0] == v0 || triangle.v[1] == v0 || triangle.v[2] == v0) {
+				triangle.removed = true;
+				--m_activeTriangles;
+				continue;
+			}
+
+			for (int k = 0; k < 3; ++k) {
+				if (triangle.v[k] == v1) {
+					triangle.v[k] = v0;
+				}
+			}
+
+			m_vertexFaces[v0].push_back(face);
+		}
+
+		m_vertexFaces[v1].clear();
+
+		// Drop the removed faces from the kept vertex.
+		vector<uint32_t>& faces = m_vertexFaces[v0];
+		size_t kept = 0;
+		for (size_t f = 0; f < faces.size(); ++f) {
+			if (!m_triangles[faces[f]].removed) {
+				faces[kept++] = faces[f];
+			}
+		}
+		faces.resize(kept);
+	}
+
+	vector<Vec3> m_positions;
+	vector<Quadric> m_quadrics;
+	vector<uint32_t> m_versions;
+	vector<bool> m_removed;
+	vector<Triangle> m_triangles;
+	vector<vector<uint32_t> > m_vertexFaces;
+	size_t m_activeTriangles;
+};
+
+size_t lodTriangleCount(size_t sourceTriangles, double budget) {
+
+	if (budget <= 0.0) {
+		return 0;
+	}
+
+	if (budget <= 1.0) {
+		return static_cast<size_t>(ceil(sourceTriangles * budget));
+	}
+
+	return min(sourceTriangles, static_cast<size_t>(budget));
+}
+
+void decimateMesh(const MergedMesh& source, double budget, unsigned int threadCount, MergedMesh& mesh) {
+
+	size_t sourceTriangles = source.indices.size() / 3;
+	size_t targetTriangles = lodTriangleCount(sourceTriangles, budget);
+
+	vector<WeldedGroup> groups(source.groups.size());
+
+	parallelFor(source.groups.size(), threadCount, [&](size_t g) {
+
+		const MeshGroup& group = source.groups[g];
+		groups[g].materialIndex = group.materialIndex;
+
+		Simplifier simplifier(source, group);
+
+		// Share of the budget proportional to the triangles of the group.
+		size_t groupTriangles = group.count / 3;
+		size_t groupTarget = (sourceTriangles > 0 ? static_cast<size_t>(ceil(double(targetTriangles) * groupTriangles / sourceTriangles)) : 0);
+
+		simplifier.simplify(groupTarget);
+		simplifier.output(groups[g]);
+	});
+
+	appendGroups(groups, mesh);
+}
+
+}
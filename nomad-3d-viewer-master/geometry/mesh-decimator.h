@@ -0,0 +1,26 @@
+#ifndef NOMAD_MESHDECIMATOR_H
+#define NOMAD_MESHDECIMATOR_H
+
+#include <cstddef>
+#include "mesh-merger.h"
+
+namespace nomad {
+
+/**
+ * Computes the triangle count of a LOD from its budget.
+ * A budget up to 1 is a ratio of the source triangles, a greater budget is a triangle count.
+ */
+size_t lodTriangleCount(size_t sourceTriangles, double budget);
+
+/**
+ * Simplifies a merged mesh with quadric error metrics (Garland and Heckbert edge collapses).
+ * Each material group is simplified separately, in parallel, and receives a share of the budget
+ * proportional to its triangles. The positions are welded before the collapses so that the flat
+ * shaded parts are simplified as surfaces; the result has the face normals.
+ * A thread count of 0 uses the hardware concurrency.
+ */
+void decimateMesh(const MergedMesh& source, double budget, unsigned int threadCount, MergedMesh& mesh);
+
+}
+
+#endif
@@ -0,0 +1,314 @@
+#include "mesh-merger.h"
+#include "stl-io.h"
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <thread>
+#include <utility>
+
+using namespace std;
+
+namespace nomad {
+
+SourceCache::SourceCache() :
+	m_reads(0),
+	m_hits(0),
+	m_shared(0) {
+}
+
+shared_ptr<const SourceMesh> SourceCache::get(const string& path, FileSignature& signature) {
+
+	shared_ptr<Slot> slot;
+	{
+		lock_guard<mutex> lock(m_mutex);
+
+		shared_ptr<Slot>& found = m_slots[path];
+		if (!found) {
+			found.reset(new Slot());
+		}
+		slot = found;
+	}
+
+	// A merge reading the file meanwhile is waited for.
+	lock_guard<mutex> slotLock(slot->mutex);
+
+	if (slot->mesh) {
+		FileSignature current;
+		if (statFile(path, current) && current.size == slot->signature.size && current.mtimeMs == slot->signature.mtimeMs) {
+			++m_hits;
+			signature = slot->signature;
+			return slot->mesh;
+		}
+	}
+
+	shared_ptr<SourceMesh> loaded(new SourceMesh());
+	FileSignature loadedSignature;
+
+	if (!readStl(path, loaded->positions, loaded->normals, &loadedSignature)) {
+		slot->mesh.reset();
+		return shared_ptr<const SourceMesh>();
+	}
+
+	++m_reads;
+
+	shared_ptr<const SourceMesh> mesh = loaded;
+	{
+		lock_guard<mutex> lock(m_mutex);
+
+		// A file with the same content was already read and its mesh is still used: it is shared.
+		weak_ptr<const SourceMesh>& content = m_contents[loadedSignature.hash];
+		shared_ptr<const SourceMesh> same = content.lock();
+		if (same && same->positions == mesh->positions && same->normals == mesh->normals) {
+			++m_shared;
+			mesh = same;
+		}
+		else if (!same) {
+			content = mesh;
+		}
+	}
+
+	slot->mesh = mesh;
+	slot->signature = loadedSignature;
+	signature = loadedSignature;
+
+	return mesh;
+}
+
+void SourceCache::clear() {
+
+	lock_guard<mutex> lock(m_mutex);
+
+	m_slots.clear();
+	m_contents.clear();
+}
+
+SourceCacheStats SourceCache::stats() const {
+
+	SourceCacheStats stats;
+	stats.reads = m_reads;
+	stats.hits = m_hits;
+	stats.shared = m_shared;
+	stats.bytes = 0;
+
+	lock_guard<mutex> lock(m_mutex);
+
+	stats.meshes = 0;
+	for (map<uint64_t, weak_ptr<const SourceMesh> >::const_iterator c = m_contents.begin(); c != m_contents.end(); ++c) {
+		shared_ptr<const SourceMesh> mesh = c->second.lock();
+		if (mesh) {
+			++stats.meshes;
+			stats.bytes += (mesh->positions.size() + mesh->normals.size()) * sizeof(float);
+		}
+	}
+
+	return stats;
+}
+
+void parallelFor(size_t count, unsigned int threadCount, function<void (size_t)> task) {
+
+	if (threadCount == 0) {
+		threadCount = thread::hardware_concurrency();
+		if (threadCount == 0) {
+			threadCount = 1;
+		}
+	}
+
+	atomic<size_t> next(0);
+
+	auto worker = [&]() {
+		for (size_t i = next++; i < count; i = next++) {
+			task(i);
+		}
+	};
+
+	unsigned int extraThreads = (count < threadCount ? count : threadCount);
+	vector<thread> threads;
+
+	for (unsigned int i = 1; i < extraThreads; ++i) {
+		threads.push_back(thread(worker));
+	}
+
+	worker();
+
+	for (size_t i = 0; i < threads.size(); ++i) {
+		threads[i].join();
+	}
+}
+
+/**
+ * Config transform of a part, applied to its vertices while they are welded.
+ */
+class PartTransform {
+
+public:
+	PartTransform(const double * m) : m_m(m) {
+
+		// Normal matrix: inverse transpose of the upper 3x3, computed with the cofactors.
+		double a = m[0], b = m[4], c = m[8];
+		double d = m[1], e = m[5], f = m[9];
+		double g = m[2], h = m[6], k = m[10];
+
+		m_n[0] = e * k - f * h; m_n[1] = f * g - d * k; m_n[2] = d * h - e * g;
+		m_n[3] = c * h - b * k; m_n[4] = a * k - c * g; m_n[5] = b * g - a * h;
+		m_n[6] = b * f - c * e; m_n[7] = c * d - a * f; m_n[8] = a * e - b * d;
+	}
+
+	/**
+	 * Transforms the position by the matrix and the normal by the normal matrix.
+	 */
+	void apply(const float * position, const float * normal, float * transformedPosition, float * transformedNormal) const {
+
+		const double * m = m_m;
+		const double * n = m_n;
+
+		double x = position[0], y = position[1], z = position[2];
+
+		transformedPosition[0] = m[0] * x + m[4] * y + m[8] * z + m[12];
+		transformedPosition[1] = m[1] * x + m[5] * y + m[9] * z + m[13];
+		transformedPosition[2] = m[2] * x + m[6] * y + m[10] * z + m[14];
+
+		x = normal[0];
+		y = normal[1];
+		z = normal[2];
+
+		double nx = n[0] * x + n[1] * y + n[2] * z;
+		double ny = n[3] * x + n[4] * y + n[5] * z;
+		double nz = n[6] * x + n[7] * y + n[8] * z;
+		double length = sqrt(nx * nx + ny * ny + nz * nz);
+
+		if (length > 0.0) {
+			nx /= length;
+			ny /= length;
+			nz /= length;
+		}
+
+		transformedNormal[0] = nx;
+		transformedNormal[1] = ny;
+		transformedNormal[2] = nz;
+	}
+
+private:
+	const double * m_m;
+	double m_n[9];
+};
+
+/**
+ * Welds the parts of a group in the order of the parts, transforming their shared meshes.
+ */
+static void weld(const vector<MeshPart>& parts, const vector<shared_ptr<const SourceMesh> >& meshes, const vector<size_t>& partIndices, WeldedGroup& group) {
+
+	size_t vertexCount = 0;
+	for (size_t i = 0; i < partIndices.size(); ++i) {
+		vertexCount += meshes[partIndices[i]]->positions.size() / 3;
+	}
+
+	VertexWelder welder(group);
+	welder.reserve(vertexCount);
+
+	float position[3];
+	float normal[3];
+
+	for (size_t p = 0; p < partIndices.size(); ++p) {
+
+		const SourceMesh& mesh = *meshes[partIndices[p]];
+		PartTransform transform(parts[partIndices[p]].matrix);
+
+		for (size_t i = 0; i < mesh.positions.size(); i += 3) {
+			transform.apply(&mesh.positions[i], &mesh.normals[i], position, normal);
+			welder.add(position, normal);
+		}
+	}
+}
+
+void mergeParts(const vector<MeshPart>& parts, uint32_t groupCount, unsigned int threadCount, MergedMesh& mesh, SourceCache * sources) {
+
+	// Each file is read once for the merge without a shared cache.
+	SourceCache mergeSources;
+	if (sources == 0) {
+		sources = &mergeSources;
+	}
+
+	// Read the distinct files, the parts with the same path share their mesh.
+	map<string, size_t> pathIndices;
+	vector<size_t> distinct;
+	vector<size_t> partPaths(parts.size());
+
+	for (size_t i = 0; i < parts.size(); ++i) {
+		pair<map<string, size_t>::iterator, bool> inserted = pathIndices.insert(make_pair(parts[i].path, distinct.size()));
+		if (inserted.second) {
+			distinct.push_back(i);
+		}
+		partPaths[i] = inserted.first->second;
+	}
+
+	vector<shared_ptr<const SourceMesh> > distinctMeshes(distinct.size());
+	vector<FileSignature> distinctSignatures(distinct.size());
+
+	parallelFor(distinct.size(), threadCount, [&](size_t d) {
+		distinctMeshes[d] = sources->get(parts[distinct[d]].path, distinctSignatures[d]);
+	});
+
+	vector<shared_ptr<const SourceMesh> > meshes(parts.size());
+	mesh.sources.resize(parts.size());
+
+	for (size_t i = 0; i < parts.size(); ++i) {
+		meshes[i] = distinctMeshes[partPaths[i]];
+		mesh.sources[i] = distinctSignatures[partPaths[i]];
+	}
+
+	// Dispatch the parts into their groups, keeping their order.
+	vector<vector<size_t> > groupParts(groupCount);
+
+	for (size_t i = 0; i < parts.size(); ++i) {
+		if (!meshes[i]) {
+			mesh.errors.push_back(parts[i].path);
+		}
+		else if (parts[i].group < groupCount) {
+			groupParts[parts[i].group].push_back(i);
+		}
+	}
+
+	// Weld the groups.
+	vector<WeldedGroup> groups(groupCount);
+
+	parallelFor(groupCount, threadCount, [&](size_t g) {
+		groups[g].materialIndex = g;
+		weld(parts, meshes, groupParts[g], groups[g]);
+	});
+
+	appendGroups(groups, mesh);
+}
+
+void appendGroups(const vector<WeldedGroup>& groups, MergedMesh& mesh) {
+
+	// Concatenate the groups, offsetting their indices.
+	size_t vertexCount = 0, indexCount = 0;
+	for (size_t g = 0; g < groups.size(); ++g) {
+		vertexCount += groups[g].positions.size();
+		indexCount += groups[g].indices.size();
+	}
+
+	mesh.positions.reserve(vertexCount);
+	mesh.normals.reserve(vertexCount);
+	mesh.indices.reserve(indexCount);
+
+	for (uint32_t g = 0; g < groups.size(); ++g) {
+
+		uint32_t offset = mesh.positions.size() / 3;
+
+		MeshGroup meshGroup;
+		meshGroup.start = mesh.indices.size();
+		meshGroup.count = groups[g].indices.size();
+		meshGroup.materialIndex = groups[g].materialIndex;
+		mesh.groups.push_back(meshGroup);
+
+		mesh.positions.insert(mesh.positions.end(), groups[g].positions.begin(), groups[g].positions.end());
+		mesh.normals.insert(mesh.normals.end(), groups[g].normals.begin(), groups[g].normals.end());
+
+		for (size_t i = 0; i < groups[g].indices.size(); ++i) {
+			mesh.indices.push_back(groups[g].indices[i] + offset);
+		}
+	}
+}
+
+}
@@ -0,0 +1,131 @@
+#ifndef NOMAD_MESHMERGER_H
+#define NOMAD_MESHMERGER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "file-signature.h"
+#include "vertex-welder.h"
+
+namespace nomad {
+
+/**
+ * Leaf geometry of a mergeable component.
+ * The matrix is the column-major config transform, as in THREE.Matrix4.elements.
+ * The group is the index of the material group the part belongs to.
+ */
+struct MeshPart {
+	std::string path;
+	double matrix[16];
+	uint32_t group;
+};
+
+/**
+ * Range of indices drawn with the same material.
+ */
+struct MeshGroup {
+	uint32_t start;
+	uint32_t count;
+	uint32_t materialIndex;
+};
+
+/**
+ * Indexed mesh resulting from the merge. The groups are in the order of the material groups.
+ * The sources are the signatures of the part files in the order of the parts.
+ * The errors contain the paths of the parts that could not be read.
+ */
+struct MergedMesh {
+	std::vector<float> positions;
+	std::vector<float> normals;
+	std::vector<uint32_t> indices;
+	std::vector<MeshGroup> groups;
+	std::vector<FileSignature> sources;
+	std::vector<std::string> errors;
+};
+
+/**
+ * Triangle soup of a STL file in its own frame, shared by the parts that reference the file or an identical one.
+ */
+struct SourceMesh {
+	std::vector<float> positions;
+	std::vector<float> normals;
+};
+
+/**
+ * Source cache statistics. The bytes are the ones of the distinct meshes held.
+ */
+struct SourceCacheStats {
+	uint64_t reads;
+	uint64_t hits;
+	uint64_t shared;
+	uint64_t meshes;
+	uint64_t bytes;
+};
+
+/**
+ * STL files read by the merges. Each file is read once while it does not change, even by concurrent merges,
+ * and the files with the same content hash share one mesh, so that the memory scales with the distinct parts.
+ * The meshes are only owned by the files and the merges in progress: the content index does not keep a mesh alive,
+ * so that the mesh of a changed file or of released files is freed.
+ */
+class SourceCache {
+
+public:
+	SourceCache();
+
+	/**
+	 * Gets the mesh of the file and its signature. Returns null if the file cannot be read.
+	 */
+	std::shared_ptr<const SourceMesh> get(const std::string& path, FileSignature& signature);
+
+	/**
+	 * Releases the meshes. The merges in progress keep the ones they use.
+	 */
+	void clear();
+
+	SourceCacheStats stats() const;
+
+private:
+	struct Slot {
+		std::mutex mutex;
+		std::shared_ptr<const SourceMesh> mesh;
+		FileSignature signature;
+	};
+
+	mutable std::mutex m_mutex;
+	std::map<std::string, std::shared_ptr<Slot> > m_slots;
+	std::map<uint64_t, std::weak_ptr<const SourceMesh> > m_contents;
+
+	std::atomic<uint64_t> m_reads;
+	std::atomic<uint64_t> m_hits;
+	std::atomic<uint64_t> m_shared;
+};
+
+/**
+ * Appends the welded groups to the mesh, offsetting their indices.
+ */
+void appendGroups(const std::vector<WeldedGroup>& groups, MergedMesh& mesh);
+
+/**
+ * Runs the task for every index across the threads. Each thread takes the next index until none is left.
+ * A thread count of 0 uses the hardware concurrency.
+ */
+void parallelFor(size_t count, unsigned int threadCount, std::function<void (size_t)> task);
+
+/**
+ * Loads, transforms and merges the parts across a pool of threads.
+ * The distinct files are read in parallel, then each material group is welded in parallel: the parts are
+ * transformed while they are welded and the vertices with the same quantized position and normal are shared.
+ * The files are read through the source cache if it is given, otherwise each one is read once for the merge.
+ * A thread count of 0 uses the hardware concurrency.
+ */
+void mergeParts(const std::vector<MeshPart>& parts, uint32_t groupCount, unsigned int threadCount, MergedMesh& mesh, SourceCache * sources = 0);
+
+}
+
+#endif
@@ -0,0 +1,139 @@
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include "geometry-cache.h"
+#include "mesh-decimator.h"
+
+using namespace std;
+using namespace nomad;
+
+/**
+ * Copies a mapped entry so that the cache can be rewritten.
+ */
+static void copyEntry(const CacheEntryView& view, CacheEntry& entry) {
+
+	entry.name = view.name;
+	entry.lod = view.lod;
+	entry.positions.assign(view.positions, view.positions + view.vertexCount * 3);
+	entry.normals.assign(view.normals, view.normals + view.vertexCount * 3);
+	entry.indices.assign(view.indices, view.indices + view.indexCount);
+	entry.groups.assign(view.groups, view.groups + view.groupCount);
+	entry.materials.assign(view.materials, view.materialsLength);
+	entry.sources.assign(view.sources, view.sourcesLength);
+}
+
+/**
+ * Sources of a generated LOD: the sources of the finest LOD with the budget, as checked by the viewer.
+ */
+static string generatedSources(const string& sources, double budget) {
+
+	char text[64];
+	snprintf(text, sizeof(text), "{\"budget\":%.17g", budget);
+
+	if (sources.size() < 2 || sources[0] != '{') {
+		return string(text) + "}";
+	}
+
+	return string(text) + "," + sources.substr(1);
+}
+
+/**
+ * Generates the LODs of all the components of a geometry cache from their finest LOD.
+ * The budgets are the ones of the lodBudgets config attribute: up to 1 a ratio of the triangles, above a triangle count.
+ */
+int main(int argc, char * argv[]) {
+
+	if (argc < 3) {
+		cout << "usage: n3dlod <geometry cache> <budget> [<budget> ...]" << endl;
+		cout << "generates the LODs 1 to N of every component from its LOD 0 in the geometry cache" << endl;
+		return EXIT_FAILURE;
+	}
+
+	string path = argv[1];
+	vector<double> budgets;
+
+	for (int i = 2; i < argc; ++i) {
+		budgets.push_back(atof(argv[i]));
+	}
+
+	string error;
+	shared_ptr<GeometryCache> cache = GeometryCache::open(path, error);
+
+	if (cache.get() == 0) {
+		cout << "cannot open " << path << ": " << error << endl;
+		return EXIT_FAILURE;
+	}
+
+	// Keep the finest LOD of each component, the other LODs are replaced.
+	vector<CacheEntry> sources;
+	const vector<CacheEntryView>& views = cache->entries();
+
+	for (size_t i = 0; i < views.size(); ++i) {
+		if (views[i].lod == 0) {
+			sources.push_back(CacheEntry());
+			copyEntry(views[i], sources.back());
+		}
+	}
+
+	cache.reset();
+
+	vector<vector<CacheEntry> > generated(sources.size(), vector<CacheEntry>(budgets.size()));
+
+	// The components are simplified in parallel, their groups sequentially.
+	parallelFor(sources.size(), 0, [&](size_t c) {
+
+		const CacheEntry& source = sources[c];
+
+		MergedMesh mesh;
+		mesh.positions = source.positions;
+		mesh.normals = source.normals;
+		mesh.indices = source.indices;
+		mesh.groups = source.groups;
+
+		for (size_t b = 0; b < budgets.size(); ++b) {
+
+			MergedMesh lod;
+			decimateMesh(mesh, budgets[b], 1, lod);
+
+			CacheEntry& entry = generated[c][b];
+			entry.name = source.name;
+			entry.lod = b + 1;
+			entry.positions.swap(lod.positions);
+			entry.normals.swap(lod.normals);
+			entry.indices.swap(lod.indices);
+			entry.groups.swap(lod.groups);
+			entry.materials = source.materials;
+			entry.sources = generatedSources(source.sources, budgets[b]);
+		}
+	});
+
+	vector<CacheEntry> entries;
+	size_t triangles = 0;
+	vector<size_t> lodTriangles(budgets.size(), 0);
+
+	for (size_t c = 0; c < sources.size(); ++c) {
+
+		triangles += sources[c].indices.size() / 3;
+		entries.push_back(sources[c]);
+
+		for (size_t b = 0; b < budgets.size(); ++b) {
+			lodTriangles[b] += generated[c][b].indices.size() / 3;
+			entries.push_back(generated[c][b]);
+		}
+	}
+
+	if (!GeometryCache::write(path, entries)) {
+		cout << "cannot write " << path << endl;
+		return EXIT_FAILURE;
+	}
+
+	cout << sources.size() << " components, LOD 0 with " << triangles << " triangles" << endl;
+	for (size_t b = 0; b < budgets.size(); ++b) {
+		cout << "LOD " << (b + 1) << " with " << lodTriangles[b] << " triangles" << endl;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,181 @@
+#include "stl-io.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+using namespace std;
+
+namespace nomad {
+
+static const size_t HEADER_SIZE = 80;
+static const size_t FACET_SIZE = 50;
+
+/**
+ * Computes the facet normal from the vertices when the file does not provide it.
+ */
+static void facetNormal(const float * v, float * n) {
+
+	float ax = v[3] - v[0], ay = v[4] - v[1], az = v[5] - v[2];
+	float bx = v[6] - v[0], by = v[7] - v[1], bz = v[8] - v[2];
+
+	n[0] = ay * bz - az * by;
+	n[1] = az * bx - ax * bz;
+	n[2] = ax * by - ay * bx;
+
+	float length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+	if (length > 0.0f) {
+		n[0] /= length;
+		n[1] /= length;
+		n[2] /= length;
+	}
+}
+
+static void appendFacet(const float * normal, const float * vertices, vector<float>& positions, vector<float>& normals) {
+
+	float n[3] = {normal[0], normal[1], normal[2]};
+
+	if (n[0] == 0.0f && n[1] == 0.0f && n[2] == 0.0f) {
+		facetNormal(vertices, n);
+	}
+
+	positions.insert(positions.end(), vertices, vertices + 9);
+
+	for (int i = 0; i < 3; ++i) {
+		normals.insert(normals.end(), n, n + 3);
+	}
+}
+
+static bool readBinary(const string& data, vector<float>& positions, vector<float>& normals) {
+
+	uint32_t count;
+	memcpy(&count, data.data() + HEADER_SIZE, sizeof(count));
+
+	positions.reserve(positions.size() + count * 9);
+	normals.reserve(normals.size() + count * 9);
+
+	const char * facet = data.data() + HEADER_SIZE + sizeof(count);
+
+	for (uint32_t i = 0; i < count; ++i, facet += FACET_SIZE) {
+		// Normal, 3 vertices and a 2-byte attribute count.
+		float values[12];
+		memcpy(values, facet, sizeof(values));
+		appendFacet(values, values + 3, positions, normals);
+	}
+
+	return true;
+}
+
+static bool readAscii(const string& data, vector<float>& positions, vector<float>& normals) {
+
+	const char * current = data.c_str();
+	float normal[3] = {0.0f, 0.0f, 0.0f};
+	float vertices[9];
+	int vertex = 0;
+
+	while ((current = strpbrk(current, "fv")) != 0) {
+
+		if (strncmp(current, "facet normal", 12) == 0) {
+			char * end = const_cast<char *>(current) + 12;
+			for (int i = 0; i < 3; ++i) {
+				normal[i] = strtof(end, &end);
+			}
+			vertex = 0;
+			current = end;
+		}
+		else if (strncmp(current, "vertex", 6) == 0) {
+			char * end = const_cast<char *>(current) + 6;
+			if (vertex < 3) {
+				for (int i = 0; i < 3; ++i) {
+					vertices[vertex * 3 + i] = strtof(end, &end);
+				}
+				if (++vertex == 3) {
+					appendFacet(normal, vertices, positions, normals);
+				}
+			}
+			current = end;
+		}
+		else {
+			++current;
+		}
+	}
+
+	return true;
+}
+
+bool readStl(const string& path, vector<float>& positions, vector<float>& normals, FileSignature * signature) {
+
+	// Stat before reading so that a modification during the read is seen at the next check.
+	if (signature != 0 && !statFile(path, *signature)) {
+		return false;
+	}
+
+	ifstream file(path.c_str(), ios::binary);
+
+	if (!file) {
+		return false;
+	}
+
+	string data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+
+	if (signature != 0) {
+		signature->hash = hashBytes(data.data(), data.size());
+	}
+
+	if (data.size() < HEADER_SIZE + sizeof(uint32_t)) {
+		return false;
+	}
+
+	// A binary file has exactly the size announced by its facet count, even if its header starts with "solid".
+	uint32_t count;
+	memcpy(&count, data.data() + HEADER_SIZE, sizeof(count));
+
+	if (data.size() == HEADER_SIZE + sizeof(count) + count * FACET_SIZE) {
+		return readBinary(data, positions, normals);
+	}
+
+	if (data.compare(0, 5, "solid") == 0) {
+		return readAscii(data, positions, normals);
+	}
+
+	return false;
+}
+
+bool writeStl(const string& path, const vector<float>& positions, const vector<float>& normals, const vector<uint32_t>& indices) {
+
+	ofstream file(path.c_str(), ios::binary);
+
+	if (!file) {
+		return false;
+	}
+
+	char header[HEADER_SIZE];
+	memset(header, 0, sizeof(header));
+	file.write(header, sizeof(header));
+
+	uint32_t count = indices.size() / 3;
+	file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+
+	char facet[FACET_SIZE];
+	memset(facet, 0, sizeof(facet));
+
+	for (uint32_t i = 0; i < count; ++i) {
+
+		const uint32_t * triangle = &indices[i * 3];
+
+		// The vertices of a facet share the facet normal, the normal of the first vertex is written.
+		memcpy(facet, &normals[triangle[0] * 3], 3 * sizeof(float));
+
+		for (int v = 0; v < 3; ++v) {
+			memcpy(facet + (v + 1) * 3 * sizeof(float), &positions[triangle[v] * 3], 3 * sizeof(float));
+		}
+
+		file.write(facet, sizeof(facet));
+	}
+
+	return file.good();
+}
+
+}
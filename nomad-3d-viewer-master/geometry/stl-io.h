@@ -0,0 +1,28 @@
+#ifndef NOMAD_STLIO_H
+#define NOMAD_STLIO_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "file-signature.h"
+
+namespace nomad {
+
+/**
+ * Reads a binary or ASCII STL file as a triangle soup.
+ * Three positions and three normals are appended per vertex, the normal of a vertex is the facet normal.
+ * If the signature is given, it receives the size, modification time and content hash of the file.
+ * Returns false if the file cannot be read or is not a STL file.
+ */
+bool readStl(const std::string& path, std::vector<float>& positions, std::vector<float>& normals, FileSignature * signature = 0);
+
+/**
+ * Writes the indexed triangles as a binary STL file. The triangles are written in the order of the indices
+ * so that the index ranges of the groups are also vertex ranges of the file.
+ * Returns false if the file cannot be written.
+ */
+bool writeStl(const std::string& path, const std::vector<float>& positions, const std::vector<float>& normals, const std::vector<uint32_t>& indices);
+
+}
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef NOMAD_VERTEXWELDER_H
+#define NOMAD_VERTEXWELDER_H
+
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace nomad {
+
+/**
+ * Welded vertices and local indices of a material group.
+ */
+struct WeldedGroup {
+	std::vector<float> positions;
+	std::vector<float> normals;
+	std::vector<uint32_t> indices;
+	uint32_t materialIndex;
+
+	WeldedGroup() : materialIndex(0) {}
+};
+
+/**
+ * Welds the vertices added to a group: the vertices with the same quantized position and normal are shared.
+ */
+class VertexWelder {
+
+public:
+	VertexWelder(WeldedGroup& group) : m_group(group) {}
+
+	void reserve(size_t vertexCount) {
+		m_vertices.reserve(vertexCount / 2);
+		m_group.indices.reserve(m_group.indices.size() + vertexCount);
+	}
+
+	/**
+	 * Adds a vertex and appends its index.
+	 */
+	void add(const float * position, const float * normal) {
+
+		Key key;
+		for (int j = 0; j < 3; ++j) {
+			key.values[j] = llround(position[j] * POSITION_PRECISION);
+			key.values[j + 3] = llround(normal[j] * NORMAL_PRECISION);
+		}
+
+		uint32_t index = m_group.positions.size() / 3;
+		std::pair<Map::iterator, bool> inserted = m_vertices.insert(std::make_pair(key, index));
+
+		if (inserted.second) {
+			m_group.positions.insert(m_group.positions.end(), position, position + 3);
+			m_group.normals.insert(m_group.normals.end(), normal, normal + 3);
+		}
+
+		m_group.indices.push_back(inserted.first->second);
+	}
+
+private:
+	// Same precision as THREE.Geometry.mergeVertices for the positions.
+	static constexpr double POSITION_PRECISION = 1.0e4;
+	static constexpr double NORMAL_PRECISION = 1.0e3;
+
+	/**
+	 * Quantized position and normal of a vertex.
+	 */
+	struct Key {
+		int64_t values[6];
+
+		bool operator==(const Key& other) const {
+			for (int i = 0; i < 6; ++i) {
+				if (values[i] != other.values[i]) {
+					return false;
+				}
+			}
+			return true;
+		}
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key& key) const {
+			// FNV-1a over the quantized values.
+			uint64_t hash = 14695981039346656037ULL;
+			for (int i = 0; i < 6; ++i) {
+				hash ^= static_cast<uint64_t>(key.values[i]);
+				hash *= 1099511628211ULL;
+			}
+			return static_cast<size_t>(hash);
+		}
+	};
+
+	typedef std::unordered_map<Key, uint32_t, KeyHash> Map;
+
+	WeldedGroup& m_group;
+	Map m_vertices;
+};
+
+}
+
+#endif
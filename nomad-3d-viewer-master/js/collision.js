@@ -27,6 +27,7 @@ class Collision {
 		this._sceneNodeMap = null;
 		this._collisionFocus = false;
 		this._pauseOnCollision = false;
+		this._anticipated = false;
 		this._counterController = null;
 		this._collisionDetection = null;
 
@@ -216,6 +217,28 @@ class Collision {
 		}
 	}
 
+	/**
+	 * Pauses Nomad when a collision is predicted in the future poses, before the contact.
+	 * @param {Number} timeMs The delay of the earliest colliding pose, 0 if no pose collides
+	 * @param {Array} collisions The collisions of the pose
+	 * @param {Nomad3DPositions} nomad3DPositions
+	 */
+	anticipateCollisions(timeMs, collisions, nomad3DPositions) {
+
+		let anticipated = (timeMs > 0);
+
+		// Only a new prediction pauses Nomad, the collision stack keeps the actual collisions.
+		if (anticipated && !this._anticipated) {
+			console.warn("collision predicted in " + timeMs + " ms between " + collisions.map((c) => c.mergedBlockA + " and " + c.mergedBlockB).join(", "));
+
+			if (this._pauseOnCollision) {
+				nomad3DPositions.pause();
+			}
+		}
+
+		this._anticipated = anticipated;
+	}
+
 	resetCollisionStack() {
 		this._collisionStack = {};
 	}
@@ -82,11 +82,137 @@ if (!("frameTimeOut" in config)) {
     config.frameTimeOut = 0;
 }
 
+// Set default value to minDeltaTime if it is not defined in the config file. The positions are polled every minDeltaTime ms.
+if (!("minDeltaTime" in config)) {
+    config.minDeltaTime = 40;
+}
+
+// Set default value to interactionPeriod if it is not defined in the config file. The frames are rendered during this period in ms after a user input.
+if (!("interactionPeriod" in config)) {
+    config.interactionPeriod = 500;
+}
+
+// Set default value to maxFrameInterval if it is not defined in the config file. A frame is rendered at least every maxFrameInterval ms.
+if (!("maxFrameInterval" in config)) {
+    config.maxFrameInterval = 1000;
+}
+
+// Set default value to asyncRequests if it is not defined in the config file.
+if (!("asyncRequests" in config)) {
+    config.asyncRequests = true;
+}
+
+// Set default value to positionsPeriod if it is not defined in the config file. 0 disables the position stream.
+if (!("positionsPeriod" in config)) {
+    config.positionsPeriod = 0;
+}
+
+// Set default value to binaryPositions if it is not defined in the config file. The streamed positions are then read as a Float64Array.
+if (!("binaryPositions" in config)) {
+    config.binaryPositions = true;
+}
+
+// Set default value to positionsPoolSize if it is not defined in the config file. Number of n3dpositions instances kept started for the recently used Nomad servers.
+if (!("positionsPoolSize" in config)) {
+    config.positionsPoolSize = 4;
+}
+
+// Set default value to serverWatchPeriod if it is not defined in the config file. The simulated servers are listed every serverWatchPeriod ms.
+if (!("serverWatchPeriod" in config)) {
+    config.serverWatchPeriod = 2000;
+}
+
+// Set default value to recordPath if it is not defined in the config file. The received positions are recorded into this binary log.
+if (!("recordPath" in config)) {
+    config.recordPath = null;
+}
+
+// Set default values to replayPath, replaySpeed and replayLoop if they are not defined in the config file.
+// The positions are then read from the binary log instead of Nomad.
+if (!("replayPath" in config)) {
+    config.replayPath = null;
+}
+if (!("replaySpeed" in config)) {
+    config.replaySpeed = 1;
+}
+if (!("replayLoop" in config)) {
+    config.replayLoop = true;
+}
+
+// Set default value to sharedMemory if it is not defined in the config file. The positions and the collision verdicts are then read
+// from shared memory when n3dpositions and n3dcollisions run on the same host and publish them.
+if (!("sharedMemory" in config)) {
+    config.sharedMemory = false;
+}
+
+// Set default values to lookaheadSteps and lookaheadStepMs if they are not defined in the config file. The collisions of the
+// lookaheadSteps future poses spaced by lookaheadStepMs ms are checked so that Nomad is paused before a collision. 0 disables the lookahead.
+if (!("lookaheadSteps" in config)) {
+    config.lookaheadSteps = 0;
+}
+if (!("lookaheadStepMs" in config)) {
+    config.lookaheadStepMs = 100;
+}
+
+// Set default values to ghostColor and ghostOpacity if they are not defined in the config file.
+// The model moved by the positions of another Nomad server is shown with this color and opacity.
+if (!("ghostColor" in config)) {
+    config.ghostColor = 0x40a0ff;
+}
+if (!("ghostOpacity" in config)) {
+    config.ghostOpacity = 0.35;
+}
+
+// Set default values to statsDumpPath and statsDumpPeriod if they are not defined in the config file.
+// The stats of the addons are then appended to this file as JSON lines every statsDumpPeriod ms.
+if (!("statsDumpPath" in config)) {
+    config.statsDumpPath = null;
+}
+if (!("statsDumpPeriod" in config)) {
+    config.statsDumpPeriod = 5000;
+}
+
+// Set default value to collisionPipelineDepth if it is not defined in the config file. 0 disables the collision pipeline.
+if (!("collisionPipelineDepth" in config)) {
+    config.collisionPipelineDepth = 0;
+}
+
+// Set default value to nativeGeometry if it is not defined in the config file. The STL files are then loaded and merged by the geometry addon.
+if (!("nativeGeometry" in config)) {
+    config.nativeGeometry = true;
+}
+
+// Set default value to geometryThreads if it is not defined in the config file. 0 uses all the cores.
+if (!("geometryThreads" in config)) {
+    config.geometryThreads = 0;
+}
+
+// Set default value to lodBudgets if it is not defined in the config file. An array of budgets generates the LODs 1 to N from the finest geometries:
+// a budget up to 1 is a ratio of the triangles, a greater budget is a number of triangles. The geometry directories define the LODs if null.
+if (!("lodBudgets" in config)) {
+    config.lodBudgets = null;
+}
+
 // Set default value to collisionMargin if it is not defined in the config file.
 if (!("collisionMargin" in config)) {
     config.collisionMargin = 0.04;
 }
 
+// Set default value to broadPhase if it is not defined in the config file.
+if (!("broadPhase" in config)) {
+    config.broadPhase = true;
+}
+
+// Set default value to fusedCollisions if it is not defined in the config file. The streamed positions are then forwarded to the collision server by the positions addon.
+// The forwarder sends every snapshot without the broad phase that skips the requests, so both cannot be set together.
+if (!("fusedCollisions" in config)) {
+    config.fusedCollisions = !config.broadPhase;
+}
+else if (config.fusedCollisions && config.broadPhase) {
+    console.warn('fusedCollisions is ignored with broadPhase: the forwarder would send every snapshot to the collision server.');
+    config.fusedCollisions = false;
+}
+
 console.log('Link : ' + link);
 console.log('Stats : ' + stats);
 console.log('Collision margin : ' + config.collisionMargin);
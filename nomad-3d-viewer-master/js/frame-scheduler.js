@@ -0,0 +1,151 @@
+/**
+ *
+ * @class FrameScheduler
+ */
+
+/**
+ * Event-driven frame loop. The update callback runs at every tick and tells whether the scene changed,
+ * the render callback only runs when the scene changed, a frame was requested or the user is interacting.
+ * When nothing changes, the ticks are spaced by the idle period instead of following the display refresh.
+ */
+class FrameScheduler {
+
+	/**
+	 * @param {Function} update Called at every tick, returns true if the scene changed
+	 * @param {Function} render Renders the frame
+	 * @param {Object} options {frameTimeOut, idlePeriod, interactionPeriod, maxFrameInterval} in ms
+	 */
+	constructor(update, render, options) {
+		this._update = update;
+		this._render = render;
+		this._frameTimeOut = options.frameTimeOut;
+		this._idlePeriod = options.idlePeriod;
+		this._interactionPeriod = options.interactionPeriod;
+		this._maxFrameInterval = options.maxFrameInterval;
+		this._playing = true;
+		this._running = false;
+		this._requested = true;
+		this._activeUntil = 0;
+		this._lastRenderTime = 0;
+		this._rendered = 0;
+		this._skipped = 0;
+		this._tick = this.tick.bind(this);
+	}
+
+	get playing() {
+		return this._playing;
+	}
+
+	set playing(value) {
+		this._playing = value;
+		this.requestFrame();
+	}
+
+	get frameTimeOut() {
+		return this._frameTimeOut;
+	}
+
+	set frameTimeOut(value) {
+		this._frameTimeOut = value;
+	}
+
+	get rendered() {
+		return this._rendered;
+	}
+
+	set rendered(value) {
+		console.warn("FrameScheduler.rendered is a read-only property.");
+	}
+
+	get skipped() {
+		return this._skipped;
+	}
+
+	set skipped(value) {
+		console.warn("FrameScheduler.skipped is a read-only property.");
+	}
+
+	/**
+	 * Requests the rendering of the next frame.
+	 */
+	requestFrame() {
+		this._requested = true;
+	}
+
+	/**
+	 * Keeps rendering during the interaction period, e.g. for user inputs or damped controls.
+	 */
+	interact() {
+		this._requested = true;
+		this._activeUntil = performance.now() + this._interactionPeriod;
+	}
+
+	/**
+	 * Renders the frames while the user interacts with the element.
+	 * @param {EventTarget} element
+	 */
+	listen(element) {
+		let interact = this.interact.bind(this);
+		let events = ['pointerdown', 'pointermove', 'wheel', 'keydown', 'input', 'change', 'click'];
+
+		for (let i = 0; i < events.length; i++) {
+			element.addEventListener(events[i], interact, false);
+		}
+	}
+
+	resetStats() {
+		this._rendered = 0;
+		this._skipped = 0;
+	}
+
+	start() {
+		if (!this._running) {
+			this._running = true;
+			requestAnimationFrame(this._tick);
+		}
+	}
+
+	schedule(active) {
+
+		if (!this._playing) {
+			setTimeout(() => {
+				requestAnimationFrame(this._tick);
+			}, 2000);
+		}
+		else if (!active) {
+			// Nothing to draw: poll at the idle period.
+			setTimeout(this._tick, this._idlePeriod);
+		}
+		else if (this._frameTimeOut == 0) {
+			requestAnimationFrame(this._tick);
+		}
+		else {
+			setTimeout(() => {
+				requestAnimationFrame(this._tick);
+			}, this._frameTimeOut);
+		}
+	}
+
+	tick() {
+
+		let now = performance.now();
+
+		// The update runs first as it may move the scene or request a frame.
+		let changed = this._update();
+		let interacting = (now < this._activeUntil);
+
+		if (changed || this._requested || interacting || now - this._lastRenderTime > this._maxFrameInterval) {
+			this._requested = false;
+			this._lastRenderTime = now;
+			this._rendered++;
+			this._render();
+		}
+		else {
+			this._skipped++;
+		}
+
+		this.schedule(changed || interacting || this._requested);
+	}
+}
+
+module.exports = FrameScheduler;
@@ -1,185 +1,144 @@
 /**
   * @class LogAnimator
  */
-const fs = require('fs');
-const THREE = require('three');
+const config = require('../../config');
 
-const Seconds = 1;
-const MilliSeconds = 1e-3;
-const MicroSeconds = 1e-6;
+let NomadPositions = null;
+
+try {
+	NomadPositions = require('../../../build/Release/addonnomad3dposition');
+
+} catch (e) {
+	console.error(e);
+}
 
 /**
- * The LogAnimator has to be instantiated with a log file (Check previous versions for an example of log).
- * TODO: this code is no longer working. Update with the new way of getting axis values: call Nomad3D controller and do not manage offsets.
+ * The LogAnimator replays a binary positions log recorded by the positions addon (see recordPath in the config).
+ * The log is mapped in memory by the addon that serves the replayed positions through the same functions as the
+ * Nomad positions, so that the model and the collisions are updated as with a live instrument.
  */
 class LogAnimator {
 
-	constructor(logPath, model) {
+	constructor(logPath, speed, loop) {
 		this._logPath = logPath;
-		this._logs = fs.readFileSync(logPath, "utf8").split("\n");
-		this._model = model;
-		this._timeUnit = MicroSeconds;
-		this._repeat = true;
-
-		// private
-		this._clock = new THREE.Clock();
+		this._speed = (speed === undefined) ? 1 : speed;
+		this._loop = (loop === undefined) ? true : loop;
 		this._started = false;
-		this._start = this.readLog(0).date;
-		this._currentLogIdx = 0;
+		this._status = null;
 
-		// Change the state of the components. CHECK
-		model.root.traverse(component => {
-			component.animation = Component.Animated;
-		});
+		this._controller = {
+			"Speed": this._speed,
+			"Time": 0,
+			"Play / Pause": () => {
+				this.started = !this.started;
+			}
+		};
+
+		this.start();
 	}
 
 	get logPath() {
 		return this._logPath;
 	}
-	
+
 	set logPath(path) {
 		this._logPath = path;
-		this._logs = fs.readFileSync(path, "utf8").split("\n");
-		this._start = this.readLog(0).date;
-		this._currentLogIdx = 0;
-	}
-	
-	get logs() {
-		return this._logs;
-	}
-	
-	set logs(value) {
-		console.warn("LogAnimator.logs is a read-only property.");
+		this.start();
 	}
-	
-	get model() {
-		return this._model;
-	}
-	
-	set model(value) {
-		this._model = value;
-	}
-	
-	get timeUnit() {
-		return this._timeUnit;
+
+	get speed() {
+		return this._speed;
 	}
-	
-	set timeUnit(value) {
-		this._timeUnit = value;
+
+	set speed(value) {
+		this._speed = value;
+		if (this._started) {
+			NomadPositions.setReplaySpeed(value);
+		}
 	}
-	
-	get repeat() {
-		return this._repeat;
+
+	get loop() {
+		return this._loop;
 	}
-	
-	set repeat(value) {
-		this._repeat = value;
+
+	set loop(value) {
+		console.warn("LogAnimator.loop is a read-only property.");
 	}
-	
+
 	get started() {
 		return this._started;
 	}
-	
+
 	set started(value) {
 		this._started = value;
-		this._clock.stop();
-		this._clock.start();
+		NomadPositions.setReplaySpeed(value ? this._speed : 0);
 	}
 
-	readLog(i) {
-		let props = this.logs[i].split(", ");
-		return {
-			date: this._timeUnit * parseInt(props[0]),
-			name: props[1],
-			value: parseFloat(props[2])
-		};
+	/**
+	 * Gets the replay time in s from the start of the log.
+	 */
+	get time() {
+		return (this._status !== null) ? this._status.time / 1000 : 0;
 	}
 
+	set time(value) {
+		NomadPositions.seekReplay(value * 1000);
+	}
 
-	updateComponent(component, t, log) {
-                        
-		if (component !== null && component.axis !== null 
-				&& component.axis.isControllable()
-				&& component.animation === Component.Animated
-				&& component.controller.name === log.name) {
-			try {
-				let oldValue = component.axis.value;
-				let actualPosition = log.value;
-				let offsetPosition = component.controller.getOffsetPosition();
-				component.axis.value = actualPosition - offsetPosition;
-				let deltaValue = component.axis.value - oldValue;
-
-				console.log(component.controller.name + " : " + deltaValue);
-				component.controller.move(deltaValue);
-			} catch (e) {
-				console.error(e);
-			}
+	/**
+	 * Gets the duration of the log in s.
+	 */
+	get duration() {
+		return (this._status !== null) ? this._status.duration / 1000 : 0;
+	}
+
+	set duration(value) {
+		console.warn("LogAnimator.duration is a read-only property.");
+	}
+
+	start() {
+		if (NomadPositions === null || !NomadPositions.startReplay(this._logPath, this._speed, this._loop)) {
+			console.error("Cannot replay the positions log " + this._logPath);
+			return;
 		}
 
-		// Children
-		for (let i = 0 ; i < component.children.length ; i++) {
-			updateComponent(component.children[i], t, log);
+		this._started = true;
+		this._status = NomadPositions.getReplayStatus();
+
+		console.info("Replaying " + this._status.count + " position snapshots during " + this.duration.toFixed(1) + " s from " + this._logPath);
+	}
+
+	stop() {
+		if (NomadPositions !== null) {
+			NomadPositions.stopReplay();
 		}
+		this._started = false;
+		this._status = null;
 	}
 
-	update() {
-		if (this.model.needsUpdate) {
-			// No animation while loading
-			this._currentLogIdx = -1;
-			this._clock.stop();
+	initGui(gui) {
+		if (this._status === null) {
 			return;
 		}
-		if (this._currentLogIdx < 0) {
-			this._currentLogIdx = 0;
-			//this._clock.start();
-		}
-		if (this._currentLogIdx >= this._logs.length) {
-			if (this.repeat) {
-				this._currentLogIdx = 0;
-				this._clock.start();
-			} else {
-				return;
-			}
+
+		let folder = gui.addFolder("Replay");
+
+		folder.add(this._controller, "Speed", 0, 20, 0.1).onChange((value) => {
+			this.speed = value;
+		});
+		folder.add(this._controller, "Time", 0, this.duration, 0.01).onChange((value) => {
+			this.time = value;
+		}).listen();
+		folder.add(this._controller, "Play / Pause");
+	}
+
+	update() {
+		// The model reads the replayed positions itself, only the status is followed.
+		if (this._status !== null) {
+			this._status = NomadPositions.getReplayStatus();
+			this._controller.Time = this.time;
 		}
-        
-        let t = 0;
-        
-        if (this._started) {
-            t = this._clock.getElapsedTime() + this._start;
-
-            let updateLogs = [];
-            for ( ; this._currentLogIdx < this.logs.length ; this._currentLogIdx++) {
-                    let nextLog = this.readLog(this._currentLogIdx);
-                    if (nextLog.date > t) {
-                            break;
-                    } else {
-                            updateLogs.push(nextLog);
-                            //console.log('started update log ' + nextLog.date);
-                    }
-            }
-            
-            for (let i = 0; i < updateLogs.length; i++) {
-                this.updateComponent(model.root, t, updateLogs[i]);
-            }
-        }
-        else {
-            
-            let updateLogs = [];
-            
-            // We read the first 10 values to ensure to have correct positions before starting the simulation.
-            for ( ; this._currentLogIdx < 10 ; this._currentLogIdx++) {
-                    let nextLog = this.readLog(this._currentLogIdx);
-                    updateLogs.push(nextLog);
-                    //console.log('started update log ' + nextLog.date);
-            }
-            
-            for (let i = 0; i < updateLogs.length; i++) {
-                updateComponent(model.root, t, updateLogs[i]);
-            }
-        }
-	}
-
-	//console.log(updateLogs.length + " logs to update", t);
+	}
 }
 
 module.exports = LogAnimator;
@@ -8,6 +8,86 @@ class Nomad3DCollisions {
         return this._collisionDetection.request(JSON.stringify({type: "COLLISIONS", positions}));
     }
 
+    updatePositionsAsync(positions) {
+        return this._collisionDetection.requestAsync(JSON.stringify({type: "COLLISIONS", positions}));
+    }
+
+    updatePositionsJsonAsync(jsonPositions) {
+        // The JSON positions are embedded as they are received, without parsing them.
+        return this._collisionDetection.requestAsync('{"type":"COLLISIONS","positions":' + jsonPositions + '}');
+    }
+
+    startPipeline(depth) {
+        return this._collisionDetection.startPipeline(depth);
+    }
+
+    get pipelineRunning() {
+        return this._collisionDetection.isPipelineRunning();
+    }
+
+    submitPositions(positions) {
+        return this._collisionDetection.submit(JSON.stringify({type: "COLLISIONS", positions}));
+    }
+
+    submitPositionsJson(jsonPositions) {
+        return this._collisionDetection.submit('{"type":"COLLISIONS","positions":' + jsonPositions + '}');
+    }
+
+    updateVerdict() {
+        // Get the newest verdict of the pipeline: {sequence, latency, response}.
+        return this._collisionDetection.getVerdict();
+    }
+
+    get pipelineStats() {
+        return this._collisionDetection.getPipelineStats();
+    }
+
+    get lookaheadRunning() {
+        return this._collisionDetection.isLookaheadRunning();
+    }
+
+    submitLookaheadJson(jsonPositions) {
+        // The future poses are interpolated from the successive positions by the addon.
+        return this._collisionDetection.submitLookahead(jsonPositions);
+    }
+
+    setLookaheadTargets(targets) {
+        // Targets of the moving axes by name, an empty object removes them.
+        return this._collisionDetection.setLookaheadTargets(JSON.stringify(targets));
+    }
+
+    updateLookaheadVerdict() {
+        // Get the newest lookahead verdict: {sequence, step, time, latency, response}, step 0 meaning no collision.
+        return this._collisionDetection.getLookaheadVerdict();
+    }
+
+    setBodies(localBoxes, groups) {
+        // Local boxes: Float64Array of 6 values per body, groups: Int32Array.
+        return this._collisionDetection.setBodies(localBoxes, groups);
+    }
+
+    updateBodies(matrices, margin) {
+        // Returns the number of candidate pairs of the broad phase.
+        return this._collisionDetection.updateBodies(matrices, margin);
+    }
+
+    get candidatePairs() {
+        return this._collisionDetection.getCandidatePairs();
+    }
+
+    get broadPhaseStats() {
+        return this._collisionDetection.getBroadPhaseStats();
+    }
+
+    get stats() {
+        // Latency histograms, counters, gauges and last events of the addon.
+        return this._collisionDetection.getStats();
+    }
+
+    get latency() {
+        return this._collisionDetection.getLatency();
+    }
+
     addObject(path, fileName) {
         //return this._collisionDetection.request(JSON.stringify({type: "ADD_OBJECT", path, fileName}));
         let response = JSON.parse(this._collisionDetection.request(JSON.stringify({type: "ADD_OBJECT", path, fileName})));
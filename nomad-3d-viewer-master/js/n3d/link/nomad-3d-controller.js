@@ -14,6 +14,7 @@ class Nomad3DController {
 		this._name = "";
 		this._component = null;
 		this._actualPosition = 0;
+		this._positionIndex = -1;
 	}
 
 	get name() {
@@ -32,6 +33,26 @@ class Nomad3DController {
 		console.warn("Nomad3DController.component is a read-only property.");
 	}
 
+	get positionIndex() {
+		return this._positionIndex;
+	}
+
+	set positionIndex(index) {
+		this._positionIndex = index;
+	}
+
+	/**
+	 * Gets the position of the controller.
+	 * @param {Object|Float64Array} positions Positions by name or packed in the order of the axis table
+	 * @return {Number} The position
+	 */
+	positionOf(positions) {
+		if (ArrayBuffer.isView(positions)) {
+			return (this._positionIndex >= 0) ? positions[this._positionIndex] : undefined;
+		}
+		return positions[this.name];
+	}
+
 	init(position) {
 
 		if (this.component === null || this.component.axis === null 
@@ -69,7 +90,10 @@ class Nomad3DController {
 			this.component.axis.value = this._actualPosition;
 			let deltaValue = this.component.axis.value - oldValue;
 
-			this.move(deltaValue);
+			// An axis that did not move keeps its transform.
+			if (deltaValue !== 0) {
+				this.move(deltaValue);
+			}
 		} catch (e) {
 			console.error(e);
 		}
@@ -78,20 +102,40 @@ class Nomad3DController {
 	}
 
 	move(deltaValue) {
-		let position = new THREE.Vector3().copy(this.component.axis.position);
 		
+		switch (this.component.axis.type) {
+			case Axis.Translation:
+			case Axis.Rotation:
+
+				// Recalculate the local scene node transform.
+				this.component.calculateSceneNodeTransform(this.motion(deltaValue, new THREE.Matrix4()));
+				break;
+
+			default:
+				break;
+		}
+
+	}
+
+	/**
+	 * Computes the movement transform of the axis for a delta value.
+	 * The movements of an axis commute, so the delta from the initial value gives the whole movement.
+	 * @param {Number} deltaValue The delta value
+	 * @param {Matrix4} target The matrix receiving the transform
+	 * @return {Matrix4} The target
+	 */
+	motion(deltaValue, target) {
+		let position = new THREE.Vector3().copy(this.component.axis.position);
+
 		switch (this.component.axis.type) {
 			case Axis.Translation:
 
 				// Define the movement transform.
-				let deltaTranslation = new THREE.Matrix4().makeTranslation(
+				target.makeTranslation(
 						deltaValue * this.component.axis.direction.x,
 						deltaValue * this.component.axis.direction.y,
 						deltaValue * this.component.axis.direction.z
 				);
-
-				// Recalculate the local scene node transform.
-				this.component.calculateSceneNodeTransform(deltaTranslation);
 				break;
 
 			case Axis.Rotation:
@@ -114,21 +158,18 @@ class Nomad3DController {
 						position.z
 					);
 
-				let deltaRotation = new THREE.Matrix4();
-
 				// The multiplication order must be respected.
-				deltaRotation.copy(pivotToLocal);
-				deltaRotation.multiply(axisRotation);
-				deltaRotation.multiply(localToPivot);
-
-				// Recalculate the local scene node transform.
-				this.component.calculateSceneNodeTransform(deltaRotation);
+				target.copy(pivotToLocal);
+				target.multiply(axisRotation);
+				target.multiply(localToPivot);
 				break;
 
 			default:
+				target.identity();
 				break;
 		}
 
+		return target;
 	}
 
 	// Not used anymore. Move special code for special controllers in the Nomad3D module.
@@ -3,7 +3,8 @@ const config = require('../../config');
 let NomadPositions = null;
 
 try {
-	if (config.link) {
+	// The addon also serves the positions of a replayed log.
+	if (config.link || config.replayPath !== null) {
 		NomadPositions = require('../../../build/Release/addonnomad3dposition');
 	}
 
@@ -25,6 +26,102 @@ class Nomad3DPositions {
         return null;
     }
 
+    updateAsync() {
+        // Get the positions from Nomad without blocking the render loop.
+        if (NomadPositions !== null) {
+            // The streamed positions are read without waiting.
+            if (NomadPositions.isStreaming()) {
+                return Promise.resolve(NomadPositions.getPositions());
+            }
+            return NomadPositions.getPositionsAsync();
+        }
+        return null;
+    }
+
+    updateBuffer() {
+        // Get the newest streamed positions as a Float64Array packed in the order of the axis names.
+        if (NomadPositions !== null && NomadPositions.isStreaming()) {
+            return NomadPositions.getPositionsBuffer();
+        }
+        return null;
+    }
+
+    updateChanges() {
+        // Get the streamed positions that changed since the last call: {sequence, full, changed, positions}.
+        if (NomadPositions !== null && NomadPositions.isStreaming()) {
+            return NomadPositions.getPositionChanges();
+        }
+        return null;
+    }
+
+    updateCollisionVerdict() {
+        // Get the newest collision verdict of the forwarded positions: {sequence, latency, response}.
+        if (NomadPositions !== null && NomadPositions.isCollisionForwarding()) {
+            return NomadPositions.getCollisionVerdict();
+        }
+        return null;
+    }
+
+    openStream(nomadId, periodMs) {
+        // Open a stream of the positions of another Nomad server, resolved with its handle or -1.
+        if (NomadPositions !== null) {
+            return NomadPositions.openStream(nomadId, periodMs);
+        }
+        return Promise.resolve(-1);
+    }
+
+    closeStream(handle) {
+        if (NomadPositions !== null) {
+            NomadPositions.closeStream(handle);
+        }
+    }
+
+    streamSnapshot(handle) {
+        // Get the newest positions of the stream if they changed: {sequence, tableVersion, positions}.
+        if (NomadPositions !== null) {
+            return NomadPositions.getStreamPositions(handle);
+        }
+        return null;
+    }
+
+    streamAxisNames(handle) {
+        return (NomadPositions !== null) ? NomadPositions.getStreamAxisNames(handle) : [];
+    }
+
+    get collisionForwarding() {
+        return (NomadPositions !== null) && NomadPositions.isCollisionForwarding();
+    }
+
+    get streaming() {
+        return (NomadPositions !== null) && NomadPositions.isStreaming();
+    }
+
+    get axisNames() {
+        return (NomadPositions !== null) ? NomadPositions.getAxisNames() : [];
+    }
+
+    get axisTableVersion() {
+        return (NomadPositions !== null) ? NomadPositions.getAxisTableVersion() : 0;
+    }
+
+    get currentPositions() {
+        // JSON positions of the last buffer.
+        return (NomadPositions !== null) ? NomadPositions.getCurrentPositions() : "";
+    }
+
+    get latency() {
+        // Round trip time in ms of the last async request.
+        if (NomadPositions !== null) {
+            return NomadPositions.getLatency();
+        }
+        return 0;
+    }
+
+    get stats() {
+        // Latency histograms, counters, gauges and last events of the addon.
+        return (NomadPositions !== null) ? NomadPositions.getStats() : null;
+    }
+
     pause() {
         // Pause Nomad.
         if (NomadPositions !== null) {
@@ -10,6 +10,9 @@ const fs = require('fs');
 let Buffer = require('buffer/').Buffer
 const bufferToArrayBuffer = require('buffer-to-arraybuffer');
 let STLLoader = require('three-stl-loader')(THREE)
+const config = require('../../config');
+const NativeGeometry = require('./native-geometry');
+const GeometryCache = require('./geometry-cache');
 /**
  * Default material of a component : gray metal.
  */
@@ -35,6 +38,8 @@ class Component {
 		this._material = DefaultMaterial;
 		this._boundingBox = null;
 		this._sceneNodeMap = {}
+		this._transformTree = null;
+		this._transformIndex = -1;
 
 		// New members to test transforms
 		this._invParentTransform = null;
@@ -218,16 +223,41 @@ class Component {
 		// Note that multiply or premultiply provide same results because they are either only rotations around the same axis or only translations on the same axis.
 
 		// Recalculate the scene node transform matrix.
-		let localTransform = new THREE.Matrix4();
-		localTransform.copy(this._invParentTransform);
-		localTransform.multiply(this._movementTransform);
-		localTransform.multiply(this._transform);
+		let localTransform = this.localTransform(this._movementTransform, new THREE.Matrix4());
 
 		// Reset the matrix of the scene node to identity.
 		this.sceneNode.matrix.identity();
 
 		// It is necessary to have matrixAutoUpdate of the scene node to false, otherwise calling applyMatrix leads to undefined behaviour.
 		this.sceneNode.applyMatrix(localTransform);
+
+		// Only the moved subtrees get their world matrices recomputed.
+		if (this._transformTree !== null) {
+			this._transformTree.markDirty(this._transformIndex);
+		}
+	}
+
+	/**
+	 * Computes the local transform of the scene node for a movement from the shown configuration without moving the component.
+	 * @param {Matrix4} movementTransform The movement transform
+	 * @param {Matrix4} target The matrix receiving the transform
+	 * @return {Matrix4} The target
+	 */
+	localTransform(movementTransform, target) {
+		target.copy(this._invParentTransform);
+		target.multiply(movementTransform);
+		target.multiply(this._transform);
+		return target;
+	}
+
+	/**
+	 * Sets the flat transform tree containing the component and its index in it.
+	 * @param {TransformTree} tree 
+	 * @param {Number} index 
+	 */
+	setTransformTree(tree, index) {
+		this._transformTree = tree;
+		this._transformIndex = index;
 	}
 
 	showConfiguration(configName, recursive, parentTransform) {
@@ -340,9 +370,41 @@ class Component {
 			// Start the recursion for merging component geometries.
 			let loadedComponents = new LoadedComponents(this, model);
 
+			// Merges the geometries when they are not cached.
+			let merge = () => {
+				let promise = new Promise((resolve) => {
+					// we merge geometries first to get all materials ready
+					if (NativeGeometry !== null) {
+						this.mergeGeometriesNative(model, loadedComponents);
+					}
+					else {
+						this.mergeGeometries(model, loader, loadedComponents);
+					}
+					resolve();
+				});
+				promise.then(() => {
+					// once the objects are optimized and merge we export only the necessary
+					// materials to avoid redundancy of equals materials
+					this.materialsCacheExport(this, model, loadedComponents);
+				});
+			};
+
 			//loading géometries
-			//case 1 : cache exists
-			if (this.geomCacheExists(model, loadedComponents)) {
+			//case 0 : the component is in the mapped geometry cache and its inputs did not change
+			let cached = model.geometryCache.has(this.name);
+			if (cached) {
+				model.addSourcesCheck(this.mappedCacheValid(model).then((valid) => {
+					if (valid) {
+						this.mappedCacheLoader(model, loadedComponents);
+					}
+					else {
+						merge();
+					}
+				}));
+			}
+			//case 1 : cache exists, only read without the geometry addon. Otherwise it has no signatures of its sources
+			// and it is a miss so that the merge fills the mapped cache.
+			else if (!GeometryCache.available && this.geomCacheExists(model, loadedComponents)) {
 				let promise = new Promise((resolve) => {
 					// we make sure that all materials are loaded in order to proceed
 					let map = this.materialsCacheLoader(this, model, loadedComponents);
@@ -356,16 +418,7 @@ class Component {
 			}
 			// case 2: cache does not exist 
 			else {
-				let promise = new Promise((resolve) => {
-					// we merge geometries first to get all materials ready
-					this.mergeGeometries(model, loader, loadedComponents);
-					resolve();
-				});
-				promise.then(() => {
-					// once the objects are optimized and merge we export only the necessary
-					// materials to avoid redundancy of equals materials
-					this.materialsCacheExport(this, model, loadedComponents);
-				});
+				merge();
 			}
 			
 
@@ -461,7 +514,7 @@ class Component {
 	 */
 	geomCacheExists(model, loadedComponents) {
 		let exists = true;
-		for (let i = 0; i < model.geometryDirectories.length; i++) {
+		for (let i = 0; i < model.lodsCount; i++) {
 			exists = exists && fs.existsSync(loadedComponents.geomCachePath(i)) &&
 				fs.existsSync(loadedComponents.geomCachePath(i)) &&
 				fs.existsSync(loadedComponents.geomMaterialsPath);
@@ -507,16 +560,105 @@ class Component {
 
 
 
+	/**
+	 * Gets the leaves of the sub-hierarchy in the order of mergeGeometries.
+	 */
+	mergedLeaves() {
+		let leaves = [];
+		this.traverse((component) => {
+			if (component.isLeaf()) {
+				leaves.push(component);
+			}
+		});
+		return leaves;
+	}
+
+	/**
+	 * Gets the inputs of the merge of a LOD: the STL paths and a key made of the file names,
+	 * config transforms and materials of the leaves.
+	 * @param {Model} model 
+	 * @param {Number} lod 
+	 * @param {Array} leaves 
+	 */
+	mergeInputs(model, lod, leaves) {
+		let dir = path.join(model.directoryPath, model.lodDirectory(lod));
+		let paths = [];
+		let key = [];
+		for (let l = 0; l < leaves.length; l++) {
+			let material = leaves[l].material;
+			paths.push(path.join(dir, leaves[l].fileName + ".STL"));
+			key.push([leaves[l].fileName, leaves[l].configurations[0].transformMatrix().elements,
+				material.color.getHex(), material.opacity, material.transparent, material.metalness]);
+		}
+		return { "paths": paths, "key": JSON.stringify(key) };
+	}
+
+	/**
+	 * checks that the inputs of all the LODs in the mapped geometry cache did not change.
+	 * Returns a promise resolved with the validity.
+	 * @param {Model} model 
+	 */
+	mappedCacheValid(model) {
+		let leaves = this.mergedLeaves();
+		let checks = [];
+		for (let i = 0; i < model.lodsCount; i++) {
+			let inputs = this.mergeInputs(model, i, leaves);
+			checks.push(model.geometryCache.isValid(this.name, i, inputs.paths, inputs.key, model.lodBudget(i)));
+		}
+		return Promise.all(checks).then((valid) => {
+			if (valid.indexOf(false) >= 0) {
+				console.log("geometry cache of " + this.name + " is outdated, it will be merged again");
+				return false;
+			}
+			return true;
+		});
+	}
+
+	/**
+	 * load the merged geometries and the materials from the mapped geometry cache.
+	 * The attributes view the mapped file, nothing is parsed.
+	 * @param {Model} model 
+	 * @param {LoadedComponents} loadedComponents 
+	 */
+	mappedCacheLoader(model, loadedComponents) {
+		let cache = model.geometryCache;
+
+		this.materialsCacheLoader(this, model, loadedComponents, cache.entry(this.name, 0).materials);
+
+		for (let i = 0; i < model.lodsCount; i++) {
+			let entry = cache.entry(this.name, i);
+
+			// The identical component LODs have the same blob and share the buffer geometry.
+			let bufferGeometry = model.sharedGeometry("blob " + entry.blob, () => {
+				let geometry = new THREE.BufferGeometry();
+				geometry.setIndex(new THREE.BufferAttribute(entry.index, 1));
+				geometry.addAttribute('position', new THREE.BufferAttribute(entry.position, 3));
+				geometry.addAttribute('normal', new THREE.BufferAttribute(entry.normal, 3));
+
+				for (let g = 0; g < entry.groups.length; g++) {
+					geometry.addGroup(entry.groups[g].start, entry.groups[g].count, entry.groups[g].materialIndex);
+				}
+				return geometry;
+			});
+
+			let distance = model.distanceOfLOD(i);
+			this.sceneNode.getObjectForDistance(distance).geometry = bufferGeometry;
+		}
+	}
+
 	/**
 	 * load the cache of materials .
 	 *  @param {Component} component
 	 * @param {Model} model  
 	 * @param {LoadedComponents} loadedComponents 
+	 * @param {String} jsonMaterials materials already loaded, read from the materials cache file if undefined
 	 */
-	materialsCacheLoader(component, model, loadedComponents) {
+	materialsCacheLoader(component, model, loadedComponents, jsonMaterials) {
 		console.log("cache found, and is being loaded ...");
 		
-		let jsonMaterials = fs.readFileSync(loadedComponents.geomMaterialsPath);//load and parse
+		if (jsonMaterials === undefined) {
+			jsonMaterials = fs.readFileSync(loadedComponents.geomMaterialsPath);//load and parse
+		}
 		let materials = JSON.parse(jsonMaterials);
 		
 		// create a materials with information parsed
@@ -528,13 +670,13 @@ class Component {
 			material.roughness = 0.35;   //materials[i].roughness/4; // looks better
 			material.metalness = materials[i].metalness / 1.05;
 			// adding te material
-			for (let j = 0; j < model.geometryDirectories.length; j++) {
+			for (let j = 0; j < model.lodsCount; j++) {
 				loadedComponents.loaded[j].materials.push(material);
 			}
 		}
 
 		// Create the mesh.
-		for (let i = 0; i < model.geometryDirectories.length; i++) {
+		for (let i = 0; i < model.lodsCount; i++) {
 			//let mesh = new THREE.Mesh(new THREE.IcosahedronBufferGeometry(), this.material); /*component.material); // */ 
 			let mesh = new THREE.Mesh(new THREE.IcosahedronBufferGeometry(), loadedComponents.loaded[i].materials);
 			component.sceneNode.addLevel(mesh, model.distanceOfLOD(i));
@@ -591,9 +733,10 @@ class Component {
 		// we store the materials
 		let jsonMaterials = JSON.stringify(materials, undefined, 2);
 		fs.writeFileSync(loadedComponents.geomMaterialsPath, jsonMaterials);
+		loadedComponents.materialsJson = jsonMaterials;
 		
 		// Create the mesh.
-		for (let i = 0; i < model.geometryDirectories.length; i++) {
+		for (let i = 0; i < model.lodsCount; i++) {
 			//let mesh = new THREE.Mesh(new THREE.IcosahedronBufferGeometry(), this.material) // uses same material for all objects of the scene
 			let mesh = new THREE.Mesh(new THREE.IcosahedronBufferGeometry(), factorizedMaterials);
 			component.sceneNode.addLevel(mesh, model.distanceOfLOD(i));
@@ -628,8 +771,8 @@ class Component {
 
 				//console.log(this.name + " loading " + i + " " + loadedComponents.loaded[i].geometriesCount);
 
-				// Asynchronous call.
-				loader.load(stlPath, (bufferGeometry) => {
+				// Asynchronous call, the leaves with the same file share the load.
+				model.loadStl(loader, stlPath, (bufferGeometry) => {
 					// Apply the config transform to the buffer geometry.
 					let transform = this.configurations[0].transformMatrix();
 
@@ -724,11 +867,12 @@ class Component {
 					// Force the update of the model when all the geometries have been loaded and merged.
 					if (model.allLoadedGeometriesCount === model.allGeometriesCount) {
 						model.needsUpdate = true;
+						model.releaseSources();
 
 						console.log("Geometries loaded and merged");
 					}
 
-				}, undefined, () => {
+				}, () => {
 					console.error("Unable to load file " + stlPath);
 				});
 
@@ -747,6 +891,114 @@ class Component {
 		}
 	}
 
+	/**
+	 * Merges the geometries of all the sub-hierarchy with the native addon.
+	 * The leaf STL files are loaded, transformed, grouped by material and welded across a pool of threads.
+	 * The LODs with a budget are simplified from the finest merged geometry.
+	 * The materials are stored synchronously as in mergeGeometries, the geometries are set once merged
+	 * and added to the geometry cache of the model.
+	 * @param {Model} model 
+	 * @param {LoadedComponents} loadedComponents 
+	 */
+	mergeGeometriesNative(model, loadedComponents) {
+
+		this.createCacheDirectories(model);
+
+		// Collect the leaves in the same order as mergeGeometries.
+		let leaves = this.mergedLeaves();
+
+		let merged = [];
+
+		// Iterate the LODs.
+		for (let i = 0; i < model.lodsCount; i++) {
+
+			let loaded = loadedComponents.loaded[i];
+			let inputs = this.mergeInputs(model, i, leaves);
+			let budget = model.lodBudget(i);
+
+			for (let l = 0; l < leaves.length; l++) {
+				loaded.index.push(loaded.geometriesCount);
+				loaded.geometriesCount++;
+				model.allGeometriesCount++;
+
+				// Store the material.
+				loaded.materials.push(leaves[l].material);
+			}
+
+			let promise = null;
+
+			if (budget === undefined) {
+				// Find the group of each material.
+				let materialsMap = this.materialsMapping(loaded.materials);
+				let materialGroups = [];
+				let groupsCount = 0;
+				for (let key in materialsMap) {
+					for (let j = 0; j < materialsMap[key].length; j++) {
+						materialGroups[materialsMap[key][j]] = groupsCount;
+					}
+					groupsCount++;
+				}
+
+				let parts = [];
+				for (let l = 0; l < leaves.length; l++) {
+					parts.push({
+						"path": inputs.paths[l],
+						"matrix": leaves[l].configurations[0].transformMatrix().elements,
+						"group": materialGroups[l]
+					});
+				}
+
+				promise = NativeGeometry.mergeStl(parts, groupsCount, { "threads": config.geometryThreads });
+			}
+			else {
+				// Simplify the finest geometry, the LOD has the same sources.
+				promise = merged[0].then((mesh) => {
+					return NativeGeometry.decimate(mesh, budget, { "threads": config.geometryThreads }).then((lod) => {
+						lod.sources = mesh.sources;
+						return lod;
+					});
+				});
+			}
+
+			merged.push(promise);
+
+			promise.then((mesh) => {
+
+				for (let e = 0; e < mesh.errors.length; e++) {
+					console.error("Unable to load file " + mesh.errors[e]);
+				}
+
+				let bufferGeometry = new THREE.BufferGeometry();
+				bufferGeometry.setIndex(new THREE.BufferAttribute(mesh.index, 1));
+				bufferGeometry.addAttribute('position', new THREE.BufferAttribute(mesh.position, 3));
+				bufferGeometry.addAttribute('normal', new THREE.BufferAttribute(mesh.normal, 3));
+
+				for (let g = 0; g < mesh.groups.length; g++) {
+					bufferGeometry.addGroup(mesh.groups[g].start, mesh.groups[g].count, mesh.groups[g].materialIndex);
+				}
+
+				model.geometryCache.add(this.name, i, mesh, loadedComponents.materialsJson, { "budget": budget, "key": inputs.key, "files": mesh.sources });
+
+				loaded.loadedGeometriesCount += leaves.length;
+				model.allLoadedGeometriesCount += leaves.length;
+
+				// Set the buffer geometry to the scene node.
+				let distance = model.distanceOfLOD(i);
+				loadedComponents.component.sceneNode.getObjectForDistance(distance).geometry = bufferGeometry;
+
+				// Force the update of the model when all the geometries have been loaded and merged.
+				model.completeGeometries();
+			}, (error) => {
+				console.error("Unable to merge the geometries of " + this.name + ": " + error);
+
+				// The failed LOD is counted so that the STL files are still released once the other merges complete.
+				loaded.loadedGeometriesCount += leaves.length;
+				model.allLoadedGeometriesCount += leaves.length;
+				model.completeGeometries();
+			});
+		}
+	}
+
 	setEnvMap(envMap, intensity) {
 		intensity = (intensity === undefined) ? 0.5 : intensity;
 
@@ -834,7 +1086,7 @@ class Component {
 
 		if (this.controller !== null) {
 			if (positions !== null) {
-				this.controller.init(positions[this.controller.name]);
+				this.controller.init(this.controller.positionOf(positions));
 			}
 			else {
 				this.controller.init(0);
@@ -856,7 +1108,7 @@ class Component {
 
 		// Controller.
 		if (this.controller !== null && positions !== null) {
-			this.controller.update(positions[this.controller.name]);
+			this.controller.update(this.controller.positionOf(positions));
 		}
 
 		// Iterate the children if the component is not mergeable.
@@ -0,0 +1,174 @@
+/**
+ *
+ * @class GeometryCache
+ */
+const path = require('path');
+const NativeGeometry = require('./native-geometry');
+
+/**
+ * Single memory-mapped cache file of the merged geometries of a model.
+ * Each entry holds the indexed geometry of a mergeable component LOD, the materials of the component
+ * and the signatures of the merge inputs so that only the components whose inputs changed are merged again.
+ */
+class GeometryCache {
+
+	constructor(model) {
+		this._path = path.join(path.join(model.directoryPath, "cache " + model.name), "geometry.n3dc");
+		this._lodsCount = model.lodsCount;
+		this._entries = {};
+		this._dirty = false;
+	}
+
+	get path() {
+		return this._path;
+	}
+
+	set path(value) {
+		console.warn("GeometryCache.path is a read-only property.");
+	}
+
+	static get available() {
+		return (NativeGeometry !== null);
+	}
+
+	/**
+	 * Maps the cache file if it exists. The geometries are then viewed without parsing.
+	 */
+	open() {
+		if (NativeGeometry === null) {
+			return;
+		}
+
+		let cache = NativeGeometry.openCache(this._path);
+		if (cache === null) {
+			return;
+		}
+
+		for (let i = 0; i < cache.entries.length; i++) {
+			let entry = cache.entries[i];
+			if (!(entry.name in this._entries)) {
+				this._entries[entry.name] = [];
+			}
+			this._entries[entry.name][entry.lod] = entry;
+		}
+
+		console.log("geometry cache mapped with " + cache.entries.length + " entries");
+	}
+
+	/**
+	 * Checks if the cache contains all the LODs of a component.
+	 * @param {String} name 
+	 */
+	has(name) {
+		if (!(name in this._entries)) {
+			return false;
+		}
+		for (let i = 0; i < this._lodsCount; i++) {
+			if (this._entries[name][i] === undefined) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Checks that the inputs of a component LOD did not change since it was merged.
+	 * The files are hashed only if their size or modification time changed. If they only have been touched,
+	 * their new signatures are stored so that they are not hashed again. Returns a promise resolved with the validity.
+	 * @param {String} name 
+	 * @param {Number} lod 
+	 * @param {Array} paths STL paths of the leaves
+	 * @param {String} key file names, config transforms and materials of the leaves
+	 * @param {Number} budget budget of a generated LOD, undefined for a merged LOD
+	 */
+	isValid(name, lod, paths, key, budget) {
+		let entry = this._entries[name][lod];
+		let sources = null;
+
+		try {
+			sources = JSON.parse(entry.sources);
+		} catch (e) {
+			return Promise.resolve(false);
+		}
+
+		if (sources.key !== key || sources.budget !== budget || sources.files.length !== paths.length) {
+			return Promise.resolve(false);
+		}
+
+		// The files are hashed outside the JS thread.
+		return NativeGeometry.checkSources(paths, sources.files).then((files) => {
+			let touched = false;
+
+			for (let i = 0; i < files.length; i++) {
+				if (files[i] === null || files[i].hash !== sources.files[i].hash) {
+					return false;
+				}
+				touched = touched || (files[i].mtime !== sources.files[i].mtime);
+			}
+
+			if (touched) {
+				entry.sources = JSON.stringify({ "budget": budget, "key": key, "files": files });
+				this._dirty = true;
+			}
+
+			return true;
+		});
+	}
+
+	entry(name, lod) {
+		return this._entries[name][lod];
+	}
+
+	/**
+	 * Adds the merged geometry of a component LOD. The cache needs to be written.
+	 * @param {String} name 
+	 * @param {Number} lod 
+	 * @param {Object} mesh {position, normal, index, groups}
+	 * @param {String} materials JSON description of the materials
+	 * @param {Object} sources inputs of the merge {budget, key, files}
+	 */
+	add(name, lod, mesh, materials, sources) {
+		if (!(name in this._entries)) {
+			this._entries[name] = [];
+		}
+		this._entries[name][lod] = {
+			"name": name,
+			"lod": lod,
+			"position": mesh.position,
+			"normal": mesh.normal,
+			"index": mesh.index,
+			"groups": mesh.groups,
+			"materials": materials,
+			"sources": JSON.stringify(sources)
+		};
+		this._dirty = true;
+	}
+
+	/**
+	 * Writes the cache file if entries were added. The file is replaced so that the current mapping stays valid.
+	 */
+	write() {
+		if (NativeGeometry === null || !this._dirty) {
+			return;
+		}
+
+		let entries = [];
+		for (let name in this._entries) {
+			for (let i = 0; i < this._entries[name].length; i++) {
+				if (this._entries[name][i] !== undefined) {
+					entries.push(this._entries[name][i]);
+				}
+			}
+		}
+
+		this._dirty = false;
+
+		NativeGeometry.writeCache(this._path, entries).then(() => {
+			console.log("geometry cache written with " + entries.length + " entries");
+		}, (error) => {
+			console.error(error);
+		});
+	}
+}
+
+module.exports = GeometryCache;
@@ -0,0 +1,189 @@
+/**
+ *
+ * @class Ghost
+ */
+const THREE = require('three');
+const Component = require('./component.js');
+
+/**
+ * Translucent copy of a model moved by the positions of another Nomad server, for instance a simulation shown next
+ * to the real instrument. The scene nodes are cloned and share the geometries of the model, so that only the
+ * transforms of the controlled components are computed for the ghost.
+ */
+class Ghost {
+
+	constructor(model, color, opacity) {
+		this._model = model;
+		this._positions = null;
+		this._tableVersion = -1;
+		this.handle = -1;
+
+		this._material = new THREE.MeshLambertMaterial({
+			color: color,
+			transparent: true,
+			opacity: opacity,
+			depthWrite: false
+		});
+
+		// The ghost has the transform of the model.
+		this._sceneNode = new THREE.Group();
+		this._sceneNode.position.copy(model.sceneNode.position);
+		this._sceneNode.rotation.copy(model.sceneNode.rotation);
+		this._sceneNode.scale.copy(model.sceneNode.scale);
+		this._sceneNode.updateMatrix();
+
+		// Only the moved nodes have their world matrix updated.
+		this._sceneNode.matrixAutoUpdate = false;
+
+		let rootNode = model.root.sceneNode.clone();
+		this._sceneNode.add(rootNode);
+
+		let nodes = new Map();
+		Ghost.mapNodes(model.root.sceneNode, rootNode, nodes);
+
+		// The controlled components with the cloned scene node and the value of the axis in the shown configuration.
+		this._controlled = [];
+		this._lods = [];
+
+		model.root.traverse((component) => {
+			let node = nodes.get(component.sceneNode);
+
+			if (node === undefined) {
+				return;
+			}
+
+			if (node.isLOD) {
+				this._lods.push(node);
+			}
+
+			if (component.controller !== null && component.axis !== null && component.axis.isControllable()
+				&& component.animation === Component.Controlled) {
+				this._controlled.push({
+					component,
+					node,
+					index: -1,
+					value: undefined,
+					initialValue: THREE.Math.clamp(-component.axis.zeroValue, component.axis.minValue, component.axis.maxValue)
+				});
+			}
+		});
+
+		rootNode.traverse((object) => {
+			if (object.isMesh) {
+				object.material = this._material;
+				object.castShadow = false;
+				object.receiveShadow = false;
+			}
+		});
+
+		this._movement = new THREE.Matrix4();
+	}
+
+	get sceneNode() {
+		return this._sceneNode;
+	}
+
+	set sceneNode(node) {
+		console.warn("Ghost.sceneNode is a read-only property.");
+	}
+
+	get tableVersion() {
+		return this._tableVersion;
+	}
+
+	set tableVersion(version) {
+		console.warn("Ghost.tableVersion is a read-only property.");
+	}
+
+	/**
+	 * Maps the scene nodes to their clones. The LOD levels are cloned in their own order, only the LOD is mapped.
+	 */
+	static mapNodes(node, clone, nodes) {
+		nodes.set(node, clone);
+
+		if (node.isLOD) {
+			return;
+		}
+
+		for (let i = 0; i < node.children.length && i < clone.children.length; i++) {
+			Ghost.mapNodes(node.children[i], clone.children[i], nodes);
+		}
+	}
+
+	/**
+	 * Sets the positions of the ghost.
+	 * @param {Float64Array} positions The positions packed in the order of the axis names
+	 * @param {Array} axisNames The axis names, only read when the table version changes
+	 * @param {Number} tableVersion The version of the axis table
+	 */
+	setPositions(positions, axisNames, tableVersion) {
+
+		if (tableVersion !== this._tableVersion) {
+			this._tableVersion = tableVersion;
+
+			for (let i = 0; i < this._controlled.length; i++) {
+				this._controlled[i].index = axisNames.indexOf(this._controlled[i].component.controller.name);
+				this._controlled[i].value = undefined;
+			}
+		}
+
+		this._positions = positions;
+	}
+
+	/**
+	 * Moves the controlled components of the ghost to its positions and updates its LODs.
+	 * Returns true if a component moved.
+	 * @param {Camera} camera
+	 */
+	update(camera) {
+
+		let changed = false;
+
+		if (this._positions !== null) {
+			for (let i = 0; i < this._controlled.length; i++) {
+				let controlled = this._controlled[i];
+
+				if (controlled.index < 0) {
+					continue;
+				}
+
+				let axis = controlled.component.axis;
+				let value = THREE.Math.clamp(this._positions[controlled.index], axis.minValue, axis.maxValue);
+
+				if (value === controlled.value) {
+					continue;
+				}
+
+				controlled.value = value;
+
+				controlled.component.controller.motion(value - controlled.initialValue, this._movement);
+				controlled.component.localTransform(this._movement, controlled.node.matrix);
+				controlled.node.matrixWorldNeedsUpdate = true;
+
+				changed = true;
+			}
+
+			this._positions = null;
+		}
+
+		if (camera !== undefined) {
+			for (let i = 0; i < this._lods.length; i++) {
+				this._lods[i].update(camera);
+			}
+		}
+
+		return changed;
+	}
+
+	dispose() {
+
+		if (this._sceneNode.parent !== null) {
+			this._sceneNode.parent.remove(this._sceneNode);
+		}
+
+		// The geometries belong to the model.
+		this._material.dispose();
+	}
+}
+
+module.exports = Ghost;
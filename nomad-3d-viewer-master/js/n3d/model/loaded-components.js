@@ -8,27 +8,27 @@ class LoadedComponents {
 
         // we keep paths here to reduce the variable on component.js, factorized code is always better ;)
         //model's folder path
-        this._geomFolderCachePath = [path.join(path.join(path.join(model.directoryPath, "cache "+model.name), model.geometryDirectories[0]), component.name),
-        path.join(path.join(path.join(model.directoryPath, "cache "+model.name), model.geometryDirectories[1]), component.name),
-        path.join(path.join(path.join(model.directoryPath, "cache "+model.name), model.geometryDirectories[2]), component.name)
-        ];
+        this._geomFolderCachePath = [];
         //merged model's sub_geometries path
-        this._geomCachePath = [path.join(this._geomFolderCachePath[0], component.name + '.STL'),
-        path.join(this._geomFolderCachePath[1], component.name + '.STL'),
-        path.join(this._geomFolderCachePath[2], component.name + '.STL')
-        ];
+        this._geomCachePath = [];
         //group material mapping params path
-        this._geomParamsPath = [path.join(this._geomFolderCachePath[0], component.name + 'Params.Json'),
-        path.join(this._geomFolderCachePath[1], component.name + 'Params.Json'),
-        path.join(this._geomFolderCachePath[2], component.name + 'Params.Json')
-        ];
+        this._geomParamsPath = [];
+
+        for (let i = 0; i < model.geometryDirectories.length; i++) {
+            this._geomFolderCachePath.push(path.join(path.join(path.join(model.directoryPath, "cache "+model.name), model.geometryDirectories[i]), component.name));
+            this._geomCachePath.push(path.join(this._geomFolderCachePath[i], component.name + '.STL'));
+            this._geomParamsPath.push(path.join(this._geomFolderCachePath[i], component.name + 'Params.Json'));
+        }
         //model's materials path
         this._geomMaterialsPath = path.join(path.join(model.directoryPath, "cache " +model.name +"/materials"), component.name + '.json');
         this._materialsMapPath = path.join(path.join(model.directoryPath, "cache " +model.name +"/materials"), component.name +'materialsMap.json');
 
+        //JSON description of the materials written in the geometry cache
+        this._materialsJson = null;
+
         this._loaded = [];
 
-        for (let i = 0; i < model.geometryDirectories.length; i++) {
+        for (let i = 0; i < model.lodsCount; i++) {
 
             this._loaded.push({
                 geometriesCount: 0,
@@ -64,6 +64,14 @@ class LoadedComponents {
         return this._materialsMapPath;
     }
 
+    get materialsJson() {
+        return this._materialsJson;
+    }
+
+    set materialsJson(json) {
+        this._materialsJson = json;
+    }
+
     get loaded() {
         return this._loaded;
     }
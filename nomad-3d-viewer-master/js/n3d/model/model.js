@@ -8,6 +8,10 @@ const STLLoader = require('three-stl-loader')(THREE);
 const config = require('../../config.js');
 const Nomad3DPositions = require('../link/nomad-3d-positions');
 const collision = require("../../collision.js");
+const GeometryCache = require('./geometry-cache');
+const NativeGeometry = require('./native-geometry');
+const TransformTree = require('./transform-tree');
+const Ghost = require('./ghost');
 
 class Model {
 
@@ -15,8 +19,11 @@ class Model {
 		this._name = "";
 		this._directoryPath = "";
 		this._geometryDirectories = [];
+		// Budgets of the LODs generated from the finest geometries, the geometry directories define the LODs if empty.
+		this._lodBudgets = (GeometryCache.available && Array.isArray(config.lodBudgets) ? config.lodBudgets : []);
 		this._root = null;
 		this._geometries = {};
+		this._stlLoads = {};
 		this._viewDistance = 2000000;
 		this._wallOpacity = 1;
 		this._wallsVisible = true;
@@ -27,6 +34,10 @@ class Model {
 		this._sceneNode = null;
 		this._sceneNodeMap = {};
 		this._boundingBox = null;
+		this._geometryCache = null;
+		this._sourcesChecks = [];
+		this._sourcesChecked = false;
+		this._transformTree = null;
 		this._clock = new THREE.Clock();
 		this._previousUpdateTime = 0;
 		this._minDeltaTimeMs = 40;
@@ -35,9 +46,28 @@ class Model {
 
 		this._nomad3DPositions = null;
 		this._currentPositions = null;
+		this._asyncRequests = config.asyncRequests;
+		this._binaryPositions = config.binaryPositions;
+		this._controllersByIndex = [];
+		this._positionsApplied = false;
+		this._collisionsNeedUpdate = false;
+		this._collisionsLatency = 0;
+		this._pendingUpdate = false;
+		this._collisionsStatus = null;
+		this._collisionsChanged = false;
+
+		// Broad phase bodies: the finest mesh of each mergeable component.
+		this._broadPhaseMeshes = null;
+		this._broadPhaseMatrices = null;
+		this._broadPhaseMatrix = new THREE.Matrix4();
+		this._inverseWorldMatrix = new THREE.Matrix4();
 
 		this._collisionDetection = null;
 
+		// Ghosts of the model moved by the positions of other Nomad servers, by server id.
+		this._ghosts = {};
+		this._ghostsChanged = false;
+
 		if (config.collisionDetection) {
 			let Nomad3DCollisions = require('../link/nomad-3d-collisions');
 			this._collisionDetection = new Nomad3DCollisions();
@@ -68,6 +98,35 @@ class Model {
 		console.warn("Model.geometryDirectories is a read-only property.");
 	}
 
+	get lodsCount() {
+		if (this._lodBudgets.length > 0) {
+			return 1 + this._lodBudgets.length;
+		}
+		return this._geometryDirectories.length;
+	}
+
+	/**
+	 * Gets the budget of a generated LOD, undefined if the LOD is read from its geometry directory.
+	 * @param {Number} lodIndex 
+	 */
+	lodBudget(lodIndex) {
+		if (lodIndex > 0 && this._lodBudgets.length > 0) {
+			return this._lodBudgets[lodIndex - 1];
+		}
+		return undefined;
+	}
+
+	/**
+	 * Gets the geometry directory of a LOD. The generated LODs come from the finest geometries.
+	 * @param {Number} lodIndex 
+	 */
+	lodDirectory(lodIndex) {
+		if (this._lodBudgets.length > 0) {
+			return this._geometryDirectories[0];
+		}
+		return this._geometryDirectories[lodIndex];
+	}
+
 	get root() {
 		return this._root;
 	}
@@ -169,6 +228,129 @@ class Model {
 		console.warn("Model.boundingBox is a read-only property.");
 	}
 
+	get geometryCache() {
+		return this._geometryCache;
+	}
+
+	set geometryCache(cache) {
+		console.warn("Model.geometryCache is a read-only property.");
+	}
+
+	/**
+	 * Gets the geometry shared under the key, created the first time.
+	 * The component LODs with the same blob in the geometry cache share their buffer geometry.
+	 * @param {String} key 
+	 * @param {Function} create returns the geometry
+	 */
+	sharedGeometry(key, create) {
+		if (!(key in this._geometries)) {
+			this._geometries[key] = create();
+		}
+		return this._geometries[key];
+	}
+
+	/**
+	 * Loads an STL file once for all the leaves using it. Each leaf receives its own clone of the geometry
+	 * so that it can be transformed into the root frame.
+	 * @param {STLLoader} loader 
+	 * @param {String} stlPath 
+	 * @param {Function} onLoad called with the geometry
+	 * @param {Function} onError 
+	 */
+	loadStl(loader, stlPath, onLoad, onError) {
+		let load = this._stlLoads[stlPath];
+
+		if (load === undefined) {
+			load = { "geometry": null, "failed": false, "callbacks": [] };
+			this._stlLoads[stlPath] = load;
+
+			loader.load(stlPath, (geometry) => {
+				load.geometry = geometry;
+				for (let i = 0; i < load.callbacks.length; i++) {
+					load.callbacks[i].onLoad(geometry.clone());
+				}
+				load.callbacks = [];
+			}, undefined, () => {
+				load.failed = true;
+				for (let i = 0; i < load.callbacks.length; i++) {
+					load.callbacks[i].onError();
+				}
+				load.callbacks = [];
+			});
+		}
+
+		if (load.geometry !== null) {
+			onLoad(load.geometry.clone());
+		}
+		else if (load.failed) {
+			onError();
+		}
+		else {
+			load.callbacks.push({ "onLoad": onLoad, "onError": onError });
+		}
+	}
+
+	/**
+	 * Adds the promise of the check of the cached geometries of a component. The merges of the outdated components
+	 * are only counted once all the checks are done.
+	 */
+	addSourcesCheck(promise) {
+		this._sourcesChecks.push(promise.catch((error) => {
+			console.error(error);
+		}));
+	}
+
+	/**
+	 * True once the cached geometries are checked and all the geometries are loaded and merged.
+	 */
+	get geometriesLoaded() {
+		return this._sourcesChecked && (this.allLoadedGeometriesCount === this.allGeometriesCount);
+	}
+
+	set geometriesLoaded(value) {
+		console.warn("Model.geometriesLoaded is a read-only property.");
+	}
+
+	/**
+	 * Forces the update of the model, writes the geometry cache and releases the STL files once all the geometries
+	 * are loaded and merged. Called when a merge completes and when the cached geometries are checked.
+	 */
+	completeGeometries() {
+		if (!this.geometriesLoaded) {
+			return;
+		}
+
+		this.needsUpdate = true;
+		this._geometryCache.write();
+
+		if (this.allGeometriesCount > 0) {
+			this.releaseSources();
+			console.log("Geometries loaded and merged");
+		}
+	}
+
+	/**
+	 * Releases the STL files loaded for the merges once all the geometries are merged.
+	 */
+	releaseSources() {
+		this._stlLoads = {};
+
+		if (NativeGeometry !== null) {
+			let stats = NativeGeometry.releaseSources();
+			console.log("STL files read " + stats.reads + " times for " + (stats.reads + stats.hits) + " parts, "
+				+ stats.shared + " with the content of another file, " + stats.meshes + " distinct meshes of "
+				+ Math.round(stats.bytes / 1024) + " KB released");
+		}
+	}
+
+	get transformTree() {
+		return this._transformTree;
+	}
+
+	set transformTree(tree) {
+		console.warn("Model.transformTree is a read-only property.");
+	}
+
 	distanceOfLOD(lodIndex) {
 		return (this.viewDistance * lodIndex);
 	}
@@ -176,10 +358,32 @@ class Model {
 	loadGeometries() {
 		console.info("Model " + this.name + " : loading geometries...");
 
+		// Map the geometry cache before the components look for their geometries.
+		this._geometryCache = new GeometryCache(this);
+		this._geometryCache.open();
+
+		this._sourcesChecks = [];
+		this._sourcesChecked = false;
+
 		this.root.loadGeometries(this, new STLLoader());
+
+		// The cached geometries are checked outside the JS thread and loaded once their sources are known to be unchanged.
+		Promise.all(this._sourcesChecks).then(() => {
+			this._sourcesChecks = [];
+			this._sourcesChecked = true;
+			this.completeGeometries();
+		});
 		// this.sceneNode.scale.set(0.01, 0.01, 0.01);
 		// this.sceneNode.rotation.y = Math.PI;
 		this.sceneNode.add(this.root.sceneNode);
+
+		// The world matrices of the components are updated by the flat tree, only for the moved subtrees.
+		let transformTree = new TransformTree(this.root);
+		this.root.sceneNode.updateMatrixWorld = () => {
+			transformTree.updateMatrixWorld();
+		};
+		this._transformTree = transformTree;
+
 		console.info("Model " + this.name + " : geometries loaded.");
 	}
 
@@ -259,6 +463,123 @@ class Model {
 		}
 	}
 
+	get positionsLatency() {
+		return (this._nomad3DPositions !== null) ? this._nomad3DPositions.latency : 0;
+	}
+
+	get collisionsLatency() {
+		if (this._collisionDetection === null) {
+			return 0;
+		}
+		if ((this._nomad3DPositions !== null && this._nomad3DPositions.collisionForwarding) || this._collisionDetection.pipelineRunning) {
+			return this._collisionsLatency;
+		}
+		return this._collisionDetection.latency;
+	}
+
+	updateCollisions(collisions) {
+		this._collisionsChanged = this._collisionsChanged || collisions.status == 'COLLIDING' || collisions.status != this._collisionsStatus;
+		this._collisionsStatus = collisions.status;
+		//console.log(this._collisions.collisionStack)
+		if (collisions.status == 'COLLIDING') {
+			PubSub.publish('ALERT COLLISION', ['COLLIDING', collisions.collisions]);
+			this.resetSceneMap();//we reset to have an updated list of object colliding in real time
+			this._collisions.updateCollisionStack(collisions.collisions, this._nomad3DPositions); //collision stack is a log of collisions
+			this.updateSceneNodeMap(collisions.collisions);// we update current objects in collision
+		}
+		if (collisions.status == 'OK') {
+			this.resetSceneMap();
+			PubSub.publish('ALERT COLLISION', 'OK');
+			this._collisions.resetHighligthedObjects()
+		}
+	}
+
+	/**
+	 * Builds the broad phase bodies from the bounding boxes of the finest LOD of the mergeable components.
+	 * The group of a body is its nearest ancestor with a controller, 0 for the static bodies.
+	 */
+	setBroadPhaseBodies() {
+
+		let meshes = [];
+		let boxes = [];
+		let groups = [];
+		let groupsCount = 0;
+
+		let collect = (component, group) => {
+
+			if (component.controller !== null) {
+				groupsCount++;
+				group = groupsCount;
+			}
+
+			if (component.isMergeable()) {
+				let mesh = component.sceneNode.levels[0].object;
+				mesh.geometry.computeBoundingBox();
+				let box = mesh.geometry.boundingBox;
+
+				meshes.push(mesh);
+				boxes.push(box.min.x, box.min.y, box.min.z, box.max.x, box.max.y, box.max.z);
+				groups.push(group);
+				return;
+			}
+
+			for (let i = 0; i < component.children.length; i++) {
+				collect(component.children[i], group);
+			}
+		};
+
+		collect(this.root, 0);
+
+		this._broadPhaseMeshes = meshes;
+		this._broadPhaseMatrices = new Float64Array(16 * meshes.length);
+		this._collisionDetection.setBodies(new Float64Array(boxes), new Int32Array(groups));
+
+		console.info("Model " + this.name + " : " + meshes.length + " broad phase bodies in " + (groupsCount + 1) + " groups.");
+	}
+
+	/**
+	 * Runs the broad phase on the current positions. Returns false if no two bodies that can move relatively to each other
+	 * are closer than the collision margin and the last verdict is not colliding, so that the collision request can be skipped.
+	 */
+	collisionCandidates() {
+
+		if (this._broadPhaseMeshes === null) {
+			return true;
+		}
+
+		// The positions must be applied to get the world matrices of the bodies.
+		if (!this._positionsApplied && this._currentPositions !== null) {
+			if (this._transformTree !== null) {
+				this._transformTree.updateComponents(undefined, this._currentPositions);
+			}
+			else {
+				this.root.update(undefined, this._currentPositions);
+			}
+			this._positionsApplied = true;
+		}
+
+		this._sceneNode.updateMatrixWorld(true);
+
+		// The bodies are expressed in the model space, the one of the collision server.
+		this._inverseWorldMatrix.getInverse(this._sceneNode.matrixWorld);
+
+		for (let i = 0; i < this._broadPhaseMeshes.length; i++) {
+			this._broadPhaseMatrix.multiplyMatrices(this._inverseWorldMatrix, this._broadPhaseMeshes[i].matrixWorld);
+			this._broadPhaseMatrices.set(this._broadPhaseMatrix.elements, 16 * i);
+		}
+
+		if (this._collisionDetection.updateBodies(this._broadPhaseMatrices, config.collisionMargin) !== 0) {
+			return true;
+		}
+
+		// Nothing is close but the last verdict is kept until the collision server confirms that the collisions are over.
+		return (this._collisionsStatus === 'COLLIDING');
+	}
+
+	get broadPhaseStats() {
+		return (this._broadPhaseMeshes !== null) ? this._collisionDetection.broadPhaseStats : null;
+	}
+
 	updatePositions() {
 
 		// Get the positions from Nomad.
@@ -268,27 +589,191 @@ class Model {
 			return;
 		}
 
-		// Get the positions from Nomad.
-		if (this._collisionDetection !== null) {
-			//console.log(this._sceneNode.children[0].children)
-			let collisions = JSON.parse(this._collisionDetection.updatePositions(JSON.parse(positions)));
-			//console.log(this._collisions.collisionStack)
-			if (collisions.status == 'COLLIDING') {
-				PubSub.publish('ALERT COLLISION', ['COLLIDING', collisions.collisions]);
-				this.resetSceneMap();//we reset to have an updated list of object colliding in real time
-				this._collisions.updateCollisionStack(collisions.collisions, this._nomad3DPositions); //collision stack is a log of collisions
-				this.updateSceneNodeMap(collisions.collisions);// we update current objects in collision
+		// Parse the result.
+		this._currentPositions = JSON.parse(positions);
+		this._positionsApplied = false;
+		this.submitLookahead(positions);
+
+		// Check the collisions if the broad phase finds close bodies.
+		if (this._collisionDetection !== null && this.collisionCandidates()) {
+			this.updateCollisions(JSON.parse(this._collisionDetection.updatePositions(this._currentPositions)));
+		}
+	}
+
+	updatePositionsAsync() {
+
+		// Only one positions request is in flight, the next one is sent when it is completed.
+		if (this._pendingUpdate) {
+			return;
+		}
+
+		let request = this._nomad3DPositions.updateAsync();
+
+		if (request === null) {
+			return;
+		}
+
+		this._pendingUpdate = true;
+
+		request.then((positions) => {
+
+			if (positions === "") {
+				return;
+			}
+
+			// The positions are applied as soon as they are received, the collisions follow.
+			this._currentPositions = JSON.parse(positions);
+			this._positionsApplied = false;
+			this.submitLookahead(positions);
+
+			if (this._collisionDetection === null || !this.collisionCandidates()) {
+				return;
+			}
+
+			if (this._collisionDetection.pipelineRunning) {
+				this._collisionDetection.submitPositions(this._currentPositions);
+			}
+			else {
+				return this._collisionDetection.updatePositionsAsync(this._currentPositions).then((collisions) => {
+					this.updateCollisions(JSON.parse(collisions));
+				});
 			}
-			if (collisions.status == 'OK') {
-				this.resetSceneMap();
-				PubSub.publish('ALERT COLLISION', 'OK');
-				this._collisions.resetHighligthedObjects()
+		}).catch((e) => {
+			console.error(e);
+		}).then(() => {
+			this._pendingUpdate = false;
+		});
+	}
+
+	updateBufferedPositions() {
+
+		// Get the positions that changed since the last snapshot.
+		let changes = this._nomad3DPositions.updateChanges();
+
+		if (changes === null) {
+			// The positions did not change if the stream is running.
+			return this._nomad3DPositions.streaming;
+		}
+
+		// Resolve the controllers of each axis when the axis table changes.
+		if (changes.full) {
+			let axisNames = this._nomad3DPositions.axisNames;
+
+			this._controllersByIndex = axisNames.map(() => []);
+
+			this.root.traverse((component) => {
+				if (component.controller !== null) {
+					let index = axisNames.indexOf(component.controller.name);
+					component.controller.positionIndex = index;
+					if (index >= 0) {
+						this._controllersByIndex[index].push(component.controller);
+					}
+				}
+			});
+		}
+
+		this._currentPositions = changes.positions;
+		this._positionsApplied = true;
+
+		// Only the controllers of the changed axes move their component.
+		for (let i = 0; i < changes.changed.length; i++) {
+			let index = changes.changed[i];
+			let controllers = this._controllersByIndex[index];
+
+			for (let j = 0; j < controllers.length; j++) {
+				controllers[j].update(changes.positions[index]);
 			}
+		}
 
+		if (changes.changed.length > 0) {
+			this._collisionsNeedUpdate = true;
+			this.submitLookahead(this._nomad3DPositions.currentPositions);
 		}
 
-		// Parse the result.
-		this._currentPositions = JSON.parse(positions);
+		this.updateBufferedCollisions();
+
+		return true;
+	}
+
+	updateBufferedCollisions() {
+
+		if (this._collisionDetection === null) {
+			return;
+		}
+
+		// The positions addon forwards the positions to the collision server, only the verdict is read.
+		if (this._nomad3DPositions.collisionForwarding) {
+			let verdict = this._nomad3DPositions.updateCollisionVerdict();
+
+			if (verdict !== null) {
+				this._collisionsLatency = verdict.latency;
+				this.updateCollisions(JSON.parse(verdict.response));
+			}
+			return;
+		}
+
+		// The pipeline checks the newest positions, the verdict is read in update().
+		if (this._collisionDetection.pipelineRunning) {
+			if (this._collisionsNeedUpdate) {
+				if (this.collisionCandidates()) {
+					this._collisionDetection.submitPositionsJson(this._nomad3DPositions.currentPositions);
+				}
+				this._collisionsNeedUpdate = false;
+			}
+			return;
+		}
+
+		// The collision server already has the current state if no axis moved.
+		if (!this._collisionsNeedUpdate || this._pendingUpdate) {
+			return;
+		}
+
+		this._collisionsNeedUpdate = false;
+
+		if (!this.collisionCandidates()) {
+			return;
+		}
+
+		this._pendingUpdate = true;
+
+		// The collision request reuses the received JSON positions.
+		this._collisionDetection.updatePositionsJsonAsync(this._nomad3DPositions.currentPositions).then((collisions) => {
+			this.updateCollisions(JSON.parse(collisions));
+		}).catch((e) => {
+			console.error(e);
+		}).then(() => {
+			this._pendingUpdate = false;
+		});
+	}
+
+	updatePipelineCollisions() {
+
+		// Apply the newest verdict of the collision pipeline.
+		let verdict = this._collisionDetection.updateVerdict();
+
+		if (verdict !== null) {
+			this._collisionsLatency = verdict.latency;
+			this.updateCollisions(JSON.parse(verdict.response));
+		}
+	}
+
+	submitLookahead(jsonPositions) {
+
+		// The future poses are checked even if the current one has no close bodies.
+		if (this._collisionDetection !== null && this._collisionDetection.lookaheadRunning) {
+			this._collisionDetection.submitLookaheadJson(jsonPositions);
+		}
+	}
+
+	updateLookaheadCollisions() {
+
+		// Apply the newest verdict of the future poses.
+		let verdict = this._collisionDetection.updateLookaheadVerdict();
+
+		if (verdict !== null) {
+			let collisions = (verdict.step > 0) ? JSON.parse(verdict.response).collisions || [] : [];
+			this._collisions.anticipateCollisions(verdict.time, collisions, this._nomad3DPositions);
+		}
 	}
 
 	updatePositionsAtFrequency() {
@@ -299,13 +784,115 @@ class Model {
 
 		if (deltaTimeMs > this._minDeltaTimeMs) {
 
-			this.updatePositions();
+			if (this._binaryPositions && this.updateBufferedPositions()) {
+				// The streamed positions are applied.
+			}
+			else if (this._asyncRequests) {
+				this.updatePositionsAsync();
+			}
+			else {
+				this.updatePositions();
+			}
 			this._previousUpdateTime = time;
 		}
 	}
 
+	/**
+	 * Shows a ghost of the model moved by the positions of another Nomad server, streamed next to the active one.
+	 * @param {Number} nomadServerId The id of the Nomad server
+	 */
+	showGhost(nomadServerId) {
+
+		if (this._nomad3DPositions === null || nomadServerId in this._ghosts) {
+			return;
+		}
+
+		// Reserve the place so that the ghost is not opened twice.
+		this._ghosts[nomadServerId] = null;
+
+		let periodMs = (config.positionsPeriod > 0) ? config.positionsPeriod : this._minDeltaTimeMs;
+
+		this._nomad3DPositions.openStream(nomadServerId, periodMs).then((handle) => {
+
+			// The ghost was hidden meanwhile.
+			if (!(nomadServerId in this._ghosts)) {
+				this._nomad3DPositions.closeStream(handle);
+				return;
+			}
+
+			if (handle < 0) {
+				delete this._ghosts[nomadServerId];
+				console.error("Cannot stream the positions of the Nomad server " + nomadServerId);
+				return;
+			}
+
+			let ghost = new Ghost(this, config.ghostColor, config.ghostOpacity);
+			ghost.handle = handle;
+			this._sceneNode.parent.add(ghost.sceneNode);
+			this._ghosts[nomadServerId] = ghost;
+
+		}).catch((e) => {
+			delete this._ghosts[nomadServerId];
+			console.error(e);
+		});
+	}
+
+	hideGhost(nomadServerId) {
+
+		let ghost = this._ghosts[nomadServerId];
+		delete this._ghosts[nomadServerId];
+
+		// The stream still being opened is closed when it is.
+		if (ghost !== undefined && ghost !== null) {
+			this._nomad3DPositions.closeStream(ghost.handle);
+			ghost.dispose();
+			this._ghostsChanged = true;
+		}
+	}
+
+	hideGhosts() {
+		for (let nomadServerId in this._ghosts) {
+			this.hideGhost(nomadServerId);
+		}
+	}
+
+	/**
+	 * Moves the ghosts to the newest positions of their streams. Returns true if a ghost moved.
+	 * @param {Camera} camera 
+	 */
+	updateGhosts(camera) {
+
+		let changed = this._ghostsChanged;
+		this._ghostsChanged = false;
+
+		for (let nomadServerId in this._ghosts) {
+			let ghost = this._ghosts[nomadServerId];
+
+			if (ghost === null) {
+				continue;
+			}
+
+			let snapshot = this._nomad3DPositions.streamSnapshot(ghost.handle);
+
+			if (snapshot !== null) {
+				let axisNames = (snapshot.tableVersion !== ghost.tableVersion) ? this._nomad3DPositions.streamAxisNames(ghost.handle) : null;
+				ghost.setPositions(snapshot.positions, axisNames, snapshot.tableVersion);
+			}
+
+			changed = ghost.update(camera) || changed;
+		}
+
+		return changed;
+	}
+
+	/**
+	 * Updates the positions, the collisions and the LODs. Returns true if the scene changed and must be rendered.
+	 * @param {Camera} camera 
+	 */
 	update(camera) {
 
+		let changed = this.needsUpdate;
+
 		if (this.needsUpdate) {
 
 			if (this.root.getConfigurationByName(this.activeConfiguration) !== null) {
@@ -318,20 +905,57 @@ class Model {
 		// Update the positions.
 		this.updatePositionsAtFrequency();
 
-		// Always updated for LODs
-		this.root.update(camera, this._currentPositions);
+		if (this._collisionDetection !== null && this._collisionDetection.pipelineRunning) {
+			this.updatePipelineCollisions();
+		}
+
+		if (this._collisionDetection !== null && this._collisionDetection.lookaheadRunning) {
+			this.updateLookaheadCollisions();
+		}
+
+		// Always updated for LODs. The streamed positions are already applied to the controllers.
+		let positions = this._positionsApplied ? null : this._currentPositions;
+
+		if (this._transformTree !== null) {
+			this._transformTree.updateComponents(camera, positions);
+		}
+		else {
+			this.root.update(camera, positions);
+		}
 
 		if (this.needsUpdate) {
 
+			// New scene nodes may have been added to the components.
+			if (this._transformTree !== null) {
+				this._transformTree.invalidate();
+			}
+
 			// Bounding box.
 			if (this.boundingBox === null) {
 				this._boundingBox = new THREE.Box3();
 			}
 
 			this._boundingBox.setFromObject(this._sceneNode);
+
+			// The broad phase bodies are built once all the geometries are loaded.
+			if (this._collisionDetection !== null && config.broadPhase && this.geometriesLoaded) {
+				this.setBroadPhaseBodies();
+			}
 		}
 
 		this.needsUpdate = false;
+
+		changed = this.updateGhosts(camera) || changed;
+
+		// Moved components or new collision highlights.
+		changed = changed || this._collisionsChanged || this._transformTree === null || this._transformTree.moved;
+		this._collisionsChanged = false;
+
+		if (this._transformTree !== null) {
+			this._transformTree.clearMoved();
+		}
+
+		return changed;
 	}
 
 	showConfiguration(configName, recursive) {
@@ -354,6 +978,8 @@ class Model {
 		this._directoryPath = "";
 		this._geometryDirectories = "";
 		this._root = null;
+		this._geometries = {};
+		this._stlLoads = {};
 
 		// Create a new group.
 		this._sceneNode = new THREE.Group();
@@ -0,0 +1,14 @@
+const config = require('../../config');
+
+// Native loader and merger of the STL files. The geometries are merged in JS if it is not available.
+let NativeGeometry = null;
+
+try {
+	if (config.nativeGeometry) {
+		NativeGeometry = require('../../../build/Release/addonnomad3dgeometry');
+	}
+} catch (e) {
+	console.error(e);
+}
+
+module.exports = NativeGeometry;
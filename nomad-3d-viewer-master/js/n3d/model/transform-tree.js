@@ -0,0 +1,256 @@
+/**
+ *
+ * @class TransformTree
+ */
+const THREE = require('three');
+
+/**
+ * Flat view of the component tree in depth-first order. The world matrices are kept in a single array
+ * and only the subtrees of the components whose transform changed are recomputed.
+ */
+class TransformTree {
+
+	constructor(root) {
+		this._components = [];
+		this._parents = [];
+		this._ends = [];
+		this._controlled = [];
+		this._lods = [];
+
+		this.build(root, -1);
+
+		let count = this._components.length;
+
+		this._worldMatrices = new Float64Array(16 * count);
+		this._parentWorld = new Float64Array(16);
+		this._dirty = new Uint8Array(count);
+		this._dirtyIndices = [];
+		this._full = true;
+		this._moved = true;
+		this._componentNodes = new Set(this._components.map((component) => component.sceneNode));
+		this._updatedCount = 0;
+
+		for (let i = 0; i < count; i++) {
+			this._components[i].setTransformTree(this, i);
+		}
+	}
+
+	build(component, parentIndex) {
+
+		let index = this._components.length;
+
+		this._components.push(component);
+		this._parents.push(parentIndex);
+		this._ends.push(index + 1);
+
+		if (component.controller !== null) {
+			this._controlled.push(component);
+		}
+
+		// The children of a mergeable component are merged into its scene node.
+		if (component.isMergeable()) {
+			this._lods.push(component);
+		}
+		else {
+			for (let i = 0; i < component.children.length; i++) {
+				this.build(component.children[i], index);
+			}
+		}
+
+		this._ends[index] = this._components.length;
+	}
+
+	get count() {
+		return this._components.length;
+	}
+
+	set count(value) {
+		console.warn("TransformTree.count is a read-only property.");
+	}
+
+	/**
+	 * Tells whether world matrices must be recomputed.
+	 */
+	get dirty() {
+		return this._full || this._dirtyIndices.length > 0;
+	}
+
+	set dirty(value) {
+		console.warn("TransformTree.dirty is a read-only property.");
+	}
+
+	/**
+	 * Tells whether components moved since the last frame. Unlike dirty, it is not cleared by updateMatrixWorld
+	 * which may be called before the frame, for instance to find the collision candidates.
+	 */
+	get moved() {
+		return this._moved;
+	}
+
+	set moved(value) {
+		console.warn("TransformTree.moved is a read-only property.");
+	}
+
+	/**
+	 * Clears the moved flag once the frame is decided.
+	 */
+	clearMoved() {
+		this._moved = false;
+	}
+
+	/**
+	 * Gets the number of world matrices recomputed by the last update.
+	 */
+	get updatedCount() {
+		return this._updatedCount;
+	}
+
+	set updatedCount(value) {
+		console.warn("TransformTree.updatedCount is a read-only property.");
+	}
+
+	/**
+	 * Marks the subtree of a component dirty after its local transform changed.
+	 * @param {Number} index The tree index of the component
+	 */
+	markDirty(index) {
+		if (this._dirty[index] === 0) {
+			this._dirty[index] = 1;
+			this._dirtyIndices.push(index);
+		}
+		this._moved = true;
+	}
+
+	/**
+	 * Forces the update of the whole tree, for instance when scene nodes were added.
+	 */
+	invalidate() {
+		this._full = true;
+		this._moved = true;
+	}
+
+	/**
+	 * Updates the controllers with the positions and the LODs with the camera.
+	 * @param {Camera} camera
+	 * @param {Object|Float64Array} positions The positions, null if they are already applied
+	 */
+	updateComponents(camera, positions) {
+
+		if (positions !== null) {
+			for (let i = 0; i < this._controlled.length; i++) {
+				let controller = this._controlled[i].controller;
+				controller.update(controller.positionOf(positions));
+			}
+		}
+
+		if (camera !== undefined) {
+			for (let i = 0; i < this._lods.length; i++) {
+				this._lods[i].sceneNode.update(camera);
+			}
+		}
+	}
+
+	/**
+	 * Updates the world matrices of the dirty subtrees. It replaces updateMatrixWorld of the root scene node.
+	 */
+	updateMatrixWorld() {
+
+		this._updatedCount = 0;
+
+		if (this._components.length === 0) {
+			return;
+		}
+
+		// A change of the parent of the root, i.e. the model scene node, moves everything.
+		let parent = this._components[0].sceneNode.parent;
+		let parentElements = (parent !== null) ? parent.matrixWorld.elements : TransformTree.Identity.elements;
+
+		for (let i = 0; i < 16; i++) {
+			if (this._parentWorld[i] !== parentElements[i]) {
+				this._parentWorld.set(parentElements);
+				this._full = true;
+				break;
+			}
+		}
+
+		if (this._full) {
+			this.updateRange(0, this._components.length);
+			this._full = false;
+		}
+		else if (this._dirtyIndices.length > 0) {
+
+			// Parents come before their children, so that a range covers the dirty subtrees it contains.
+			this._dirtyIndices.sort((a, b) => a - b);
+
+			let end = 0;
+
+			for (let i = 0; i < this._dirtyIndices.length; i++) {
+				let index = this._dirtyIndices[i];
+				if (index >= end) {
+					end = this._ends[index];
+					this.updateRange(index, end);
+				}
+			}
+		}
+
+		for (let i = 0; i < this._dirtyIndices.length; i++) {
+			this._dirty[this._dirtyIndices[i]] = 0;
+		}
+		this._dirtyIndices.length = 0;
+	}
+
+	updateRange(start, end) {
+
+		for (let i = start; i < end; i++) {
+
+			let node = this._components[i].sceneNode;
+			let parentIndex = this._parents[i];
+
+			if (parentIndex < 0) {
+				TransformTree.multiply(this._parentWorld, 0, node.matrix.elements, this._worldMatrices, 0);
+			}
+			else {
+				TransformTree.multiply(this._worldMatrices, 16 * parentIndex, node.matrix.elements, this._worldMatrices, 16 * i);
+			}
+
+			let elements = node.matrixWorld.elements;
+			for (let j = 0; j < 16; j++) {
+				elements[j] = this._worldMatrices[16 * i + j];
+			}
+			node.matrixWorldNeedsUpdate = false;
+
+			// The other children (meshes, LOD levels) follow their component.
+			let children = node.children;
+			for (let j = 0; j < children.length; j++) {
+				if (!this._componentNodes.has(children[j])) {
+					children[j].updateMatrixWorld(true);
+				}
+			}
+		}
+
+		this._updatedCount += end - start;
+	}
+
+	/**
+	 * Multiplies the column-major matrices a and b into result at the offsets.
+	 */
+	static multiply(a, aOffset, b, result, offset) {
+
+		for (let column = 0; column < 4; column++) {
+
+			let b0 = b[4 * column];
+			let b1 = b[4 * column + 1];
+			let b2 = b[4 * column + 2];
+			let b3 = b[4 * column + 3];
+
+			for (let row = 0; row < 4; row++) {
+				result[offset + 4 * column + row] = a[aOffset + row] * b0 + a[aOffset + 4 + row] * b1
+					+ a[aOffset + 8 + row] * b2 + a[aOffset + 12 + row] * b3;
+			}
+		}
+	}
+}
+
+TransformTree.Identity = new THREE.Matrix4();
+
+module.exports = TransformTree;
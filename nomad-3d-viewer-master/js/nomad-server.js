@@ -14,22 +14,31 @@ class NomadServer {
 	constructor() {
 		
 		this._controller = {
-			Server: []
+			Server: [],
+			Ghost: []
 		}
 
 	}
 
-	resetServerIdMap() {
+	resetServerIdMap(simulatedServerIds) {
 
 		this._serverIdMap = {
 			"real" : 0
 		};
 
-		// Retrieve the list of simulated servers from the Cameo server.
-		let simulatedServerIds = NomadPositions.getSimulatedServerIds();
+		// Retrieve the cached list of simulated servers if it is not given. While it is pending, the watcher calls back once it is received.
+		if (simulatedServerIds === undefined) {
+			let list = NomadPositions.getSimulatedServerIds();
+			simulatedServerIds = list.ids;
+
+			if (list.pending) {
+				console.log("The simulated servers are being listed");
+			}
+		}
 
 		// Init the Server property.
 		this._controller.Server = ["real"];
+		this._controller.Ghost = ["none", "real"];
 
 		// Iterate the simulated server ids.
 		for (let i = 0; i < simulatedServerIds.length; i++) {
@@ -37,6 +46,7 @@ class NomadServer {
 			let simId = "sim " + id.toString();
 			this._serverIdMap[simId] = id;
 			this._controller.Server.push(simId);
+			this._controller.Ghost.push(simId);
 		}
 	}
 
@@ -44,19 +54,97 @@ class NomadServer {
 
 		// Init the addon.
 		if (NomadPositions !== null) {
+			NomadPositions.setPoolSize(config.positionsPoolSize);
+			NomadPositions.setSharedMemory(config.sharedMemory);
 			NomadPositions.init([config.localEndpoint, config.nomadEndpoint, config.name]);
+
+			// Append the latency histograms and counters of the addon to the stats file.
+			if (config.statsDumpPath !== null) {
+				NomadPositions.startStatsDump(config.statsDumpPath, config.statsDumpPeriod);
+			}
+
+			// Record every received snapshot into the binary log.
+			if (config.recordPath !== null) {
+				NomadPositions.startRecording(config.recordPath);
+			}
+
+			// Acquire the positions in the background at their own rate.
+			if (config.positionsPeriod > 0) {
+				NomadPositions.startStreaming(config.positionsPeriod);
+			}
 		
-			// Get the current simulated server list.
+			// The simulated servers are listed in the background, the combo is updated when they change.
 			this.resetServerIdMap([]);
 			this._currentServerId = this._controller.Server[0];
+			this._currentGhostId = this._controller.Ghost[0];
+			this.prestart();
+
+			NomadPositions.watchSimulatedServers(config.serverWatchPeriod, (simulatedServerIds) => {
+				this.updateServers(simulatedServerIds);
+			});
 		}
 	}
 
+	updateServers(simulatedServerIds) {
+
+		this.resetServerIdMap(simulatedServerIds);
+
+		// The ghost of a server that disappeared is hidden.
+		if (this._controller.Ghost.indexOf(this._currentGhostId) === -1) {
+			this._currentGhostId = this._controller.Ghost[0];
+			PubSub.publish('GHOST', null);
+		}
+
+		if (this._serversController !== undefined) {
+			this._nomadFolder.remove(this._serversController);
+			this._nomadFolder.remove(this._ghostController);
+			this.addCombo();
+			this.addGhostCombo();
+		}
+
+		this.prestart();
+	}
+
+	prestart() {
+
+		// Start the positions of the first servers in the background so that switching to them is immediate.
+		// The active instance keeps a place in the pool.
+		let ids = this._controller.Server.slice(0, config.positionsPoolSize - 1).map((server) => this._serverIdMap[server]);
+
+		if (ids.length > 0) {
+			NomadPositions.prestart(ids).catch((e) => {
+				console.error(e);
+			});
+		}
+	}
+
+	startCollisionForwarding(collisionServerName) {
+
+		// Forward the streamed positions to the collision server from the addon.
+		if (NomadPositions !== null && NomadPositions.isStreaming()) {
+			if (NomadPositions.startCollisionForwarding(collisionServerName)) {
+				console.info("Forwarding the positions to " + collisionServerName);
+			}
+		}
+	}
+
+	get stats() {
+		// Latency histograms, counters, gauges and last events of the addon.
+		return (NomadPositions !== null) ? NomadPositions.getStats() : null;
+	}
+
 	reset(nomadServerId) {
 
-		// Reset the addon.
+		// Reset the addon without blocking the UI: a pooled instance is swapped at once, otherwise it is started.
 		if (NomadPositions !== null) {
-			NomadPositions.reset(nomadServerId);
+			NomadPositions.resetAsync(nomadServerId).then((active) => {
+				// Null means that another server was selected meanwhile.
+				if (active === false) {
+					console.error("Cannot reset the positions to the Nomad server " + nomadServerId);
+				}
+			}).catch((e) => {
+				console.error(e);
+			});
 		}
 	}
 
@@ -71,6 +159,17 @@ class NomadServer {
 		}).bind(this));
 	}
 
+	addGhostCombo() {
+
+		// Show the positions of another server as a ghost of the model, for instance a simulation next to the real instrument.
+		this._ghostController = this._nomadFolder.add(this._controller, 'Ghost', this._controller.Ghost).setValue(this._currentGhostId).onChange(((ghostServerId) => {
+
+			PubSub.publish('GHOST', (ghostServerId in this._serverIdMap) ? this._serverIdMap[ghostServerId] : null);
+			this._currentGhostId = ghostServerId;
+
+		}).bind(this));
+	}
+
 	initGui(gui) {
 
 		// Create the GUI.
@@ -79,9 +178,9 @@ class NomadServer {
 
 			let refreshFunction = {
 				"Refresh": (() => {
-					this.resetServerIdMap();
-					this._nomadFolder.remove(this._serversController);
-					this.addCombo();
+					// Show the cached list at once, the watcher calls back if it changed.
+					NomadPositions.refreshSimulatedServers();
+					this.updateServers();
 
 				}).bind(this)
 			}
@@ -89,8 +188,9 @@ class NomadServer {
 			// Add refresh button.
 			this._nomadFolder.add(refreshFunction, "Refresh");
 
-			// Add the combo.
+			// Add the combos.
 			this.addCombo();
+			this.addGhostCombo();
 		}
 	}
 }
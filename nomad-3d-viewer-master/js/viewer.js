@@ -46,6 +46,9 @@ const Importer = require('./n3d/io/importer.js');
 const config = require('./config.js');
 const Lights = require('./lights.js');
 const Objects = require('./objects.js')
+const FrameScheduler = require('./frame-scheduler.js');
+const LogAnimator = require('./n3d/link/log-animator.js');
+const NativeGeometry = require('./n3d/model/native-geometry.js');
 
 let collisionDetection = null;
 if (config.collisionDetection) {
@@ -79,6 +82,14 @@ class Viewer {
 		this._play = true;
 		this._alertType = null;
 		this._alertPOS = null;
+		this._frameStats = { count: 0, totalMs: 0, maxMs: 0, startTime: 0 };
+		this._frameStart = 0;
+		this._scheduler = new FrameScheduler(this.update.bind(this), this.render.bind(this), {
+			frameTimeOut: config.frameTimeOut,
+			idlePeriod: config.minDeltaTime,
+			interactionPeriod: config.interactionPeriod,
+			maxFrameInterval: config.maxFrameInterval
+		});
 	}
 
 	init() {
@@ -88,8 +99,30 @@ class Viewer {
 		// Init Nomad server for positions.
 		this._nomad.init();
 
+		if (NativeGeometry !== null && config.statsDumpPath !== null) {
+			NativeGeometry.startStatsDump(config.statsDumpPath, config.statsDumpPeriod);
+		}
+
 		if (collisionDetection !== null) {
 			collisionDetection.init([config.localEndpoint, config.name, config.modelDirectoryPath, config.modelFileName, 0, config.collisionMargin, config.collisionGUI]);
+
+			if (config.statsDumpPath !== null) {
+				collisionDetection.startStatsDump(config.statsDumpPath, config.statsDumpPeriod);
+			}
+
+			if (config.fusedCollisions) {
+				this._nomad.startCollisionForwarding(config.collisionGUI ? "n3dcollisionsgui" : "n3dcollisions");
+			}
+
+			// Keep several collision requests in flight.
+			if (config.collisionPipelineDepth > 0) {
+				collisionDetection.startPipeline(config.collisionPipelineDepth);
+			}
+
+			// Check the future poses to pause before a collision.
+			if (config.lookaheadSteps > 0) {
+				collisionDetection.startLookahead(config.lookaheadSteps, config.lookaheadStepMs);
+			}
 		}
 
 		this.initRenderer();
@@ -114,12 +147,33 @@ class Viewer {
 			if(data == 'OK'){
 				this.alertOk();
 			}
+			this._scheduler.requestFrame();
 		});
 
 		this._nomad.initGui(this._gui);
+
+		// Show the model moved by the positions of another Nomad server as a ghost.
+		PubSub.subscribe('GHOST', (msg, nomadServerId) => {
+			if (this._model !== null) {
+				this._model.hideGhosts();
+				if (nomadServerId !== null) {
+					this._model.showGhost(nomadServerId);
+				}
+			}
+			this._scheduler.requestFrame();
+		});
+
+		// Replay a recorded positions log instead of the Nomad positions.
+		if (config.replayPath !== null) {
+			this._animator = new LogAnimator(config.replayPath, config.replaySpeed, config.replayLoop);
+			this._animator.initGui(this._gui);
+		}
 		
 		window.addEventListener('resize', this.onWindowResize.bind(this), false);
 		window.addEventListener('keydown', this.onDocumentKeyDown.bind(this), false);
+
+		// The user inputs on the canvas and the GUI render the next frames.
+		this._scheduler.listen(window);
 	}
 
 	printComponent(component) {
@@ -130,23 +184,21 @@ class Viewer {
 	}
 
 	animate() {
+		this._scheduler.start();
+	}
 
-		if (!this._play) {
-			setTimeout(() => {
-				requestAnimationFrame(this.animate.bind(this));
-			}, 2000);
-		}
-		else {
-			if (this._frameTimeOut == 0) {
-				requestAnimationFrame(this.animate.bind(this));
-			}
-			else {
-				setTimeout(() => {
-					requestAnimationFrame(this.animate.bind(this));
-				}, this._frameTimeOut);
-			}
-		}
+	get frameScheduler() {
+		return this._scheduler;
+	}
+
+	/**
+	 * Updates the scene at each tick of the scheduler. Returns true if the scene changed and must be rendered.
+	 */
+	update() {
+
+		this._frameStart = performance.now();
 
+		let changed = false;
 
 		this._controls.update();
 		this._lights.updateLightSpheres(this._gui);
@@ -156,14 +208,14 @@ class Viewer {
 			if (this._animator !== null) {
 				this._animator.update();
 			}
-			this._model.update(this._camera);
+			changed = this._model.update(this._camera) || changed;
 		}
 		if (this._objects.objects !== []) {
 			if (this._animator !== null) {
 				this._animator.update();
 			}
 			for (let i = 0; i < this._objects.objects.length; i++) {
-				this._objects.objects[i].model.update(this._camera);
+				changed = this._objects.objects[i].model.update(this._camera) || changed;
 			}
 
 		}
@@ -171,6 +223,7 @@ class Viewer {
 		this._objects.checkFolders();
 		for(let j = 0; j < this._objects.positioning.length; j++){
 			if (this._objects.positioning[j] && collisionDetection != null) {
+				changed = true;
 				if(this._objects.objectsFallDirection[j] == 'Rx+')
 						this._objects.objectsCenter[j].position.x += 0.05;
 
@@ -202,21 +255,68 @@ class Viewer {
 			}
 		}
 
-		this._renderer.render(this._scene, this._camera);
+		return changed;
+	}
 
+	render() {
+
+		this._renderer.render(this._scene, this._camera);
 
 		if (this._statsEnabled) {
 			this._stats.update();
+			this.updateFrameStats(this._frameStart, performance.now());
 		}
 
 	}
 
+	updateFrameStats(frameStart, frameEnd) {
+
+		let frameTimeMs = frameEnd - frameStart;
+
+		this._frameStats.count++;
+		this._frameStats.totalMs += frameTimeMs;
+		this._frameStats.maxMs = Math.max(this._frameStats.maxMs, frameTimeMs);
+
+		// Report the frame times with the request latencies every 5 seconds.
+		if (frameEnd - this._frameStats.startTime > 5000) {
+
+			if (this._model !== null && this._frameStats.count > 0) {
+				console.info("frame time avg " + (this._frameStats.totalMs / this._frameStats.count).toFixed(2) + " ms"
+					+ ", max " + this._frameStats.maxMs.toFixed(2) + " ms"
+					+ ", positions latency " + this._model.positionsLatency.toFixed(2) + " ms"
+					+ ", collisions latency " + this._model.collisionsLatency.toFixed(2) + " ms"
+					+ ", rendered " + this._scheduler.rendered + ", skipped " + this._scheduler.skipped);
+			}
+
+			// Structured line with the stats of the addons. The times are wall clock ms like the events of the addons.
+			if (this._frameStats.count > 0) {
+				console.info(JSON.stringify({
+					time: Date.now(),
+					frame: {
+						count: this._frameStats.count,
+						avgMs: this._frameStats.totalMs / this._frameStats.count,
+						maxMs: this._frameStats.maxMs,
+						rendered: this._scheduler.rendered,
+						skipped: this._scheduler.skipped
+					},
+					positions: this._nomad.stats,
+					collisions: (collisionDetection !== null) ? collisionDetection.getStats() : null,
+					geometry: (NativeGeometry !== null) ? NativeGeometry.getStats() : null
+				}));
+			}
+
+			this._frameStats = { count: 0, totalMs: 0, maxMs: 0, startTime: frameEnd };
+			this._scheduler.resetStats();
+		}
+	}
+
 	onWindowResize(event) {
 		let screenWidth = window.innerWidth;
 		let screenHeight = window.innerHeight;
 		this._renderer.setSize(screenWidth, screenHeight);
 		this._camera.aspect = screenWidth / screenHeight;
 		this._camera.updateProjectionMatrix();
+		this._scheduler.requestFrame();
 	}
 
 	onDocumentKeyDown(event) {
@@ -226,7 +326,9 @@ class Viewer {
 
 		switch (keycode) {
 			case 83:
-				this._animator.started = true;
+				if (this._animator !== null) {
+					this._animator.started = !this._animator.started;
+				}
 				break;
 		}
 	}
@@ -254,6 +356,11 @@ class Viewer {
 		// When I set the screenSpacePanning property of OrbitControls to true,
 		// Zooming in to a certain level, zooming and panning become very, very slow
 		this._controls.screenSpacePanning = false;
+
+		// The damping keeps moving the camera after the inputs.
+		this._controls.addEventListener('change', () => {
+			this._scheduler.interact();
+		});
 	}
 
 	initRenderer() {
@@ -395,7 +502,10 @@ class Viewer {
 			Reflection: false,
 			DynamicShadows: false,
 			"FrameTimeOut": this._frameTimeOut,
-			"Play / Pause": () => { this._play = !this._play}
+			"Play / Pause": () => {
+				this._play = !this._play;
+				this._scheduler.playing = this._play;
+			}
 		};
 
 		const view = this._gui.addFolder("View");
@@ -409,6 +519,7 @@ class Viewer {
 		graphics.add(this._effectController, "DynamicShadows").onChange(this.qualityChanger.bind(this)).listen();
 		graphics.add(this._effectController, "FrameTimeOut").min(0).max(100).step(0.5).onChange((val) => {
 			this._frameTimeOut = val;
+			this._scheduler.frameTimeOut = val;
 		});
 
 
@@ -0,0 +1,131 @@
+#include "collision-forwarder.h"
+
+using namespace std;
+
+namespace nomad {
+
+CollisionForwarder::CollisionForwarder() :
+	m_running(false),
+	m_pendingSequence(0),
+	m_replaced(0) {
+}
+
+CollisionForwarder::~CollisionForwarder() {
+	stop();
+}
+
+void CollisionForwarder::start(RequestFunction request) {
+
+	stop();
+
+	m_request = request;
+	m_checkedValues.clear();
+	m_running = true;
+	m_thread = thread(&CollisionForwarder::run, this);
+
+	event("collision-forwarder-started");
+}
+
+void CollisionForwarder::stop() {
+
+	if (!m_thread.joinable()) {
+		return;
+	}
+
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_running = false;
+	}
+	m_condition.notify_one();
+	m_thread.join();
+
+	event("collision-forwarder-stopped");
+}
+
+bool CollisionForwarder::isRunning() const {
+	return m_running;
+}
+
+void CollisionForwarder::submit(const PositionSnapshot& snapshot) {
+
+	if (!m_running) {
+		return;
+	}
+
+	{
+		// A snapshot that was not checked yet is replaced by the newer one.
+		lock_guard<mutex> lock(m_mutex);
+		if (m_pendingSequence != 0) {
+			++m_replaced;
+		}
+		m_pendingJson = snapshot.json;
+		m_pendingValues = *snapshot.values;
+		m_pendingSequence = snapshot.sequence;
+	}
+	m_condition.notify_one();
+}
+
+bool CollisionForwarder::update() {
+	return m_verdicts.update();
+}
+
+const CollisionVerdict& CollisionForwarder::verdict() const {
+	return m_verdicts.front();
+}
+
+uint64_t CollisionForwarder::replaced() const {
+	return m_replaced;
+}
+
+void CollisionForwarder::run() {
+
+	string json;
+	vector<double> values;
+	string message;
+
+	while (true) {
+
+		uint64_t sequence;
+		{
+			unique_lock<mutex> lock(m_mutex);
+			m_condition.wait(lock, [this] { return !m_running || m_pendingSequence != 0; });
+
+			if (!m_running) {
+				return;
+			}
+
+			json.swap(m_pendingJson);
+			values.swap(m_pendingValues);
+			sequence = m_pendingSequence;
+			m_pendingSequence = 0;
+		}
+
+		// The collision server already has the state if no axis moved.
+		if (values == m_checkedValues) {
+			continue;
+		}
+
+		message = "{\"type\":\"COLLISIONS\",\"positions\":";
+		message += json;
+		message += "}";
+
+		CollisionVerdict& verdict = m_verdicts.back();
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+		try {
+			m_request(message, verdict.response);
+		}
+		catch (const exception& e) {
+			event("collision-forwarder-failed", {{"error", e.what()}});
+			continue;
+		}
+
+		verdict.sequence = sequence;
+		verdict.latencyMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		m_verdicts.publish();
+
+		m_checkedValues.swap(values);
+	}
+}
+
+}
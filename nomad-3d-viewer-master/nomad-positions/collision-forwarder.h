@@ -0,0 +1,88 @@
+#ifndef NOMAD_COLLISIONFORWARDER_H
+#define NOMAD_COLLISIONFORWARDER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "addon-stats.h"
+#include "position-stream.h"
+#include "triple-buffer.h"
+
+namespace nomad {
+
+/**
+ * Collision verdict for a position snapshot.
+ */
+struct CollisionVerdict {
+	std::string response;
+	uint64_t sequence;
+	double latencyMs;
+
+	CollisionVerdict() : sequence(0), latencyMs(0.0) {}
+};
+
+/**
+ * Forwards the streamed position snapshots to the collision server from its own thread.
+ * Only the newest snapshot is checked and only if an axis moved since the last check.
+ * The verdicts are published into a triple buffer read by the JS thread.
+ */
+class CollisionForwarder : public EventSource {
+
+public:
+	/**
+	 * The request function sends the request and fills the response.
+	 */
+	typedef std::function<void (const std::string&, std::string&)> RequestFunction;
+
+	CollisionForwarder();
+	~CollisionForwarder();
+
+	void start(RequestFunction request);
+	void stop();
+	bool isRunning() const;
+
+	/**
+	 * Submits a snapshot. Called by the stream thread, never waits on the collision server.
+	 */
+	void submit(const PositionSnapshot& snapshot);
+
+	/**
+	 * Takes the newest verdict. Returns true if it changed since the last call.
+	 * Only called by the JS thread.
+	 */
+	bool update();
+
+	const CollisionVerdict& verdict() const;
+
+	/**
+	 * Gets the number of snapshots replaced by a newer one before being checked.
+	 */
+	uint64_t replaced() const;
+
+private:
+	void run();
+
+	RequestFunction m_request;
+	std::atomic<bool> m_running;
+	std::thread m_thread;
+
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::string m_pendingJson;
+	std::vector<double> m_pendingValues;
+	uint64_t m_pendingSequence;
+	std::atomic<uint64_t> m_replaced;
+
+	std::vector<double> m_checkedValues;
+	TripleBuffer<CollisionVerdict> m_verdicts;
+};
+
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include <node.h>
+#include <node_buffer.h>
 #include <iostream>
 #include <unistd.h>
 #include <uv.h>
@@ -6,7 +7,22 @@
 #include <sstream>
 #include <functional>
 #include <string>
+#include <mutex>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <set>
+#include <atomic>
+#include <condition_variable>
+#include <stdexcept>
 #include <cameo/cameo.h>
+#include "position-stream.h"
+#include "collision-forwarder.h"
+#include "server-watcher.h"
+#include "positions-log.h"
+#include "positions-json.h"
+#include "shared-ring.h"
+#include "addon-stats.h"
 
 using namespace std;
 using namespace std::placeholders;
@@ -26,22 +42,367 @@ using v8::Integer;
 using v8::Boolean;
 using v8::Array;
 using v8::Persistent;
+using v8::Promise;
+using v8::Exception;
+using v8::ArrayBuffer;
+using v8::Uint8Array;
+using v8::Float64Array;
+using v8::Int32Array;
 
 unique_ptr<cameo::Server> server;
 unique_ptr<cameo::Server> remoteServer;
-unique_ptr<cameo::application::Instance> nomad3DPositions;
-unique_ptr<cameo::application::Requester> requester;
 Isolate * v8Isolate;
 
+/**
+ * Started n3dpositions instance with its requesters.
+ * The synchronous functions of the JS thread use the requester, the worker threads (async requests and streams) use
+ * the worker requester, so that the JS thread never waits for a request in flight on a worker. The requests of each
+ * requester are serialised by its mutex.
+ */
+struct PositionsInstance {
+	string appArgs;
+	unique_ptr<cameo::application::Instance> instance;
+	unique_ptr<cameo::application::Requester> requester;
+	mutex requestMutex;
+	unique_ptr<cameo::application::Requester> workerRequester;
+	mutex workerRequestMutex;
+	uint64_t lastUsed;
+	int streamCount;
+
+	PositionsInstance() : lastUsed(0), streamCount(0) {}
+};
+
+// Pool of the started instances by their arguments. The least recently used ones are stopped beyond the pool size.
+// The arguments of the instances being started are kept so that an instance is started once.
+vector<shared_ptr<PositionsInstance> > pool;
+shared_ptr<PositionsInstance> activeInstance;
+size_t poolSize = 4;
+uint64_t poolClock = 0;
+set<string> startingInstances;
+condition_variable poolCondition;
+mutex poolMutex;
+
+// Generation of the last reset. A reset only activates its instance if no other reset started meanwhile.
+atomic<uint64_t> resetGeneration(0);
+
+// Id of the real Nomad server.
+const string REAL_SERVER_ID = "0";
+
+// Requester of the active instance used by the synchronous functions. The workers only take the active instance under the mutex.
+cameo::application::Requester * requester = 0;
+mutex requesterMutex;
+
+// Round trip time of the last async positions request.
+double lastLatencyMs = 0.0;
+
+// Background stream of positions.
+PositionStream positionStream;
+
+// Collision server requester used to forward the streamed positions.
+unique_ptr<cameo::application::Instance> collisionServer;
+unique_ptr<cameo::application::Requester> collisionRequester;
+mutex collisionRequesterMutex;
+CollisionForwarder collisionForwarder;
+
+// Positions delivered by the last call to getPositionChanges.
+vector<double> deliveredValues;
+uint32_t deliveredTableVersion = 0;
+uint64_t deliveredSequence = 0;
+
+// Watcher of the simulated servers on the remote server. The remote server is only used by the watcher thread once it is started.
+ServerWatcher simulatedServerWatcher;
+mutex remoteServerMutex;
+uv_async_t simulatedServersAsync;
+bool simulatedServersAsyncInitialised = false;
+Persistent<Function> simulatedServersCallback;
+
+// Recorder of the received snapshots.
+PositionsRecorder recorder;
+
+// Replay of a positions log. The replay time runs at the speed from the origin time set at the anchor.
+PositionsReplay replay;
+mutex replayMutex;
+double replaySpeed = 1.0;
+bool replayLoop = false;
+int64_t replayOriginUs = 0;
+chrono::steady_clock::time_point replayAnchor;
+vector<double> replayValues;
+
+/**
+ * Position stream of a Nomad server opened by JS next to the active one, for instance a simulation shown as a ghost.
+ * Each stream has its own thread, requester and latest snapshot so that the servers are requested in parallel.
+ * The stream is declared last so that its thread is stopped before the instance is released.
+ */
+struct PositionsStreamHandle {
+	string nomadId;
+	shared_ptr<PositionsInstance> instance;
+	shared_ptr<SharedRingReader> ring;
+	uint64_t deliveredSequence;
+	PositionStream stream;
+
+	PositionsStreamHandle() : deliveredSequence(0) {}
+};
+
+map<int, shared_ptr<PositionsStreamHandle> > streamHandles;
+mutex streamHandlesMutex;
+int nextStreamHandle = 1;
+
+// Shared memory rings of the servers running on the same host. They are found by the ids of the Cameo instances.
+// The positions ring is only read by the stream thread, the collision rings by the forwarder thread.
+bool sharedMemory = false;
+shared_ptr<SharedRingReader> positionsRing;
+mutex positionsRingMutex;
+unique_ptr<SharedRingWriter> collisionPositionsRing;
+unique_ptr<SharedRingReader> collisionVerdictsRing;
+const uint32_t COLLISION_RING_SLOTS = 4;
+const uint32_t COLLISION_RING_SLOT_SIZE = 256 * 1024;
+const chrono::milliseconds COLLISION_RING_TIMEOUT(1000);
+// Successive timeouts after which a collision server that is alive but does not answer is requested through Cameo.
+const int COLLISION_RING_MAX_TIMEOUTS = 3;
+int collisionRingTimeouts = 0;
+
+// Latency histograms, counters and events. The histograms of the hot paths are kept by reference.
+AddonStats stats("positions");
+LatencyHistogram& positionsHistogram = stats.histogram("POSITIONS");
+LatencyHistogram& pauseHistogram = stats.histogram("PAUSE");
+LatencyHistogram& restartHistogram = stats.histogram("RESTART");
+LatencyHistogram& collisionsHistogram = stats.histogram("COLLISIONS");
+LatencyHistogram& sharedPositionsHistogram = stats.histogram("POSITIONS.shm");
+LatencyHistogram& sharedCollisionsHistogram = stats.histogram("COLLISIONS.shm");
+LatencyHistogram& decodeHistogram = stats.histogram("positions.decode");
+LatencyHistogram& queueHistogram = stats.histogram("async.queue");
+LatencyHistogram& resetHistogram = stats.histogram("reset");
+LatencyHistogram& startHistogram = stats.histogram("instance.start");
+atomic<uint64_t>& bytesSent = stats.counter("bytes.sent");
+atomic<uint64_t>& bytesReceived = stats.counter("bytes.received");
+atomic<uint64_t>& snapshotCount = stats.counter("stream.snapshots");
+Gauge& asyncRequests = stats.gauge("async.requests");
+Gauge& poolGauge = stats.gauge("pool.instances");
+Gauge& streamsGauge = stats.gauge("streams");
+
 string nomadEndpoint;
 std::string NOMAD3DPOSITIONS = "n3dpositions";
+std::string NOMADSIMULATOR = "nssim";
+
+/**
+ * Formats the object as it is written to a stream.
+ */
+template<typename Type>
+static string ToString(const Type& object) {
+	ostringstream text;
+	text << object;
+	return text.str();
+}
+
+/**
+ * Starts a nomad 3D positions instance with the arguments and creates its requester.
+ * Returns null if the instance or the requester cannot be created.
+ */
+static shared_ptr<PositionsInstance> StartInstance(const string& appArgs) {
+
+	shared_ptr<PositionsInstance> instance(new PositionsInstance());
+	instance->appArgs = appArgs;
+
+	vector<string> args;
+	args.push_back(appArgs);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	instance->instance = server->start(NOMAD3DPOSITIONS, args);
+
+	if (!instance->instance->exists()) {
+		stats.event("start-failed", {{"appArgs", appArgs}});
+		return shared_ptr<PositionsInstance>();
+	}
+
+	// Create the requesters
+	instance->requester = cameo::application::Requester::create(*instance->instance, "get_positions");
+	instance->workerRequester = cameo::application::Requester::create(*instance->instance, "get_positions");
+
+	startHistogram.record(start, chrono::steady_clock::now());
+	stats.event("instance-started", {{"appArgs", appArgs}, {"instance", ToString(*instance->instance)}});
+
+	if (instance->requester.get() == 0 || instance->workerRequester.get() == 0) {
+		stats.event("requester-failed", {{"appArgs", appArgs}});
+		instance->instance->kill();
+		instance->instance->waitFor();
+		return shared_ptr<PositionsInstance>();
+	}
+
+	return instance;
+}
+
+/**
+ * Gets the pooled instance with the arguments or starts it. The start takes time and must not run on the JS thread
+ * except at init.
+ */
+static shared_ptr<PositionsInstance> AcquireInstance(const string& appArgs) {
+
+	shared_ptr<PositionsInstance> instance;
+
+	{
+		unique_lock<mutex> lock(poolMutex);
+
+		// Wait for the instance if it is being started by another thread.
+		while (true) {
+			for (size_t i = 0; i < pool.size(); ++i) {
+				if (pool[i]->appArgs == appArgs) {
+					instance = pool[i];
+					instance->lastUsed = ++poolClock;
+					return instance;
+				}
+			}
+
+			if (startingInstances.count(appArgs) == 0) {
+				break;
+			}
+
+			poolCondition.wait(lock);
+		}
+
+		startingInstances.insert(appArgs);
+	}
+
+	// Start the instance outside the lock so that the other instances remain usable.
+	try {
+		instance = StartInstance(appArgs);
+	}
+	catch (...) {
+		{
+			lock_guard<mutex> lock(poolMutex);
+			startingInstances.erase(appArgs);
+		}
+		poolCondition.notify_all();
+		throw;
+	}
+
+	{
+		lock_guard<mutex> lock(poolMutex);
+
+		startingInstances.erase(appArgs);
+
+		if (instance.get() != 0) {
+			instance->lastUsed = ++poolClock;
+			pool.push_back(instance);
+			poolGauge.set(pool.size());
+		}
+	}
+	poolCondition.notify_all();
+
+	return instance;
+}
+
+/**
+ * Stops the least recently used instances beyond the pool size. The active instance and the instances of the open
+ * streams are kept.
+ */
+static void EvictInstances() {
+
+	vector<shared_ptr<PositionsInstance> > evicted;
+
+	{
+		lock_guard<mutex> lock(poolMutex);
+
+		while (pool.size() > poolSize) {
+
+			size_t oldest = pool.size();
+
+			for (size_t i = 0; i < pool.size(); ++i) {
+				if (pool[i] != activeInstance && pool[i]->streamCount == 0 && (oldest == pool.size() || pool[i]->lastUsed < pool[oldest]->lastUsed)) {
+					oldest = i;
+				}
+			}
+
+			if (oldest == pool.size()) {
+				break;
+			}
+
+			evicted.push_back(pool[oldest]);
+			pool.erase(pool.begin() + oldest);
+		}
+
+		poolGauge.set(pool.size());
+	}
+
+	for (size_t i = 0; i < evicted.size(); ++i) {
+		// A worker may still use the requesters of an instance that was active.
+		{
+			lock_guard<mutex> lock(evicted[i]->requestMutex);
+			evicted[i]->requester.reset();
+		}
+		{
+			lock_guard<mutex> lock(evicted[i]->workerRequestMutex);
+			evicted[i]->workerRequester.reset();
+		}
+		evicted[i]->instance->kill();
+		cameo::application::State state = evicted[i]->instance->waitFor();
+		stats.event("instance-stopped", {{"appArgs", evicted[i]->appArgs}, {"state", cameo::application::toString(state)}});
+	}
+}
+
+/**
+ * Opens the ring of the positions published by the instance if the shared memory is enabled.
+ * Returns null if the instance does not publish its positions in shared memory.
+ */
+static shared_ptr<SharedRingReader> OpenPositionsRing(PositionsInstance& instance) {
+
+	shared_ptr<SharedRingReader> ring;
+
+	if (!sharedMemory) {
+		return ring;
+	}
+
+	ring = make_shared<SharedRingReader>();
+
+	if (!ring->open(SharedRing::positionsName(instance.instance->getId())) || !ring->isWriterAlive()) {
+		ring.reset();
+	}
+
+	return ring;
+}
+
+/**
+ * Makes the instance serve the requests. The requester is swapped between two requests.
+ * The instance is not activated if a reset newer than the generation started meanwhile. Returns false in that case.
+ */
+static bool ActivateInstance(shared_ptr<PositionsInstance> instance, uint64_t generation) {
+
+	shared_ptr<SharedRingReader> ring = OpenPositionsRing(*instance);
+
+	{
+		lock_guard<mutex> lock(requesterMutex);
+		lock_guard<mutex> poolLock(poolMutex);
+
+		if (generation != resetGeneration) {
+			return false;
+		}
+
+		activeInstance = instance;
+		requester = instance->requester.get();
+
+		lock_guard<mutex> ringLock(positionsRingMutex);
+		positionsRing = ring;
+	}
+
+	if (ring) {
+		stats.event("shared-memory", {{"name", ring->name()}});
+	}
+
+	EvictInstances();
+
+	return true;
+}
+
+static string NomadAppArgs(const string& nomadId) {
+	return nomadEndpoint + "," + nomadId;
+}
 
 /**
  * Init function to initialise the Cameo Nomad addon.
  */
 void Init(const FunctionCallbackInfo<Value>& args) {
 
-	cout << "initialising nomad positions" << endl;
+	stats.event("init");
 
 	// Get the V8 isolate.
 	v8Isolate = args.GetIsolate();
@@ -50,27 +411,21 @@ void Init(const FunctionCallbackInfo<Value>& args) {
 	v8::String::Utf8Value param1(args[0]->ToString());
 	string electronArgs(*param1);
 
-	cout << "electron args = " << electronArgs << endl;
-
 	size_t pos = 0;
 
 	// Parse the args.
 	size_t endPos = electronArgs.find_first_of(',', pos);
 	string localEndpoint = electronArgs.substr(pos, endPos - pos);
 
-	cout << "local endpoint = " << localEndpoint << endl;
-
 	pos = endPos + 1;
 	endPos = electronArgs.find_first_of(',', pos);
 	nomadEndpoint = electronArgs.substr(pos, endPos - pos);
 
-	cout << "nomad endpoint = " << nomadEndpoint << endl;
-
 	pos = endPos + 1;
 	endPos = electronArgs.find_first_of(',', pos);
 	string name = electronArgs.substr(pos, endPos - pos + 1);
 
-	cout << "name = " << name << endl;
+	stats.event("args", {{"electronArgs", electronArgs}, {"localEndpoint", localEndpoint}, {"nomadEndpoint", nomadEndpoint}, {"name", name}});
 
 	// Init the app if it is not already done.
 	if (cameo::application::This::getId() == -1) {
@@ -83,145 +438,1477 @@ void Init(const FunctionCallbackInfo<Value>& args) {
 
 		cameo::application::This::init(1, argv);
 
-		cout << "initialised cameo" << endl;
+		stats.event("cameo-initialised");
 	}
 
     // Init nomad3d positions.
     server.reset(new cameo::Server(cameo::application::This::getServer().getEndpoint()));
 
-    cout << "cameo server " << *server << endl;
+    stats.event("cameo-server", {{"server", ToString(*server)}});
 
-    nomad3DPositions = server->connect(NOMAD3DPOSITIONS);
-	if (nomad3DPositions->exists()) {
-		// The application exists from a previous server session
-		nomad3DPositions->kill();
-		cameo::application::State state = nomad3DPositions->waitFor();
-		cout << "terminated old nomad 3D positions with state " << cameo::application::toString(state) << endl;
+	// The applications exist from a previous server session.
+	{
+		lock_guard<mutex> lock(streamHandlesMutex);
+		streamHandles.clear();
+		streamsGauge.set(0);
 	}
 
-	vector<string> appArgs;
-    appArgs.push_back(nomadEndpoint);
+	{
+		lock_guard<mutex> lock(requesterMutex);
+		lock_guard<mutex> poolLock(poolMutex);
+
+		requester = 0;
+		activeInstance.reset();
+		pool.clear();
+	}
 
-    nomad3DPositions = server->start(NOMAD3DPOSITIONS, appArgs);
+	cameo::application::InstanceArray oldInstances = server->connectAll(NOMAD3DPOSITIONS);
 
-	if (!nomad3DPositions->exists()) {
-		cout << "no nomad 3D positions" << endl;
+	for (size_t i = 0; i < oldInstances.size(); ++i) {
+		oldInstances[i]->kill();
+		cameo::application::State state = oldInstances[i]->waitFor();
+		stats.event("old-instance-terminated", {{"state", cameo::application::toString(state)}});
 	}
-    else {
-        cout << "nomad 3D positions " << *nomad3DPositions << endl;
-    }
 
-    // Create the requester
-	requester = cameo::application::Requester::create(*nomad3DPositions, "get_positions");
+	// The real server has the same arguments as when it is selected again, so that it is started once.
+	uint64_t generation = ++resetGeneration;
+	shared_ptr<PositionsInstance> instance = AcquireInstance(NomadAppArgs(REAL_SERVER_ID));
 
-	if (requester.get() == 0) {
-		cout << "cannot create requester" << endl;
+	if (instance.get() == 0) {
+		stats.event("init-failed");
 		return;
 	}
 
+	ActivateInstance(instance, generation);
+
+	stats.event("initialised", {{"appArgs", instance->appArgs}});
+
 	// Create the remote server.
-	remoteServer.reset(new cameo::Server(nomadEndpoint));
+	{
+		lock_guard<mutex> lock(remoteServerMutex);
+		remoteServer.reset(new cameo::Server(nomadEndpoint));
+	}
 
 	args.GetReturnValue().Set(Undefined(v8Isolate));
 }
 
 /**
- * Reset function to reset the Cameo Nomad addon to a new Nomad server.
+ * Work structure used to start the instances on the libuv thread pool.
+ */
+struct ResetWork {
+	uv_work_t request;
+	Persistent<Promise::Resolver> resolver;
+	vector<string> nomadIds;
+	bool activate;
+	uint64_t generation;
+	bool done;
+	bool superseded;
+};
+
+static void ResetWorkAsync(uv_work_t *req) {
+
+	ResetWork *work = static_cast<ResetWork *>(req->data);
+
+	work->done = false;
+
+	for (size_t i = 0; i < work->nomadIds.size(); ++i) {
+
+		try {
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+			shared_ptr<PositionsInstance> instance = AcquireInstance(NomadAppArgs(work->nomadIds[i]));
+
+			if (instance.get() != 0) {
+				work->done = true;
+
+				// A newer reset started meanwhile: its server is kept.
+				if (work->activate && !ActivateInstance(instance, work->generation)) {
+					work->superseded = true;
+					stats.event("reset-superseded", {{"nomadId", work->nomadIds[i]}});
+				}
+				else if (work->activate) {
+					resetHistogram.record(start, chrono::steady_clock::now());
+					stats.event("reset-done", {{"nomadId", work->nomadIds[i]}});
+				}
+			}
+		}
+		catch (const exception& e) {
+			stats.event("start-failed", {{"nomadId", work->nomadIds[i]}, {"error", e.what()}});
+		}
+	}
+
+	EvictInstances();
+}
+
+static void ResetWorkAsyncComplete(uv_work_t *req, int status) {
+
+	Isolate * isolate = Isolate::GetCurrent();
+
+	v8::HandleScope handleScope(isolate);
+
+	ResetWork *work = static_cast<ResetWork *>(req->data);
+
+	node::CallbackScope callbackScope(isolate, Object::New(isolate), {0, 0});
+
+	Local<Context> context = isolate->GetCurrentContext();
+	Local<Promise::Resolver> resolver = Local<Promise::Resolver>::New(isolate, work->resolver);
+
+	if (work->superseded) {
+		resolver->Resolve(context, v8::Null(isolate)).FromJust();
+	}
+	else {
+		resolver->Resolve(context, Boolean::New(isolate, work->done)).FromJust();
+	}
+
+	work->resolver.Reset();
+	delete work;
+}
+
+static void QueueReset(const FunctionCallbackInfo<Value>& args, const vector<string>& nomadIds, bool activate) {
+
+	Isolate * isolate = args.GetIsolate();
+	Local<Promise::Resolver> resolver = Promise::Resolver::New(isolate->GetCurrentContext()).ToLocalChecked();
+
+	stats.event(activate ? "reset" : "prestart", {{"nomadIds", ToString(nomadIds.size())}});
+
+	ResetWork * work = new ResetWork();
+
+	work->request.data = work;
+	work->resolver.Reset(isolate, resolver);
+	work->nomadIds = nomadIds;
+	work->activate = activate;
+	work->generation = activate ? ++resetGeneration : 0;
+	work->done = false;
+	work->superseded = false;
+
+	uv_queue_work(uv_default_loop(), &work->request, ResetWorkAsync, ResetWorkAsyncComplete);
+
+	args.GetReturnValue().Set(resolver->GetPromise());
+}
+
+/**
+ * Resets the addon to a new Nomad server without blocking the JS thread. The pooled instance of the server is
+ * activated at once, otherwise it is started. Returns a promise resolved with true if the server is active,
+ * false if it cannot be started and null if a newer reset started meanwhile so that this server is not activated.
  */
-void Reset(const FunctionCallbackInfo<Value>& args) {
+void ResetAsync(const FunctionCallbackInfo<Value>& args) {
 
 	v8::String::Utf8Value param0(args[0]->ToString());
-	std::string nomadId(*param0);
 
-	cout << "resetting nomad positions with nomad " << nomadId << endl;
+	vector<string> nomadIds;
+	nomadIds.push_back(*param0);
 
-	requester.reset();
+	QueueReset(args, nomadIds, true);
+}
 
-    nomad3DPositions = server->connect(NOMAD3DPOSITIONS);
-	if (nomad3DPositions->exists()) {
-		// The application exists from a previous server session
-		nomad3DPositions->kill();
-		cameo::application::State state = nomad3DPositions->waitFor();
-		cout << "terminated old nomad 3D positions with state " << cameo::application::toString(state) << endl;
-	}
+/**
+ * Starts in the background the instances of the Nomad servers with the ids so that a later reset is immediate.
+ * Returns a promise resolved once they are started.
+ */
+void Prestart(const FunctionCallbackInfo<Value>& args) {
 
-	vector<string> appArgs;
-    appArgs.push_back(nomadEndpoint + "," + nomadId);
+	Local<Context> context = args.GetIsolate()->GetCurrentContext();
+	Local<Array> array = Local<Array>::Cast(args[0]);
 
-    nomad3DPositions = server->start(NOMAD3DPOSITIONS, appArgs);
+	vector<string> nomadIds;
 
-	if (!nomad3DPositions->exists()) {
-		cout << "no nomad 3D positions" << endl;
+	for (uint32_t i = 0; i < array->Length(); ++i) {
+		v8::String::Utf8Value id(args.GetIsolate(), array->Get(context, i).ToLocalChecked());
+		nomadIds.push_back(*id);
 	}
-    else {
-        cout << "nomad 3D positions " << *nomad3DPositions << endl;
-    }
 
-    // Create the requester
-	requester = cameo::application::Requester::create(*nomad3DPositions, "get_positions");
+	QueueReset(args, nomadIds, false);
+}
 
-	if (requester.get() == 0) {
-		cout << "cannot create requester" << endl;
-		return;
+/**
+ * Sets the number of started instances kept in the pool.
+ */
+void SetPoolSize(const FunctionCallbackInfo<Value>& args) {
+
+	int size = Local<Integer>::Cast(args[0])->Value();
+
+	{
+		lock_guard<mutex> lock(poolMutex);
+		poolSize = (size < 1 ? 1 : size);
 	}
 
-	args.GetReturnValue().Set(Undefined(v8Isolate));
+	args.GetReturnValue().Set(Undefined(args.GetIsolate()));
 }
 
-void GetSimulatedServerIds(const FunctionCallbackInfo<Value>& args) {
+/**
+ * Gets the arguments of the pooled instances.
+ */
+void GetPooledInstances(const FunctionCallbackInfo<Value>& args) {
 
 	Local<Context> context = args.GetIsolate()->GetCurrentContext();
-	Local<Array> array = Array::New(args.GetIsolate(), 0);
 
-	cameo::application::InstanceArray nomadApplications = remoteServer->connectAll("nssim");
+	lock_guard<mutex> lock(poolMutex);
 
-	for (size_t i = 0; i < nomadApplications.size(); ++i) {
-		array->Set(context, i, Integer::New(args.GetIsolate(), nomadApplications[i]->getId()));
+	Local<Array> array = Array::New(args.GetIsolate(), pool.size());
+
+	for (size_t i = 0; i < pool.size(); ++i) {
+		array->Set(context, i, String::NewFromUtf8(args.GetIsolate(), pool[i]->appArgs.c_str()).ToLocalChecked());
 	}
 
 	args.GetReturnValue().Set(array);
 }
 
-void GetPositions(const FunctionCallbackInfo<Value>& args) {
+/**
+ * Lists the ids of the simulated servers. Called by the server watcher thread.
+ */
+bool ListSimulatedServers(vector<int>& ids) {
 
-	std::string reqPositions("POSITIONS");
+	lock_guard<mutex> lock(remoteServerMutex);
 
-	// Send the request.
-	requester->send(reqPositions);
+	if (remoteServer.get() == 0) {
+		return false;
+	}
 
-	// Wait for the response.
-	string response;
-	requester->receive(response);
-    
-    args.GetReturnValue().Set(String::NewFromUtf8(args.GetIsolate(), response.c_str()).ToLocalChecked());
+	cameo::application::InstanceArray nomadApplications = remoteServer->connectAll(NOMADSIMULATOR);
+
+	for (size_t i = 0; i < nomadApplications.size(); ++i) {
+		ids.push_back(nomadApplications[i]->getId());
+	}
+
+	return true;
 }
 
-void Pause(const FunctionCallbackInfo<Value>& args) {
+static Local<Array> NewIdsArray(Isolate * isolate, const vector<int>& ids) {
 
-	std::string reqPause("PAUSE");
+	Local<Context> context = isolate->GetCurrentContext();
+	Local<Array> array = Array::New(isolate, ids.size());
 
-	// Send the request.
-	requester->send(reqPause);
+	for (size_t i = 0; i < ids.size(); ++i) {
+		array->Set(context, i, Integer::New(isolate, ids[i]));
+	}
 
-	// Wait for the response.
-	string response;
-	requester->receive(response);
-    
-    args.GetReturnValue().Set(String::NewFromUtf8(args.GetIsolate(), response.c_str()).ToLocalChecked());
+	return array;
 }
 
-void Restart(const FunctionCallbackInfo<Value>& args) {
+/**
+ * Gets the ids of the simulated servers as {ids, pending}. The remote server is never requested on the JS thread:
+ * the list cached by the watcher is returned, and pending is true while the watcher has not received a list yet,
+ * in which case the ids are empty. The watcher calls back once it has the list.
+ */
+void GetSimulatedServerIds(const FunctionCallbackInfo<Value>& args) {
 
-	std::string reqRestart("RESTART");
+	Isolate * isolate = args.GetIsolate();
 
-	// Send the request.
-	requester->send(reqRestart);
+	bool pending = !simulatedServerWatcher.isRunning() || simulatedServerWatcher.version() == 0;
 
-	// Wait for the response.
-	string response;
+	Local<Object> result = Object::New(isolate);
+	result->Set(String::NewFromUtf8(isolate, "ids").ToLocalChecked(), NewIdsArray(isolate, simulatedServerWatcher.ids()));
+	result->Set(String::NewFromUtf8(isolate, "pending").ToLocalChecked(), Boolean::New(isolate, pending));
+
+	args.GetReturnValue().Set(result);
+}
+
+/**
+ * Calls the JS callback with the new list on the JS thread.
+ */
+static void SimulatedServersChanged(uv_async_t * handle) {
+
+	Isolate * isolate = Isolate::GetCurrent();
+
+	v8::HandleScope handleScope(isolate);
+
+	if (simulatedServersCallback.IsEmpty()) {
+		return;
+	}
+
+	Local<Function> callback = Local<Function>::New(isolate, simulatedServersCallback);
+	Local<Value> argv[1] = {NewIdsArray(isolate, simulatedServerWatcher.ids())};
+
+	node::MakeCallback(isolate, isolate->GetCurrentContext()->Global(), callback, 1, argv, {0, 0});
+}
+
+/**
+ * Starts watching the simulated servers with the period in ms. The callback is called with the ids each time the list changes.
+ */
+void WatchSimulatedServers(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+
+	int periodMs = Local<Integer>::Cast(args[0])->Value();
+
+	simulatedServerWatcher.stop();
+
+	if (!simulatedServersAsyncInitialised) {
+		uv_async_init(uv_default_loop(), &simulatedServersAsync, SimulatedServersChanged);
+
+		// The handle does not keep the loop alive.
+		uv_unref(reinterpret_cast<uv_handle_t *>(&simulatedServersAsync));
+		simulatedServersAsyncInitialised = true;
+	}
+
+	if (args[1]->IsFunction()) {
+		simulatedServersCallback.Reset(isolate, Local<Function>::Cast(args[1]));
+	}
+	else {
+		simulatedServersCallback.Reset();
+	}
+
+	simulatedServerWatcher.start(periodMs, ListSimulatedServers, []() {
+		uv_async_send(&simulatedServersAsync);
+	});
+
+	args.GetReturnValue().Set(Undefined(isolate));
+}
+
+/**
+ * Asks the watcher to list the simulated servers now. The callback is called if the list changed.
+ */
+void RefreshSimulatedServers(const FunctionCallbackInfo<Value>& args) {
+
+	simulatedServerWatcher.refresh();
+
+	args.GetReturnValue().Set(Undefined(args.GetIsolate()));
+}
+
+static bool Replaying();
+
+/**
+ * Records the JSON positions received by a request if the recorder is open.
+ * The stream records its snapshots itself when it is running, so that each snapshot is recorded once.
+ */
+static void RecordPositions(const string& json) {
+
+	if (!recorder.isOpen() || positionStream.isRunning() || Replaying()) {
+		return;
+	}
+
+	vector<string> names;
+	vector<double> values;
+
+	if (parsePositions(json, names, values)) {
+		recorder.record(PositionsRecorder::now(), names, values);
+	}
+}
+
+/**
+ * Gets the current time of the replay. Must be called with the replay mutex locked.
+ */
+static int64_t ReplayTime() {
+
+	int64_t elapsedUs = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - replayAnchor).count();
+	int64_t timeUs = replayOriginUs + static_cast<int64_t>(elapsedUs * replaySpeed);
+
+	int64_t start = replay.startTime();
+	int64_t end = replay.endTime();
+
+	if (timeUs > end) {
+		if (replayLoop && end > start) {
+			timeUs = start + (timeUs - start) % (end - start);
+		}
+		else {
+			timeUs = end;
+		}
+	}
+	else if (timeUs < start) {
+		timeUs = start;
+	}
+
+	return timeUs;
+}
+
+static bool Replaying() {
+
+	lock_guard<mutex> lock(replayMutex);
+	return replay.isOpen();
+}
+
+/**
+ * Fills the JSON positions of the replay at the current time. Returns false if no replay is running.
+ */
+bool ReplayPositions(string& response) {
+
+	lock_guard<mutex> lock(replayMutex);
+
+	if (!replay.isOpen() || replay.sample(ReplayTime(), replayValues) < 0) {
+		return false;
+	}
+
+	formatPositions(replay.names(), replayValues.data(), response);
+
+	return true;
+}
+
+/**
+ * Sends the request with the requester and records its round trip and the bytes moved.
+ * Throws if the requester was released because its instance was stopped.
+ */
+static void SendRequest(unique_ptr<cameo::application::Requester>& requester, mutex& requestMutex, LatencyHistogram& histogram, const string& message, string& response) {
+
+	lock_guard<mutex> lock(requestMutex);
+
+	if (requester.get() == 0) {
+		throw runtime_error("instance stopped");
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	requester->send(message);
 	requester->receive(response);
-    
-    args.GetReturnValue().Set(String::NewFromUtf8(args.GetIsolate(), response.c_str()).ToLocalChecked());
+
+	histogram.record(start, chrono::steady_clock::now());
+	bytesSent += message.size();
+	bytesReceived += response.size();
+}
+
+/**
+ * Sends the request to the active instance. Must be called with the requester mutex locked.
+ */
+static void SendRequest(LatencyHistogram& histogram, const string& message, string& response) {
+
+	if (!activeInstance) {
+		throw runtime_error("no active instance");
+	}
+
+	SendRequest(activeInstance->requester, activeInstance->requestMutex, histogram, message, response);
+}
+
+/**
+ * Sends the request of a worker thread to the instance with its worker requester.
+ */
+static void SendWorkerRequest(PositionsInstance& instance, LatencyHistogram& histogram, const string& message, string& response) {
+	SendRequest(instance.workerRequester, instance.workerRequestMutex, histogram, message, response);
+}
+
+/**
+ * Gets the active instance for a worker thread. The requester mutex is only held while the instance is taken.
+ */
+static shared_ptr<PositionsInstance> ActiveInstance() {
+
+	lock_guard<mutex> lock(requesterMutex);
+	return activeInstance;
+}
+
+/**
+ * Sends a command to the active instance. The command is not sent while a log is replayed, it would act on the
+ * instrument instead of the replay, nor if there is no active instance, for instance when only a log is replayed.
+ * Returns false if the command is not sent.
+ */
+static bool SendCommand(LatencyHistogram& histogram, const string& message, string& response) {
+
+	if (Replaying()) {
+		stats.event("command-ignored", {{"message", message}, {"reason", "replay"}});
+		return false;
+	}
+
+	lock_guard<mutex> lock(requesterMutex);
+
+	if (requester == 0) {
+		stats.event("command-ignored", {{"message", message}, {"reason", "no instance"}});
+		return false;
+	}
+
+	SendRequest(histogram, message, response);
+
+	return true;
+}
+
+static shared_ptr<SharedRingReader> PositionsRing() {
+
+	lock_guard<mutex> lock(positionsRingMutex);
+	return positionsRing;
+}
+
+/**
+ * Requests the positions. Called by the position stream thread.
+ * The positions are read from the shared memory if the instance publishes them, there is no new snapshot
+ * if they did not change.
+ */
+bool RequestPositions(string& response) {
+
+	if (ReplayPositions(response)) {
+		return true;
+	}
+
+	shared_ptr<SharedRingReader> ring = PositionsRing();
+
+	if (ring) {
+		if (!ring->read(response)) {
+			return false;
+		}
+
+		sharedPositionsHistogram.recordNs(ring->latencyNs());
+		bytesReceived += response.size();
+
+		return true;
+	}
+
+	shared_ptr<PositionsInstance> instance = ActiveInstance();
+
+	if (!instance) {
+		return false;
+	}
+
+	SendWorkerRequest(*instance, positionsHistogram, "POSITIONS", response);
+
+	return true;
+}
+
+/**
+ * Waits for the next positions in the shared memory. Called by the position stream thread.
+ * Returns false if the positions are requested, then the stream keeps its period.
+ */
+bool WaitPositions(chrono::steady_clock::time_point deadline) {
+
+	if (Replaying()) {
+		return false;
+	}
+
+	shared_ptr<SharedRingReader> ring = PositionsRing();
+
+	if (!ring) {
+		return false;
+	}
+
+	if (!ring->wait(deadline) && !ring->isWriterAlive()) {
+
+		// The instance was killed, the requester is used again.
+		lock_guard<mutex> lock(positionsRingMutex);
+
+		if (positionsRing == ring) {
+			positionsRing.reset();
+			stats.event("shared-memory-lost", {{"name", ring->name()}});
+		}
+	}
+
+	return true;
+}
+
+void GetPositions(const FunctionCallbackInfo<Value>& args) {
+
+	// Return the newest streamed snapshot if there is one.
+	if (positionStream.isRunning()) {
+		positionStream.update();
+
+		const PositionSnapshot& snapshot = positionStream.snapshot();
+		if (snapshot.sequence > 0) {
+			args.GetReturnValue().Set(String::NewFromUtf8(args.GetIsolate(), snapshot.json.c_str()).ToLocalChecked());
+			return;
+		}
+	}
+
+	string response;
+
+	if (!ReplayPositions(response)) {
+
+		std::string reqPositions("POSITIONS");
+
+		lock_guard<mutex> lock(requesterMutex);
+
+		// Only a log is replayed, without an instance.
+		if (requester == 0) {
+			args.GetReturnValue().Set(String::NewFromUtf8(args.GetIsolate(), "").ToLocalChecked());
+			return;
+		}
+
+		// Send the request and wait for the response.
+		SendRequest(positionsHistogram, reqPositions, response);
+
+		RecordPositions(response);
+	}
+
+    args.GetReturnValue().Set(String::NewFromUtf8(args.GetIsolate(), response.c_str()).ToLocalChecked());
+}
+
+void Pause(const FunctionCallbackInfo<Value>& args) {
+
+	std::string reqPause("PAUSE");
+
+	// Send the request and wait for the response.
+	string response;
+	SendCommand(pauseHistogram, reqPause, response);
+    
+    args.GetReturnValue().Set(String::NewFromUtf8(args.GetIsolate(), response.c_str()).ToLocalChecked());
+}
+
+void Restart(const FunctionCallbackInfo<Value>& args) {
+
+	std::string reqRestart("RESTART");
+
+	// Send the request and wait for the response.
+	string response;
+	SendCommand(restartHistogram, reqRestart, response);
+    
+    args.GetReturnValue().Set(String::NewFromUtf8(args.GetIsolate(), response.c_str()).ToLocalChecked());
+}
+
+/**
+ * Work structure used to run a request on the libuv thread pool and resolve
+ * the promise once the response is received.
+ */
+struct RequestWork {
+	uv_work_t request;
+	Persistent<Promise::Resolver> resolver;
+	string message;
+	string response;
+	string error;
+	double latencyMs;
+	chrono::steady_clock::time_point queueTime;
+};
+
+static void RequestWorkAsync(uv_work_t *req) {
+
+	RequestWork *work = static_cast<RequestWork *>(req->data);
+
+	// Time spent waiting for a thread of the pool.
+	queueHistogram.record(work->queueTime, chrono::steady_clock::now());
+
+	// The replayed positions do not need the requester.
+	if (work->message == "POSITIONS" && ReplayPositions(work->response)) {
+		return;
+	}
+
+	// The worker requester is used so that the synchronous functions do not wait for this request.
+	shared_ptr<PositionsInstance> instance = ActiveInstance();
+
+	if (!instance) {
+		work->error = "no requester";
+		return;
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	try {
+		// Send the request and wait for the response outside the JS thread.
+		SendWorkerRequest(*instance, positionsHistogram, work->message, work->response);
+
+		if (work->message == "POSITIONS") {
+			RecordPositions(work->response);
+		}
+	}
+	catch (const exception& e) {
+		work->error = e.what();
+	}
+
+	work->latencyMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * RequestWorkAsyncComplete function is called on the JS thread once the response is received.
+ */
+static void RequestWorkAsyncComplete(uv_work_t *req, int status) {
+
+	Isolate * isolate = Isolate::GetCurrent();
+
+	v8::HandleScope handleScope(isolate);
+
+	RequestWork *work = static_cast<RequestWork *>(req->data);
+
+	asyncRequests.add(-1);
+
+	// The callback scope runs the microtasks so that the promise continuations are executed now.
+	node::CallbackScope callbackScope(isolate, Object::New(isolate), {0, 0});
+
+	Local<Context> context = isolate->GetCurrentContext();
+	Local<Promise::Resolver> resolver = Local<Promise::Resolver>::New(isolate, work->resolver);
+
+	if (work->error.empty()) {
+		lastLatencyMs = work->latencyMs;
+		resolver->Resolve(context, String::NewFromUtf8(isolate, work->response.c_str()).ToLocalChecked()).FromJust();
+	}
+	else {
+		resolver->Reject(context, Exception::Error(String::NewFromUtf8(isolate, work->error.c_str()).ToLocalChecked())).FromJust();
+	}
+
+	work->resolver.Reset();
+	delete work;
+}
+
+/**
+ * Queues the request and returns a promise resolved with the response.
+ */
+static void QueueRequest(const FunctionCallbackInfo<Value>& args, const string& message) {
+
+	Isolate * isolate = args.GetIsolate();
+	Local<Promise::Resolver> resolver = Promise::Resolver::New(isolate->GetCurrentContext()).ToLocalChecked();
+
+	RequestWork * work = new RequestWork();
+
+	work->request.data = work;
+	work->resolver.Reset(isolate, resolver);
+	work->message = message;
+	work->latencyMs = 0.0;
+	work->queueTime = chrono::steady_clock::now();
+
+	asyncRequests.add(1);
+
+	uv_queue_work(uv_default_loop(), &work->request, RequestWorkAsync, RequestWorkAsyncComplete);
+
+	args.GetReturnValue().Set(resolver->GetPromise());
+}
+
+/**
+ * Gets the positions without blocking the JS thread. Returns a promise resolved with the JSON positions.
+ */
+void GetPositionsAsync(const FunctionCallbackInfo<Value>& args) {
+	QueueRequest(args, "POSITIONS");
+}
+
+/**
+ * Releases the values viewed by a typed array once it is garbage collected.
+ */
+static void ReleaseValues(char * data, void * hint) {
+	delete static_cast<shared_ptr<vector<double> > *>(hint);
+}
+
+/**
+ * Creates a Float64Array that views the values of the snapshot without a copy.
+ * The producers never write a vector viewed by a typed array (see PositionSnapshot::writableValues),
+ * so the array keeps the values of the snapshot.
+ */
+static Local<Float64Array> NewPositionsArray(Isolate * isolate, const PositionSnapshot& snapshot) {
+
+	// The buffer keeps a reference to the values so that they live as long as the typed array.
+	shared_ptr<vector<double> > * hint = new shared_ptr<vector<double> >(snapshot.values);
+	size_t size = (*hint)->size();
+
+	Local<Object> buffer = node::Buffer::New(isolate, reinterpret_cast<char *>((*hint)->data()), size * sizeof(double), ReleaseValues, hint).ToLocalChecked();
+	Local<Uint8Array> bytes = buffer.As<Uint8Array>();
+
+	return Float64Array::New(bytes->Buffer(), bytes->ByteOffset(), size);
+}
+
+/**
+ * Gets the newest streamed positions as a Float64Array packed in the order of getAxisNames().
+ * The array views the snapshot buffer without a copy and keeps its values.
+ * Returns null if the stream is not running or has no snapshot yet.
+ */
+void GetPositionsBuffer(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+
+	if (!positionStream.isRunning()) {
+		args.GetReturnValue().SetNull();
+		return;
+	}
+
+	positionStream.update();
+
+	const PositionSnapshot& snapshot = positionStream.snapshot();
+	if (snapshot.sequence == 0 || snapshot.values->empty()) {
+		args.GetReturnValue().SetNull();
+		return;
+	}
+
+	args.GetReturnValue().Set(NewPositionsArray(isolate, snapshot));
+}
+
+/**
+ * Gets the streamed positions that changed since the last call.
+ * Returns an object {sequence, full, changed, positions} where changed is an Int32Array of the indexes
+ * of the changed axes and positions the Float64Array of all the positions. full is true when the axis table
+ * changed, in that case all the indexes are changed. Returns null if there is no new snapshot.
+ */
+void GetPositionChanges(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+
+	if (!positionStream.isRunning()) {
+		args.GetReturnValue().SetNull();
+		return;
+	}
+
+	positionStream.update();
+
+	const PositionSnapshot& snapshot = positionStream.snapshot();
+	if (snapshot.sequence == 0 || snapshot.sequence == deliveredSequence || snapshot.values->empty()) {
+		args.GetReturnValue().SetNull();
+		return;
+	}
+
+	const vector<double>& values = *snapshot.values;
+	vector<int32_t> changed;
+
+	// Resynchronise all the axes if the table changed.
+	bool full = (snapshot.tableVersion != deliveredTableVersion || values.size() != deliveredValues.size());
+
+	if (full) {
+		changed.resize(values.size());
+		for (size_t i = 0; i < values.size(); ++i) {
+			changed[i] = i;
+		}
+		deliveredValues = values;
+	}
+	else {
+		for (size_t i = 0; i < values.size(); ++i) {
+			if (values[i] != deliveredValues[i]) {
+				changed.push_back(i);
+				deliveredValues[i] = values[i];
+			}
+		}
+	}
+
+	deliveredTableVersion = snapshot.tableVersion;
+	deliveredSequence = snapshot.sequence;
+
+	Local<ArrayBuffer> changedBuffer = ArrayBuffer::New(isolate, changed.size() * sizeof(int32_t));
+	if (!changed.empty()) {
+		memcpy(changedBuffer->GetContents().Data(), changed.data(), changed.size() * sizeof(int32_t));
+	}
+
+	Local<Object> result = Object::New(isolate);
+	result->Set(String::NewFromUtf8(isolate, "sequence").ToLocalChecked(), Number::New(isolate, snapshot.sequence));
+	result->Set(String::NewFromUtf8(isolate, "full").ToLocalChecked(), Boolean::New(isolate, full));
+	result->Set(String::NewFromUtf8(isolate, "changed").ToLocalChecked(), Int32Array::New(changedBuffer, 0, changed.size()));
+	result->Set(String::NewFromUtf8(isolate, "positions").ToLocalChecked(), NewPositionsArray(isolate, snapshot));
+
+	args.GetReturnValue().Set(result);
+}
+
+/**
+ * Gets the JSON positions of the snapshot returned by the last call to getPositionsBuffer().
+ */
+void GetCurrentPositions(const FunctionCallbackInfo<Value>& args) {
+	args.GetReturnValue().Set(String::NewFromUtf8(args.GetIsolate(), positionStream.snapshot().json.c_str()).ToLocalChecked());
+}
+
+/**
+ * Gets the axis names of the packed positions.
+ */
+void GetAxisNames(const FunctionCallbackInfo<Value>& args) {
+
+	Local<Context> context = args.GetIsolate()->GetCurrentContext();
+
+	vector<string> names = positionStream.axisNames();
+	Local<Array> array = Array::New(args.GetIsolate(), names.size());
+
+	for (size_t i = 0; i < names.size(); ++i) {
+		array->Set(context, i, String::NewFromUtf8(args.GetIsolate(), names[i].c_str()).ToLocalChecked());
+	}
+
+	args.GetReturnValue().Set(array);
+}
+
+/**
+ * Gets the version of the axis table of the current snapshot. It changes when the axis set changes.
+ */
+void GetAxisTableVersion(const FunctionCallbackInfo<Value>& args) {
+	args.GetReturnValue().Set(Integer::NewFromUnsigned(args.GetIsolate(), positionStream.snapshot().tableVersion));
+}
+
+/**
+ * Starts the background position stream with the period in ms.
+ */
+void StartStreaming(const FunctionCallbackInfo<Value>& args) {
+
+	int periodMs = Local<Integer>::Cast(args[0])->Value();
+
+	// Each snapshot is also submitted to the collision forwarder that ignores it if it is not started.
+	positionStream.stop();
+	positionStream.setListener([](const PositionSnapshot& snapshot) {
+		collisionForwarder.submit(snapshot);
+
+		decodeHistogram.recordNs(snapshot.decodeNs);
+		++snapshotCount;
+
+		// The replayed snapshots are not recorded again.
+		if (recorder.isOpen() && !Replaying()) {
+			recorder.record(PositionsRecorder::now(), positionStream.axisNames(), *snapshot.values);
+		}
+	});
+	positionStream.setWait(WaitPositions);
+	positionStream.start(periodMs, RequestPositions);
+
+	stats.event("streaming", {{"periodMs", ToString(periodMs)}});
+
+	args.GetReturnValue().Set(Undefined(args.GetIsolate()));
+}
+
+/**
+ * Stops the background position stream.
+ */
+void StopStreaming(const FunctionCallbackInfo<Value>& args) {
+
+	positionStream.stop();
+
+	args.GetReturnValue().Set(Undefined(args.GetIsolate()));
+}
+
+void IsStreaming(const FunctionCallbackInfo<Value>& args) {
+	args.GetReturnValue().Set(Boolean::New(args.GetIsolate(), positionStream.isRunning()));
+}
+
+/**
+ * Requests the positions of an opened stream. Called by the thread of the stream.
+ */
+static bool RequestStreamPositions(PositionsStreamHandle& handle, string& response) {
+
+	if (handle.ring) {
+		if (!handle.ring->read(response)) {
+			return false;
+		}
+
+		sharedPositionsHistogram.recordNs(handle.ring->latencyNs());
+		bytesReceived += response.size();
+
+		return true;
+	}
+
+	SendWorkerRequest(*handle.instance, positionsHistogram, "POSITIONS", response);
+
+	return true;
+}
+
+static bool WaitStreamPositions(PositionsStreamHandle& handle, chrono::steady_clock::time_point deadline) {
+
+	if (!handle.ring) {
+		return false;
+	}
+
+	// The ring is only used by the thread of the stream, the requester is used again if the instance was killed.
+	if (!handle.ring->wait(deadline) && !handle.ring->isWriterAlive()) {
+		stats.event("shared-memory-lost", {{"name", handle.ring->name()}});
+		handle.ring.reset();
+	}
+
+	return true;
+}
+
+/**
+ * Work structure used to open the streams on the libuv thread pool.
+ */
+struct OpenStreamWork {
+	uv_work_t request;
+	Persistent<Promise::Resolver> resolver;
+	string nomadId;
+	int periodMs;
+	int handleId;
+};
+
+static void OpenStreamWorkAsync(uv_work_t *req) {
+
+	OpenStreamWork *work = static_cast<OpenStreamWork *>(req->data);
+
+	work->handleId = -1;
+
+	shared_ptr<PositionsInstance> instance;
+
+	try {
+		instance = AcquireInstance(NomadAppArgs(work->nomadId));
+	}
+	catch (const exception& e) {
+		stats.event("start-failed", {{"nomadId", work->nomadId}, {"error", e.what()}});
+	}
+
+	if (instance.get() == 0) {
+		return;
+	}
+
+	{
+		lock_guard<mutex> lock(poolMutex);
+		++instance->streamCount;
+	}
+
+	shared_ptr<PositionsStreamHandle> handle(new PositionsStreamHandle());
+	handle->nomadId = work->nomadId;
+	handle->instance = instance;
+	handle->ring = OpenPositionsRing(*instance);
+
+	PositionsStreamHandle * streamHandle = handle.get();
+	handle->stream.setStats(&stats);
+	handle->stream.setWait([streamHandle](chrono::steady_clock::time_point deadline) {
+		return WaitStreamPositions(*streamHandle, deadline);
+	});
+	handle->stream.start(work->periodMs, [streamHandle](string& response) {
+		return RequestStreamPositions(*streamHandle, response);
+	});
+
+	lock_guard<mutex> lock(streamHandlesMutex);
+
+	work->handleId = nextStreamHandle++;
+	streamHandles[work->handleId] = handle;
+	streamsGauge.set(streamHandles.size());
+
+	stats.event("stream-opened", {{"nomadId", work->nomadId}, {"handle", ToString(work->handleId)}, {"sharedMemory", handle->ring ? "true" : "false"}});
+}
+
+static void OpenStreamWorkAsyncComplete(uv_work_t *req, int status) {
+
+	Isolate * isolate = Isolate::GetCurrent();
+
+	v8::HandleScope handleScope(isolate);
+
+	OpenStreamWork *work = static_cast<OpenStreamWork *>(req->data);
+
+	node::CallbackScope callbackScope(isolate, Object::New(isolate), {0, 0});
+
+	Local<Context> context = isolate->GetCurrentContext();
+	Local<Promise::Resolver> resolver = Local<Promise::Resolver>::New(isolate, work->resolver);
+
+	resolver->Resolve(context, Integer::New(isolate, work->handleId)).FromJust();
+
+	work->resolver.Reset();
+	delete work;
+}
+
+/**
+ * Opens a position stream of the Nomad server with the id and the period in ms, next to the active server.
+ * The instance is taken from the pool or started in the background. Returns a promise resolved with the handle
+ * of the stream or -1 if the server cannot be started.
+ */
+void OpenStream(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+	Local<Promise::Resolver> resolver = Promise::Resolver::New(isolate->GetCurrentContext()).ToLocalChecked();
+
+	v8::String::Utf8Value param0(args[0]->ToString());
+
+	OpenStreamWork * work = new OpenStreamWork();
+
+	work->request.data = work;
+	work->resolver.Reset(isolate, resolver);
+	work->nomadId = *param0;
+	work->periodMs = Local<Integer>::Cast(args[1])->Value();
+	work->handleId = -1;
+
+	uv_queue_work(uv_default_loop(), &work->request, OpenStreamWorkAsync, OpenStreamWorkAsyncComplete);
+
+	args.GetReturnValue().Set(resolver->GetPromise());
+}
+
+static shared_ptr<PositionsStreamHandle> FindStream(int handleId) {
+
+	lock_guard<mutex> lock(streamHandlesMutex);
+
+	map<int, shared_ptr<PositionsStreamHandle> >::iterator handle = streamHandles.find(handleId);
+	if (handle == streamHandles.end()) {
+		return shared_ptr<PositionsStreamHandle>();
+	}
+
+	return handle->second;
+}
+
+/**
+ * Closes the stream with the handle. Its instance returns to the pool.
+ */
+void CloseStream(const FunctionCallbackInfo<Value>& args) {
+
+	int handleId = Local<Integer>::Cast(args[0])->Value();
+
+	shared_ptr<PositionsStreamHandle> handle;
+
+	{
+		lock_guard<mutex> lock(streamHandlesMutex);
+
+		map<int, shared_ptr<PositionsStreamHandle> >::iterator found = streamHandles.find(handleId);
+		if (found != streamHandles.end()) {
+			handle = found->second;
+			streamHandles.erase(found);
+		}
+		streamsGauge.set(streamHandles.size());
+	}
+
+	if (handle) {
+		handle->stream.stop();
+
+		{
+			lock_guard<mutex> lock(poolMutex);
+			--handle->instance->streamCount;
+		}
+
+		stats.event("stream-closed", {{"nomadId", handle->nomadId}, {"handle", ToString(handleId)}});
+		EvictInstances();
+	}
+
+	args.GetReturnValue().Set(Undefined(args.GetIsolate()));
+}
+
+/**
+ * Gets the newest snapshot of the stream with the handle as an object {sequence, tableVersion, positions} where
+ * positions is a Float64Array in the order of the axis table of the stream. Returns null if there is no new snapshot.
+ */
+void GetStreamPositions(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+
+	shared_ptr<PositionsStreamHandle> handle = FindStream(Local<Integer>::Cast(args[0])->Value());
+
+	if (!handle) {
+		args.GetReturnValue().SetNull();
+		return;
+	}
+
+	handle->stream.update();
+
+	const PositionSnapshot& snapshot = handle->stream.snapshot();
+	if (snapshot.sequence == 0 || snapshot.sequence == handle->deliveredSequence || snapshot.values->empty()) {
+		args.GetReturnValue().SetNull();
+		return;
+	}
+
+	handle->deliveredSequence = snapshot.sequence;
+
+	Local<Object> result = Object::New(isolate);
+	result->Set(String::NewFromUtf8(isolate, "sequence").ToLocalChecked(), Number::New(isolate, snapshot.sequence));
+	result->Set(String::NewFromUtf8(isolate, "tableVersion").ToLocalChecked(), Integer::NewFromUnsigned(isolate, snapshot.tableVersion));
+	result->Set(String::NewFromUtf8(isolate, "positions").ToLocalChecked(), NewPositionsArray(isolate, snapshot));
+
+	args.GetReturnValue().Set(result);
+}
+
+/**
+ * Gets the axis names of the stream with the handle.
+ */
+void GetStreamAxisNames(const FunctionCallbackInfo<Value>& args) {
+
+	Local<Context> context = args.GetIsolate()->GetCurrentContext();
+
+	shared_ptr<PositionsStreamHandle> handle = FindStream(Local<Integer>::Cast(args[0])->Value());
+
+	vector<string> names;
+	if (handle) {
+		names = handle->stream.axisNames();
+	}
+
+	Local<Array> array = Array::New(args.GetIsolate(), names.size());
+
+	for (size_t i = 0; i < names.size(); ++i) {
+		array->Set(context, i, String::NewFromUtf8(args.GetIsolate(), names[i].c_str()).ToLocalChecked());
+	}
+
+	args.GetReturnValue().Set(array);
+}
+
+/**
+ * Sends the collision request. Called by the collision forwarder thread.
+ * The request goes through the shared memory if the collision server reads it.
+ */
+void RequestCollisions(const string& message, string& response) {
+
+	lock_guard<mutex> lock(collisionRequesterMutex);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	if (collisionPositionsRing) {
+
+		// A verdict that arrived after a timeout is dropped.
+		collisionVerdictsRing->read(response);
+
+		if (collisionPositionsRing->publish(message)) {
+
+			// The verdict answers the positions frame: a verdict of an earlier request is discarded.
+			uint64_t frame = collisionPositionsRing->published();
+			bool received = false;
+
+			while (collisionVerdictsRing->next(response, start + COLLISION_RING_TIMEOUT)) {
+				if (collisionVerdictsRing->request() == frame) {
+					received = true;
+					break;
+				}
+				stats.event("collision-verdict-discarded", {{"request", ToString(collisionVerdictsRing->request())}, {"expected", ToString(frame)}});
+			}
+
+			if (received) {
+				collisionRingTimeouts = 0;
+				sharedCollisionsHistogram.record(start, chrono::steady_clock::now());
+				bytesSent += message.size();
+				bytesReceived += response.size();
+
+				return;
+			}
+
+			// The collision server was killed or does not read the positions: the requester is used again.
+			++collisionRingTimeouts;
+
+			if (!collisionVerdictsRing->isWriterAlive() || collisionRingTimeouts >= COLLISION_RING_MAX_TIMEOUTS) {
+				stats.event("collision-shared-memory-lost", {{"name", collisionPositionsRing->name()}, {"timeouts", ToString(collisionRingTimeouts)}});
+				collisionPositionsRing.reset();
+				collisionVerdictsRing.reset();
+				collisionRingTimeouts = 0;
+			}
+			else {
+				throw runtime_error("no collision verdict in shared memory");
+			}
+
+			start = chrono::steady_clock::now();
+		}
+	}
+
+	collisionRequester->send(message);
+	collisionRequester->receive(response);
+
+	collisionsHistogram.record(start, chrono::steady_clock::now());
+	bytesSent += message.size();
+	bytesReceived += response.size();
+}
+
+/**
+ * Starts forwarding the streamed positions to the collision server application with the name.
+ * The collision server must have been started by the collision addon.
+ */
+void StartCollisionForwarding(const FunctionCallbackInfo<Value>& args) {
+
+	v8::String::Utf8Value param0(args[0]->ToString());
+	std::string collisionServerName(*param0);
+
+	collisionForwarder.stop();
+	collisionRequester.reset();
+	collisionPositionsRing.reset();
+	collisionVerdictsRing.reset();
+	collisionRingTimeouts = 0;
+
+	collisionServer = server->connect(collisionServerName);
+
+	if (!collisionServer->exists()) {
+		stats.event("no-collision-server", {{"name", collisionServerName}});
+		args.GetReturnValue().Set(Boolean::New(args.GetIsolate(), false));
+		return;
+	}
+
+	collisionRequester = cameo::application::Requester::create(*collisionServer, "update_positions");
+
+	if (collisionRequester.get() == 0) {
+		stats.event("collision-requester-failed", {{"name", collisionServerName}});
+		args.GetReturnValue().Set(Boolean::New(args.GetIsolate(), false));
+		return;
+	}
+
+	// The collision server publishes its verdicts in shared memory if it can read the positions from it.
+	if (sharedMemory) {
+		collisionVerdictsRing.reset(new SharedRingReader());
+		collisionPositionsRing.reset(new SharedRingWriter());
+
+		if (!collisionVerdictsRing->open(SharedRing::collisionVerdictsName(collisionServer->getId()))
+			|| !collisionVerdictsRing->isWriterAlive()
+			|| !collisionPositionsRing->create(SharedRing::collisionPositionsName(collisionServer->getId()), COLLISION_RING_SLOTS, COLLISION_RING_SLOT_SIZE)) {
+			collisionVerdictsRing.reset();
+			collisionPositionsRing.reset();
+		}
+		else {
+			stats.event("collision-shared-memory", {{"name", collisionPositionsRing->name()}});
+		}
+	}
+
+	collisionForwarder.start(RequestCollisions);
+
+	stats.event("collision-forwarding", {{"name", collisionServerName}});
+
+	args.GetReturnValue().Set(Boolean::New(args.GetIsolate(), true));
+}
+
+void StopCollisionForwarding(const FunctionCallbackInfo<Value>& args) {
+
+	collisionForwarder.stop();
+	collisionRequester.reset();
+	collisionPositionsRing.reset();
+	collisionVerdictsRing.reset();
+
+	args.GetReturnValue().Set(Undefined(args.GetIsolate()));
+}
+
+void IsCollisionForwarding(const FunctionCallbackInfo<Value>& args) {
+	args.GetReturnValue().Set(Boolean::New(args.GetIsolate(), collisionForwarder.isRunning()));
+}
+
+/**
+ * Gets the newest collision verdict of the forwarded positions as an object {sequence, latency, response}
+ * where response is the JSON response of the collision server. Returns null if there is no new verdict.
+ */
+void GetCollisionVerdict(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+
+	if (!collisionForwarder.isRunning() || !collisionForwarder.update()) {
+		args.GetReturnValue().SetNull();
+		return;
+	}
+
+	const CollisionVerdict& verdict = collisionForwarder.verdict();
+
+	Local<Object> result = Object::New(isolate);
+	result->Set(String::NewFromUtf8(isolate, "sequence").ToLocalChecked(), Number::New(isolate, verdict.sequence));
+	result->Set(String::NewFromUtf8(isolate, "latency").ToLocalChecked(), Number::New(isolate, verdict.latencyMs));
+	result->Set(String::NewFromUtf8(isolate, "response").ToLocalChecked(), String::NewFromUtf8(isolate, verdict.response.c_str()).ToLocalChecked());
+
+	args.GetReturnValue().Set(result);
+}
+
+/**
+ * Enables the shared memory transport with the servers running on the same host. Applies to the instances
+ * activated and to the collision forwarding started afterwards. The servers that do not publish their rings
+ * are still requested through Cameo.
+ */
+void SetSharedMemory(const FunctionCallbackInfo<Value>& args) {
+
+	sharedMemory = Local<Boolean>::Cast(args[0])->Value();
+
+	args.GetReturnValue().Set(Undefined(args.GetIsolate()));
+}
+
+/**
+ * Returns true if the streamed positions are read from shared memory.
+ */
+void IsSharedMemoryActive(const FunctionCallbackInfo<Value>& args) {
+	args.GetReturnValue().Set(Boolean::New(args.GetIsolate(), PositionsRing().get() != 0));
+}
+
+/**
+ * Starts recording the received positions into the binary log at the path. Returns false if it cannot be created.
+ */
+void StartRecording(const FunctionCallbackInfo<Value>& args) {
+
+	v8::String::Utf8Value param0(args[0]->ToString());
+	std::string path(*param0);
+
+	args.GetReturnValue().Set(Boolean::New(args.GetIsolate(), recorder.open(path)));
+}
+
+void StopRecording(const FunctionCallbackInfo<Value>& args) {
+
+	recorder.close();
+
+	args.GetReturnValue().Set(Undefined(args.GetIsolate()));
+}
+
+void IsRecording(const FunctionCallbackInfo<Value>& args) {
+	args.GetReturnValue().Set(Boolean::New(args.GetIsolate(), recorder.isOpen()));
+}
+
+/**
+ * Starts replaying the binary log at the path with the speed and the loop flag. The replayed positions are then returned
+ * by all the positions functions instead of the Nomad ones. Returns false if the log cannot be read.
+ */
+void StartReplay(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+	Local<Context> context = isolate->GetCurrentContext();
+
+	v8::String::Utf8Value param0(args[0]->ToString());
+	std::string path(*param0);
+
+	lock_guard<mutex> lock(replayMutex);
+
+	string error;
+
+	if (!replay.open(path, error)) {
+		stats.event("replay-failed", {{"path", path}, {"error", error}});
+		args.GetReturnValue().Set(Boolean::New(isolate, false));
+		return;
+	}
+
+	replaySpeed = args[1]->IsNumber() ? args[1]->NumberValue(context).FromMaybe(1.0) : 1.0;
+	replayLoop = args[2]->IsTrue();
+	replayOriginUs = replay.startTime();
+	replayAnchor = chrono::steady_clock::now();
+
+	args.GetReturnValue().Set(Boolean::New(isolate, true));
+}
+
+void StopReplay(const FunctionCallbackInfo<Value>& args) {
+
+	lock_guard<mutex> lock(replayMutex);
+
+	replay.close();
+
+	args.GetReturnValue().Set(Undefined(args.GetIsolate()));
+}
+
+/**
+ * Sets the replay speed, 1 being real time and 0 pausing the replay.
+ */
+void SetReplaySpeed(const FunctionCallbackInfo<Value>& args) {
+
+	double speed = args[0]->NumberValue(args.GetIsolate()->GetCurrentContext()).FromMaybe(1.0);
+
+	lock_guard<mutex> lock(replayMutex);
+
+	if (replay.isOpen()) {
+		replayOriginUs = ReplayTime();
+		replayAnchor = chrono::steady_clock::now();
+	}
+	replaySpeed = speed;
+
+	args.GetReturnValue().Set(Undefined(args.GetIsolate()));
+}
+
+/**
+ * Moves the replay to the time in ms from the start of the log.
+ */
+void SeekReplay(const FunctionCallbackInfo<Value>& args) {
+
+	double timeMs = args[0]->NumberValue(args.GetIsolate()->GetCurrentContext()).FromMaybe(0.0);
+
+	lock_guard<mutex> lock(replayMutex);
+
+	if (replay.isOpen()) {
+		replayOriginUs = replay.startTime() + static_cast<int64_t>(timeMs * 1000.0);
+		replayAnchor = chrono::steady_clock::now();
+	}
+
+	args.GetReturnValue().Set(Undefined(args.GetIsolate()));
+}
+
+/**
+ * Gets the replay status {time, duration, speed, count, startWallTime} with the times in ms from the start of the log
+ * and the wall clock time of the start in ms since the epoch.
+ * Returns null if no replay is running.
+ */
+void GetReplayStatus(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+
+	lock_guard<mutex> lock(replayMutex);
+
+	if (!replay.isOpen()) {
+		args.GetReturnValue().SetNull();
+		return;
+	}
+
+	Local<Object> result = Object::New(isolate);
+	result->Set(String::NewFromUtf8(isolate, "time").ToLocalChecked(), Number::New(isolate, (ReplayTime() - replay.startTime()) / 1000.0));
+	result->Set(String::NewFromUtf8(isolate, "duration").ToLocalChecked(), Number::New(isolate, (replay.endTime() - replay.startTime()) / 1000.0));
+	result->Set(String::NewFromUtf8(isolate, "speed").ToLocalChecked(), Number::New(isolate, replaySpeed));
+	result->Set(String::NewFromUtf8(isolate, "count").ToLocalChecked(), Number::New(isolate, replay.count()));
+
+	// Wall clock time of the start of the log, 0 if it was not recorded.
+	double startWallTime = (replay.wallOffsetUs() != 0) ? (replay.startTime() + replay.wallOffsetUs()) / 1000.0 : 0.0;
+	result->Set(String::NewFromUtf8(isolate, "startWallTime").ToLocalChecked(), Number::New(isolate, startWallTime));
+
+	args.GetReturnValue().Set(result);
+}
+
+/**
+ * Gets the round trip time in ms of the last async request.
+ */
+void GetLatency(const FunctionCallbackInfo<Value>& args) {
+	args.GetReturnValue().Set(Number::New(args.GetIsolate(), lastLatencyMs));
+}
+
+/**
+ * Gets the stats {time, addon, histograms, counters, gauges, events} without waiting on a request.
+ * The histograms give the count and the min, mean, percentiles and max times in us, the times are wall clock ms.
+ */
+void GetStats(const FunctionCallbackInfo<Value>& args) {
+
+	Isolate * isolate = args.GetIsolate();
+
+	Local<String> json = String::NewFromUtf8(isolate, stats.toJson().c_str()).ToLocalChecked();
+
+	args.GetReturnValue().Set(v8::JSON::Parse(isolate->GetCurrentContext(), json).ToLocalChecked());
+}
+
+/**
+ * Starts appending the stats to the file every period in ms.
+ */
+void StartStatsDump(const FunctionCallbackInfo<Value>& args) {
+
+	v8::String::Utf8Value param0(args[0]->ToString());
+	std::string path(*param0);
+
+	int periodMs = Local<Integer>::Cast(args[1])->Value();
+
+	args.GetReturnValue().Set(Boolean::New(args.GetIsolate(), stats.startDump(path, periodMs)));
+}
+
+void StopStatsDump(const FunctionCallbackInfo<Value>& args) {
+
+	stats.stopDump();
+
+	args.GetReturnValue().Set(Undefined(args.GetIsolate()));
 }
 
 /**
@@ -232,10 +1919,58 @@ void init(Local<Object> exports) {
 	// Register the functions.
 	NODE_SET_METHOD(exports, "init", Init);
 	NODE_SET_METHOD(exports, "getPositions", GetPositions);
+	NODE_SET_METHOD(exports, "getPositionsAsync", GetPositionsAsync);
+	NODE_SET_METHOD(exports, "getLatency", GetLatency);
+	NODE_SET_METHOD(exports, "startStreaming", StartStreaming);
+	NODE_SET_METHOD(exports, "stopStreaming", StopStreaming);
+	NODE_SET_METHOD(exports, "isStreaming", IsStreaming);
+	NODE_SET_METHOD(exports, "getPositionsBuffer", GetPositionsBuffer);
+	NODE_SET_METHOD(exports, "getPositionChanges", GetPositionChanges);
+	NODE_SET_METHOD(exports, "getCurrentPositions", GetCurrentPositions);
+	NODE_SET_METHOD(exports, "getAxisNames", GetAxisNames);
+	NODE_SET_METHOD(exports, "getAxisTableVersion", GetAxisTableVersion);
+	NODE_SET_METHOD(exports, "startCollisionForwarding", StartCollisionForwarding);
+	NODE_SET_METHOD(exports, "stopCollisionForwarding", StopCollisionForwarding);
+	NODE_SET_METHOD(exports, "isCollisionForwarding", IsCollisionForwarding);
+	NODE_SET_METHOD(exports, "getCollisionVerdict", GetCollisionVerdict);
 	NODE_SET_METHOD(exports, "pause", Pause);
 	NODE_SET_METHOD(exports, "restart", Restart);
-	NODE_SET_METHOD(exports, "reset", Reset);
+	NODE_SET_METHOD(exports, "resetAsync", ResetAsync);
+	NODE_SET_METHOD(exports, "prestart", Prestart);
+	NODE_SET_METHOD(exports, "setPoolSize", SetPoolSize);
+	NODE_SET_METHOD(exports, "getPooledInstances", GetPooledInstances);
 	NODE_SET_METHOD(exports, "getSimulatedServerIds", GetSimulatedServerIds);
+	NODE_SET_METHOD(exports, "watchSimulatedServers", WatchSimulatedServers);
+	NODE_SET_METHOD(exports, "refreshSimulatedServers", RefreshSimulatedServers);
+	NODE_SET_METHOD(exports, "startRecording", StartRecording);
+	NODE_SET_METHOD(exports, "stopRecording", StopRecording);
+	NODE_SET_METHOD(exports, "isRecording", IsRecording);
+	NODE_SET_METHOD(exports, "startReplay", StartReplay);
+	NODE_SET_METHOD(exports, "stopReplay", StopReplay);
+	NODE_SET_METHOD(exports, "setReplaySpeed", SetReplaySpeed);
+	NODE_SET_METHOD(exports, "seekReplay", SeekReplay);
+	NODE_SET_METHOD(exports, "getReplayStatus", GetReplayStatus);
+	NODE_SET_METHOD(exports, "openStream", OpenStream);
+	NODE_SET_METHOD(exports, "closeStream", CloseStream);
+	NODE_SET_METHOD(exports, "getStreamPositions", GetStreamPositions);
+	NODE_SET_METHOD(exports, "getStreamAxisNames", GetStreamAxisNames);
+	NODE_SET_METHOD(exports, "setSharedMemory", SetSharedMemory);
+	NODE_SET_METHOD(exports, "isSharedMemoryActive", IsSharedMemoryActive);
+	NODE_SET_METHOD(exports, "getStats", GetStats);
+	NODE_SET_METHOD(exports, "startStatsDump", StartStatsDump);
+	NODE_SET_METHOD(exports, "stopStatsDump", StopStatsDump);
+
+	// The workers emit their events through the stats of the addon.
+	positionStream.setStats(&stats);
+	collisionForwarder.setStats(&stats);
+	simulatedServerWatcher.setStats(&stats);
+	recorder.setStats(&stats);
+	replay.setStats(&stats);
+
+	// The coalesced snapshots are counted by the forwarder.
+	stats.addSource([](AddonStats& stats) {
+		stats.counter("forwarder.replaced") = collisionForwarder.replaced();
+	});
 }
 
 NODE_MODULE(addonnomad3dposition, init)
@@ -0,0 +1,146 @@
+#include "position-stream.h"
+#include "positions-json.h"
+
+using namespace std;
+
+namespace nomad {
+
+PositionStream::PositionStream() :
+	m_period(20),
+	m_running(false),
+	m_sequence(0),
+	m_tableVersion(0) {
+}
+
+PositionStream::~PositionStream() {
+	stop();
+}
+
+void PositionStream::start(int periodMs, RequestFunction request) {
+
+	stop();
+
+	m_request = request;
+	m_period = chrono::milliseconds(periodMs);
+	m_running = true;
+	m_thread = thread(&PositionStream::run, this);
+
+	event("position-stream-started", {{"periodMs", AddonStats::number(periodMs)}});
+}
+
+void PositionStream::stop() {
+
+	if (!m_thread.joinable()) {
+		return;
+	}
+
+	m_running = false;
+	m_thread.join();
+
+	event("position-stream-stopped");
+}
+
+bool PositionStream::isRunning() const {
+	return m_running;
+}
+
+void PositionStream::setListener(Listener listener) {
+	m_listener = listener;
+}
+
+void PositionStream::setWait(WaitFunction wait) {
+	m_wait = wait;
+}
+
+bool PositionStream::update() {
+	return m_buffer.update();
+}
+
+const PositionSnapshot& PositionStream::snapshot() const {
+	return m_buffer.front();
+}
+
+vector<string> PositionStream::axisNames() {
+
+	lock_guard<mutex> lock(m_tableMutex);
+	return m_names;
+}
+
+void PositionStream::decode(PositionSnapshot& snapshot) {
+
+	// Fast path: same axes in the same order, the values are written in place unless a JS typed array
+	// still views them.
+	if (m_tableVersion > 0 && snapshot.values->size() == m_names.size()
+		&& parsePositionValues(snapshot.json, m_names, snapshot.writableValues())) {
+		snapshot.tableVersion = m_tableVersion;
+		return;
+	}
+
+	vector<string> names;
+	shared_ptr<vector<double> > values = make_shared<vector<double> >();
+
+	if (!parsePositions(snapshot.json, names, *values)) {
+		values->clear();
+	}
+	else if (names != m_names) {
+		lock_guard<mutex> lock(m_tableMutex);
+		m_names.swap(names);
+		++m_tableVersion;
+
+		event("position-stream-axes", {{"version", AddonStats::number(static_cast<uint64_t>(m_tableVersion))}, {"axes", AddonStats::number(static_cast<uint64_t>(m_names.size()))}});
+	}
+
+	// A new vector is used because a JS typed array may still view the previous one.
+	snapshot.values = values;
+	snapshot.tableVersion = m_tableVersion;
+}
+
+void PositionStream::run() {
+
+	chrono::steady_clock::time_point next = chrono::steady_clock::now();
+
+	while (m_running) {
+
+		PositionSnapshot& snapshot = m_buffer.back();
+
+		try {
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+			if (m_request(snapshot.json)) {
+				chrono::steady_clock::time_point received = chrono::steady_clock::now();
+
+				decode(snapshot);
+				snapshot.sequence = ++m_sequence;
+				snapshot.time = chrono::steady_clock::now();
+				snapshot.requestNs = chrono::duration_cast<chrono::nanoseconds>(received - start).count();
+				snapshot.decodeNs = chrono::duration_cast<chrono::nanoseconds>(snapshot.time - received).count();
+
+				if (m_listener) {
+					m_listener(snapshot);
+				}
+
+				m_buffer.publish();
+			}
+		}
+		catch (const exception& e) {
+			event("position-stream-failed", {{"error", e.what()}});
+		}
+
+		// Keep the acquisition rate independent of the request time.
+		next += m_period;
+		chrono::steady_clock::time_point now = chrono::steady_clock::now();
+		if (next < now) {
+			next = now;
+		}
+
+		// The wait function returns as soon as the next snapshot is available.
+		if (m_wait && m_wait(next)) {
+			next = chrono::steady_clock::now();
+		}
+		else {
+			this_thread::sleep_until(next);
+		}
+	}
+}
+
+}
@@ -0,0 +1,125 @@
+#ifndef NOMAD_POSITIONSTREAM_H
+#define NOMAD_POSITIONSTREAM_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "addon-stats.h"
+#include "triple-buffer.h"
+
+namespace nomad {
+
+/**
+ * Position snapshot published by the stream.
+ * The values are packed in the order of the axis table. They are shared so that a JS typed array
+ * can keep viewing them without a copy: once published, a vector is never written again while it is shared,
+ * the producers write through writableValues().
+ */
+struct PositionSnapshot {
+	std::string json;
+	std::shared_ptr<std::vector<double> > values;
+	uint32_t tableVersion;
+	uint64_t sequence;
+	std::chrono::steady_clock::time_point time;
+	int64_t requestNs;
+	int64_t decodeNs;
+
+	PositionSnapshot() : values(std::make_shared<std::vector<double> >()), tableVersion(0), sequence(0), requestNs(0), decodeNs(0) {}
+
+	/**
+	 * Gets the values to write. They are replaced by a new vector if a typed array still views them.
+	 * Only the writer of the snapshot calls it, so no reference can be taken meanwhile.
+	 */
+	std::vector<double>& writableValues() {
+		if (values.use_count() != 1) {
+			values = std::make_shared<std::vector<double> >(values->size());
+		}
+		return *values;
+	}
+};
+
+/**
+ * Background thread that requests the positions at a fixed period and publishes
+ * each snapshot into a triple buffer so that the JS thread never waits on a socket.
+ */
+class PositionStream : public EventSource {
+
+public:
+	/**
+	 * The request function sends the request and fills the response. It returns false if no response is available.
+	 */
+	typedef std::function<bool (std::string&)> RequestFunction;
+
+	/**
+	 * The listener is called by the stream thread with each new snapshot before it is published.
+	 */
+	typedef std::function<void (const PositionSnapshot&)> Listener;
+
+	/**
+	 * The wait function waits until a new snapshot can be requested or until the deadline. It returns false if it
+	 * cannot wait, then the stream sleeps until the deadline.
+	 */
+	typedef std::function<bool (std::chrono::steady_clock::time_point)> WaitFunction;
+
+	PositionStream();
+	~PositionStream();
+
+	void start(int periodMs, RequestFunction request);
+	void stop();
+	bool isRunning() const;
+
+	/**
+	 * Sets the listener. The stream must not be running.
+	 */
+	void setListener(Listener listener);
+
+	/**
+	 * Sets the wait function. The period then only bounds the wait and a new snapshot is requested as soon as it
+	 * is available. The stream must not be running.
+	 */
+	void setWait(WaitFunction wait);
+
+	/**
+	 * Takes the newest snapshot. Returns true if it changed since the last call.
+	 * Only called by the JS thread.
+	 */
+	bool update();
+
+	/**
+	 * Gets the newest snapshot taken by update().
+	 */
+	const PositionSnapshot& snapshot() const;
+
+	/**
+	 * Gets the axis names in the order of the packed values. The table is agreed with the first snapshot
+	 * and changes only if the server sends another axis set.
+	 */
+	std::vector<std::string> axisNames();
+
+private:
+	void run();
+	void decode(PositionSnapshot& snapshot);
+
+	TripleBuffer<PositionSnapshot> m_buffer;
+	RequestFunction m_request;
+	Listener m_listener;
+	WaitFunction m_wait;
+	std::chrono::milliseconds m_period;
+	std::atomic<bool> m_running;
+	std::thread m_thread;
+	uint64_t m_sequence;
+
+	std::mutex m_tableMutex;
+	std::vector<std::string> m_names;
+	uint32_t m_tableVersion;
+};
+
+}
+
+#endif
@@ -0,0 +1,421 @@
+#include "positions-log.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace nomad {
+
+static const char DATA_MAGIC[4] = {'N', '3', 'D', 'L'};
+static const char INDEX_MAGIC[4] = {'N', '3', 'D', 'I'};
+static const uint32_t VERSION = 1;
+
+static const uint32_t TABLE_RECORD = 1;
+static const uint32_t SNAPSHOT_RECORD = 2;
+
+// The files are flushed at this period so that a crash loses little.
+static const int64_t FLUSH_PERIOD_US = 1000000;
+
+struct LogHeader {
+	char magic[4];
+	uint32_t version;
+	int64_t wallOffsetUs;
+};
+
+struct RecordHeader {
+	uint32_t type;
+	uint32_t count;
+};
+
+struct SnapshotHeader {
+	int64_t timeUs;
+	uint64_t tableOffset;
+};
+
+PositionsRecorder::PositionsRecorder() :
+	m_data(0),
+	m_index(0),
+	m_offset(0),
+	m_tableOffset(0),
+	m_count(0),
+	m_lastFlushUs(0) {
+}
+
+PositionsRecorder::~PositionsRecorder() {
+	close();
+}
+
+bool PositionsRecorder::open(const string& path) {
+
+	close();
+
+	lock_guard<mutex> lock(m_mutex);
+
+	m_data = fopen(path.c_str(), "wb");
+	m_index = fopen((path + ".idx").c_str(), "wb");
+
+	if (m_data == 0 || m_index == 0) {
+		event("positions-log-failed", {{"path", path}});
+
+		if (m_data != 0) {
+			fclose(m_data);
+			m_data = 0;
+		}
+		if (m_index != 0) {
+			fclose(m_index);
+			m_index = 0;
+		}
+		return false;
+	}
+
+	LogHeader header;
+	memset(&header, 0, sizeof(header));
+	header.version = VERSION;
+	header.wallOffsetUs = chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count() - now();
+
+	memcpy(header.magic, DATA_MAGIC, 4);
+	fwrite(&header, sizeof(header), 1, m_data);
+
+	memcpy(header.magic, INDEX_MAGIC, 4);
+	fwrite(&header, sizeof(header), 1, m_index);
+
+	m_offset = sizeof(header);
+	m_tableOffset = 0;
+	m_names.clear();
+	m_count = 0;
+	m_lastFlushUs = 0;
+
+	event("recording-started", {{"path", path}});
+
+	return true;
+}
+
+void PositionsRecorder::close() {
+
+	lock_guard<mutex> lock(m_mutex);
+
+	if (m_data == 0) {
+		return;
+	}
+
+	fclose(m_data);
+	fclose(m_index);
+	m_data = 0;
+	m_index = 0;
+
+	event("recording-stopped", {{"snapshots", AddonStats::number(m_count)}});
+}
+
+bool PositionsRecorder::isOpen() const {
+
+	lock_guard<mutex> lock(m_mutex);
+	return (m_data != 0);
+}
+
+uint64_t PositionsRecorder::count() const {
+
+	lock_guard<mutex> lock(m_mutex);
+	return m_count;
+}
+
+int64_t PositionsRecorder::now() {
+	return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void PositionsRecorder::pad() {
+
+	static const char zeros[8] = {0};
+
+	size_t padding = (8 - m_offset % 8) % 8;
+	if (padding > 0) {
+		fwrite(zeros, 1, padding, m_data);
+		m_offset += padding;
+	}
+}
+
+void PositionsRecorder::writeTable(const vector<string>& names) {
+
+	m_tableOffset = m_offset;
+	m_names = names;
+
+	RecordHeader header;
+	header.type = TABLE_RECORD;
+	header.count = names.size();
+
+	fwrite(&header, sizeof(header), 1, m_data);
+	m_offset += sizeof(header);
+
+	for (size_t i = 0; i < names.size(); ++i) {
+		uint32_t length = names[i].size();
+		fwrite(&length, sizeof(length), 1, m_data);
+		fwrite(names[i].data(), 1, length, m_data);
+		m_offset += sizeof(length) + length;
+	}
+
+	pad();
+}
+
+void PositionsRecorder::record(int64_t timeUs, const vector<string>& names, const vector<double>& values) {
+
+	lock_guard<mutex> lock(m_mutex);
+
+	if (m_data == 0 || names.size() != values.size()) {
+		return;
+	}
+
+	if (m_tableOffset == 0 || names != m_names) {
+		writeTable(names);
+	}
+
+	int64_t entry[2] = {timeUs, static_cast<int64_t>(m_offset)};
+	fwrite(entry, sizeof(entry), 1, m_index);
+
+	RecordHeader header;
+	header.type = SNAPSHOT_RECORD;
+	header.count = values.size();
+
+	SnapshotHeader snapshot;
+	snapshot.timeUs = timeUs;
+	snapshot.tableOffset = m_tableOffset;
+
+	fwrite(&header, sizeof(header), 1, m_data);
+	fwrite(&snapshot, sizeof(snapshot), 1, m_data);
+	fwrite(values.data(), sizeof(double), values.size(), m_data);
+
+	m_offset += sizeof(header) + sizeof(snapshot) + values.size() * sizeof(double);
+	++m_count;
+
+	if (timeUs - m_lastFlushUs > FLUSH_PERIOD_US) {
+		fflush(m_data);
+		fflush(m_index);
+		m_lastFlushUs = timeUs;
+	}
+}
+
+PositionsReplay::PositionsReplay() :
+	m_data(0),
+	m_dataSize(0),
+	m_index(0),
+	m_indexSize(0),
+	m_entries(0),
+	m_count(0),
+	m_namesOffset(0),
+	m_tableVersion(0),
+	m_wallOffsetUs(0) {
+}
+
+PositionsReplay::~PositionsReplay() {
+	close();
+}
+
+static char * mapFile(const string& path, size_t& size) {
+
+	int fd = ::open(path.c_str(), O_RDONLY);
+
+	if (fd < 0) {
+		return 0;
+	}
+
+	struct stat status;
+
+	if (fstat(fd, &status) != 0 || status.st_size < static_cast<off_t>(sizeof(LogHeader))) {
+		::close(fd);
+		return 0;
+	}
+
+	size = status.st_size;
+	void * data = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+
+	if (data == MAP_FAILED) {
+		return 0;
+	}
+
+	// The snapshots are mostly read forward.
+	madvise(data, size, MADV_SEQUENTIAL);
+
+	return static_cast<char *>(data);
+}
+
+bool PositionsReplay::open(const string& path, string& error) {
+
+	close();
+
+	m_data = mapFile(path, m_dataSize);
+	m_index = mapFile(path + ".idx", m_indexSize);
+
+	if (m_data == 0 || m_index == 0) {
+		close();
+		error = "cannot map positions log";
+		return false;
+	}
+
+	const LogHeader * dataHeader = reinterpret_cast<const LogHeader *>(m_data);
+	const LogHeader * indexHeader = reinterpret_cast<const LogHeader *>(m_index);
+
+	if (memcmp(dataHeader->magic, DATA_MAGIC, 4) != 0 || memcmp(indexHeader->magic, INDEX_MAGIC, 4) != 0) {
+		close();
+		error = "invalid positions log";
+		return false;
+	}
+
+	if (dataHeader->version != VERSION || indexHeader->version != VERSION) {
+		close();
+		error = "positions log version mismatch";
+		return false;
+	}
+
+	m_wallOffsetUs = dataHeader->wallOffsetUs;
+	m_entries = reinterpret_cast<const IndexEntry *>(m_index + sizeof(LogHeader));
+	m_count = (m_indexSize - sizeof(LogHeader)) / sizeof(IndexEntry);
+
+	// A log still being recorded may end with a partial snapshot.
+	while (m_count > 0) {
+		const IndexEntry& last = m_entries[m_count - 1];
+		if (last.offset + sizeof(RecordHeader) + sizeof(SnapshotHeader) <= m_dataSize) {
+			const RecordHeader * header = reinterpret_cast<const RecordHeader *>(m_data + last.offset);
+			if (last.offset + sizeof(RecordHeader) + sizeof(SnapshotHeader) + header->count * sizeof(double) <= m_dataSize) {
+				break;
+			}
+		}
+		--m_count;
+	}
+
+	event("replay-opened", {{"path", path}, {"snapshots", AddonStats::number(m_count)}});
+
+	return true;
+}
+
+void PositionsReplay::close() {
+
+	if (m_data != 0) {
+		munmap(m_data, m_dataSize);
+	}
+	if (m_index != 0) {
+		munmap(m_index, m_indexSize);
+	}
+
+	m_data = 0;
+	m_index = 0;
+	m_entries = 0;
+	m_count = 0;
+	m_names.clear();
+	m_namesOffset = 0;
+}
+
+bool PositionsReplay::isOpen() const {
+	return (m_data != 0);
+}
+
+uint64_t PositionsReplay::count() const {
+	return m_count;
+}
+
+int64_t PositionsReplay::startTime() const {
+	return (m_count > 0) ? m_entries[0].timeUs : 0;
+}
+
+int64_t PositionsReplay::endTime() const {
+	return (m_count > 0) ? m_entries[m_count - 1].timeUs : 0;
+}
+
+int64_t PositionsReplay::wallOffsetUs() const {
+	return m_wallOffsetUs;
+}
+
+const vector<string>& PositionsReplay::names() const {
+	return m_names;
+}
+
+uint32_t PositionsReplay::tableVersion() const {
+	return m_tableVersion;
+}
+
+bool PositionsReplay::readNames(uint64_t tableOffset, vector<string>& names) const {
+
+	if (tableOffset + sizeof(RecordHeader) > m_dataSize) {
+		return false;
+	}
+
+	const RecordHeader * header = reinterpret_cast<const RecordHeader *>(m_data + tableOffset);
+
+	if (header->type != TABLE_RECORD) {
+		return false;
+	}
+
+	names.resize(header->count);
+
+	uint64_t offset = tableOffset + sizeof(RecordHeader);
+
+	for (uint32_t i = 0; i < header->count; ++i) {
+
+		uint32_t length;
+
+		if (offset + sizeof(length) > m_dataSize) {
+			return false;
+		}
+
+		memcpy(&length, m_data + offset, sizeof(length));
+		offset += sizeof(length);
+
+		if (offset + length > m_dataSize) {
+			return false;
+		}
+
+		names[i].assign(m_data + offset, length);
+		offset += length;
+	}
+
+	return true;
+}
+
+int64_t PositionsReplay::sample(int64_t timeUs, vector<double>& values) {
+
+	if (m_count == 0) {
+		return -1;
+	}
+
+	// Last entry at or before the time.
+	const IndexEntry * end = m_entries + m_count;
+	const IndexEntry * entry = upper_bound(m_entries, end, timeUs, [](int64_t time, const IndexEntry& e) {
+		return time < e.timeUs;
+	});
+
+	if (entry != m_entries) {
+		--entry;
+	}
+
+	const RecordHeader * header = reinterpret_cast<const RecordHeader *>(m_data + entry->offset);
+	const SnapshotHeader * snapshot = reinterpret_cast<const SnapshotHeader *>(m_data + entry->offset + sizeof(RecordHeader));
+	const double * data = reinterpret_cast<const double *>(m_data + entry->offset + sizeof(RecordHeader) + sizeof(SnapshotHeader));
+
+	if (header->type != SNAPSHOT_RECORD) {
+		return -1;
+	}
+
+	// The names are only read when the table changes.
+	if (snapshot->tableOffset != m_namesOffset) {
+		if (!readNames(snapshot->tableOffset, m_names)) {
+			m_names.clear();
+			m_namesOffset = 0;
+			return -1;
+		}
+		m_namesOffset = snapshot->tableOffset;
+		++m_tableVersion;
+	}
+
+	if (m_names.size() != header->count) {
+		return -1;
+	}
+
+	values.assign(data, data + header->count);
+
+	return entry - m_entries;
+}
+
+}
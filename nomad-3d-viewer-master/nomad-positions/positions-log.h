@@ -0,0 +1,120 @@
+#ifndef NOMAD_POSITIONSLOG_H
+#define NOMAD_POSITIONSLOG_H
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "addon-stats.h"
+
+namespace nomad {
+
+/**
+ * Binary positions log. The data file is a header followed by records aligned to 8 bytes:
+ *  - table record: the axis names, written when the axis table changes,
+ *  - snapshot record: the steady clock time in us, the offset of its table record and the values.
+ * The steady times are monotonic so that they can be searched, the header holds the offset from them to the wall clock.
+ * The index file holds one fixed-size entry {time, offset} per snapshot so that a time is found by binary search.
+ * Both files are append-only.
+ */
+class PositionsRecorder : public EventSource {
+
+public:
+	PositionsRecorder();
+	~PositionsRecorder();
+
+	/**
+	 * Creates the data file and its index <path>.idx. Returns false if they cannot be created.
+	 */
+	bool open(const std::string& path);
+	void close();
+	bool isOpen() const;
+
+	/**
+	 * Appends a snapshot. The table is written if the names changed since the last snapshot.
+	 */
+	void record(int64_t timeUs, const std::vector<std::string>& names, const std::vector<double>& values);
+
+	uint64_t count() const;
+
+	/**
+	 * Gets the steady clock time in us used to record the snapshots.
+	 */
+	static int64_t now();
+
+private:
+	void writeTable(const std::vector<std::string>& names);
+	void pad();
+
+	mutable std::mutex m_mutex;
+	FILE * m_data;
+	FILE * m_index;
+	uint64_t m_offset;
+	uint64_t m_tableOffset;
+	std::vector<std::string> m_names;
+	uint64_t m_count;
+	int64_t m_lastFlushUs;
+};
+
+/**
+ * Reads a positions log mapped in memory.
+ */
+class PositionsReplay : public EventSource {
+
+public:
+	PositionsReplay();
+	~PositionsReplay();
+
+	bool open(const std::string& path, std::string& error);
+	void close();
+	bool isOpen() const;
+
+	uint64_t count() const;
+	int64_t startTime() const;
+	int64_t endTime() const;
+
+	/**
+	 * Gets the offset in us to add to the recorded times to get the wall clock times, 0 if it was not recorded.
+	 */
+	int64_t wallOffsetUs() const;
+
+	/**
+	 * Gets the values of the last snapshot recorded at or before the time, the first one if the time is before the start.
+	 * Returns the index of the snapshot, -1 if the log is empty or invalid.
+	 */
+	int64_t sample(int64_t timeUs, std::vector<double>& values);
+
+	/**
+	 * Gets the axis names of the last sample.
+	 */
+	const std::vector<std::string>& names() const;
+
+	/**
+	 * Gets the version of the axis table of the last sample. It changes when the axis set changes.
+	 */
+	uint32_t tableVersion() const;
+
+private:
+	struct IndexEntry {
+		int64_t timeUs;
+		uint64_t offset;
+	};
+
+	bool readNames(uint64_t tableOffset, std::vector<std::string>& names) const;
+
+	char * m_data;
+	size_t m_dataSize;
+	char * m_index;
+	size_t m_indexSize;
+	const IndexEntry * m_entries;
+	uint64_t m_count;
+	std::vector<std::string> m_names;
+	uint64_t m_namesOffset;
+	uint32_t m_tableVersion;
+	int64_t m_wallOffsetUs;
+};
+
+}
+
+#endif
@@ -0,0 +1,110 @@
+#include "server-watcher.h"
+
+using namespace std;
+
+namespace nomad {
+
+ServerWatcher::ServerWatcher() :
+	m_period(2000),
+	m_running(false),
+	m_refresh(false),
+	m_version(0) {
+}
+
+ServerWatcher::~ServerWatcher() {
+	stop();
+}
+
+void ServerWatcher::start(int periodMs, ListFunction list, Listener listener) {
+
+	stop();
+
+	m_list = list;
+	m_listener = listener;
+	m_period = chrono::milliseconds(periodMs);
+	m_running = true;
+	m_thread = thread(&ServerWatcher::run, this);
+
+	event("server-watcher-started", {{"periodMs", AddonStats::number(periodMs)}});
+}
+
+void ServerWatcher::stop() {
+
+	if (!m_thread.joinable()) {
+		return;
+	}
+
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_running = false;
+	}
+
+	m_condition.notify_one();
+	m_thread.join();
+
+	event("server-watcher-stopped");
+}
+
+bool ServerWatcher::isRunning() const {
+	return m_running;
+}
+
+void ServerWatcher::refresh() {
+
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_refresh = true;
+	}
+
+	m_condition.notify_one();
+}
+
+vector<int> ServerWatcher::ids() const {
+
+	lock_guard<mutex> lock(m_mutex);
+	return m_ids;
+}
+
+uint64_t ServerWatcher::version() const {
+
+	lock_guard<mutex> lock(m_mutex);
+	return m_version;
+}
+
+void ServerWatcher::run() {
+
+	vector<int> ids;
+
+	while (m_running) {
+
+		ids.clear();
+
+		bool changed = false;
+
+		try {
+			if (m_list(ids)) {
+				lock_guard<mutex> lock(m_mutex);
+
+				if (m_version == 0 || ids != m_ids) {
+					m_ids = ids;
+					m_version++;
+					changed = true;
+				}
+			}
+		}
+		catch (const exception& e) {
+			event("server-watcher-failed", {{"error", e.what()}});
+		}
+
+		if (changed && m_listener) {
+			m_listener();
+		}
+
+		// Wait for the next period or a refresh.
+		unique_lock<mutex> lock(m_mutex);
+		m_condition.wait_for(lock, m_period, [this] { return m_refresh || !m_running; });
+		m_refresh = false;
+	}
+}
+
+}
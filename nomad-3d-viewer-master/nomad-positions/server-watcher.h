@@ -0,0 +1,73 @@
+#ifndef NOMAD_SERVERWATCHER_H
+#define NOMAD_SERVERWATCHER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "addon-stats.h"
+
+namespace nomad {
+
+/**
+ * Background thread that keeps the list of the ids of an application on a remote server up to date.
+ * The list is cached so that the JS thread reads it without waiting on the server.
+ */
+class ServerWatcher : public EventSource {
+
+public:
+	/**
+	 * The list function fills the ids. It returns false if the server cannot be reached.
+	 */
+	typedef std::function<bool (std::vector<int>&)> ListFunction;
+
+	/**
+	 * The listener is called by the watcher thread when the list changes.
+	 */
+	typedef std::function<void ()> Listener;
+
+	ServerWatcher();
+	~ServerWatcher();
+
+	void start(int periodMs, ListFunction list, Listener listener);
+	void stop();
+	bool isRunning() const;
+
+	/**
+	 * Wakes the watcher so that the list is updated now.
+	 */
+	void refresh();
+
+	/**
+	 * Gets the cached ids.
+	 */
+	std::vector<int> ids() const;
+
+	/**
+	 * Gets the version of the list, incremented at each change. 0 means that the list was never received.
+	 */
+	uint64_t version() const;
+
+private:
+	void run();
+
+	ListFunction m_list;
+	Listener m_listener;
+	std::chrono::milliseconds m_period;
+	std::atomic<bool> m_running;
+	std::thread m_thread;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_refresh;
+	std::vector<int> m_ids;
+	uint64_t m_version;
+};
+
+}
+
+#endif
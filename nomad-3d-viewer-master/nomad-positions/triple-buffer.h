@@ -0,0 +1,71 @@
+#ifndef NOMAD_TRIPLEBUFFER_H
+#define NOMAD_TRIPLEBUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace nomad {
+
+/**
+ * Lock-free latest-value slot between one writer thread and one reader thread.
+ * The writer fills the back buffer and publishes it, the reader takes the newest published buffer.
+ * Neither side ever waits: intermediate values that the reader did not take are overwritten.
+ */
+template<typename Type>
+class TripleBuffer {
+
+public:
+	TripleBuffer() : m_middle(1), m_back(0), m_front(2) {}
+
+	/**
+	 * Gets the buffer that the writer fills. Only called by the writer.
+	 */
+	Type& back() {
+		return m_buffers[m_back];
+	}
+
+	/**
+	 * Publishes the back buffer. Only called by the writer.
+	 */
+	void publish() {
+		uint8_t previous = m_middle.exchange(m_back | DIRTY, std::memory_order_acq_rel);
+		m_back = previous & INDEX;
+	}
+
+	/**
+	 * Takes the newest published buffer if there is one. Only called by the reader.
+	 * Returns true if the front buffer changed.
+	 */
+	bool update() {
+		if ((m_middle.load(std::memory_order_relaxed) & DIRTY) == 0) {
+			return false;
+		}
+		uint8_t previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+		m_front = previous & INDEX;
+		return true;
+	}
+
+	/**
+	 * Gets the buffer that the reader owns. It stays unchanged until the next call to update().
+	 */
+	const Type& front() const {
+		return m_buffers[m_front];
+	}
+
+	Type& front() {
+		return m_buffers[m_front];
+	}
+
+private:
+	static const uint8_t INDEX = 0x3;
+	static const uint8_t DIRTY = 0x4;
+
+	Type m_buffers[3];
+	std::atomic<uint8_t> m_middle;
+	uint8_t m_back;
+	uint8_t m_front;
+};
+
+}
+
+#endif